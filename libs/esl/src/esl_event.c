@@ -886,6 +886,83 @@ ESL_DECLARE(esl_status_t) esl_event_serialize(esl_event_t *event, char **str, es
 	return ESL_SUCCESS;
 }
 
+static uint32_t esl_event_binary_get32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+/* see switch_event_binary_frame_send() for the layout */
+ESL_DECLARE(esl_status_t) esl_event_create_binary(esl_event_t **event, const char *data, esl_size_t len)
+{
+	const unsigned char *p = (const unsigned char *) data, *end = p + len;
+	esl_event_t *new_event;
+	uint32_t count, blen, i;
+
+	if (len < 16 || esl_event_binary_get32(p) != 0x46534231) {
+		return (esl_status_t) ESL_FALSE;
+	}
+
+	count = esl_event_binary_get32(p + 8);
+	blen = esl_event_binary_get32(p + 12);
+	p += 16;
+
+	if (esl_event_create(&new_event, ESL_EVENT_CLONE) != ESL_SUCCESS) {
+		return (esl_status_t) ESL_FALSE;
+	}
+
+	for (i = 0; i < count; i++) {
+		uint32_t nlen, vlen;
+		const char *name, *value;
+
+		if ((esl_size_t) (end - p) < 8) {
+			goto fail;
+		}
+
+		nlen = esl_event_binary_get32(p);
+		vlen = esl_event_binary_get32(p + 4);
+		p += 8;
+
+		if (!nlen || !vlen || nlen > (esl_size_t) (end - p) || vlen > (esl_size_t) (end - p) - nlen) {
+			goto fail;
+		}
+
+		name = (const char *) p;
+		value = name + nlen;
+		p += nlen + vlen;
+
+		if (name[nlen - 1] != '\0' || value[vlen - 1] != '\0') {
+			goto fail;
+		}
+
+		if (!strcasecmp(name, "event-name")) {
+			esl_event_del_header(new_event, "event-name");
+			esl_name_event(value, &new_event->event_id);
+		}
+
+		if (!strncmp(value, "ARRAY::", 7)) {
+			esl_event_add_array(new_event, name, value);
+		} else {
+			esl_event_add_header_string(new_event, ESL_STACK_BOTTOM, name, value);
+		}
+	}
+
+	if (blen) {
+		if (blen > (esl_size_t) (end - p) || p[blen - 1] != '\0') {
+			goto fail;
+		}
+
+		new_event->body = strdup((const char *) p);
+	}
+
+	*event = new_event;
+	return ESL_SUCCESS;
+
+ fail:
+
+	esl_event_destroy(&new_event);
+	return (esl_status_t) ESL_FALSE;
+}
+
 ESL_DECLARE(esl_status_t) esl_event_create_json(esl_event_t **event, const char *json)
 {
 	esl_event_t *new_event;
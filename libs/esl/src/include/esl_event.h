@@ -301,6 +301,14 @@ ESL_DECLARE(esl_status_t) esl_name_event(const char *name, esl_event_types_t *ty
 ESL_DECLARE(esl_status_t) esl_event_serialize(esl_event_t *event, char **str, esl_bool_t encode);
 ESL_DECLARE(esl_status_t) esl_event_serialize_json(esl_event_t *event, char **str);
 ESL_DECLARE(esl_status_t) esl_event_create_json(esl_event_t **event, const char *json);
+/*!
+  \brief Create an event from the length prefixed binary format sent by "event binary"
+  \param event a pointer to point at the new event
+  \param data the frame
+  \param len the length of the frame
+  \return ESL_SUCCESS if the frame was valid
+*/
+ESL_DECLARE(esl_status_t) esl_event_create_binary(esl_event_t **event, const char *data, esl_size_t len);
 /*!
   \brief Add a body to an event
   \param event the event to add to body to
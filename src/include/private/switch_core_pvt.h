@@ -154,6 +154,7 @@ struct switch_core_session {
 	switch_queue_t *private_event_queue_pri;
 	switch_thread_rwlock_t *bug_rwlock;
 	switch_media_bug_t *bugs;
+	struct switch_media_bug_tap *bug_tap;
 	switch_app_log_t *app_log;
 	uint32_t stack_count;
 
@@ -186,6 +187,10 @@ struct switch_core_session {
 	uint32_t soft_lock;
 	switch_ivr_dmachine_t *dmachine[2];
 	plc_state_t *plc;
+	/* decoded audio of a frame read ahead by the jitter buffer, waiting for the next one */
+	int16_t *stretch_buf;
+	uint32_t stretch_len;
+	switch_frame_t stretch_frame;
 
 	switch_media_handle_t *media_handle;
 	uint32_t decoder_errors;
@@ -201,6 +206,26 @@ struct switch_core_session {
 	switch_mutex_t *text_mutex;
 };
 
+/* one copy of each leg's audio shared by every bug on the session, see switch_core_media_bug.c */
+typedef struct switch_media_bug_tap {
+	switch_mutex_t *mutex;
+	uint8_t *ring[2];
+	uint32_t size;
+	int grow;
+	uint64_t head[2];
+	uint64_t start[2];
+	uint64_t floor[2];
+	/* the last mix handed out, a bug reading the same span gets a copy of it */
+	uint64_t mix_pos[2];
+	switch_size_t mix_len[2];
+	switch_size_t mix_bytes;
+	uint32_t mix_flags;
+	uint32_t mix_out;
+	uint64_t mixes;
+	uint64_t mix_hits;
+	int16_t mix[SWITCH_RECOMMENDED_BUFFER_SIZE];
+} switch_media_bug_tap_t;
+
 struct switch_media_bug {
 	switch_buffer_t *raw_write_buffer;
 	switch_buffer_t *raw_read_buffer;
@@ -242,6 +267,26 @@ struct switch_media_bug {
 	char *text_framedata;
 	uint32_t text_framesize;
 	switch_mm_t mm;
+
+	/* read position and end of this bug's audio in the session tap when it has no raw buffer of its own */
+	switch_media_bug_tap_t *tap;
+	uint64_t tap_pos[2];
+	uint64_t tap_end[2];
+
+	/* SMBF_ASYNC: events waiting for the worker pool */
+	switch_mutex_t *async_mutex;
+	struct media_bug_async_event *async_ring;
+	uint8_t *async_data;
+	uint32_t async_slot_bytes;
+	uint32_t async_depth;
+	uint32_t async_head;
+	uint32_t async_count;
+	switch_media_bug_async_policy_t async_policy;
+	uint8_t async_scheduled;
+	uint8_t async_running;
+	switch_media_bug_async_stats_t async_stats;
+	switch_time_t async_latency_total;
+	switch_time_t async_run_total;
 	struct switch_media_bug *next;
 };
 
@@ -295,6 +340,12 @@ struct switch_runtime {
 	uint32_t cpu_idle_smoothing_depth;
 	uint32_t microseconds_per_tick;
 	int32_t timer_affinity;
+	int32_t record_writer_threads;
+	int32_t media_bug_threads;
+	switch_size_t file_cache_size;
+	switch_bool_t file_cache_mmap;
+	uint32_t regex_cache_size;
+	switch_bool_t regex_jit;
 	switch_profile_timer_t *profile_timer;
 	double profile_time;
 	double min_idle_time;
@@ -315,6 +366,8 @@ struct switch_runtime {
 	uint32_t port_alloc_flags;
 	char *event_channel_key_separator;
 	uint32_t max_audio_channels;
+	int channel_index;
+	int channel_index_sql;
 };
 
 extern struct switch_runtime runtime;
@@ -341,8 +394,13 @@ switch_status_t switch_core_sqldb_init(const char **err);
 void switch_core_sqldb_destroy();
 switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_t manage);
 void switch_core_sqldb_stop(void);
+void switch_core_channel_index_stop(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
+switch_status_t switch_core_media_bug_async_push(switch_media_bug_t *bug, switch_abc_type_t type, switch_frame_t *frame);
+void switch_core_media_bug_tap_write(switch_core_session_t *session, switch_rw_t rw, const void *data, uint32_t datalen);
+void switch_core_media_bug_tap_take(switch_media_bug_t *bug, switch_rw_t rw);
+void switch_core_media_bug_tap_destroy(switch_core_session_t *session);
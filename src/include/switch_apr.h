@@ -1164,6 +1164,23 @@ SWITCH_DECLARE(switch_status_t) switch_sockaddr_create(switch_sockaddr_t **sa, s
  */
 SWITCH_DECLARE(switch_status_t) switch_socket_send(switch_socket_t *sock, const char *buf, switch_size_t *len);
 
+/** One buffer of a gathered write */
+typedef struct switch_io_vec {
+	const void *base;
+	switch_size_t len;
+} switch_io_vec_t;
+
+/**
+ * Send several buffers over a network with as few system calls as possible.
+ * @param sock The socket to send the data over.
+ * @param vec The buffers to send, in order.
+ * @param nvec The number of buffers in vec.
+ * @param len On exit, the number of bytes sent.
+ * @remark Blocks like switch_socket_send() until everything is sent or the
+ *         socket fails, vec is left untouched.
+ */
+SWITCH_DECLARE(switch_status_t) switch_socket_sendv(switch_socket_t *sock, const switch_io_vec_t *vec, int32_t nvec, switch_size_t *len);
+
 /**
  * @param sock The socket to send from
  * @param where The apr_sockaddr_t describing where to send the data
@@ -1186,6 +1203,14 @@ SWITCH_DECLARE(switch_status_t) switch_socket_send_nonblock(switch_socket_t *soc
  */
 SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom(switch_sockaddr_t *from, switch_socket_t *sock, int32_t flags, char *buf, size_t *len);
 
+/**
+ * Fill in an apr_sockaddr_t from a raw sockaddr, as returned by recvmsg() and friends
+ * @param sa The apr_sockaddr_t to fill in
+ * @param raw The struct sockaddr_in or sockaddr_in6 to copy
+ * @param len The length of raw
+ */
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_raw(switch_sockaddr_t *sa, const void *raw, size_t len);
+
 SWITCH_DECLARE(switch_status_t) switch_socket_atmark(switch_socket_t *sock, int *atmark);
 
 /**
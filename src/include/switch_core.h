@@ -437,6 +437,60 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_flush_all(_In_ switch_core
 
 SWITCH_DECLARE(switch_status_t) switch_core_media_bug_set_pre_buffer_framecount(switch_media_bug_t *bug, uint32_t framecount);
 
+typedef struct {
+	switch_media_bug_async_policy_t policy;
+	uint32_t depth;
+	uint32_t queued_now;
+	uint32_t max_queued;
+	uint64_t queued;
+	uint64_t processed;
+	uint64_t dropped;
+	uint64_t blocked;
+	uint32_t avg_latency_us;
+	uint32_t max_latency_us;
+	uint32_t avg_run_us;
+	uint32_t max_run_us;
+} switch_media_bug_async_stats_t;
+
+typedef struct {
+	uint32_t threads;
+	uint32_t bugs;
+	uint32_t backlog;
+	uint64_t processed;
+	uint64_t dropped;
+} switch_media_bug_pool_stats_t;
+
+/*!
+  \brief Change how an SMBF_ASYNC bug handles a full queue
+  \param bug the bug
+  \param policy drop the new frame, drop the oldest frame or block the media thread
+  \param depth the number of frames the bug may queue, 0 keeps the current depth
+  \return SWITCH_STATUS_SUCCESS, SWITCH_STATUS_FALSE if the bug does not run on the worker pool
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_set_async_policy(switch_media_bug_t *bug, switch_media_bug_async_policy_t policy, uint32_t depth);
+
+/*!
+  \brief Read the queue and latency counters of an SMBF_ASYNC bug
+  \param bug the bug
+  \param stats the counters
+  \return SWITCH_STATUS_SUCCESS, SWITCH_STATUS_FALSE if the bug does not run on the worker pool
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_get_async_stats(switch_media_bug_t *bug, switch_media_bug_async_stats_t *stats);
+
+/*!
+  \brief Start the threads SMBF_ASYNC media bugs run their callbacks on
+  \param threads the number of threads, 0 for one per 4 cpus
+  \return SWITCH_STATUS_SUCCESS if the pool started
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_pool_start(uint32_t threads);
+
+/*!
+  \brief Stop the media bug worker pool, bugs still open fall back to running inline
+*/
+SWITCH_DECLARE(void) switch_core_media_bug_pool_stop(void);
+
+SWITCH_DECLARE(void) switch_core_media_bug_pool_stats(switch_media_bug_pool_stats_t *stats);
+
 ///\}
 
 ///\defgroup pa1 Port Allocation
@@ -1985,6 +2039,48 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 SWITCH_DECLARE(switch_status_t) switch_core_file_truncate(switch_file_handle_t *fh, int64_t offset);
 SWITCH_DECLARE(switch_bool_t) switch_core_file_has_video(switch_file_handle_t *fh, switch_bool_t CHECK_OPEN);
 
+typedef struct {
+	/*! the most decoded audio kept, 0 when the cache is off */
+	switch_size_t max_bytes;
+	/*! decoded audio kept now */
+	switch_size_t bytes;
+	/*! files in the cache */
+	uint32_t entries;
+	/*! opens served from the cache */
+	uint64_t hits;
+	/*! opens that went to the format module */
+	uint64_t misses;
+	/*! files dropped to stay under max_bytes */
+	uint64_t evictions;
+} switch_file_cache_stats_t;
+
+/*!
+  \brief Start the cache of decoded files, it stays off until it is given a size
+  \param pool the pool for the cache lock
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_init(switch_memory_pool_t *pool);
+
+/*!
+  \brief Size the cache of decoded files
+  \param max_bytes the most decoded audio to keep (0 turns the cache off for new opens)
+  \param use_mmap keep the audio in unlinked temp files mapped into memory instead of the heap
+  \note only local files read as shorts are cached, keyed by path, rate, channels and module
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_set_size(switch_size_t max_bytes, switch_bool_t use_mmap);
+
+/*!
+  \brief Drop every cached file, handles still playing one keep it until they close
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_flush(void);
+
+/*!
+  \brief Read the decoded file cache counters
+  \param stats the counters to fill in
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_stats(switch_file_cache_stats_t *stats);
+
+SWITCH_DECLARE(void) switch_core_file_cache_shutdown(void);
+
 
 ///\}
 
@@ -2456,10 +2552,17 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_token(const char *ip_
 #define switch_check_network_list_ip(_ip_str, _list_name) switch_check_network_list_ip_token(_ip_str, _list_name, NULL)
 SWITCH_DECLARE(void) switch_time_set_monotonic(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_timerfd(int enable);
+SWITCH_DECLARE(int) switch_time_get_timerfd(void);
 SWITCH_DECLARE(void) switch_time_set_nanosleep(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_matrix(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_cond_yield(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_use_system_time(switch_bool_t enable);
+/*!
+ \brief Report the wake latency histogram of the "wheel" timer, one row per bucket (latency, wakeups, percent)
+ \param callback called for each row, return non zero to stop
+ \param pArg user data for the callback
+*/
+SWITCH_DECLARE(void) switch_time_wheel_stats(switch_core_db_callback_func_t callback, void *pArg);
 SWITCH_DECLARE(uint32_t) switch_core_min_dtmf_duration(uint32_t duration);
 SWITCH_DECLARE(uint32_t) switch_core_max_dtmf_duration(uint32_t duration);
 SWITCH_DECLARE(double) switch_core_min_idle_cpu(double new_limit);
@@ -2480,6 +2583,46 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_preprocess_session(switch_core_sessio
 SWITCH_DECLARE(void) switch_core_sqldb_pause(void);
 SWITCH_DECLARE(void) switch_core_sqldb_resume(void);
 
+typedef enum {
+	SCI_VIEW_CHANNELS,
+	SCI_VIEW_BASIC_CALLS,
+	SCI_VIEW_DETAILED_CALLS
+} switch_channel_index_view_t;
+
+typedef enum {
+	SCIF_NONE = 0,
+	/* only calls that have a b leg, like "where b_uuid is not null" */
+	SCIF_BRIDGED = (1 << 0),
+	/* one row with the number of matches instead of the matches */
+	SCIF_COUNT = (1 << 1),
+	/* order by call_created_epoch instead of created_epoch */
+	SCIF_ORDER_BY_CALL = (1 << 2)
+} switch_channel_index_flag_t;
+
+/*!
+ \brief Check if the in-memory channel index (switch.conf channel-index) is maintained
+ \return SWITCH_TRUE when switch_core_channel_index_query() can be used
+*/
+SWITCH_DECLARE(switch_bool_t) switch_core_channel_index_enabled(void);
+
+/*!
+ \brief Start or stop maintaining the in-memory channel index at runtime, like switch.conf channel-index
+ \param enable SWITCH_TRUE to start it, SWITCH_FALSE to stop it and drop its rows
+*/
+SWITCH_DECLARE(void) switch_core_channel_index_enable(switch_bool_t enable);
+
+/*!
+ \brief Read the in-memory channel index with the same columns as the channels table or the basic_calls/detailed_calls views
+ \param view which table or view to reproduce
+ \param like optional SQL LIKE pattern matched against uuid, name, cid_name, cid_num, presence_data and accountcode
+ \param flags switch_channel_index_flag_t
+ \param callback called for each row, return non zero to stop
+ \param pArg user data for the callback
+ \return the number of matching rows
+*/
+SWITCH_DECLARE(uint32_t) switch_core_channel_index_query(switch_channel_index_view_t view, const char *like, switch_channel_index_flag_t flags,
+														 switch_core_db_callback_func_t callback, void *pArg);
+
 
 ///\}
 
@@ -2657,6 +2800,42 @@ SWITCH_DECLARE(int) switch_cache_db_affected_rows(switch_cache_db_handle_t *dbh)
 */
 SWITCH_DECLARE(int) switch_cache_db_load_extension(switch_cache_db_handle_t *dbh, const char *extension);
 
+typedef struct switch_cache_db_stmt switch_cache_db_stmt_t;
+
+/*!
+ \brief Looks up a prepared statement in the per handle statement cache, preparing it on a miss
+ \param [in] dbh The handle
+ \param [in] sql - sql to prepare, parameters are marked with ?
+ \param [out] stmtp - the statement, owned by the handle and valid until the handle is released
+ \param [out] err - Error if it exists
+ \note the cache is LRU ordered, a statement is never evicted between prepare and step
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_prepare(switch_cache_db_handle_t *dbh, const char *sql, switch_cache_db_stmt_t **stmtp, char **err);
+
+/*!
+ \brief Binds a text value to a parameter of a prepared statement
+ \param [in] stmt The statement
+ \param [in] index - the parameter, starting at 1
+ \param [in] value - the value, NULL binds SQL NULL
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_bind(switch_cache_db_stmt_t *stmt, int index, const char *value);
+
+/*!
+ \brief Binds an integer value to a parameter of a prepared statement
+ \param [in] stmt The statement
+ \param [in] index - the parameter, starting at 1
+ \param [in] value - the value
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_bind_int64(switch_cache_db_stmt_t *stmt, int index, int64_t value);
+
+/*!
+ \brief Executes a prepared statement and clears its bindings for the next use
+ \param [in] stmt The statement
+ \param [out] err - Error if it exists
+ \note rows returned by the statement are discarded
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_step(switch_cache_db_stmt_t *stmt, char **err);
+
 /*!
  \brief Provides some feedback as to the status of the db connection pool
  \param [in] stream stream for status
@@ -2775,6 +2954,16 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+ \brief Queues a statement with ? parameter markers, the queue thread runs it through the handle's prepared statement cache
+ \param [in] qm The queue manager
+ \param [in] sql - sql with ? parameter markers
+ \param [in] pos - the queue to use
+ \param [in] argc - number of parameters
+ \param [in] argv - parameter values, copied, a NULL value binds SQL NULL
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_prepared(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos,
+																	   int argc, const char * const *argv);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp,
@@ -261,6 +261,14 @@ SWITCH_DECLARE(int) switch_core_db_finalize(switch_core_db_stmt_t *pStmt);
  */
 SWITCH_DECLARE(int) switch_core_db_prepare(switch_core_db_t *db, const char *zSql, int nBytes, switch_core_db_stmt_t **ppStmt, const char **pzTail);
 
+/**
+ * Same as switch_core_db_prepare() but the statement keeps a copy of its SQL, so
+ * switch_core_db_step() recompiles it on its own after a schema change instead of
+ * failing with SWITCH_CORE_DB_SCHEMA.  Use it for statements that are kept around
+ * and executed more than once.
+ */
+SWITCH_DECLARE(int) switch_core_db_prepare_v2(switch_core_db_t *db, const char *zSql, int nBytes, switch_core_db_stmt_t **ppStmt, const char **pzTail);
+
 /**
  * After an SQL query has been compiled with a call to either
  * switch_core_db_prepare(), then this function must be
@@ -348,6 +356,12 @@ SWITCH_DECLARE(int) switch_core_db_bind_int(switch_core_db_stmt_t *pStmt, int i,
  */
 SWITCH_DECLARE(int) switch_core_db_bind_int64(switch_core_db_stmt_t *pStmt, int i, int64_t iValue);
 
+/**
+ * Binds SQL NULL to a parameter.  Bindings survive switch_core_db_reset(), so a
+ * parameter that is NULL this time around must be bound explicitly.
+ */
+SWITCH_DECLARE(int) switch_core_db_bind_null(switch_core_db_stmt_t *pStmt, int i);
+
 /**
  * In the SQL strings input to switch_core_db_prepare(),
  * one or more literals can be replace by parameters "?" or ":AAA" or
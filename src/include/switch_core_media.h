@@ -93,6 +93,7 @@ typedef enum {
 typedef struct switch_core_media_params_s {
 	uint32_t rtp_timeout_sec;
 	uint32_t rtp_hold_timeout_sec;
+	uint32_t rtp_shared_ports;
 	uint32_t dtmf_delay;
 	uint32_t codec_flags;
 
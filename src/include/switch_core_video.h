@@ -407,6 +407,17 @@ SWITCH_DECLARE(switch_status_t) switch_img_data_url_png(switch_image_t *img, cha
 */
 SWITCH_DECLARE(void) switch_img_overlay(switch_image_t *IMG, switch_image_t *img, int x, int y, uint8_t percent);
 
+/*!\brief Name of the compositing kernel used by patch, overlay, fill_noalpha and chromakey (avx2, sse4.1 or scalar)
+*/
+SWITCH_DECLARE(const char *) switch_img_kernel_name(void);
+
+/*!\brief Force a compositing kernel, meant for tests and benchmarks
+*
+* \param[in]    name      avx2, sse4.1, scalar, or NULL/auto for the best one this cpu supports
+* \return SWITCH_STATUS_FALSE if the cpu or build does not support the kernel
+*/
+SWITCH_DECLARE(switch_status_t) switch_img_set_kernel(const char *name);
+
 SWITCH_DECLARE(switch_status_t) switch_img_mirror(switch_image_t *src, switch_image_t **destP);
 SWITCH_DECLARE(switch_status_t) switch_img_scale(switch_image_t *src, switch_image_t **destP, int width, int height);
 SWITCH_DECLARE(switch_status_t) switch_img_fit(switch_image_t **srcP, int width, int height, switch_img_fit_t fit);
@@ -100,6 +100,8 @@ struct switch_event {
 	unsigned long key;
 	struct switch_event *next;
 	int flags;
+	/*! storage for the headers and the header name index (private to switch_event.c) */
+	struct switch_event_arena *arena;
 };
 
 typedef struct switch_serial_event_s {
@@ -268,6 +270,22 @@ SWITCH_DECLARE(switch_status_t) switch_event_get_custom_events(switch_console_ca
 */
 SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, switch_event_types_t event, const char *subclass_name,
 															switch_event_callback_t callback, void *user_data, switch_event_node_t **node);
+
+/*!
+  \brief Bind an event callback to a specific event with binding flags
+  \param id an identifier token of the binder
+  \param event the event enumeration to bind to
+  \param subclass_name the event subclass to bind to in the case if SWITCH_EVENT_CUSTOM
+  \param callback the callback functon to bind
+  \param user_data optional user specific data to pass whenever the callback is invoked
+  \param flags SEBF_READ_ONLY if the callback never changes the event it is handed
+  \param node optional bind handle to later remove the binding.
+  \return SWITCH_STATUS_SUCCESS if the event was binded
+  \note a SEBF_READ_ONLY callback may get the same event other subscribers are reading, without it the callback owns its event
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_bind_removable_flags(const char *id, switch_event_types_t event, const char *subclass_name,
+																  switch_event_callback_t callback, void *user_data, switch_event_bind_flag_t flags,
+																  switch_event_node_t **node);
 /*!
   \brief Unbind a bound event consumer
   \param node node to unbind
@@ -276,6 +294,14 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node);
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback);
 
+/*!
+  \brief Report the dispatch queue of every event binding
+  \param callback called once per binding with the columns id, event, subclass, backlog, max_backlog, delivered and dropped,
+  a non zero return stops the walk
+  \param pArg user data for the callback
+*/
+SWITCH_DECLARE(void) switch_event_subscriber_stats(switch_core_db_callback_func_t callback, void *pArg);
+
 /*!
   \brief Render the name of an event id enumeration
   \param event the event id to render the name of
@@ -314,6 +340,44 @@ SWITCH_DECLARE(switch_status_t) switch_event_free_subclass_detailed(const char *
 SWITCH_DECLARE(switch_status_t) switch_event_binary_deserialize(switch_event_t **eventp, void **data, switch_size_t len, switch_bool_t duplicate);
 SWITCH_DECLARE(switch_status_t) switch_event_binary_serialize(switch_event_t *event, void **data, switch_size_t *len);
 SWITCH_DECLARE(switch_status_t) switch_event_serialize(switch_event_t *event, char **str, switch_bool_t encode);
+
+/*!
+  \brief Compute the size of the length prefixed binary representation of an event
+  \param event the event
+  \return the number of bytes switch_event_binary_frame_send or switch_event_binary_frame_render will produce
+*/
+SWITCH_DECLARE(switch_size_t) switch_event_binary_frame_size(switch_event_t *event);
+
+/*!
+  \brief Write the binary representation of an event to a socket with one gathered write
+  \param sock the socket
+  \param event the event to send
+  \param prefix optional bytes to send ahead of the frame (eg. the content headers of the transport)
+  \param prefix_len the length of prefix
+  \return SWITCH_STATUS_SUCCESS if everything was sent
+  \note header names and values are written straight from the event, nothing is encoded or copied
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_send(switch_socket_t *sock, switch_event_t *event, const char *prefix, switch_size_t prefix_len);
+
+/*!
+  \brief Render the binary representation of an event into a buffer
+  \param event the event to render
+  \param data a pointer to point at the allocated data
+  \param len the length of the data
+  \return SWITCH_STATUS_SUCCESS if the operation was successful
+  \note you must free the resulting buffer when you are finished with it
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_render(switch_event_t *event, char **data, switch_size_t *len);
+
+/*!
+  \brief Create an event from its binary representation
+  \param eventp a pointer to point at the new event
+  \param data the frame
+  \param len the length of the frame
+  \return SWITCH_STATUS_SUCCESS if the frame was valid
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_parse(switch_event_t **eventp, const char *data, switch_size_t len);
+
 SWITCH_DECLARE(switch_status_t) switch_event_serialize_json(switch_event_t *event, char **str);
 SWITCH_DECLARE(switch_status_t) switch_event_serialize_json_obj(switch_event_t *event, cJSON **json);
 SWITCH_DECLARE(switch_status_t) switch_event_create_json(switch_event_t **event, const char *json);
@@ -296,6 +296,43 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_session(switch_core_session_t
 SWITCH_DECLARE(switch_status_t) switch_ivr_record_session_event(switch_core_session_t *session, const char *file, uint32_t limit, switch_file_handle_t *fh, switch_event_t *variables);
 SWITCH_DECLARE(switch_status_t) switch_ivr_transfer_recordings(switch_core_session_t *orig_session, switch_core_session_t *new_session);
 
+typedef struct {
+	/*! running writer threads */
+	uint32_t threads;
+	/*! recordings handing their audio to the writers */
+	uint32_t recordings;
+	/*! recordings waiting for a writer */
+	uint32_t queue_depth;
+	/*! file writes done by the writers */
+	uint64_t writes;
+	/*! bytes of audio written */
+	uint64_t bytes;
+	/*! failed file writes */
+	uint32_t errors;
+	/*! time from queueing a recording until its audio is written, in us */
+	uint32_t avg_latency_us;
+	uint32_t max_latency_us;
+} switch_ivr_record_writer_stats_t;
+
+/*!
+  \brief Start the threads that write session recordings to disk for every recording
+  \param threads the number of writer threads (0 for one per 4 cpus, at least 2)
+  \return SWITCH_STATUS_SUCCESS if the writers are running
+  \note without them each recording gets its own writer thread, or writes from the media bug when RECORD_USE_THREAD is false
+*/
+SWITCH_DECLARE(switch_status_t) switch_ivr_record_writer_start(uint32_t threads);
+
+/*!
+  \brief Stop the recording writer threads, recordings still open flush what is left when they close
+*/
+SWITCH_DECLARE(void) switch_ivr_record_writer_stop(void);
+
+/*!
+  \brief Read the recording writer counters
+  \param stats the counters to fill in
+*/
+SWITCH_DECLARE(void) switch_ivr_record_writer_stats(switch_ivr_record_writer_stats_t *stats);
+
 
 SWITCH_DECLARE(switch_status_t) switch_ivr_eavesdrop_pop_eavesdropper(switch_core_session_t *session, switch_core_session_t **sessionp);
 SWITCH_DECLARE(switch_status_t) switch_ivr_eavesdrop_exec_all(switch_core_session_t *session, const char *app, const char *arg);
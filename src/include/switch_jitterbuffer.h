@@ -34,7 +34,8 @@
 #define SWITCH_VIDDERBUFFER_H
 
 typedef enum {
-	SJB_QUEUE_ONLY = (1 << 0)
+	SJB_QUEUE_ONLY = (1 << 0),
+	SJB_ADAPTIVE = (1 << 1)
 } switch_jb_flag_t;
 
 typedef enum {
@@ -57,6 +58,7 @@ SWITCH_DECLARE(int) switch_jb_frame_count(switch_jb_t *jb);
 SWITCH_DECLARE(int) switch_jb_poll(switch_jb_t *jb);
 SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t len);
 SWITCH_DECLARE(switch_size_t) switch_jb_get_last_read_len(switch_jb_t *jb);
+SWITCH_DECLARE(switch_bool_t) switch_jb_last_read_accelerated(switch_jb_t *jb);
 SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t *len);
 SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb);
 SWITCH_DECLARE(switch_status_t) switch_jb_get_packet_by_seq(switch_jb_t *jb, uint16_t seq, switch_rtp_packet_t *packet, switch_size_t *len);
@@ -66,6 +68,8 @@ SWITCH_DECLARE(void) switch_jb_set_flag(switch_jb_t *jb, switch_jb_flag_t flag);
 SWITCH_DECLARE(void) switch_jb_clear_flag(switch_jb_t *jb, switch_jb_flag_t flag);
 SWITCH_DECLARE(uint32_t) switch_jb_get_nack_success(switch_jb_t *jb);
 SWITCH_DECLARE(uint32_t) switch_jb_get_packets_per_frame(switch_jb_t *jb);
+SWITCH_DECLARE(void) switch_jb_set_adaptive(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second);
+SWITCH_DECLARE(void) switch_jb_get_delay_stats(switch_jb_t *jb, uint32_t *target_ms, uint32_t *delay_ms, uint32_t *accelerate_count, uint32_t *expand_count);
 
 SWITCH_END_EXTERN_C
 #endif
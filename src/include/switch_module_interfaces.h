@@ -383,6 +383,8 @@ struct switch_file_handle {
 	int64_t vpos;
 	void *muxbuf;
 	switch_size_t muxlen;
+	/*! decoded audio from the file cache, read instead of the module when set */
+	void *cache;
 };
 
 /*! \brief Abstract interface to an asr module */
@@ -633,6 +635,10 @@ struct switch_database_interface {
 	switch_status_t(*callback_exec_detailed)(const char *file, const char *func, int line,
 		switch_database_interface_handle_t *dih, const char *sql, switch_core_db_callback_func_t callback, void *pdata, char **err);
 	switch_status_t(*affected_rows)(switch_database_interface_handle_t *dih, int *affected_rows);
+	/*! optional, prepare a statement with ? parameter markers, the core expands the parameters into the sql text when missing */
+	switch_status_t(*prepare)(switch_database_interface_handle_t *dih, const char *sql, void **stmt, char **err);
+	switch_status_t(*exec_prepared)(switch_database_interface_handle_t *dih, void *stmt, int argc, const char * const *argv, char **err);
+	switch_status_t(*finalize)(switch_database_interface_handle_t *dih, void **stmt);
 
 	/*! list of supported dsn prefixes */
 	char **prefixes;
@@ -38,6 +38,7 @@
 
 SWITCH_BEGIN_EXTERN_C struct switch_odbc_handle;
 typedef void *switch_odbc_statement_handle_t;
+typedef struct switch_odbc_prepared switch_odbc_prepared_t;
 
 typedef enum {
 	SWITCH_ODBC_STATE_INIT,
@@ -98,6 +99,28 @@ SWITCH_DECLARE(char *) switch_odbc_handle_get_error(switch_odbc_handle_t *handle
 
 SWITCH_DECLARE(int) switch_odbc_handle_affected_rows(switch_odbc_handle_t *handle);
 
+/*!
+  \brief Prepare a statement with ? parameter markers for repeated execution
+  \param handle the ODBC handle
+  \param sql the sql string to prepare
+  \param preparedp the prepared statement
+  \param err error message if it exists
+  \return SWITCH_ODBC_SUCCESS if the statement was prepared
+*/
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_prepared_new(switch_odbc_handle_t *handle, const char *sql, switch_odbc_prepared_t **preparedp, char **err);
+
+/*!
+  \brief Execute a prepared statement, binding every parameter as text
+  \param prepared the prepared statement
+  \param argc the number of parameters
+  \param argv the parameter values, a NULL value binds SQL NULL
+  \param err error message if it exists
+  \return SWITCH_ODBC_SUCCESS if the statement was executed
+  \note the statement is prepared again transparently when the connection was re-established
+*/
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_prepared_exec(switch_odbc_prepared_t *prepared, int argc, const char * const *argv, char **err);
+SWITCH_DECLARE(void) switch_odbc_prepared_destroy(switch_odbc_prepared_t **preparedp);
+
 SWITCH_END_EXTERN_C
 #endif
 /* For Emacs:
@@ -81,6 +81,50 @@ SWITCH_DECLARE_NONSTD(void) switch_regex_set_event_header_callback(const char *v
 				re = NULL;\
 			}
 
+#define SWITCH_REGEX_CACHE_DEFAULT_SIZE 4096
+
+typedef struct {
+	/*! the most patterns kept, 0 when the cache is off */
+	uint32_t max_entries;
+	/*! patterns in the cache */
+	uint32_t entries;
+	/*! patterns are jit compiled */
+	switch_bool_t jit;
+	/*! lookups served from the cache */
+	uint64_t hits;
+	/*! lookups that had to compile the pattern */
+	uint64_t misses;
+	/*! patterns dropped to stay under max_entries */
+	uint64_t evictions;
+} switch_regex_cache_stats_t;
+
+/*!
+  \brief Start the cache of compiled patterns used by switch_regex_perform and switch_regex_match_partial
+  \param pool the pool for the cache lock
+*/
+SWITCH_DECLARE(void) switch_regex_cache_init(switch_memory_pool_t *pool);
+
+/*!
+  \brief Size the cache of compiled patterns
+  \param max_entries the most patterns to keep (0 compiles every expression again like before)
+  \param jit jit compile new patterns when pcre was built with jit support
+  \note patterns are keyed by the expression and its compile flags, a handle from switch_regex_perform keeps its pattern alive until switch_regex_free
+*/
+SWITCH_DECLARE(void) switch_regex_cache_set_size(uint32_t max_entries, switch_bool_t jit);
+
+/*!
+  \brief Drop every cached pattern, handles still held keep theirs until they are freed
+*/
+SWITCH_DECLARE(void) switch_regex_cache_flush(void);
+
+/*!
+  \brief Read the compiled pattern cache counters
+  \param stats the counters to fill in
+*/
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats);
+
+SWITCH_DECLARE(void) switch_regex_cache_shutdown(void);
+
 
 /** @} */
 
@@ -52,7 +52,7 @@ SWITCH_BEGIN_EXTERN_C
   \{
 */
 /*! \brief An audio resampling handle */
-	typedef struct {
+	typedef struct switch_audio_resampler_s {
 	/*! a pointer to store the resampler object */
 	void *resampler;
 	/*! the rate to resample from in hz */
@@ -69,6 +69,12 @@ SWITCH_BEGIN_EXTERN_C
 	uint32_t to_size;
 	/*! the number of channels */
 	int channels;
+	/*! the built in polyphase filter used instead of speex for the common mono rates */
+	void *polyphase;
+	/*! the quality it was created with */
+	int quality;
+	/*! next idle handle in the resampler cache */
+	struct switch_audio_resampler_s *next;
 
 } switch_audio_resampler_t;
 
@@ -102,6 +108,31 @@ SWITCH_DECLARE(void) switch_resample_destroy(switch_audio_resampler_t **resample
  */
 SWITCH_DECLARE(uint32_t) switch_resample_process(switch_audio_resampler_t *resampler, int16_t *src, uint32_t srclen);
 
+/*!
+  \brief Start the cache destroyed resampler handles are kept in for the next create with the same rates
+  \param pool the pool for the cache lock
+ */
+SWITCH_DECLARE(void) switch_resample_cache_init(switch_memory_pool_t *pool);
+
+/*!
+  \brief Free every idle handle in the resampler cache and stop caching
+ */
+SWITCH_DECLARE(void) switch_resample_cache_shutdown(void);
+
+/*!
+  \brief Read the resampler cache counters
+  \param hits creates served from the cache
+  \param misses creates that had to build a new handle
+  \param idle handles waiting in the cache
+ */
+SWITCH_DECLARE(void) switch_resample_cache_stats(uint32_t *hits, uint32_t *misses, uint32_t *idle);
+
+/*!
+  \brief Choose between the built in polyphase filter and speex for mono 8k/16k/32k/48k conversions
+  \param enabled SWITCH_FALSE to always use speex for new handles
+ */
+SWITCH_DECLARE(void) switch_resample_set_polyphase(switch_bool_t enabled);
+
 
 /*!
   \brief Convert an array of floats to an array of shorts
@@ -175,6 +206,39 @@ SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16
 SWITCH_DECLARE(uint32_t) switch_unmerge_sln(int16_t *data, uint32_t samples, int16_t *other_data, uint32_t other_samples, int channels);
 SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, uint32_t orig_channels, uint32_t channels);
 
+/*!
+  \brief Add a signed linear frame into a 32 bit mix (vectorized when the cpu allows)
+  \param mix the 32 bit mix
+  \param data the audio data to add
+  \param samples the number of 2 byte samples
+ */
+SWITCH_DECLARE(void) switch_mix_sln_accumulate(int32_t *mix, const int16_t *data, uint32_t samples);
+
+/*!
+  \brief Saturate a 32 bit mix to signed linear, removing one contributor's own audio
+  \param out the 16 bit output
+  \param mix the 32 bit mix
+  \param self the contribution to remove from the mix or NULL
+  \param self_samples the number of samples in self
+  \param samples the number of 2 byte samples to write to out
+ */
+SWITCH_DECLARE(void) switch_mix_sln_subtract(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples);
+
+/*!
+  \brief Name of the mixing and resampling kernel selected for this cpu (avx2, sse2 or scalar)
+ */
+SWITCH_DECLARE(const char *) switch_mix_sln_kernel_name(void);
+
+/*!
+  \brief Shorten a mono signed linear buffer in place with one pitch aligned, cross faded cut
+  \param data the audio data
+  \param samples the number of 2 byte samples
+  \param max_remove the most samples to cut, the cut is at most one pitch period shorter
+  \param rate the sample rate
+  \return the number of samples left
+ */
+SWITCH_DECLARE(uint32_t) switch_accelerate_sln(int16_t *data, uint32_t samples, uint32_t max_remove, uint32_t rate);
+
 #define switch_resample_calc_buffer_size(_to, _from, _srclen) ((uint32_t)(((float)_to / (float)_from) * (float)_srclen) * 2)
 
 SWITCH_DECLARE(void) switch_agc_set(switch_agc_t *agc, uint32_t energy_avg, 
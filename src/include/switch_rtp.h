@@ -190,6 +190,35 @@ SWITCH_DECLARE(void) switch_rtp_get_random(void *buf, uint32_t len);
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool);
 SWITCH_DECLARE(void) switch_rtp_shutdown(void);
 
+/*!
+  \brief Start the batched RTP receive engine
+  \param threads the number of receive threads (0 for one per 8 cpus)
+  \return SWITCH_STATUS_SUCCESS if the engine is running, SWITCH_STATUS_NOTIMPL without recvmmsg/sendmmsg/epoll
+  \note only non blocking sessions whose local address is set while the engine runs are handed to it
+*/
+SWITCH_DECLARE(switch_status_t) switch_rtp_io_engine_start(uint32_t threads);
+
+/*!
+  \brief Stop the batched RTP receive engine, attached sessions go back to reading their own socket
+*/
+SWITCH_DECLARE(void) switch_rtp_io_engine_stop(void);
+
+/*!
+  \brief Request a port shared by many sessions, the io engine hands the packets to them by SSRC or remote address
+  \param ip the ip to bind
+  \param count how many shared ports to open on this ip before reusing them round robin
+  \return the port, 0 if the io engine is not running
+*/
+SWITCH_DECLARE(switch_port_t) switch_rtp_request_shared_port(const char *ip, uint32_t count);
+
+/*!
+  \brief Check if a port was handed out by switch_rtp_request_shared_port
+  \param ip the ip
+  \param port the port
+  \return SWITCH_TRUE if the port is shared
+*/
+SWITCH_DECLARE(switch_bool_t) switch_rtp_port_is_shared(const char *ip, switch_port_t port);
+
 /*!
   \brief Set/Get RTP start port
   \param port new value (if > 0)
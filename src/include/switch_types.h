@@ -690,6 +690,11 @@ typedef struct {
 	switch_size_t cng_packet_count;
 	switch_size_t flush_packet_count;
 	switch_size_t largest_jb_size;
+	/* Adaptive jitter buffer */
+	switch_size_t jb_target_delay;
+	switch_size_t jb_delay;
+	switch_size_t jb_accelerate_count;
+	switch_size_t jb_expand_count;
 	/* Jitter */
 	int64_t last_proc_time;
 	int64_t jitter_n;
@@ -1663,6 +1668,7 @@ SFF_RFC2833    = (1 <<  4) - Frame has rfc2833 dtmf data
 SFF_DYNAMIC    = (1 <<  5) - Frame is dynamic and should be freed
 SFF_MARKER     = (1 << 11) - Frame flag has Marker set, only set by encoder
 SFF_WAIT_KEY_FRAME = (1 << 12) - Need a key from before could decode, or force generate a key frame on encode
+SFF_JB_ACCELERATE = (1 << 21) - Frame was read ahead to shrink the jitter buffer, the next read will not wait
 </pre>
  */
 typedef enum {
@@ -1687,7 +1693,8 @@ typedef enum {
 	SFF_ENCODED = (1 << 17),
 	SFF_TEXT_LINE_BREAK = (1 << 18),
 	SFF_IS_KEYFRAME = (1 << 19),
-	SFF_EXTERNAL = (1 << 20)
+	SFF_EXTERNAL = (1 << 20),
+	SFF_JB_ACCELERATE = (1 << 21)
 } switch_frame_flag_enum_t;
 typedef uint32_t switch_frame_flag_t;
 
@@ -1867,6 +1874,7 @@ SMBF_THREAD_LOCK - Only let the same thread who created the bug remove it.
 SMBF_PRUNE -
 SMBF_NO_PAUSE -
 SMBF_STEREO_SWAP - Record in stereo: Write Stream - left channel, Read Stream - right channel
+SMBF_ASYNC - Run the audio callbacks on the media bug worker pool instead of the media thread
 </pre>
 */
 typedef enum {
@@ -1897,10 +1905,26 @@ typedef enum {
 	SMBF_SPY_VIDEO_STREAM_BLEG = (1 << 23),
 	SMBF_READ_VIDEO_PATCH = (1 << 24),
 	SMBF_READ_TEXT_STREAM = (1 << 25),
-	SMBF_FIRST = (1 << 26)
+	SMBF_FIRST = (1 << 26),
+	SMBF_ASYNC = (1 << 27)
 } switch_media_bug_flag_enum_t;
 typedef uint32_t switch_media_bug_flag_t;
 
+/*!
+  \enum switch_media_bug_async_policy_t
+  \brief What an SMBF_ASYNC bug does with a frame when its queue is full
+<pre>
+SMBA_DROP - Drop the new frame
+SMBA_DROP_OLDEST - Drop the oldest queued frame to make room
+SMBA_BLOCK - Hold the media thread until there is room, dropping the frame after 100ms
+</pre>
+*/
+typedef enum {
+	SMBA_DROP = 0,
+	SMBA_DROP_OLDEST,
+	SMBA_BLOCK
+} switch_media_bug_async_policy_t;
+
 /*!
   \enum switch_file_flag_t
   \brief File flags
@@ -2151,6 +2175,13 @@ typedef enum {
 	SWITCH_EVENT_ALL
 } switch_event_types_t;
 
+typedef enum {
+	SEBF_NONE = 0,
+	/*! the callback never changes the event, it may be handed the copy other subscribers are reading */
+	SEBF_READ_ONLY = (1 << 0)
+} switch_event_bind_flag_enum_t;
+typedef uint32_t switch_event_bind_flag_t;
+
 typedef enum {
 	SWITCH_INPUT_TYPE_DTMF,
 	SWITCH_INPUT_TYPE_EVENT
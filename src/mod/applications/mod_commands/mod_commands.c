@@ -2326,6 +2326,8 @@ SWITCH_STANDARD_API(status_function)
 	char * nl = "\n";					/* shortcut to format.nl	*/
 	stream_format format = { 0 };
 	switch_size_t cur = 0, max = 0;
+	switch_ivr_record_writer_stats_t rws;
+	switch_media_bug_pool_stats_t mbs;
 
 	set_format(&format, stream);
 
@@ -2376,6 +2378,18 @@ SWITCH_STANDARD_API(status_function)
 	stream->write_function(stream, "%d session(s) max%s", switch_core_session_limit(0), nl);
 	stream->write_function(stream, "min idle cpu %0.2f/%0.2f%s", switch_core_min_idle_cpu(-1.0), switch_core_idle_cpu(), nl);
 
+	switch_ivr_record_writer_stats(&rws);
+	if (rws.threads) {
+		stream->write_function(stream, "%u recording(s) on %u writer(s), queue depth %u, write latency avg %ums max %ums%s",
+							   rws.recordings, rws.threads, rws.queue_depth, rws.avg_latency_us / 1000, rws.max_latency_us / 1000, nl);
+	}
+
+	switch_core_media_bug_pool_stats(&mbs);
+	if (mbs.threads) {
+		stream->write_function(stream, "%u async media bug(s) on %u worker(s), backlog %u, %" SWITCH_UINT64_T_FMT " frame(s) dropped%s",
+							   mbs.bugs, mbs.threads, mbs.backlog, mbs.dropped, nl);
+	}
+
 	if (switch_core_get_stacksizes(&cur, &max) == SWITCH_STATUS_SUCCESS) {		stream->write_function(stream, "Current Stack Size/Max %ldK/%ldK\n", cur / 1024, max / 1024);
 	}
 	return SWITCH_STATUS_SUCCESS;
@@ -3446,6 +3460,10 @@ static void jsonify_stats(cJSON *json, const char *name, switch_rtp_stats_t *sta
 	add_stat(stats->inbound.cng_packet_count, "in_cng_packet_count");
 	add_stat(stats->inbound.flush_packet_count, "in_flush_packet_count");
 	add_stat(stats->inbound.largest_jb_size, "in_largest_jb_size");
+	add_stat(stats->inbound.jb_target_delay, "in_jb_target_delay_ms");
+	add_stat(stats->inbound.jb_delay, "in_jb_delay_ms");
+	add_stat(stats->inbound.jb_accelerate_count, "in_jb_accelerate_count");
+	add_stat(stats->inbound.jb_expand_count, "in_jb_expand_count");
 
 	add_stat (stats->inbound.min_variance, "in_jitter_min_variance");
 	add_stat (stats->inbound.max_variance, "in_jitter_max_variance");
@@ -5405,6 +5423,11 @@ struct holder {
 	cJSON *json;
 	int rows;
 	int justcount;
+	void (*stats)(switch_core_db_callback_func_t callback, void *pArg);
+	int use_index;
+	switch_channel_index_view_t index_view;
+	switch_channel_index_flag_t index_flags;
+	char *index_like;
 	stream_format *format;
 };
 
@@ -5615,12 +5638,41 @@ SWITCH_STANDARD_API(coalesce_function)
 	return status;
 }
 
-#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|status"
+#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|status|subscribers|wakeups"
+static void show_execute(switch_cache_db_handle_t *db, const char *sql, switch_core_db_callback_func_t callback, struct holder *holder, char **errmsg)
+{
+	if (holder->use_index) {
+		switch_core_channel_index_query(holder->index_view, holder->index_like, holder->index_flags, callback, holder);
+	} else if (holder->stats) {
+		holder->stats(callback, holder);
+	} else if (!db) {
+		*errmsg = strdup("SQL disabled, no data available!");
+	} else {
+		switch_cache_db_execute_sql_callback(db, sql, callback, holder, errmsg);
+	}
+}
+
+/* serve channels and calls from the core channel index instead of the db when it is enabled */
+static void show_use_index(struct holder *holder, switch_channel_index_view_t view, switch_channel_index_flag_t flags, const char *like)
+{
+	if (!switch_core_channel_index_enabled()) {
+		return;
+	}
+
+	holder->use_index = 1;
+	holder->index_view = view;
+	holder->index_flags = flags;
+
+	if (!zstr(like)) {
+		holder->index_like = strchr(like, '%') ? strdup(like) : switch_mprintf("%%%s%%", like);
+	}
+}
+
 SWITCH_STANDARD_API(show_function)
 {
 	char sql[1024];
-	char *errmsg;
-	switch_cache_db_handle_t *db;
+	char *errmsg = NULL;
+	switch_cache_db_handle_t *db = NULL;
 	struct holder holder = { 0 };
 	int help = 0;
 	char *mydata = NULL, *argv[6] = { 0 };
@@ -5635,12 +5687,12 @@ SWITCH_STANDARD_API(show_function)
 	set_format(holder.format, stream);
 	html = holder.format->html; /* html is just a shortcut */
 
-	if (!(cflags & SCF_USE_SQL)) {
+	if (!(cflags & SCF_USE_SQL) && !switch_core_channel_index_enabled()) {
 		stream->write_function(stream, "-ERR SQL disabled, no data available!\n");
 		return SWITCH_STATUS_SUCCESS;
 	}
 
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
+	if ((cflags & SCF_USE_SQL) && switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
 		stream->write_function(stream, "%s", "-ERR Database error!\n");
 		return SWITCH_STATUS_SUCCESS;
 	}
@@ -5706,6 +5758,14 @@ SWITCH_STANDARD_API(show_function)
 		switch_snprintfv(sql, sizeof(sql), "select * from aliases where hostname='%q' order by alias", switch_core_get_switchname());
 	} else if (!strcasecmp(command, "complete")) {
 		switch_snprintfv(sql, sizeof(sql), "select * from complete where hostname='%q' order by a1,a2,a3,a4,a5,a6,a7,a8,a9,a10", switch_core_get_switchname());
+	} else if (!strcasecmp(command, "subscribers")) {
+		/* event bindings and their dispatch queues, straight from the core instead of the db */
+		*sql = '\0';
+		holder.stats = switch_event_subscriber_stats;
+	} else if (!strcasecmp(command, "wakeups")) {
+		/* wake latency of the wheel timer */
+		*sql = '\0';
+		holder.stats = switch_time_wheel_stats;
 	} else if (!strncasecmp(command, "help", 4)) {
 		char *cmdname = NULL;
 
@@ -5745,8 +5805,10 @@ SWITCH_STANDARD_API(show_function)
 
 		if (!strcasecmp(command, "calls")) {
 			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where hostname='%q' order by call_created_epoch", switch_core_get_switchname());
+			show_use_index(&holder, SCI_VIEW_BASIC_CALLS, SCIF_ORDER_BY_CALL, NULL);
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
 				switch_snprintfv(sql, sizeof(sql), "select count(*) from basic_calls where hostname='%q'", switch_core_get_switchname());
+				holder.index_flags |= SCIF_COUNT;
 				holder.justcount = 1;
 				if (argv[2] && argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5778,16 +5840,20 @@ SWITCH_STANDARD_API(show_function)
 						"select * from channels where hostname='%q' and uuid like '%%%q%%' or name like '%%%q%%' or cid_name like '%%%q%%' or cid_num like '%%%q%%' or presence_data like '%%%q%%' or accountcode like '%%%q%%' order by created_epoch",
 						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
 				}
+				show_use_index(&holder, SCI_VIEW_CHANNELS, SCIF_NONE, argv[2]);
 				if (argv[4] && !strcasecmp(argv[3], "as")) {
 					as = argv[4];
 				}
 			} else {
 				switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
+				show_use_index(&holder, SCI_VIEW_CHANNELS, SCIF_NONE, NULL);
 			}
 		} else if (!strcasecmp(command, "channels")) {
 			switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			show_use_index(&holder, SCI_VIEW_CHANNELS, SCIF_NONE, NULL);
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
 				switch_snprintfv(sql, sizeof(sql), "select count(*) from channels where hostname='%q'", switch_core_get_switchname());
+				holder.index_flags |= SCIF_COUNT;
 				holder.justcount = 1;
 				if (argv[2] && argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5795,16 +5861,19 @@ SWITCH_STANDARD_API(show_function)
 			}
 		} else if (!strcasecmp(command, "detailed_calls")) {
 			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			show_use_index(&holder, SCI_VIEW_DETAILED_CALLS, SCIF_NONE, NULL);
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "bridged_calls")) {
 			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			show_use_index(&holder, SCI_VIEW_BASIC_CALLS, SCIF_BRIDGED, NULL);
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "detailed_bridged_calls")) {
 			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			show_use_index(&holder, SCI_VIEW_DETAILED_CALLS, SCIF_BRIDGED, NULL);
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
@@ -5841,7 +5910,7 @@ SWITCH_STANDARD_API(show_function)
 				holder.delim = ",";
 			}
 		}
-		switch_cache_db_execute_sql_callback(db, sql, show_callback, &holder, &errmsg);
+		show_execute(db, sql, show_callback, &holder, &errmsg);
 		if (html) {
 			holder.stream->write_function(holder.stream, "</table>");
 		}
@@ -5857,7 +5926,7 @@ SWITCH_STANDARD_API(show_function)
 			stream->write_function(stream, "%s%u total.%s", nl, holder.count, nl);
 		}
 	} else if (!strcasecmp(as, "xml")) {
-		switch_cache_db_execute_sql_callback(db, sql, show_as_xml_callback, &holder, &errmsg);
+		show_execute(db, sql, show_as_xml_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL error [%s]\n", errmsg);
@@ -5885,7 +5954,7 @@ SWITCH_STANDARD_API(show_function)
 		}
 	} else if (!strcasecmp(as, "json")) {
 
-		switch_cache_db_execute_sql_callback(db, sql, show_as_json_callback, &holder, &errmsg);
+		show_execute(db, sql, show_as_json_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL Error [%s]\n", errmsg);
@@ -5930,6 +5999,7 @@ SWITCH_STANDARD_API(show_function)
   end:
 
 	switch_safe_free(mydata);
+	switch_safe_free(holder.index_like);
 	switch_cache_db_release_db_handle(&db);
 
 	return status;
@@ -7112,6 +7182,62 @@ SWITCH_STANDARD_API(file_exists_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define FILE_CACHE_SYNTAX "[stats|flush]"
+SWITCH_STANDARD_API(file_cache_function)
+{
+	switch_file_cache_stats_t stats;
+
+	if (!zstr(cmd) && !strcasecmp(cmd, "flush")) {
+		switch_core_file_cache_flush();
+		stream->write_function(stream, "+OK\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!zstr(cmd) && strcasecmp(cmd, "stats")) {
+		stream->write_function(stream, "-USAGE: %s\n", FILE_CACHE_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_core_file_cache_stats(&stats);
+
+	stream->write_function(stream, "entries: %u\n", stats.entries);
+	stream->write_function(stream, "bytes: %" SWITCH_SIZE_T_FMT "\n", stats.bytes);
+	stream->write_function(stream, "max-bytes: %" SWITCH_SIZE_T_FMT "\n", stats.max_bytes);
+	stream->write_function(stream, "hits: %" SWITCH_UINT64_T_FMT "\n", stats.hits);
+	stream->write_function(stream, "misses: %" SWITCH_UINT64_T_FMT "\n", stats.misses);
+	stream->write_function(stream, "evictions: %" SWITCH_UINT64_T_FMT "\n", stats.evictions);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+#define REGEX_CACHE_SYNTAX "[stats|flush]"
+SWITCH_STANDARD_API(regex_cache_function)
+{
+	switch_regex_cache_stats_t stats;
+
+	if (!zstr(cmd) && !strcasecmp(cmd, "flush")) {
+		switch_regex_cache_flush();
+		stream->write_function(stream, "+OK\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!zstr(cmd) && strcasecmp(cmd, "stats")) {
+		stream->write_function(stream, "-USAGE: %s\n", REGEX_CACHE_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_regex_cache_stats(&stats);
+
+	stream->write_function(stream, "entries: %u\n", stats.entries);
+	stream->write_function(stream, "max-entries: %u\n", stats.max_entries);
+	stream->write_function(stream, "jit: %s\n", stats.jit ? "true" : "false");
+	stream->write_function(stream, "hits: %" SWITCH_UINT64_T_FMT "\n", stats.hits);
+	stream->write_function(stream, "misses: %" SWITCH_UINT64_T_FMT "\n", stats.misses);
+	stream->write_function(stream, "evictions: %" SWITCH_UINT64_T_FMT "\n", stats.evictions);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 #define INTERFACE_IP_SYNTAX "[auto|ipv4|ipv6] <ifname>"
 SWITCH_STANDARD_API(interface_ip_function)
 {
@@ -7600,6 +7726,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "xml_locate", "Find some xml", xml_locate_function, "[root | <section> <tag> <tag_attr_name> <tag_attr_val>]");
 	SWITCH_ADD_API(commands_api_interface, "xml_wrap", "Wrap another api command in xml", xml_wrap_api_function, "<command> <args>");
 	SWITCH_ADD_API(commands_api_interface, "file_exists", "Check if a file exists on server", file_exists_function, "<file>");
+	SWITCH_ADD_API(commands_api_interface, "file_cache", "Decoded file cache counters", file_cache_function, FILE_CACHE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "regex_cache", "Compiled regex cache counters", regex_cache_function, REGEX_CACHE_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "getcputime", "Gets CPU time in milliseconds (user,kernel)", getcputime_function, GETCPUTIME_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "json", "JSON API", json_function, "JSON");
 
@@ -7703,6 +7831,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add show registrations");
 	switch_console_set_complete("add show say");
 	switch_console_set_complete("add show status");
+	switch_console_set_complete("add show subscribers");
+	switch_console_set_complete("add show wakeups");
 	switch_console_set_complete("add show timer");
 	switch_console_set_complete("add shutdown");
 	switch_console_set_complete("add sql_escape");
@@ -7796,6 +7926,10 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add uuid_warning ::console::list_uuid");
 	switch_console_set_complete("add ...");
 	switch_console_set_complete("add file_exists");
+	switch_console_set_complete("add file_cache stats");
+	switch_console_set_complete("add file_cache flush");
+	switch_console_set_complete("add regex_cache stats");
+	switch_console_set_complete("add regex_cache flush");
 	switch_console_set_complete("add getcputime");
 
 	switch_msrp_load_apis_and_applications(module_interface);
@@ -3346,6 +3346,10 @@ void _conference_api_sub_relate_set_member_relationship(conference_obj_t *confer
 				switch_core_session_request_video_refresh(member->session);
 			}
 
+			switch_mutex_lock(conference->member_mutex);
+			conference->relationship_version++;
+			switch_mutex_unlock(conference->member_mutex);
+
 			stream->write_function(stream, "+OK %u->%u %s set\n", id, oid, action);
 		} else {
 			stream->write_function(stream, "-ERR error!\n");
@@ -0,0 +1,330 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * conference_encode.c -- Shared encoding of the listener mix
+ *
+ */
+#include <mod_conference.h>
+
+/*
+  Members that contribute nothing to the mix (muted listeners) and have no relationships all hear the
+  exact same audio.  When the conference has the shared-encode flag, those members are grouped by write
+  codec settings and the mix is encoded once per group per tick.  The member thread then writes the
+  already encoded frame, which the core passes straight through because the codec implementation matches.
+*/
+
+void conference_encode_frame_release(conference_encoded_frame_t **encp)
+{
+	conference_encoded_frame_t *enc = *encp;
+
+	*encp = NULL;
+
+	if (enc && !switch_atomic_dec(&enc->refs)) {
+		free(enc);
+	}
+}
+
+static void conference_encode_group_destroy(conference_obj_t *conference, conference_encode_group_t *group)
+{
+	conference_encode_group_t *gp, *last = NULL;
+	switch_memory_pool_t *pool = group->pool;
+
+	for (gp = conference->encode_groups; gp; gp = gp->next) {
+		if (gp == group) {
+			if (last) {
+				last->next = gp->next;
+			} else {
+				conference->encode_groups = gp->next;
+			}
+			break;
+		}
+		last = gp;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s: shared encoder %s encoded %u frames\n",
+					  conference->name, group->key, group->encodes);
+
+	conference_encode_frame_release(&group->frame);
+
+	if (group->resampler) {
+		switch_resample_destroy(&group->resampler);
+	}
+
+	switch_core_codec_destroy(&group->codec);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* called with conference->mutex held, drops the member's reference on its group and frees the group with its last member */
+void conference_encode_member_release(conference_obj_t *conference, conference_member_t *member)
+{
+	conference_encode_group_t *group = member->encode_group_cache;
+
+	member->encode_group_cache = NULL;
+	member->encode_group_stale = 0;
+
+	if (group && !--group->members) {
+		conference_encode_group_destroy(conference, group);
+	}
+}
+
+static conference_encode_group_t *conference_encode_group_get(conference_obj_t *conference, conference_member_t *member)
+{
+	conference_encode_group_t *group;
+	switch_codec_t *write_codec;
+	switch_memory_pool_t *pool;
+	char key[512];
+	uint32_t codec_rate;
+
+	if (!member->session || !(write_codec = switch_core_session_get_write_codec(member->session)) || !switch_core_codec_ready(write_codec)) {
+		return NULL;
+	}
+
+	if (member->encode_group_cache && !member->encode_group_stale &&
+		member->encode_group_cache->codec.implementation == write_codec->implementation) {
+		return member->encode_group_cache;
+	}
+
+	conference_encode_member_release(conference, member);
+
+	if (switch_test_flag(write_codec, SWITCH_CODEC_FLAG_PASSTHROUGH) ||
+		write_codec->implementation->microseconds_per_packet / 1000 != (int)conference->interval ||
+		write_codec->implementation->number_of_channels != (int)conference->channels) {
+		return NULL;
+	}
+
+	switch_mutex_lock(write_codec->mutex);
+
+	switch_snprintf(key, sizeof(key), "%s@%uh@%di@%dc;%s", write_codec->implementation->iananame,
+					write_codec->implementation->actual_samples_per_second,
+					write_codec->implementation->microseconds_per_packet / 1000,
+					write_codec->implementation->number_of_channels, switch_str_nil(write_codec->fmtp_in));
+
+	for (group = conference->encode_groups; group; group = group->next) {
+		if (!strcmp(group->key, key) && group->codec.implementation == write_codec->implementation) {
+			break;
+		}
+	}
+
+	if (group) {
+		switch_mutex_unlock(write_codec->mutex);
+		group->members++;
+		member->encode_group_cache = group;
+		return group;
+	}
+
+	switch_core_new_memory_pool(&pool);
+	group = switch_core_alloc(pool, sizeof(*group));
+	group->pool = pool;
+	group->key = switch_core_strdup(pool, key);
+
+	if (switch_core_codec_copy(write_codec, &group->codec, NULL, pool) != SWITCH_STATUS_SUCCESS ||
+		group->codec.implementation != write_codec->implementation) {
+		switch_mutex_unlock(write_codec->mutex);
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(member->session), SWITCH_LOG_WARNING, "Cannot create shared encoder for %s\n", key);
+		if (switch_core_codec_ready(&group->codec)) {
+			switch_core_codec_destroy(&group->codec);
+		}
+		switch_core_destroy_memory_pool(&pool);
+		return NULL;
+	}
+
+	switch_mutex_unlock(write_codec->mutex);
+
+	codec_rate = group->codec.implementation->actual_samples_per_second;
+
+	if (codec_rate != conference->rate) {
+		if (switch_resample_create(&group->resampler, conference->rate, codec_rate,
+								   switch_samples_per_packet(conference->rate, conference->interval) * 2 * conference->channels * 10,
+								   SWITCH_RESAMPLE_QUALITY, conference->channels) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(member->session), SWITCH_LOG_WARNING, "Cannot create shared encoder resampler for %s\n", key);
+			switch_core_codec_destroy(&group->codec);
+			switch_core_destroy_memory_pool(&pool);
+			return NULL;
+		}
+	}
+
+	group->next = conference->encode_groups;
+	conference->encode_groups = group;
+	group->members = 1;
+	member->encode_group_cache = group;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s: created shared encoder %s\n", conference->name, key);
+
+	return group;
+}
+
+/* called from the conference thread with conference->mutex held */
+conference_encoded_frame_t *conference_encode_group_frame(conference_obj_t *conference, conference_member_t *member, int16_t *data, uint32_t bytes)
+{
+	conference_encode_group_t *group;
+	conference_encoded_frame_t *enc;
+	uint32_t encoded_rate, flag = 0;
+	uint32_t datalen = bytes;
+	void *decoded = data;
+
+	if (!conference_utils_test_flag(conference, CFLAG_SHARED_ENCODE) || !member->encode_buffer ||
+		!(group = conference_encode_group_get(conference, member))) {
+		return NULL;
+	}
+
+	if (group->frame && group->frame_tick == conference->mix_tick) {
+		return group->frame;
+	}
+
+	conference_encode_frame_release(&group->frame);
+
+	switch_zmalloc(enc, sizeof(*enc));
+	enc->implementation = group->codec.implementation;
+	switch_atomic_set(&enc->refs, 1);
+
+	if (group->resampler) {
+		switch_resample_process(group->resampler, data, bytes / 2 / conference->channels);
+		decoded = group->resampler->to;
+		datalen = group->resampler->to_len * 2 * conference->channels;
+	}
+
+	enc->datalen = sizeof(enc->data);
+	encoded_rate = enc->rate = group->codec.implementation->actual_samples_per_second;
+
+	if (switch_core_codec_encode(&group->codec, NULL, decoded, datalen, enc->rate,
+								 enc->data, &enc->datalen, &encoded_rate, &flag) != SWITCH_STATUS_SUCCESS) {
+		enc->datalen = 0;
+	}
+
+	enc->samples = group->codec.implementation->samples_per_packet;
+	group->frame = enc;
+	group->frame_tick = conference->mix_tick;
+	group->encodes++;
+
+	return enc;
+}
+
+/* keep one entry per mux frame in encode_buffer so the member thread can match them back up */
+switch_size_t conference_encode_write_mux(conference_member_t *member, void *data, uint32_t bytes, conference_encoded_frame_t *enc)
+{
+	switch_size_t ok;
+
+	switch_mutex_lock(member->audio_out_mutex);
+	ok = switch_buffer_write(member->mux_buffer, data, bytes);
+
+	if (ok && member->encode_buffer) {
+		if (enc) {
+			switch_atomic_inc(&enc->refs);
+		}
+
+		if (!switch_buffer_write(member->encode_buffer, &enc, sizeof(enc))) {
+			conference_encode_frame_release(&enc);
+		}
+	}
+	switch_mutex_unlock(member->audio_out_mutex);
+
+	return ok;
+}
+
+/* called with member->audio_out_mutex held, right after one frame was read from the mux_buffer */
+conference_encoded_frame_t *conference_encode_member_next_frame(conference_member_t *member)
+{
+	conference_encoded_frame_t *enc = NULL;
+
+	if (member->encode_buffer && switch_buffer_inuse(member->encode_buffer) >= sizeof(enc)) {
+		switch_buffer_read(member->encode_buffer, &enc, sizeof(enc));
+	}
+
+	return enc;
+}
+
+switch_status_t conference_encode_write_frame(conference_member_t *member, conference_encoded_frame_t **encp)
+{
+	conference_encoded_frame_t *enc = *encp;
+	switch_codec_t *write_codec;
+	switch_frame_t write_frame = { 0 };
+	switch_status_t status = SWITCH_STATUS_IGNORE;
+
+	if (!enc || !enc->datalen || member->volume_out_level || member->fnode ||
+		!conference_utils_member_test_flag(member, MFLAG_CAN_HEAR)) {
+		goto end;
+	}
+
+	write_codec = switch_core_session_get_write_codec(member->session);
+
+	if (!write_codec || write_codec->implementation != enc->implementation) {
+		goto end;
+	}
+
+	/* The core only looks at the codec to decode the frame again for media bugs, that has to be the
+	   member's own codec and never the group encoder which every other member is using at the same time. */
+	write_frame.codec = write_codec;
+	write_frame.data = enc->data;
+	write_frame.datalen = enc->datalen;
+	write_frame.buflen = sizeof(enc->data);
+	write_frame.samples = enc->samples;
+	write_frame.rate = enc->rate;
+
+	status = switch_core_session_write_frame(member->session, &write_frame, SWITCH_IO_FLAG_NONE, 0);
+
+ end:
+
+	conference_encode_frame_release(encp);
+
+	return status;
+}
+
+/* called with member->audio_out_mutex held whenever the mux_buffer is zeroed */
+void conference_encode_member_flush(conference_member_t *member)
+{
+	conference_encoded_frame_t *enc;
+
+	if (!member->encode_buffer) {
+		return;
+	}
+
+	while (switch_buffer_inuse(member->encode_buffer) >= sizeof(enc)) {
+		switch_buffer_read(member->encode_buffer, &enc, sizeof(enc));
+		conference_encode_frame_release(&enc);
+	}
+
+	switch_buffer_zero(member->encode_buffer);
+}
+
+/* called from the conference thread after every member is gone */
+void conference_encode_group_destroy_all(conference_obj_t *conference)
+{
+	while (conference->encode_groups) {
+		conference_encode_group_destroy(conference, conference->encode_groups);
+	}
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
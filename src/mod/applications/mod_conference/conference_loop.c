@@ -1528,23 +1528,31 @@ void conference_loop_output(conference_member_t *member)
 			low_count = 0;
 
 			if ((write_frame.datalen = (uint32_t) switch_buffer_read(use_buffer, write_frame.data, bytes))) {
+				conference_encoded_frame_t *enc = conference_encode_member_next_frame(member);
+				switch_status_t write_status;
+
 				write_frame.samples = write_frame.datalen / 2 / member->conference->channels;
 
-				if( !conference_utils_member_test_flag(member, MFLAG_CAN_HEAR)) {
-					memset(write_frame.data, 255, write_frame.datalen);
-				} else if (member->volume_out_level) { /* Check for output volume adjustments */
-					switch_change_sln_volume(write_frame.data, write_frame.samples * member->conference->channels, member->volume_out_level);
-				}
+				/* the mix may already be encoded once for every listener sharing our codec settings */
+				if ((write_status = conference_encode_write_frame(member, &enc)) == SWITCH_STATUS_IGNORE) {
+					if( !conference_utils_member_test_flag(member, MFLAG_CAN_HEAR)) {
+						memset(write_frame.data, 255, write_frame.datalen);
+					} else if (member->volume_out_level) { /* Check for output volume adjustments */
+						switch_change_sln_volume(write_frame.data, write_frame.samples * member->conference->channels, member->volume_out_level);
+					}
 
-				//write_frame.timestamp = timer.samplecount;
+					//write_frame.timestamp = timer.samplecount;
 
-				if (member->fnode) {
-					conference_member_add_file_data(member, write_frame.data, write_frame.datalen);
-				}
+					if (member->fnode) {
+						conference_member_add_file_data(member, write_frame.data, write_frame.datalen);
+					}
+
+					conference_member_check_channels(&write_frame, member, SWITCH_FALSE);
 
-				conference_member_check_channels(&write_frame, member, SWITCH_FALSE);
+					write_status = switch_core_session_write_frame(member->session, &write_frame, SWITCH_IO_FLAG_NONE, 0);
+				}
 
-				if (switch_core_session_write_frame(member->session, &write_frame, SWITCH_IO_FLAG_NONE, 0) != SWITCH_STATUS_SUCCESS) {
+				if (write_status != SWITCH_STATUS_SUCCESS) {
 					switch_mutex_unlock(member->audio_out_mutex);
 					switch_mutex_unlock(member->write_mutex);
 					break;
@@ -1558,6 +1566,7 @@ void conference_loop_output(conference_member_t *member)
 			if (switch_buffer_inuse(member->mux_buffer)) {
 				switch_mutex_lock(member->audio_out_mutex);
 				switch_buffer_zero(member->mux_buffer);
+				conference_encode_member_flush(member);
 				switch_mutex_unlock(member->audio_out_mutex);
 			}
 			conference_utils_member_clear_flag_locked(member, MFLAG_FLUSH_BUFFER);
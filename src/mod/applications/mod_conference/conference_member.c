@@ -626,6 +626,7 @@ conference_relationship_t *conference_member_add_relationship(conference_member_
 	lock_member(member);
 	switch_mutex_lock(member->conference->member_mutex);
 	member->conference->relationship_total++;
+	member->conference->relationship_version++;
 	switch_mutex_unlock(member->conference->member_mutex);
 	rel->next = member->relationships;
 	member->relationships = rel;
@@ -676,6 +677,7 @@ switch_status_t conference_member_del_relationship(conference_member_t *member,
 
 			switch_mutex_lock(member->conference->member_mutex);
 			member->conference->relationship_total--;
+			member->conference->relationship_version++;
 			switch_mutex_unlock(member->conference->member_mutex);
 
 			continue;
@@ -688,6 +690,74 @@ switch_status_t conference_member_del_relationship(conference_member_t *member,
 	return status;
 }
 
+static void conference_member_exclude_hearing(conference_member_t *member, conference_member_t *speaker)
+{
+	uint32_t i;
+
+	for (i = 0; i < member->hearing_excludes_count; i++) {
+		if (member->hearing_excludes[i] == speaker) {
+			return;
+		}
+	}
+
+	if (member->hearing_excludes_count == member->hearing_excludes_size) {
+		member->hearing_excludes_size = member->hearing_excludes_size ? member->hearing_excludes_size * 2 : 8;
+		member->hearing_excludes = realloc(member->hearing_excludes, member->hearing_excludes_size * sizeof(*member->hearing_excludes));
+		switch_assert(member->hearing_excludes);
+	}
+
+	member->hearing_excludes[member->hearing_excludes_count++] = speaker;
+}
+
+/* Compile the relationships into the list of speakers each member must not hear so the mixer
+   can remove them once per frame instead of walking every relationship for every sample.
+   Called from the conference thread with conference->mutex held whenever relationship_version moves. */
+void conference_member_update_hearing(conference_obj_t *conference)
+{
+	conference_member_t *member, *imember;
+	conference_relationship_t *rel;
+
+	switch_mutex_lock(conference->member_mutex);
+
+	conference->hearing_version = conference->relationship_version;
+
+	for (member = conference->members; member; member = member->next) {
+		member->hearing_excludes_count = 0;
+	}
+
+	if (!conference->relationship_total) {
+		goto end;
+	}
+
+	for (member = conference->members; member; member = member->next) {
+		for (rel = member->relationships; rel; rel = rel->next) {
+			if (switch_test_flag(rel, RFLAG_CAN_SPEAK) && switch_test_flag(rel, RFLAG_CAN_HEAR)) {
+				continue;
+			}
+
+			for (imember = conference->members; imember; imember = imember->next) {
+				if (imember == member || (rel->id && rel->id != imember->id)) {
+					continue;
+				}
+
+				/* they may not hear me */
+				if (!switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
+					conference_member_exclude_hearing(imember, member);
+				}
+
+				/* I may not hear them */
+				if (!switch_test_flag(rel, RFLAG_CAN_HEAR)) {
+					conference_member_exclude_hearing(member, imember);
+				}
+			}
+		}
+	}
+
+ end:
+
+	switch_mutex_unlock(conference->member_mutex);
+}
+
 
 
 /* Gain exclusive access and add the member to the list */
@@ -1038,6 +1108,7 @@ switch_status_t conference_member_add(conference_obj_t *conference, conference_m
 	switch_mutex_lock(conference->member_mutex);
 	member->next = conference->members;
 	conference->members = member;
+	conference->relationship_version++;
 	switch_mutex_unlock(conference->member_mutex);
 	switch_mutex_unlock(conference->mutex);
 	status = SWITCH_STATUS_SUCCESS;
@@ -1221,6 +1292,9 @@ switch_status_t conference_member_del(conference_obj_t *conference, conference_m
 		conference->recording_members--;
 	}
 
+	conference_encode_member_flush(member);
+	conference_encode_member_release(conference, member);
+
 	for (imember = conference->members; imember; imember = imember->next) {
 		if (imember == member) {
 			if (last) {
@@ -1233,6 +1307,8 @@ switch_status_t conference_member_del(conference_obj_t *conference, conference_m
 		last = imember;
 	}
 
+	conference->relationship_version++;
+
 	switch_mutex_lock(member->flag_mutex);
 	switch_img_free(&member->avatar_png_img);
 	switch_img_free(&member->video_mute_img);
@@ -1829,6 +1905,24 @@ int conference_member_setup_media(conference_member_t *member, conference_obj_t
 		goto codec_done1;
 	}
 
+	/* Track which mux frames have a shared encoding, only possible when our ptime matches the conference's */
+	if (member->encode_buffer) {
+		conference_encode_member_flush(member);
+		switch_buffer_zero(member->mux_buffer);
+		member->encode_group_stale = 1;
+
+		if (read_impl.microseconds_per_packet / 1000 != (int)conference->interval) {
+			switch_buffer_destroy(&member->encode_buffer);
+		}
+	}
+
+	if (!member->encode_buffer && conference_utils_test_flag(conference, CFLAG_SHARED_ENCODE) &&
+		read_impl.microseconds_per_packet / 1000 == (int)conference->interval &&
+		switch_buffer_create_dynamic(&member->encode_buffer, 64 * sizeof(void *), 64 * sizeof(void *), 0) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(member->session), SWITCH_LOG_CRIT, "Memory Error Creating Encode Buffer!\n");
+		goto codec_done1;
+	}
+
 	switch_mutex_unlock(member->audio_out_mutex);
 
 	return 0;
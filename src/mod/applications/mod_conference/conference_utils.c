@@ -216,6 +216,8 @@ void conference_utils_set_cflags(const char *flags, conference_flag_t *f)
 				f[CFLAG_PERSONAL_CANVAS] = 1;
 			} else if (!strcasecmp(argv[i], "ded-vid-layer-audio-floor")) {
 				f[CFLAG_DED_VID_LAYER_AUDIO_FLOOR] = 1;
+			} else if (!strcasecmp(argv[i], "shared-encode")) {
+				f[CFLAG_SHARED_ENCODE] = 1;
 			}
 		}
 
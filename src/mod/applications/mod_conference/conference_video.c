@@ -5058,6 +5058,7 @@ switch_status_t conference_video_thread_callback(switch_core_session_t *session,
 
 			switch_mutex_lock(member->conference->member_mutex);
 			member->conference->relationship_total--;
+			member->conference->relationship_version++;
 			switch_mutex_unlock(member->conference->member_mutex);
 
 			continue;
@@ -218,7 +218,6 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	uint8_t *async_file_frame;
 	int16_t *bptr;
 	uint32_t x = 0;
-	int32_t z = 0;
 	conference_cdr_node_t *np;
 
 	file_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE);
@@ -254,6 +253,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 
 		switch_mutex_lock(conference->mutex);
 		has_file_data = ready = total = 0;
+		conference->mix_tick++;
 
 		floor_holder = conference->floor_holder;
 
@@ -563,8 +563,11 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 
 		if (ready || has_file_data) {
 			/* Use more bits in the main_frame to preserve the exact sum of the audio samples. */
-			int main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int32_t main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
 			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int32_t hearing_frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+			int16_t listener_frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+			int listener_frame_ready = 0;
 
 
 			/* Init the main frame with file data if there is any. */
@@ -583,6 +586,10 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			conference->mux_loop_count = 0;
 			conference->member_loop_count = 0;
 
+			if (conference->hearing_version != conference->relationship_version) {
+				conference_member_update_hearing(conference);
+			}
+
 
 			/* Copy audio from every member known to be producing audio into the main frame. */
 			for (omember = conference->members; omember; omember = omember->next) {
@@ -592,10 +599,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
-				bptr = (int16_t *) omember->frame;
-				for (x = 0; x < omember->read / 2; x++) {
-					main_frame[x] += (int32_t) bptr[x];
-				}
+				switch_mix_sln_accumulate(main_frame, (int16_t *) omember->frame, omember->read / 2);
 			}
 
 			/* Create write frame once per member who is not deaf for each sample in the main frame
@@ -612,10 +616,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 				}
 				
 				if (!conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR)) {
-					switch_mutex_lock(omember->audio_out_mutex);
 					memset(write_frame, 255, bytes);
-					ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-					switch_mutex_unlock(omember->audio_out_mutex);
+					ok = conference_encode_write_mux(omember, write_frame, bytes, NULL);
 					if (!ok) {
 						switch_mutex_unlock(conference->mutex);
 						goto end;
@@ -623,54 +625,56 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
-				bptr = (int16_t *) omember->frame;
-
-				for (x = 0; x < bytes / 2 ; x++) {
-					z = main_frame[x];
+				/* members with no audio of their own and nobody they may not hear all hear the same mix, build it only once */
+				if (!omember->hearing_excludes_count && !conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO)) {
+					if (!listener_frame_ready) {
+						switch_mix_sln_subtract(listener_frame, main_frame, NULL, 0, bytes / 2);
+						listener_frame_ready = 1;
+					}
 
-					/* bptr[x] represents my own contribution to this audio sample */
-					if (conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO) && x <= omember->read / 2) {
-						z -= (int32_t) bptr[x];
+					if (!omember->channel || switch_channel_test_flag(omember->channel, CF_AUDIO)) {
+						ok = conference_encode_write_mux(omember, listener_frame, bytes,
+														 conference_encode_group_frame(conference, omember, listener_frame, bytes));
+						if (!ok) {
+							switch_mutex_unlock(conference->mutex);
+							goto end;
+						}
 					}
+					continue;
+				}
+
+				/* bptr represents my own contribution to the mix */
+				bptr = conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO) ? (int16_t *) omember->frame : NULL;
 
-					/* when there are relationships, we have to do more work by scouring all the members to see if there are any
-					   reasons why we should not be hearing a paticular member, and if not, delete their samples as well.
-					*/
-					if (conference->relationship_total) {
-						for (imember = conference->members; imember; imember = imember->next) {
-							if (imember != omember && conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
-								conference_relationship_t *rel;
-								switch_size_t found = 0;
-								int16_t *rptr = (int16_t *) imember->frame;
-								for (rel = imember->relationships; rel; rel = rel->next) {
-									if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
-										z -= (int32_t) rptr[x];
-										found = 1;
-										break;
-									}
-								}
-								if (!found) {
-									for (rel = omember->relationships; rel; rel = rel->next) {
-										if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
-											z -= (int32_t) rptr[x];
-											break;
-										}
-									}
-								}
-
-							}
+				if (!omember->hearing_excludes_count) {
+					switch_mix_sln_subtract(write_frame, main_frame, bptr, omember->read / 2, bytes / 2);
+				} else {
+					/* relationships were compiled into the speakers we may not hear, remove the ones talking right now */
+					uint32_t i;
+
+					memcpy(hearing_frame, main_frame, bytes / 2 * sizeof(int32_t));
+
+					for (i = 0; i < omember->hearing_excludes_count; i++) {
+						int16_t *rptr;
+
+						imember = omember->hearing_excludes[i];
+
+						if (!conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
+							continue;
+						}
+
+						rptr = (int16_t *) imember->frame;
+
+						for (x = 0; x < imember->read / 2 && x < bytes / 2; x++) {
+							hearing_frame[x] -= (int32_t) rptr[x];
 						}
 					}
 
-					/* Now we can convert to 16 bit. */
-					switch_normalize_to_16bit(z);
-					write_frame[x] = (int16_t) z;
+					switch_mix_sln_subtract(write_frame, hearing_frame, bptr, omember->read / 2, bytes / 2);
 				}
 
 				if (!omember->channel || switch_channel_test_flag(omember->channel, CF_AUDIO)) {
-					switch_mutex_lock(omember->audio_out_mutex);
-					ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-					switch_mutex_unlock(omember->audio_out_mutex);
+					ok = conference_encode_write_mux(omember, write_frame, bytes, NULL);
 					if (!ok) {
 						switch_mutex_unlock(conference->mutex);
 						goto end;
@@ -694,9 +698,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
-				switch_mutex_lock(omember->audio_out_mutex);
-				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-				switch_mutex_unlock(omember->audio_out_mutex);
+				ok = conference_encode_write_mux(omember, write_frame, bytes,
+												 conference_encode_group_frame(conference, omember, write_frame, bytes));
 
 				if (!ok) {
 					switch_mutex_unlock(conference->mutex);
@@ -837,6 +840,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	switch_thread_rwlock_unlock(conference->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write Lock OFF\n");
 
+	conference_encode_group_destroy_all(conference);
+
 	if (conference->la) {
 		switch_live_array_destroy(&conference->la);
 	}
@@ -2543,6 +2548,9 @@ SWITCH_STANDARD_APP(conference_function)
 	switch_buffer_destroy(&member.resample_buffer);
 	switch_buffer_destroy(&member.audio_buffer);
 	switch_buffer_destroy(&member.mux_buffer);
+	conference_encode_member_flush(&member);
+	switch_buffer_destroy(&member.encode_buffer);
+	switch_safe_free(member.hearing_excludes);
 
 	if (member.fb) {
 		switch_frame_buffer_destroy(&member.fb);
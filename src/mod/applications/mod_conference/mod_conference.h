@@ -255,6 +255,7 @@ typedef enum {
 	CFLAG_VIDEO_MUTE_EXIT_CANVAS,
 	CFLAG_NO_MOH,
 	CFLAG_DED_VID_LAYER_AUDIO_FLOOR,
+	CFLAG_SHARED_ENCODE,
 	/////////////////////////////////
 	CFLAG_MAX
 } conference_flag_t;
@@ -573,6 +574,29 @@ typedef struct mcu_canvas_s {
 	switch_bool_t disable_auto_clear;
 } mcu_canvas_t;
 
+/* One encoded copy of the listener mix, referenced by every member of the group it was encoded for */
+typedef struct conference_encoded_frame_s {
+	const switch_codec_implementation_t *implementation;
+	switch_atomic_t refs;
+	uint32_t datalen;
+	uint32_t samples;
+	uint32_t rate;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+} conference_encoded_frame_t;
+
+/* Members hearing the same mix through the same write codec settings share one encoder */
+typedef struct conference_encode_group_s {
+	char *key;
+	switch_codec_t codec;
+	switch_audio_resampler_t *resampler;
+	conference_encoded_frame_t *frame;
+	uint32_t frame_tick;
+	uint32_t encodes;
+	uint32_t members;
+	switch_memory_pool_t *pool;
+	struct conference_encode_group_s *next;
+} conference_encode_group_t;
+
 /* Record Node */
 typedef struct conference_record {
 	struct conference_obj *conference;
@@ -718,6 +742,8 @@ typedef struct conference_obj {
 	int endconference_grace_time;
 
 	uint32_t relationship_total;
+	uint32_t relationship_version;
+	uint32_t hearing_version;
 	uint32_t score;
 	int mux_loop_count;
 	int member_loop_count;
@@ -760,6 +786,8 @@ typedef struct conference_obj {
 	char *default_layout_name;
 	int mux_paused;
 	char *video_codec_config_profile_name;
+	conference_encode_group_t *encode_groups;
+	uint32_t mix_tick;
 } conference_obj_t;
 
 /* Relationship with another member */
@@ -778,6 +806,9 @@ struct conference_member {
 	switch_memory_pool_t *pool;
 	switch_buffer_t *audio_buffer;
 	switch_buffer_t *mux_buffer;
+	switch_buffer_t *encode_buffer;
+	conference_encode_group_t *encode_group_cache;
+	int encode_group_stale;
 	switch_buffer_t *resample_buffer;
 	member_flag_t flags[MFLAG_MAX];
 	int32_t score;
@@ -838,6 +869,9 @@ struct conference_member {
 	uint32_t resample_out_len;
 	conference_file_node_t *fnode;
 	conference_relationship_t *relationships;
+	struct conference_member **hearing_excludes;
+	uint32_t hearing_excludes_count;
+	uint32_t hearing_excludes_size;
 	switch_speech_handle_t lsh;
 	switch_speech_handle_t *sh;
 	uint32_t verbose_events;
@@ -988,6 +1022,7 @@ struct bg_call {
 
 switch_bool_t conference_utils_test_flag(conference_obj_t *conference, conference_flag_t flag);
 conference_relationship_t *conference_member_get_relationship(conference_member_t *member, conference_member_t *other_member);
+void conference_member_update_hearing(conference_obj_t *conference);
 
 uint32_t next_member_id(void);
 void conference_utils_set_cflags(const char *flags, conference_flag_t *f);
@@ -1003,6 +1038,14 @@ switch_status_t conference_file_close(conference_obj_t *conference, conference_f
 void *SWITCH_THREAD_FUNC conference_record_thread_run(switch_thread_t *thread, void *obj);
 switch_status_t conference_close_open_files(conference_obj_t *conference);
 void conference_al_gen_arc(conference_obj_t *conference, switch_stream_handle_t *stream);
+conference_encoded_frame_t *conference_encode_group_frame(conference_obj_t *conference, conference_member_t *member, int16_t *data, uint32_t bytes);
+switch_size_t conference_encode_write_mux(conference_member_t *member, void *data, uint32_t bytes, conference_encoded_frame_t *enc);
+conference_encoded_frame_t *conference_encode_member_next_frame(conference_member_t *member);
+switch_status_t conference_encode_write_frame(conference_member_t *member, conference_encoded_frame_t **encp);
+void conference_encode_member_flush(conference_member_t *member);
+void conference_encode_member_release(conference_obj_t *conference, conference_member_t *member);
+void conference_encode_frame_release(conference_encoded_frame_t **encp);
+void conference_encode_group_destroy_all(conference_obj_t *conference);
 void conference_al_process(al_handle_t *al, void *data, switch_size_t datalen, int rate);
 
 void conference_utils_member_set_flag_locked(conference_member_t *member, member_flag_t flag);
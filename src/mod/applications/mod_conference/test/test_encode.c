@@ -0,0 +1,149 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2019, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * test_encode.c -- tests shared listener encoding
+ *
+ */
+#include <switch.h>
+#include <stdlib.h>
+#include <mod_conference.h>
+
+#include <test/switch_test.h>
+
+static void init_member(conference_member_t *member, conference_obj_t *conference, switch_core_session_t *session, switch_memory_pool_t *pool)
+{
+	memset(member, 0, sizeof(*member));
+	member->conference = conference;
+	member->session = session;
+	switch_mutex_init(&member->audio_out_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_buffer_create_dynamic(&member->mux_buffer, 1024, 1024 * 10, 0);
+	switch_buffer_create_dynamic(&member->encode_buffer, 64 * sizeof(void *), 64 * sizeof(void *), 0);
+}
+
+static void destroy_member(conference_member_t *member)
+{
+	conference_encode_member_flush(member);
+	conference_encode_member_release(member->conference, member);
+	switch_buffer_destroy(&member->encode_buffer);
+	switch_buffer_destroy(&member->mux_buffer);
+}
+
+FST_CORE_BEGIN("./conf")
+{
+	FST_SUITE_BEGIN(conference_encode)
+	{
+		FST_SETUP_BEGIN()
+		{
+		}
+		FST_SETUP_END()
+
+		FST_TEARDOWN_BEGIN()
+		{
+		}
+		FST_TEARDOWN_END()
+
+		FST_SESSION_BEGIN(encode_group)
+		{
+			conference_obj_t conference = { 0 };
+			conference_member_t a, b, c;
+			conference_encoded_frame_t *enc_a, *enc_b, *enc;
+			conference_encode_group_t *group;
+			int16_t data[160];
+			uint32_t bytes = sizeof(data);
+			int i;
+
+			for (i = 0; i < 160; i++) {
+				data[i] = (int16_t)(i * 100);
+			}
+
+			conference.name = "encode_test";
+			conference.rate = 8000;
+			conference.interval = 20;
+			conference.channels = 1;
+
+			init_member(&a, &conference, fst_session, fst_pool);
+			init_member(&b, &conference, fst_session, fst_pool);
+			init_member(&c, &conference, fst_session, fst_pool);
+
+			/* nothing is shared unless the conference asks for it */
+			fst_check(conference_encode_group_frame(&conference, &a, data, bytes) == NULL);
+			fst_check(conference.encode_groups == NULL);
+
+			conference.flags[CFLAG_SHARED_ENCODE] = 1;
+			conference.mix_tick = 1;
+
+			/* members with the same write codec land in one group and the mix is encoded once for all of them */
+			enc_a = conference_encode_group_frame(&conference, &a, data, bytes);
+			enc_b = conference_encode_group_frame(&conference, &b, data, bytes);
+			fst_requires(enc_a != NULL);
+			fst_check(enc_a == enc_b);
+			fst_check(enc_a->datalen > 0);
+
+			group = conference.encode_groups;
+			fst_requires(group != NULL);
+			fst_check(group->next == NULL);
+			fst_check(a.encode_group_cache == group);
+			fst_check(b.encode_group_cache == group);
+			fst_check_int_equals(group->members, 2);
+			fst_check_int_equals(group->encodes, 1);
+
+			/* fan out: every member queue holds its own reference on the shared frame */
+			fst_check(conference_encode_write_mux(&a, data, bytes, enc_a));
+			fst_check(conference_encode_write_mux(&b, data, bytes, enc_b));
+			fst_check_int_equals(switch_atomic_read(&enc_a->refs), 3);
+
+			/* the next tick gets a new encoding, the queued frame stays valid for the members */
+			conference.mix_tick++;
+			enc = conference_encode_group_frame(&conference, &c, data, bytes);
+			fst_requires(enc != NULL);
+			fst_check(enc != enc_a);
+			fst_check_int_equals(group->members, 3);
+			fst_check_int_equals(group->encodes, 2);
+			fst_check_int_equals(switch_atomic_read(&enc_a->refs), 2);
+
+			switch_mutex_lock(a.audio_out_mutex);
+			enc = conference_encode_member_next_frame(&a);
+			switch_mutex_unlock(a.audio_out_mutex);
+			fst_check(enc == enc_b);
+			conference_encode_frame_release(&enc);
+			fst_check(enc == NULL);
+
+			/* the group goes away with its last member */
+			destroy_member(&a);
+			fst_check(conference.encode_groups == group);
+			fst_check_int_equals(group->members, 2);
+			destroy_member(&b);
+			fst_check_int_equals(group->members, 1);
+			destroy_member(&c);
+			fst_check(conference.encode_groups == NULL);
+
+			conference_encode_group_destroy_all(&conference);
+		}
+		FST_SESSION_END()
+	}
+	FST_SUITE_END()
+}
+FST_CORE_END()
@@ -881,6 +881,8 @@ SWITCH_STANDARD_APP(intercept_function)
 struct e_data {
 	char *uuid_list[MAX_SPY];
 	int total;
+	/* our own uuid, the channel index has no where clause to leave it out */
+	const char *skip;
 };
 
 static int e_callback(void *pArg, int argc, char **argv, char **columnNames)
@@ -888,7 +890,11 @@ static int e_callback(void *pArg, int argc, char **argv, char **columnNames)
 	char *uuid = argv[0];
 	struct e_data *e_data = (struct e_data *) pArg;
 
-	if (uuid && e_data) {
+	if (uuid && e_data && e_data->skip && !strcmp(uuid, e_data->skip)) {
+		return 0;
+	}
+
+	if (uuid && e_data && e_data->total < MAX_SPY) {
 		e_data->uuid_list[e_data->total++] = strdup(uuid);
 		return 0;
 	}
@@ -977,12 +983,18 @@ SWITCH_STANDARD_APP(eavesdrop_function)
 				}
 				e_data.total = 0;
 
-				if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Database Error!\n");
-					break;
+				if (switch_core_channel_index_enabled()) {
+					/* the channels table may not be written while the index is on */
+					e_data.skip = switch_core_session_get_uuid(session);
+					switch_core_channel_index_query(SCI_VIEW_CHANNELS, NULL, SCIF_NONE, e_callback, &e_data);
+				} else {
+					if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Database Error!\n");
+						break;
+					}
+					switch_cache_db_execute_sql_callback(db, sql, e_callback, &e_data, &errmsg);
+					switch_cache_db_release_db_handle(&db);
 				}
-				switch_cache_db_execute_sql_callback(db, sql, e_callback, &e_data, &errmsg);
-				switch_cache_db_release_db_handle(&db);
 				if (errmsg) {
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Error: %s\n", errmsg);
 					free(errmsg);
@@ -69,6 +69,15 @@ struct switch_pgsql_handle {
 	int num_retries;
 	switch_bool_t auto_commit;
 	switch_bool_t in_txn;
+	uint32_t generation;
+	uint32_t prepared_id;
+};
+
+/* server side prepared statements do not survive a reconnect, generation tells when to prepare again */
+struct switch_pgsql_prepared {
+	char name[32];
+	char *sql;
+	uint32_t generation;
 };
 
 struct switch_pgsql_result {
@@ -81,6 +90,7 @@ struct switch_pgsql_result {
 
 typedef struct switch_pgsql_handle switch_pgsql_handle_t;
 typedef struct switch_pgsql_result switch_pgsql_result_t;
+typedef struct switch_pgsql_prepared switch_pgsql_prepared_t;
 
 switch_status_t pgsql_handle_connect(switch_pgsql_handle_t *handle);
 switch_status_t pgsql_handle_destroy(switch_database_interface_handle_t **dih);
@@ -138,6 +148,7 @@ top:
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "PQstatus returned bad connection; reconnecting...\n");
 		handle->state = SWITCH_PGSQL_STATE_ERROR;
 		PQreset(handle->con);
+		handle->generation++;
 		if (PQstatus(handle->con) == CONNECTION_BAD) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "PQstatus returned bad connection -- reconnection failed!\n");
 			goto error;
@@ -155,6 +166,7 @@ error:
 	if (PQstatus(handle->con) == CONNECTION_BAD) {
 		handle->state = SWITCH_PGSQL_STATE_ERROR;
 		PQreset(handle->con);
+		handle->generation++;
 		if (PQstatus(handle->con) == CONNECTION_OK) {
 			handle->state = SWITCH_PGSQL_STATE_CONNECTED;
 			recon = SWITCH_STATUS_SUCCESS;
@@ -323,6 +335,7 @@ switch_status_t pgsql_handle_disconnect(switch_pgsql_handle_t *handle)
 		PQfinish(handle->con);
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "Disconnected from [%s]\n", handle->dsn);
 	}
+	handle->generation++;
 	switch_safe_free(handle->sql);
 	handle->state = SWITCH_PGSQL_STATE_DOWN;
 
@@ -603,6 +616,171 @@ error:
 	return SWITCH_STATUS_FALSE;
 }
 
+static switch_status_t pgsql_prepare_real(switch_pgsql_handle_t *handle, switch_pgsql_prepared_t *prepared, char **err)
+{
+	char *err_str = NULL;
+
+	if (!PQsendPrepare(handle->con, prepared->name, prepared->sql, 0, NULL)) {
+		goto error;
+	}
+
+	if (pgsql_finish_results(handle) != SWITCH_STATUS_SUCCESS) {
+		db_is_up(handle);
+		goto error;
+	}
+
+	prepared->generation = handle->generation;
+
+	return SWITCH_STATUS_SUCCESS;
+
+error:
+	err_str = pgsql_handle_get_error(handle);
+
+	if (zstr(err_str)) {
+		switch_safe_free(err_str);
+		err_str = strdup("Error preparing statement!");
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", prepared->sql, err_str);
+
+	if (err) {
+		*err = err_str;
+	} else {
+		free(err_str);
+	}
+
+	return SWITCH_STATUS_FALSE;
+}
+
+switch_status_t database_prepare(switch_database_interface_handle_t *dih, const char *sql, void **stmt, char **err)
+{
+	switch_pgsql_handle_t *handle;
+	switch_pgsql_prepared_t *prepared;
+	switch_stream_handle_t stream = { 0 };
+	const char *p;
+	int quoted = 0, argc = 0;
+
+	if (!dih || !(handle = dih->handle)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* the core marks parameters with ?, postgres wants $1..$n */
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = sql; *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		} else if (*p == '?' && !quoted) {
+			stream.write_function(&stream, "$%d", ++argc);
+			continue;
+		}
+
+		stream.raw_write_function(&stream, (uint8_t *) p, 1);
+	}
+
+	switch_zmalloc(prepared, sizeof(*prepared));
+	switch_snprintf(prepared->name, sizeof(prepared->name), "fs_stmt_%u", ++handle->prepared_id);
+	prepared->sql = (char *) stream.data;
+
+	pgsql_flush(handle);
+
+	if (!db_is_up(handle) || pgsql_prepare_real(handle, prepared, err) != SWITCH_STATUS_SUCCESS) {
+		if (err && !*err) {
+			*err = strdup("Database is not up!");
+		}
+		switch_safe_free(prepared->sql);
+		free(prepared);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*stmt = prepared;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+switch_status_t database_exec_prepared(switch_database_interface_handle_t *dih, void *stmt, int argc, const char * const *argv, char **err)
+{
+	switch_pgsql_handle_t *handle;
+	switch_pgsql_prepared_t *prepared = (switch_pgsql_prepared_t *) stmt;
+	char *err_str = NULL;
+
+	if (!dih || !(handle = dih->handle) || !prepared) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	pgsql_flush(handle);
+	handle->affected_rows = 0;
+
+	if (!db_is_up(handle)) {
+		err_str = strdup("Database is not up!");
+		goto error;
+	}
+
+	if (handle->auto_commit == SWITCH_FALSE && handle->in_txn == SWITCH_FALSE) {
+		if (pgsql_send_query(handle, "BEGIN") != SWITCH_STATUS_SUCCESS || pgsql_finish_results(handle) != SWITCH_STATUS_SUCCESS) {
+			db_is_up(handle);
+			err_str = strdup("Error sending BEGIN!");
+			goto error;
+		}
+		handle->in_txn = SWITCH_TRUE;
+	}
+
+	if (prepared->generation != handle->generation && pgsql_prepare_real(handle, prepared, err) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!PQsendQueryPrepared(handle->con, prepared->name, argc, argv, NULL, NULL, 0)) {
+		err_str = pgsql_handle_get_error(handle);
+		pgsql_finish_results(handle);
+		goto error;
+	}
+
+	return pgsql_finish_results(handle);
+
+error:
+	if (zstr(err_str)) {
+		switch_safe_free(err_str);
+		err_str = strdup("SQL ERROR!");
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", prepared->sql, err_str);
+
+	if (err) {
+		*err = err_str;
+	} else {
+		free(err_str);
+	}
+
+	return SWITCH_STATUS_FALSE;
+}
+
+switch_status_t database_finalize(switch_database_interface_handle_t *dih, void **stmt)
+{
+	switch_pgsql_handle_t *handle;
+	switch_pgsql_prepared_t *prepared;
+
+	if (!stmt || !(prepared = (switch_pgsql_prepared_t *) *stmt)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*stmt = NULL;
+
+	if (dih && (handle = dih->handle) && handle->state == SWITCH_PGSQL_STATE_CONNECTED && prepared->generation == handle->generation) {
+		char *sql = switch_mprintf("DEALLOCATE %s", prepared->name);
+
+		pgsql_flush(handle);
+		if (pgsql_send_query(handle, sql) == SWITCH_STATUS_SUCCESS) {
+			pgsql_finish_results(handle);
+		}
+		switch_safe_free(sql);
+	}
+
+	switch_safe_free(prepared->sql);
+	free(prepared);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 switch_status_t pgsql_next_result_timed(switch_pgsql_handle_t *handle, switch_pgsql_result_t **result_out, int msec)
 {
 	switch_pgsql_result_t *res;
@@ -1024,6 +1202,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_pgsql_load)
 	database_interface->commit = database_commit;
 	database_interface->rollback = database_rollback;
 	database_interface->callback_exec_detailed = pgsql_handle_callback_exec_detailed;
+	database_interface->prepare = database_prepare;
+	database_interface->exec_prepared = database_exec_prepared;
+	database_interface->finalize = database_finalize;
 	
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -35,7 +35,8 @@
 #include <fcntl.h>
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load);
-SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown);
+SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, mod_dialplan_xml_shutdown, NULL);
 
 typedef enum {
 	BREAK_ON_TRUE,
@@ -598,6 +599,413 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 	return proceed;
 }
 
+/*
+ * The routing index: each context of the main xml root is compiled into a trie of the literal prefixes the first
+ * condition of its extensions anchor on, so a hunt only runs parse_exten on extensions that can match.  An extension
+ * is only left out of a hunt when its first condition is a plain field/expression test that would fail and stop
+ * parse_exten with nothing run, anything else is always a candidate and the candidates are parsed in document order.
+ */
+
+#define DP_INDEX_STACK_WORDS 1024
+
+typedef struct dp_exten_ref_s {
+	uint32_t ordinal;
+	struct dp_exten_ref_s *next;
+} dp_exten_ref_t;
+
+typedef struct dp_trie_node_s {
+	unsigned char c;
+	dp_exten_ref_t *extens;
+	struct dp_trie_node_s *child;
+	struct dp_trie_node_s *sibling;
+} dp_trie_node_t;
+
+typedef struct dp_field_index_s {
+	const char *name;
+	dp_trie_node_t root;
+	struct dp_field_index_s *next;
+} dp_field_index_t;
+
+typedef struct dp_context_index_s {
+	switch_xml_t xcontext;
+	switch_xml_t *extens;
+	uint32_t count;
+	uint32_t indexed;
+	uint32_t words;
+	/* extensions parsed whatever the fields hold */
+	uint32_t *always;
+	dp_field_index_t *fields;
+	uint32_t nfields;
+	struct dp_context_index_s *next;
+} dp_context_index_t;
+
+typedef struct dp_index_s {
+	switch_memory_pool_t *pool;
+	/* the root the index points into, it holds a reference so the nodes stay put */
+	switch_xml_t root;
+	dp_context_index_t *contexts;
+	uint32_t refs;
+	int dead;
+} dp_index_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	dp_index_t *index;
+	switch_event_node_t *reload_node;
+} globals;
+
+static const char *dp_time_attrs[] = {
+	"date-time", "year", "yday", "mon", "mday", "week", "mweek", "wday", "hour", "minute", "minute-of-day", "time-of-day", "tz-offset", "dst", NULL
+};
+
+/* the literal text every subject matching expression starts with, nothing when the expression does not pin one down */
+static switch_size_t dp_expression_prefix(const char *expression, char *buf, switch_size_t len)
+{
+	const char *p, *next;
+	int depth = 0, in_class = 0;
+	switch_size_t n = 0;
+	char c;
+
+	*buf = '\0';
+
+	if (*expression != '^' || strstr(expression, "\\Q") || strstr(expression, "(?#")) {
+		return 0;
+	}
+
+	/* an alternation outside any group matches without the anchor */
+	for (p = expression; *p; p++) {
+		if (*p == '\\') {
+			if (!*++p) {
+				return 0;
+			}
+		} else if (in_class) {
+			if (*p == ']') {
+				in_class = 0;
+			}
+		} else if (*p == '[') {
+			in_class = 1;
+			if (p[1] == '^') {
+				p++;
+			}
+			if (p[1] == ']') {
+				p++;
+			}
+		} else if (*p == '(') {
+			depth++;
+		} else if (*p == ')') {
+			depth--;
+		} else if (*p == '|' && depth <= 0) {
+			return 0;
+		}
+	}
+
+	for (p = expression + 1; *p && n + 1 < len; p = next) {
+		if (*p == '\\') {
+			if (isalnum((unsigned char) p[1])) {
+				break;
+			}
+			c = p[1];
+			next = p + 2;
+		} else if (strchr(".[]()|?*+{}^$", *p)) {
+			break;
+		} else {
+			c = *p;
+			next = p + 1;
+		}
+
+		if (*next == '?' || *next == '*' || *next == '{') {
+			/* the last character may not be there at all */
+			break;
+		}
+
+		buf[n++] = c;
+
+		if (*next == '+') {
+			break;
+		}
+	}
+
+	buf[n] = '\0';
+
+	return n;
+}
+
+/* the field and prefix an extension can be skipped on, or 0 when it has to be parsed on every hunt */
+static switch_size_t dp_exten_prefix(switch_xml_t xexten, const char **field, char *buf, switch_size_t len)
+{
+	switch_xml_t xcond, xexpression;
+	const char *expression, *do_break;
+	int i;
+
+	if (!(xcond = switch_xml_child(xexten, "condition"))) {
+		return 0;
+	}
+
+	if (switch_xml_attr(xcond, "regex") || switch_xml_child(xcond, "anti-action")) {
+		return 0;
+	}
+
+	for (i = 0; dp_time_attrs[i]; i++) {
+		if (switch_xml_attr(xcond, dp_time_attrs[i])) {
+			return 0;
+		}
+	}
+
+	/* a failed condition only ends parse_exten when it breaks on false */
+	if ((do_break = switch_xml_attr(xcond, "break")) && (!strcasecmp(do_break, "on-true") || !strcasecmp(do_break, "never"))) {
+		return 0;
+	}
+
+	if (!(*field = switch_xml_attr(xcond, "field")) || strchr(*field, '$')) {
+		return 0;
+	}
+
+	if ((xexpression = switch_xml_child(xcond, "expression"))) {
+		expression = switch_str_nil(xexpression->txt);
+	} else {
+		expression = switch_xml_attr_soft(xcond, "expression");
+	}
+
+	/* the same test switch_channel_expand_variables makes before it changes anything */
+	if (switch_string_var_check_const(expression) || switch_string_has_escaped_data(expression)) {
+		return 0;
+	}
+
+	return dp_expression_prefix(expression, buf, len);
+}
+
+static void dp_trie_insert(switch_memory_pool_t *pool, dp_trie_node_t *node, const char *prefix, uint32_t ordinal)
+{
+	dp_exten_ref_t *ref;
+	const char *p;
+
+	for (p = prefix; *p; p++) {
+		dp_trie_node_t *child;
+
+		for (child = node->child; child && child->c != (unsigned char) *p; child = child->sibling);
+
+		if (!child) {
+			child = switch_core_alloc(pool, sizeof(*child));
+			child->c = (unsigned char) *p;
+			child->sibling = node->child;
+			node->child = child;
+		}
+
+		node = child;
+	}
+
+	ref = switch_core_alloc(pool, sizeof(*ref));
+	ref->ordinal = ordinal;
+	ref->next = node->extens;
+	node->extens = ref;
+}
+
+static dp_context_index_t *dp_context_index_create(switch_memory_pool_t *pool, switch_xml_t xcontext)
+{
+	dp_context_index_t *ci = switch_core_alloc(pool, sizeof(*ci));
+	switch_xml_t xexten;
+	char prefix[256];
+	uint32_t i = 0;
+
+	ci->xcontext = xcontext;
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		ci->count++;
+	}
+
+	ci->words = (ci->count + 31) / 32;
+	ci->extens = switch_core_alloc(pool, (ci->count + 1) * sizeof(switch_xml_t));
+	ci->always = switch_core_alloc(pool, (ci->words + 1) * sizeof(uint32_t));
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next, i++) {
+		const char *field = NULL;
+		dp_field_index_t *fi;
+
+		ci->extens[i] = xexten;
+
+		if (!dp_exten_prefix(xexten, &field, prefix, sizeof(prefix))) {
+			ci->always[i >> 5] |= 1u << (i & 31);
+			continue;
+		}
+
+		for (fi = ci->fields; fi && strcasecmp(fi->name, field); fi = fi->next);
+
+		if (!fi) {
+			fi = switch_core_alloc(pool, sizeof(*fi));
+			fi->name = switch_core_strdup(pool, field);
+			fi->next = ci->fields;
+			ci->fields = fi;
+			ci->nfields++;
+		}
+
+		dp_trie_insert(pool, &fi->root, prefix, i);
+		ci->indexed++;
+	}
+
+	return ci;
+}
+
+static dp_index_t *dp_index_create(switch_xml_t root)
+{
+	switch_memory_pool_t *pool = NULL;
+	dp_index_t *index;
+	switch_xml_t cfg, xcontext;
+
+	switch_core_new_memory_pool(&pool);
+	index = switch_core_alloc(pool, sizeof(*index));
+	index->pool = pool;
+	index->root = root;
+
+	if ((cfg = switch_xml_find_child(root, "section", "name", "dialplan"))) {
+		for (xcontext = switch_xml_child(cfg, "context"); xcontext; xcontext = xcontext->next) {
+			dp_context_index_t *ci = dp_context_index_create(pool, xcontext);
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Dialplan index: context %s, %u of %u extensions indexed on %u fields\n",
+							  switch_xml_attr_soft(xcontext, "name"), ci->indexed, ci->count, ci->nfields);
+
+			ci->next = index->contexts;
+			index->contexts = ci;
+		}
+	}
+
+	return index;
+}
+
+static void dp_index_destroy(dp_index_t *index)
+{
+	switch_memory_pool_t *pool = index->pool;
+
+	switch_xml_free(index->root);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* the index for root with a reference held, NULL when root is not the one that was indexed */
+static dp_index_t *dp_index_get(switch_xml_t root)
+{
+	dp_index_t *index = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.index && globals.index->root == root) {
+		index = globals.index;
+		index->refs++;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	return index;
+}
+
+static void dp_index_release(dp_index_t *index)
+{
+	switch_mutex_lock(globals.mutex);
+	if (!--index->refs && index->dead) {
+		dp_index_destroy(index);
+	}
+	switch_mutex_unlock(globals.mutex);
+}
+
+static void dp_index_swap(dp_index_t *index)
+{
+	dp_index_t *old;
+
+	switch_mutex_lock(globals.mutex);
+	old = globals.index;
+	globals.index = index;
+	if (old) {
+		old->dead = 1;
+		if (!old->refs) {
+			dp_index_destroy(old);
+		}
+	}
+	switch_mutex_unlock(globals.mutex);
+}
+
+static void dp_index_rebuild(void)
+{
+	switch_xml_t root;
+
+	if ((root = switch_xml_root())) {
+		dp_index_swap(dp_index_create(root));
+	}
+}
+
+static void dp_reloadxml_event_handler(switch_event_t *event)
+{
+	dp_index_rebuild();
+}
+
+static dp_context_index_t *dp_index_find_context(dp_index_t *index, switch_xml_t xcontext)
+{
+	dp_context_index_t *ci;
+
+	for (ci = index->contexts; ci && ci->xcontext != xcontext; ci = ci->next);
+
+	return ci;
+}
+
+/* mark the extensions a hunt has to parse for the field values caller_profile holds now, values keeps a copy of them */
+static void dp_context_candidates(dp_context_index_t *ci, switch_caller_profile_t *caller_profile, uint32_t *bitmap, char **values)
+{
+	dp_field_index_t *fi;
+	uint32_t f = 0;
+
+	memcpy(bitmap, ci->always, ci->words * sizeof(uint32_t));
+
+	for (fi = ci->fields; fi; fi = fi->next, f++) {
+		const char *value = switch_caller_get_field_by_name(caller_profile, fi->name);
+		dp_trie_node_t *node = &fi->root;
+		const char *p;
+
+		switch_safe_free(values[f]);
+		values[f] = strdup(switch_str_nil(value));
+
+		for (p = values[f]; *p && node; p++) {
+			dp_exten_ref_t *ref;
+
+			for (node = node->child; node && node->c != (unsigned char) *p; node = node->sibling);
+
+			if (node) {
+				for (ref = node->extens; ref; ref = ref->next) {
+					bitmap[ref->ordinal >> 5] |= 1u << (ref->ordinal & 31);
+				}
+			}
+		}
+	}
+}
+
+/* an inline action may have changed a field the candidates were picked on */
+static switch_bool_t dp_context_fields_changed(dp_context_index_t *ci, switch_caller_profile_t *caller_profile, char **values)
+{
+	dp_field_index_t *fi;
+	uint32_t f = 0;
+
+	for (fi = ci->fields; fi; fi = fi->next, f++) {
+		if (strcmp(switch_str_nil(switch_caller_get_field_by_name(caller_profile, fi->name)), values[f])) {
+			return SWITCH_TRUE;
+		}
+	}
+
+	return SWITCH_FALSE;
+}
+
+static uint32_t dp_next_candidate(const uint32_t *bitmap, uint32_t from, uint32_t count)
+{
+	while (from < count) {
+		uint32_t word = bitmap[from >> 5] >> (from & 31);
+
+		if (word) {
+			while (!(word & 1)) {
+				word >>= 1;
+				from++;
+			}
+			return from;
+		}
+
+		from = (from | 31) + 1;
+	}
+
+	return count;
+}
+
 static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t *root,
 										   switch_xml_t *node)
 {
@@ -615,6 +1023,34 @@ static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switc
 	return status;
 }
 
+/* parse one extension of a hunt, true when the hunt stops there */
+static int hunt_exten(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t xexten,
+					  switch_caller_extension_t **extension)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	int proceed = 0;
+	const char *cont = switch_xml_attr(xexten, "continue");
+	const char *exten_name = switch_xml_attr(xexten, "name");
+
+	if (!exten_name) {
+		exten_name = "UNKNOWN";
+	}
+
+	if ( switch_core_test_flag(SCF_DIALPLAN_TIMESTAMPS) ) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
+					  "Dialplan: %s parsing [%s->%s] continue=%s\n",
+					  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+					  "Dialplan: %s parsing [%s->%s] continue=%s\n",
+					  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
+	}
+
+	proceed = parse_exten(session, caller_profile, xexten, extension, exten_name, 0);
+
+	return proceed && !switch_true(cont);
+}
+
 SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 {
 	switch_caller_extension_t *extension = NULL;
@@ -622,6 +1058,8 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	switch_xml_t alt_root = NULL, cfg, xml = NULL, xcontext, xexten = NULL;
 	char *alt_path = (char *) arg;
 	const char *hunt = NULL;
+	dp_index_t *index = NULL;
+	dp_context_index_t *ci = NULL;
 
 	if (!caller_profile) {
 		if (!(caller_profile = switch_channel_get_caller_profile(channel))) {
@@ -673,36 +1111,56 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 		xexten = switch_xml_find_child(xcontext, "extension", "name", caller_profile->destination_number);
 	}
 
-	if (!xexten) {
-		xexten = switch_xml_child(xcontext, "extension");
-	}
+	if (!alt_root && (index = dp_index_get(xml)) && (ci = dp_index_find_context(index, xcontext))) {
+		uint32_t stack_bitmap[DP_INDEX_STACK_WORDS], *bitmap = stack_bitmap;
+		char **values = NULL;
+		uint32_t i = 0;
 
-	while (xexten) {
-		int proceed = 0;
-		const char *cont = switch_xml_attr(xexten, "continue");
-		const char *exten_name = switch_xml_attr(xexten, "name");
+		if (xexten) {
+			for (i = 0; i < ci->count && ci->extens[i] != xexten; i++);
+		}
 
-		if (!exten_name) {
-			exten_name = "UNKNOWN";
+		if (ci->words > DP_INDEX_STACK_WORDS) {
+			switch_malloc(bitmap, ci->words * sizeof(uint32_t));
 		}
 
-		if ( switch_core_test_flag(SCF_DIALPLAN_TIMESTAMPS) ) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
-						  "Dialplan: %s parsing [%s->%s] continue=%s\n",
-						  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
-		} else {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
-						  "Dialplan: %s parsing [%s->%s] continue=%s\n",
-						  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
+		switch_zmalloc(values, (ci->nfields + 1) * sizeof(char *));
+		dp_context_candidates(ci, caller_profile, bitmap, values);
+
+		for (i = dp_next_candidate(bitmap, i, ci->count); i < ci->count; i = dp_next_candidate(bitmap, i + 1, ci->count)) {
+			if (hunt_exten(session, caller_profile, ci->extens[i], &extension)) {
+				break;
+			}
+
+			if (dp_context_fields_changed(ci, caller_profile, values)) {
+				dp_context_candidates(ci, caller_profile, bitmap, values);
+			}
 		}
 
-		proceed = parse_exten(session, caller_profile, xexten, &extension, exten_name, 0);
+		for (i = 0; i < ci->nfields; i++) {
+			switch_safe_free(values[i]);
+		}
+		free(values);
 
-		if (proceed && !switch_true(cont)) {
-			break;
+		if (bitmap != stack_bitmap) {
+			free(bitmap);
+		}
+	} else {
+		if (!xexten) {
+			xexten = switch_xml_child(xcontext, "extension");
 		}
 
-		xexten = xexten->next;
+		while (xexten) {
+			if (hunt_exten(session, caller_profile, xexten, &extension)) {
+				break;
+			}
+
+			xexten = xexten->next;
+		}
+	}
+
+	if (index) {
+		dp_index_release(index);
 	}
 
 	switch_xml_free(xml);
@@ -721,10 +1179,27 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load)
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_DIALPLAN(dp_interface, "XML", dialplan_hunt);
 
+	memset(&globals, 0, sizeof(globals));
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+
+	if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, dp_reloadxml_event_handler, NULL, &globals.reload_node) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind to reloadxml, the dialplan index is off\n");
+	} else {
+		dp_index_rebuild();
+	}
+
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown)
+{
+	switch_event_unbind(&globals.reload_node);
+	dp_index_swap(NULL);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -0,0 +1,275 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * test_dialplan_xml.c -- tests and micro benchmarks for the xml dialplan routing index
+ *
+ */
+
+#include <switch.h>
+#include <test/switch_test.h>
+#include "../mod_dialplan_xml.c"
+
+#define BENCH_EXTENSIONS 20000
+
+static switch_bool_t prefix_is(const char *expression, const char *expected)
+{
+	char buf[256];
+
+	dp_expression_prefix(expression, buf, sizeof(buf));
+
+	return !strcmp(buf, expected) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+static switch_bool_t is_candidate(const uint32_t *bitmap, uint32_t ordinal)
+{
+	return (bitmap[ordinal >> 5] & (1u << (ordinal & 31))) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+/* the part of parse_exten a hunt spends its time in, the first condition of each extension */
+static int first_condition_matches(switch_xml_t xexten, switch_caller_profile_t *caller_profile)
+{
+	switch_xml_t xcond = switch_xml_child(xexten, "condition");
+	const char *field = switch_xml_attr(xcond, "field");
+	const char *expression = switch_xml_attr_soft(xcond, "expression");
+	const char *field_data = switch_caller_get_field_by_name(caller_profile, field);
+	switch_regex_t *re = NULL;
+	int ovector[30];
+	int proceed;
+
+	if ((proceed = switch_regex_perform(switch_str_nil(field_data), expression, &re, ovector, sizeof(ovector) / sizeof(ovector[0])))) {
+		switch_regex_safe_free(re);
+	}
+
+	return proceed;
+}
+
+static uint32_t route_walk(dp_context_index_t *ci, switch_caller_profile_t *caller_profile)
+{
+	uint32_t i;
+
+	for (i = 0; i < ci->count; i++) {
+		if (first_condition_matches(ci->extens[i], caller_profile)) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+static uint32_t route_indexed(dp_context_index_t *ci, switch_caller_profile_t *caller_profile, uint32_t *bitmap, char **values)
+{
+	uint32_t i;
+
+	dp_context_candidates(ci, caller_profile, bitmap, values);
+
+	for (i = dp_next_candidate(bitmap, 0, ci->count); i < ci->count; i = dp_next_candidate(bitmap, i + 1, ci->count)) {
+		if (first_condition_matches(ci->extens[i], caller_profile)) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+FST_MINCORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(test_dialplan_xml)
+
+FST_SETUP_BEGIN()
+{
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(expression_prefix)
+{
+	fst_check(prefix_is("^1000$", "1000"));
+	fst_check(prefix_is("^(10[01][0-9])$", ""));
+	fst_check(prefix_is("^9(\\d+)$", "9"));
+	fst_check(prefix_is("^\\+1(\\d{10})$", "+1"));
+	fst_check(prefix_is("^\\*98$", "*98"));
+	fst_check(prefix_is("^011(\\d+)", "011"));
+	fst_check(prefix_is("^1?(\\d{10})$", ""));
+	fst_check(prefix_is("^12?3", "1"));
+	fst_check(prefix_is("^12*3", "1"));
+	fst_check(prefix_is("^12{0,1}3", "1"));
+	fst_check(prefix_is("^12+3", "12"));
+	fst_check(prefix_is("^1.3", "1"));
+	fst_check(prefix_is("^\\d+", ""));
+
+	/* an alternation outside a group, or no anchor, has no prefix */
+	fst_check(prefix_is("^123|^456", ""));
+	fst_check(prefix_is("^123|456", ""));
+	fst_check(prefix_is("^12(3|4)", "12"));
+	fst_check(prefix_is("^12[|]3", "12"));
+	fst_check(prefix_is("^12\\|3", "12|3"));
+	fst_check(prefix_is("1000", ""));
+	fst_check(prefix_is("/^1000$/i", ""));
+	fst_check(prefix_is("_1XXX", ""));
+	fst_check(prefix_is("^12\\Q(\\E3|456", ""));
+	fst_check(prefix_is("^12(?#(|)3", ""));
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(context_candidates)
+{
+	const char *doc =
+		"<document type=\"freeswitch/xml\">"
+		"<section name=\"dialplan\">"
+		"<context name=\"default\">"
+		"<extension name=\"local\"><condition field=\"destination_number\" expression=\"^(10[01][0-9])$\"/></extension>"
+		"<extension name=\"us\"><condition field=\"destination_number\" expression=\"^1(\\d{10})$\"/></extension>"
+		"<extension name=\"intl\"><condition field=\"destination_number\" expression=\"^011(\\d+)$\"/></extension>"
+		"<extension name=\"vm\"><condition field=\"destination_number\" expression=\"^\\*98$\"/></extension>"
+		"<extension name=\"vars\"><condition field=\"destination_number\" expression=\"^${prefix}(\\d+)$\"/></extension>"
+		"<extension name=\"anti\"><condition field=\"destination_number\" expression=\"^5\"><anti-action application=\"log\"/></condition></extension>"
+		"<extension name=\"never\"><condition field=\"destination_number\" expression=\"^6\" break=\"never\"/></extension>"
+		"<extension name=\"timed\"><condition field=\"destination_number\" expression=\"^7\" wday=\"1-5\"/></extension>"
+		"<extension name=\"cid\"><condition field=\"caller_id_number\" expression=\"^555\"/></extension>"
+		"<extension name=\"multi\"><condition regex=\"any\"><regex field=\"destination_number\" expression=\"^8\"/></condition></extension>"
+		"</context>"
+		"</section>"
+		"</document>";
+	switch_xml_t root = switch_xml_parse_str_dynamic(strdup(doc), SWITCH_FALSE);
+	switch_caller_profile_t *caller_profile;
+	dp_index_t *index;
+	dp_context_index_t *ci;
+	uint32_t bitmap[1];
+	char *values[2] = { 0 };
+
+	fst_requires(root);
+	index = dp_index_create(root);
+	fst_requires(index->contexts);
+	ci = index->contexts;
+
+	fst_check(ci->count == 10);
+	fst_check(ci->indexed == 4);
+	fst_check(ci->nfields == 2);
+
+	caller_profile = switch_caller_profile_new(fst_pool, "user", "XML", "name", "5551212", NULL, NULL, NULL, NULL, "test", "default", "12125551212");
+	dp_context_candidates(ci, caller_profile, bitmap, values);
+
+	fst_check(is_candidate(bitmap, 0));
+	fst_check(is_candidate(bitmap, 1));
+	fst_check(!is_candidate(bitmap, 2));
+	fst_check(!is_candidate(bitmap, 3));
+	fst_check(is_candidate(bitmap, 4));
+	fst_check(is_candidate(bitmap, 5));
+	fst_check(is_candidate(bitmap, 6));
+	fst_check(is_candidate(bitmap, 7));
+	fst_check(is_candidate(bitmap, 8));
+	fst_check(is_candidate(bitmap, 9));
+	fst_check(dp_next_candidate(bitmap, 1, ci->count) == 1);
+	fst_check(dp_next_candidate(bitmap, 2, ci->count) == 4);
+
+	fst_check(!dp_context_fields_changed(ci, caller_profile, values));
+	caller_profile->destination_number = "*98";
+	fst_check(dp_context_fields_changed(ci, caller_profile, values));
+	dp_context_candidates(ci, caller_profile, bitmap, values);
+	fst_check(!is_candidate(bitmap, 1));
+	fst_check(is_candidate(bitmap, 3));
+
+	caller_profile->caller_id_number = "4441212";
+	dp_context_candidates(ci, caller_profile, bitmap, values);
+	fst_check(!is_candidate(bitmap, 8));
+
+	switch_safe_free(values[0]);
+	switch_safe_free(values[1]);
+	dp_index_destroy(index);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(routing_benchmark)
+{
+	switch_stream_handle_t stream = { 0 };
+	switch_caller_profile_t *caller_profile;
+	switch_xml_t root;
+	dp_index_t *index;
+	dp_context_index_t *ci;
+	uint32_t *bitmap, i, same = 1;
+	char *values[1] = { 0 };
+	char destination_number[32];
+	switch_time_t start, walk = 0, indexed = 0;
+	int calls = 100;
+
+	SWITCH_STANDARD_STREAM(stream);
+	stream.write_function(&stream, "<document type=\"freeswitch/xml\"><section name=\"dialplan\"><context name=\"carrier\">");
+	for (i = 0; i < BENCH_EXTENSIONS; i++) {
+		stream.write_function(&stream, "<extension name=\"route_%u\"><condition field=\"destination_number\" expression=\"^1%05u(\\d{5})$\">"
+							  "<action application=\"bridge\" data=\"sofia/gateway/carrier/$1\"/></condition></extension>", i, i);
+	}
+	stream.write_function(&stream, "<extension name=\"catchall\"><condition field=\"destination_number\" expression=\"^(.*)$\"/></extension>");
+	stream.write_function(&stream, "</context></section></document>");
+
+	root = switch_xml_parse_str_dynamic((char *) stream.data, SWITCH_FALSE);
+	fst_requires(root);
+
+	start = switch_time_now();
+	index = dp_index_create(root);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "indexed %u extensions in %" SWITCH_TIME_T_FMT "us\n", BENCH_EXTENSIONS + 1, switch_time_now() - start);
+	ci = index->contexts;
+	fst_check(ci->indexed == BENCH_EXTENSIONS);
+
+	bitmap = malloc(ci->words * sizeof(uint32_t));
+	caller_profile = switch_caller_profile_new(fst_pool, "user", "XML", "name", "5551212", NULL, NULL, NULL, NULL, "test", "carrier", "");
+
+	for (i = 0; i < (uint32_t) calls; i++) {
+		uint32_t a, b;
+
+		switch_snprintf(destination_number, sizeof(destination_number), "1%05u%05u", (i * 7919) % (BENCH_EXTENSIONS + 100), i);
+		caller_profile->destination_number = destination_number;
+
+		start = switch_time_now();
+		a = route_walk(ci, caller_profile);
+		walk += switch_time_now() - start;
+
+		start = switch_time_now();
+		b = route_indexed(ci, caller_profile, bitmap, values);
+		indexed += switch_time_now() - start;
+
+		if (a != b) {
+			same = 0;
+		}
+	}
+
+	fst_check(same);
+
+	printf("dialplan %u extensions: %.1f us per route walking the context, %.1f us indexed\n", BENCH_EXTENSIONS + 1,
+		   (double) walk / calls, (double) indexed / calls);
+
+	switch_safe_free(values[0]);
+	free(bitmap);
+	dp_index_destroy(index);
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_MINCORE_END()
@@ -2863,6 +2863,14 @@ uint32_t sofia_profile_reg_count(sofia_profile_t *profile)
 	struct cb_helper_sql2str cb;
 	char reg_count[80] = "";
 	char *sql;
+
+	if (profile->reg_index) {
+		sofia_reg_index_stats_t stats;
+
+		sofia_reg_index_stats(profile->reg_index, &stats);
+		return stats.rows;
+	}
+
 	cb.buf = reg_count;
 	cb.len = sizeof(reg_count);
 	sql = switch_mprintf("select count(*) from sip_registrations where profile_name = '%q'", profile->name);
@@ -3060,6 +3068,25 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 					stream->write_function(stream, "CALLS-OUT        \t%u\n", profile->ob_calls);
 					stream->write_function(stream, "FAILED-CALLS-OUT \t%u\n", profile->ob_failed_calls);
 					stream->write_function(stream, "REGISTRATIONS    \t%lu\n", sofia_profile_reg_count(profile));
+					if (profile->reg_index) {
+						sofia_reg_index_stats_t stats;
+
+						sofia_reg_index_stats(profile->reg_index, &stats);
+						stream->write_function(stream, "REG-INDEX        \t%u shards, %" SWITCH_UINT64_T_FMT " lookups, %" SWITCH_UINT64_T_FMT " added, %"
+											   SWITCH_UINT64_T_FMT " removed, %" SWITCH_UINT64_T_FMT " expired\n", stats.shards,
+											   stats.lookups, stats.added, stats.removed, stats.expired);
+					}
+					if (profile->pres_index) {
+						sofia_presence_index_stats_t stats;
+
+						sofia_presence_index_stats(profile->pres_index, &stats);
+						stream->write_function(stream, "PRES-INDEX       \t%u presentities, %u watchers, %" SWITCH_UINT64_T_FMT " hits, %"
+											   SWITCH_UINT64_T_FMT " misses, %" SWITCH_UINT64_T_FMT " invalidations\n", stats.presentities,
+											   stats.watchers, stats.hits, stats.misses, stats.invalidations);
+					}
+					if (profile->msg_workers_started) {
+						stream->write_function(stream, "SIP-WORKERS      \t%d (%u dropped)\n", profile->msg_workers_started, profile->msg_worker_drops);
+					}
 				}
 
 				cb.profile = profile;
@@ -76,6 +76,8 @@ typedef struct sofia_private sofia_private_t;
 
 struct private_object;
 typedef struct private_object private_object_t;
+typedef struct sofia_reg_index_s sofia_reg_index_t;
+typedef struct sofia_presence_index_s sofia_presence_index_t;
 #define NUA_HMAGIC_T sofia_private_t
 
 #define SOFIA_SESSION_TIMEOUT "sofia_session_timeout"
@@ -166,6 +168,7 @@ typedef struct sofia_dispatch_event_s {
 	switch_core_session_t *session;
 	switch_core_session_t *init_session;
 	switch_memory_pool_t *pool;
+	int new_call;
 	struct sofia_dispatch_event_s *next;
 } sofia_dispatch_event_t;
 
@@ -309,6 +312,8 @@ typedef enum {
 	PFLAG_AUTH_REQUIRE_USER,
 	PFLAG_AUTH_CALLS_ACL_ONLY,
 	PFLAG_USE_PORT_FOR_ACL_CHECK,
+	PFLAG_REG_MEMORY_INDEX,
+	PFLAG_PRESENCE_MEMORY_INDEX,
 
 	/* No new flags below this line */
 	PFLAG_MAX
@@ -692,6 +697,8 @@ struct sofia_profile {
 	switch_hash_t *chat_hash;
 	switch_hash_t *reg_nh_hash;
 	switch_hash_t *mwi_debounce_hash;
+	sofia_reg_index_t *reg_index;
+	sofia_presence_index_t *pres_index;
 	//switch_core_db_t *master_db;
 	switch_thread_rwlock_t *rwlock;
 	switch_mutex_t *flag_mutex;
@@ -702,6 +709,7 @@ struct sofia_profile {
 	uint32_t max_proceeding;
 	uint32_t rtp_timeout_sec;
 	uint32_t rtp_hold_timeout_sec;
+	uint32_t rtp_shared_ports;
 	char *odbc_dsn;
 	char *pre_trans_execute;
 	char *post_trans_execute;
@@ -770,6 +778,11 @@ struct sofia_profile {
 	sofia_paid_type_t paid_type;
 	uint32_t rtp_digit_delay;
 	switch_queue_t *event_queue;
+	int msg_workers;
+	int msg_workers_started;
+	uint32_t msg_worker_drops;
+	switch_queue_t *msg_worker_queue[SOFIA_MAX_MSG_QUEUE];
+	switch_thread_t *msg_worker_thread[SOFIA_MAX_MSG_QUEUE];
 	switch_thread_t *thread;
 	switch_core_media_vflag_t vflags;
 	char *ws_ip;
@@ -868,6 +881,91 @@ struct private_object {
 };
 
 
+/* one sip_registrations row as the registration index keeps it */
+typedef struct {
+	const char *call_id;
+	const char *sip_user;
+	const char *sip_host;
+	const char *presence_hosts;
+	const char *contact;
+	const char *status;
+	const char *rpid;
+	long expires;
+	const char *user_agent;
+	const char *server_user;
+	const char *server_host;
+	const char *profile_name;
+	const char *network_ip;
+	const char *network_port;
+	const char *sip_username;
+	const char *sip_realm;
+} sofia_reg_index_row_t;
+
+/* rows matching every field that is set, presence_host matches sip_host or one of the presence_hosts */
+typedef struct {
+	const char *call_id;
+	const char *sip_user;
+	const char *sip_host;
+	const char *presence_host;
+	const char *sip_username;
+	const char *contact;
+	const char *network_ip;
+	const char *network_port;
+	long expires_not;
+} sofia_reg_index_match_t;
+
+typedef struct {
+	uint32_t shards;
+	uint32_t rows;
+	uint64_t lookups;
+	uint64_t added;
+	uint64_t removed;
+	uint64_t expired;
+} sofia_reg_index_stats_t;
+
+/* one sip_subscriptions row as the presence index keeps it */
+typedef struct sofia_presence_watcher_s {
+	char *proto;
+	char *sip_user;
+	char *sip_host;
+	char *sub_to_user;
+	char *sub_to_host;
+	char *presence_hosts;
+	char *event;
+	char *contact;
+	char *call_id;
+	char *full_from;
+	char *full_via;
+	char *user_agent;
+	char *accept;
+	char *profile_name;
+	char *orig_proto;
+	char *full_to;
+	char *network_ip;
+	char *network_port;
+	long expires;
+	long version;
+	struct sofia_presence_watcher_s *next;
+} sofia_presence_watcher_t;
+
+/* watchers of a presentity an event goes to, host matches sub_to_host or one of the presence_hosts */
+typedef struct {
+	const char *proto;
+	const char *event;
+	const char *alt_event;
+	const char *host;
+	const char *sipip;
+	const char *extsipip;
+} sofia_presence_index_match_t;
+
+typedef struct {
+	uint32_t presentities;
+	uint32_t watchers;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t invalidations;
+} sofia_presence_index_stats_t;
+
 struct callback_t {
 	char *val;
 	switch_size_t len;
@@ -1227,6 +1325,30 @@ char *sofia_media_get_multipart(switch_core_session_t *session, const char *pref
 int sofia_glue_tech_simplify(private_object_t *tech_pvt);
 switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *profile, const char *user, const char *host);
 switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_multi(sofia_profile_t *profile, const char *user, const char *host, time_t reg_time, const char *contact_str, long exptime);
+void sofia_reg_index_load(sofia_profile_t *profile);
+
+switch_status_t sofia_reg_index_create(sofia_reg_index_t **indexp, uint32_t shards);
+void sofia_reg_index_destroy(sofia_reg_index_t **indexp);
+void sofia_reg_index_add(sofia_reg_index_t *index, const sofia_reg_index_row_t *row);
+int sofia_reg_index_update(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, const sofia_reg_index_row_t *row);
+int sofia_reg_index_select(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, int reboot, switch_core_db_callback_func_t callback, void *pArg);
+int sofia_reg_index_del(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, int reboot, switch_core_db_callback_func_t callback, void *pArg);
+int sofia_reg_index_expire(sofia_reg_index_t *index, time_t now, int reboot, switch_core_db_callback_func_t callback, void *pArg);
+void sofia_reg_index_stats(sofia_reg_index_t *index, sofia_reg_index_stats_t *stats);
+
+switch_status_t sofia_presence_index_create(sofia_presence_index_t **indexp);
+void sofia_presence_index_destroy(sofia_presence_index_t **indexp);
+sofia_presence_watcher_t *sofia_presence_watcher_dup(const sofia_presence_watcher_t *src);
+void sofia_presence_watchers_free(sofia_presence_watcher_t **list);
+int sofia_presence_index_watchers(sofia_presence_index_t *index, const char *presentity,
+								  const sofia_presence_index_match_t *match, sofia_presence_watcher_t **list);
+uint64_t sofia_presence_index_epoch(sofia_presence_index_t *index);
+int sofia_presence_index_load(sofia_presence_index_t *index, const char *presentity, sofia_presence_watcher_t *rows, uint64_t epoch,
+							  const sofia_presence_index_match_t *match, sofia_presence_watcher_t **list);
+void sofia_presence_index_invalidate(sofia_presence_index_t *index, const char *presentity, const char *call_id, switch_bool_t gone);
+long sofia_presence_index_version(sofia_presence_index_t *index, const char *call_id, long version);
+void sofia_presence_index_expire(sofia_presence_index_t *index, time_t now);
+void sofia_presence_index_stats(sofia_presence_index_t *index, sofia_presence_index_stats_t *stats);
 switch_bool_t sofia_glue_profile_exists(const char *key);
 void sofia_glue_global_siptrace(switch_bool_t on);
 void sofia_glue_global_capture(switch_bool_t on);
@@ -1249,6 +1371,9 @@ switch_status_t sofia_init(void);
 void sofia_glue_fire_events(sofia_profile_t *profile);
 void sofia_event_fire(sofia_profile_t *profile, switch_event_t **event);
 void sofia_queue_message(sofia_dispatch_event_t *de);
+int sofia_msg_worker_index(const char *call_id, const void *nh, int workers);
+void sofia_msg_workers_start(sofia_profile_t *profile);
+void sofia_msg_workers_stop(sofia_profile_t *profile);
 int sofia_glue_check_nat(sofia_profile_t *profile, const char *network_ip);
 void general_event_handler(switch_event_t *event);
 
@@ -143,7 +143,15 @@ void sofia_handle_sip_r_notify(switch_core_session_t *session, int status,
 
 		sql = switch_mprintf("delete from sip_subscriptions where call_id='%q'", sip->sip_call_id->i_id);
 		switch_assert(sql != NULL);
-		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+
+		if (profile->pres_index) {
+			/* the index must not reload the row before the delete is in */
+			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_presence_index_invalidate(profile->pres_index, NULL, sip->sip_call_id->i_id, SWITCH_TRUE);
+		} else {
+			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		}
+
 		nua_handle_destroy(nh);
 	}
 
@@ -1515,7 +1523,8 @@ static void our_sofia_event_callback(nua_event_t event,
 			if (!(gateway = sofia_reg_find_gateway(sofia_private->gateway_name))) {
 				return;
 			}
-		} else if (!zstr(sofia_private->uuid)) {
+		} else if (de->init_session || !zstr(sofia_private->uuid)) {
+			/* the INVITE of a new call is queued before its uuid is published */
 			if ((session = de->init_session)) {
 				de->init_session = NULL;
 			} else if ((session = de->session) || (session = switch_core_session_locate(sofia_private->uuid))) {
@@ -2048,6 +2057,10 @@ static void our_sofia_event_callback(nua_event_t event,
 
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+				if (profile->pres_index) {
+					sofia_presence_index_invalidate(profile->pres_index, to_user, call_id, SWITCH_TRUE);
+				}
+
 				sip_to_tag(nua_handle_get_home(nh), sip->sip_to, to_tag);
 			}
 
@@ -2070,6 +2083,15 @@ static void our_sofia_event_callback(nua_event_t event,
 				char *sql;
 				switch_event_t *event = NULL;
 
+				if (profile->reg_index) {
+					sofia_reg_index_match_t match = { 0 };
+
+					match.call_id = sofia_private->call_id;
+					match.network_ip = sofia_private->network_ip;
+					match.network_port = sofia_private->network_port;
+					sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+				}
+
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q' and network_ip='%q' and network_port='%q'",
 										   sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port);
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "SOCKET DISCONNECT: %s %s:%s\n",
@@ -2363,13 +2385,173 @@ void sofia_msg_thread_start(int idx)
 	switch_mutex_unlock(mod_sofia_globals.mutex);
 }
 
+static void sofia_event_new_call(sofia_dispatch_event_t *de, sofia_private_t *sofia_private);
+
+/* the uuid of a new call is only published once its INVITE sits on the session queue so no later event of the call can overtake it */
+static void sofia_private_publish_uuid(sofia_profile_t *profile, sofia_private_t *sofia_private)
+{
+	switch_mutex_lock(profile->flag_mutex);
+	sofia_private->uuid = sofia_private->uuid_str;
+	switch_mutex_unlock(profile->flag_mutex);
+}
+
+static int sofia_queue_session_event(sofia_private_t *sofia_private, sofia_dispatch_event_t *de)
+{
+	switch_core_session_t *session;
+	const char *uuid;
+
+	if (sofia_private && sofia_private != &mod_sofia_globals.destroy_private && sofia_private != &mod_sofia_globals.keep_private) {
+		switch_mutex_lock(de->profile->flag_mutex);
+		uuid = sofia_private->uuid;
+		switch_mutex_unlock(de->profile->flag_mutex);
+
+		if (uuid && (session = switch_core_session_locate(uuid))) {
+			switch_core_session_queue_signal_data(session, de);
+			switch_core_session_rwunlock(session);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* every message of a call-id goes to the same worker so a dialog is never processed by two threads at once */
+int sofia_msg_worker_index(const char *call_id, const void *nh, int workers)
+{
+	switch_ssize_t klen = SWITCH_HASH_KEY_STRING;
+	unsigned int hash;
+
+	if (workers < 1) {
+		return 0;
+	}
+
+	if (!zstr(call_id)) {
+		hash = switch_hashfunc_default(call_id, &klen);
+	} else {
+		hash = (unsigned int) ((uintptr_t) nh >> 4);
+	}
+
+	return (int) (hash % (unsigned int) workers);
+}
+
+static switch_queue_t *sofia_msg_worker_queue(sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip)
+{
+	const char *call_id = (sip && sip->sip_call_id) ? sip->sip_call_id->i_id : NULL;
+
+	return profile->msg_worker_queue[sofia_msg_worker_index(call_id, nh, profile->msg_workers_started)];
+}
+
+static void *SWITCH_THREAD_FUNC sofia_msg_worker_run(switch_thread_t *thread, void *obj)
+{
+	switch_queue_t *q = (switch_queue_t *) obj;
+	void *pop;
+
+	for(;;) {
+		sofia_dispatch_event_t *de;
+
+		if (switch_queue_pop(q, &pop) != SWITCH_STATUS_SUCCESS) {
+			switch_cond_next();
+			continue;
+		}
+
+		if (!(de = (sofia_dispatch_event_t *) pop)) {
+			break;
+		}
+
+		if (de->new_call) {
+			de->new_call = 0;
+			sofia_event_new_call(de, nua_handle_magic(de->nh));
+		} else if (!sofia_queue_session_event(nua_handle_magic(de->nh), de)) {
+			/* the call this event belongs to may have been set up on this worker after the event was queued */
+			sofia_process_dispatch_event(&de);
+		}
+	}
+
+	return NULL;
+}
+
+void sofia_msg_workers_start(sofia_profile_t *profile)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	int i;
+
+	profile->msg_workers_started = 0;
+	profile->msg_worker_drops = 0;
+
+	if (profile->msg_workers < 1) {
+		return;
+	}
+
+	switch_threadattr_create(&thd_attr, profile->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < profile->msg_workers; i++) {
+		switch_queue_create(&profile->msg_worker_queue[i], SOFIA_MSG_QUEUE_SIZE, profile->pool);
+		switch_thread_create(&profile->msg_worker_thread[i], thd_attr, sofia_msg_worker_run, profile->msg_worker_queue[i], profile->pool);
+	}
+
+	profile->msg_workers_started = profile->msg_workers;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %d message workers for %s\n", profile->msg_workers_started, profile->name);
+}
+
+void sofia_msg_workers_stop(sofia_profile_t *profile)
+{
+	switch_status_t st;
+	int i;
+
+	for (i = 0; i < profile->msg_workers_started; i++) {
+		if (profile->msg_worker_thread[i]) {
+			switch_queue_push(profile->msg_worker_queue[i], NULL);
+			switch_queue_interrupt_all(profile->msg_worker_queue[i]);
+			switch_thread_join(&st, profile->msg_worker_thread[i]);
+			profile->msg_worker_thread[i] = NULL;
+		}
+	}
+
+	profile->msg_workers_started = 0;
+}
+
+/* the su_root thread must never wait on a worker, so an event that does not fit its worker queue is refused */
+static void sofia_msg_worker_drop(sofia_dispatch_event_t *de)
+{
+	nua_handle_t *nh = de->nh;
+	nua_t *nua = de->nua;
+	sofia_profile_t *profile = de->profile;
+	sip_t const *sip = de->sip;
+
+	if (sip && sip->sip_request && de->data->e_event != nua_i_ack) {
+		nua_respond(nh, 503, "System Busy", SIPTAG_RETRY_AFTER_STR("300"), NUTAG_WITH_THIS_MSG(de->data->e_msg), TAG_END());
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Worker queue full on profile %s, dropping %s for call-id %s\n",
+					  profile->name, nua_event_name(de->data->e_event),
+					  (sip && sip->sip_call_id && sip->sip_call_id->i_id) ? sip->sip_call_id->i_id : "N/A");
+
+	nua_destroy_event(de->event);
+	su_free(nua_handle_get_home(nh), de);
+
+	switch_mutex_lock(profile->flag_mutex);
+	profile->queued_events--;
+	profile->msg_worker_drops++;
+	switch_mutex_unlock(profile->flag_mutex);
+
+	nua_handle_unref(nh);
+	nua_unref(nua);
+}
+
 //static int foo = 0;
 void sofia_queue_message(sofia_dispatch_event_t *de)
 {
 	int launch = 0;
 
 	if (mod_sofia_globals.running == 0 || !mod_sofia_globals.msg_queue) {
-		sofia_process_dispatch_event(&de);
+		if (de->new_call) {
+			de->new_call = 0;
+			sofia_event_new_call(de, nua_handle_magic(de->nh));
+		} else {
+			sofia_process_dispatch_event(&de);
+		}
 		return;
 	}
 
@@ -2380,6 +2562,19 @@ void sofia_queue_message(sofia_dispatch_event_t *de)
 		return;
 	}
 
+	if (de->profile && de->profile->msg_workers_started && de->profile->msg_worker_thread[0]) {
+		if (switch_queue_trypush(sofia_msg_worker_queue(de->profile, de->nh, de->sip), de) != SWITCH_STATUS_SUCCESS) {
+			sofia_msg_worker_drop(de);
+		}
+		return;
+	}
+
+	if (de->new_call) {
+		de->new_call = 0;
+		sofia_event_new_call(de, nua_handle_magic(de->nh));
+		return;
+	}
+
 
 	if ((switch_queue_size(mod_sofia_globals.msg_queue) > (SOFIA_MSG_QUEUE_SIZE * (unsigned int)msg_queue_threads))) {
 		launch++;
@@ -2404,6 +2599,136 @@ static void set_call_id(private_object_t *tech_pvt, sip_t const *sip)
 }
 
 
+/* set up the session for a new inbound INVITE, the sofia_private is already bound to the handle */
+static void sofia_event_new_call(sofia_dispatch_event_t *de, sofia_private_t *sofia_private)
+{
+	nua_handle_t *nh = de->nh;
+	nua_t *nua = de->nua;
+	sofia_profile_t *profile = de->profile;
+	sip_t const *sip = de->sip;
+	switch_core_session_t *session;
+	private_object_t *tech_pvt = NULL;
+
+	if (sip->sip_call_id && sip->sip_call_id->i_id) {
+		char *uuid = NULL, *tmp;
+
+		switch_mutex_lock(profile->flag_mutex);
+		if ((tmp = (char *) switch_core_hash_find(profile->chat_hash, sip->sip_call_id->i_id))) {
+			uuid = strdup(tmp);
+			switch_core_hash_delete(profile->chat_hash, sip->sip_call_id->i_id);
+		}
+		switch_mutex_unlock(profile->flag_mutex);
+
+		if (uuid) {
+			if ((session = switch_core_session_locate(uuid))) {
+				tech_pvt = switch_core_session_get_private(session);
+				switch_copy_string(sofia_private->uuid_str, switch_core_session_get_uuid(session), sizeof(sofia_private->uuid_str));
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Re-attaching to session %s\n", sofia_private->uuid_str);
+				de->init_session = session;
+				sofia_clear_flag(tech_pvt, TFLAG_BYE);
+				tech_pvt->sofia_private = NULL;
+				tech_pvt->nh = NULL;
+				/* the session may consume de and drop its handle ref as soon as it is queued */
+				nua_handle_ref(nh);
+				switch_core_session_queue_signal_data(session, de);
+				sofia_private_publish_uuid(profile, sofia_private);
+				nua_handle_unref(nh);
+				switch_core_session_rwunlock(session);
+				session = NULL;
+				free(uuid);
+				uuid = NULL;
+				return;
+			} else {
+				free(uuid);
+				uuid = NULL;
+				sip = NULL;
+			}
+		}
+	}
+
+	if (!sip || !sip->sip_call_id || zstr(sip->sip_call_id->i_id)) {
+		nua_respond(nh, 503, "INVALID INVITE", TAG_END());
+		nua_destroy_event(de->event);
+		su_free(nua_handle_get_home(nh), de);
+
+		switch_mutex_lock(profile->flag_mutex);
+		profile->queued_events--;
+		switch_mutex_unlock(profile->flag_mutex);
+
+		nua_handle_unref(nh);
+		nua_unref(nua);
+
+		return;
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_CALLID_AS_UUID)) {
+		session = switch_core_session_request_uuid(sofia_endpoint_interface, SWITCH_CALL_DIRECTION_INBOUND, SOF_NONE, NULL, sip->sip_call_id->i_id);
+	} else {
+		session = switch_core_session_request(sofia_endpoint_interface, SWITCH_CALL_DIRECTION_INBOUND, SOF_NONE, NULL);
+	}
+
+	if (session) {
+		const char *channel_name = NULL;
+		tech_pvt = sofia_glue_new_pvt(session);
+
+		if (sip->sip_from) {
+			channel_name = url_set_chanvars(session, sip->sip_from->a_url, sip_from);
+		}
+		if (!channel_name && sip->sip_contact) {
+			channel_name = url_set_chanvars(session, sip->sip_contact->m_url, sip_contact);
+		}
+		if (sip->sip_referred_by) {
+			channel_name = url_set_chanvars(session, sip->sip_referred_by->b_url, sip_referred_by);
+		}
+
+		sofia_glue_attach_private(session, profile, tech_pvt, channel_name);
+
+		set_call_id(tech_pvt, sip);
+	} else {
+		nua_respond(nh, 503, "Maximum Calls In Progress", SIPTAG_RETRY_AFTER_STR("300"), TAG_END());
+		nua_destroy_event(de->event);
+		su_free(nua_handle_get_home(nh), de);
+
+		switch_mutex_lock(profile->flag_mutex);
+		profile->queued_events--;
+		switch_mutex_unlock(profile->flag_mutex);
+
+		nua_handle_unref(nh);
+		nua_unref(nua);
+
+		return;
+	}
+
+
+	if (switch_core_session_thread_launch(session) != SWITCH_STATUS_SUCCESS) {
+		char *uuid;
+
+		if (!switch_core_session_running(session) && !switch_core_session_started(session)) {
+			nua_handle_bind(nh, NULL);
+			sofia_private_free(sofia_private);
+			switch_core_session_destroy(&session);
+			nua_respond(nh, 503, "Maximum Calls In Progress", SIPTAG_RETRY_AFTER_STR("300"), TAG_END());
+		}
+		switch_mutex_lock(profile->flag_mutex);
+		if ((uuid = switch_core_hash_find(profile->chat_hash, tech_pvt->call_id))) {
+			free(uuid);
+			uuid = NULL;
+			switch_core_hash_delete(profile->chat_hash, tech_pvt->call_id);
+		}
+		switch_mutex_unlock(profile->flag_mutex);
+
+		return;
+	}
+
+	switch_copy_string(sofia_private->uuid_str, switch_core_session_get_uuid(session), sizeof(sofia_private->uuid_str));
+
+	de->init_session = session;
+	nua_handle_ref(nh);
+	switch_core_session_queue_signal_data(session, de);
+	sofia_private_publish_uuid(profile, sofia_private);
+	nua_handle_unref(nh);
+}
+
 void sofia_event_callback(nua_event_t event,
 						  int status,
 						  char const *phrase,
@@ -2481,7 +2806,9 @@ void sofia_event_callback(nua_event_t event,
 			}
 
 
-			if (switch_queue_size(mod_sofia_globals.msg_queue) > (unsigned int)critical) {
+			if (switch_queue_size(mod_sofia_globals.msg_queue) > (unsigned int)critical ||
+				(profile->msg_workers_started && profile->msg_worker_thread[0] &&
+				 switch_queue_size(sofia_msg_worker_queue(profile, nh, sip)) > (SOFIA_MSG_QUEUE_SIZE * 900) / 1000)) {
 				nua_respond(nh, 503, "System Busy", SIPTAG_RETRY_AFTER_STR("300"), NUTAG_WITH_THIS(nua), TAG_END());
 				goto end;
 			}
@@ -2513,9 +2840,6 @@ void sofia_event_callback(nua_event_t event,
 	de->nua = (nua_t *)su_home_ref(nua_get_home(nua));
 
 	if (event == nua_i_invite && !sofia_private) {
-		switch_core_session_t *session;
-		private_object_t *tech_pvt = NULL;
-
 		if (!(sofia_private = su_alloc(nua_handle_get_home(nh), sizeof(*sofia_private)))) {
 			abort();
 		}
@@ -2525,131 +2849,19 @@ void sofia_event_callback(nua_event_t event,
 		sofia_private->is_static++;
 		nua_handle_bind(nh, sofia_private);
 
-
-		if (sip->sip_call_id && sip->sip_call_id->i_id) {
-			char *uuid = NULL, *tmp;
-
-			switch_mutex_lock(profile->flag_mutex);
-			if ((tmp = (char *) switch_core_hash_find(profile->chat_hash, sip->sip_call_id->i_id))) {
-				uuid = strdup(tmp);
-				switch_core_hash_delete(profile->chat_hash, sip->sip_call_id->i_id);
-			}
-			switch_mutex_unlock(profile->flag_mutex);
-
-			if (uuid) {
-				if ((session = switch_core_session_locate(uuid))) {
-					tech_pvt = switch_core_session_get_private(session);
-					switch_copy_string(sofia_private->uuid_str, switch_core_session_get_uuid(session), sizeof(sofia_private->uuid_str));
-					sofia_private->uuid = sofia_private->uuid_str;
-					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Re-attaching to session %s\n", sofia_private->uuid);
-					de->init_session = session;
-					sofia_clear_flag(tech_pvt, TFLAG_BYE);
-					tech_pvt->sofia_private = NULL;
-					tech_pvt->nh = NULL;
-					switch_core_session_queue_signal_data(session, de);
-					switch_core_session_rwunlock(session);
-					session = NULL;
-					free(uuid);
-					uuid = NULL;
-					goto end;
-				} else {
-					free(uuid);
-					uuid = NULL;
-					sip = NULL;
-				}
-			}
-		}
-
-		if (!sip || !sip->sip_call_id || zstr(sip->sip_call_id->i_id)) {
-			nua_respond(nh, 503, "INVALID INVITE", TAG_END());
-			nua_destroy_event(de->event);
-			su_free(nua_handle_get_home(nh), de);
-
-			switch_mutex_lock(profile->flag_mutex);
-			profile->queued_events--;
-			switch_mutex_unlock(profile->flag_mutex);
-
-			nua_handle_unref(nh);
-			nua_unref(nua);
-
-			goto end;
-		}
-
-		if (sofia_test_pflag(profile, PFLAG_CALLID_AS_UUID)) {
-			session = switch_core_session_request_uuid(sofia_endpoint_interface, SWITCH_CALL_DIRECTION_INBOUND, SOF_NONE, NULL, sip->sip_call_id->i_id);
-		} else {
-			session = switch_core_session_request(sofia_endpoint_interface, SWITCH_CALL_DIRECTION_INBOUND, SOF_NONE, NULL);
-		}
-
-		if (session) {
-			const char *channel_name = NULL;
-			tech_pvt = sofia_glue_new_pvt(session);
-
-			if (sip->sip_from) {
-				channel_name = url_set_chanvars(session, sip->sip_from->a_url, sip_from);
-			}
-			if (!channel_name && sip->sip_contact) {
-				channel_name = url_set_chanvars(session, sip->sip_contact->m_url, sip_contact);
-			}
-			if (sip->sip_referred_by) {
-				channel_name = url_set_chanvars(session, sip->sip_referred_by->b_url, sip_referred_by);
-			}
-
-			sofia_glue_attach_private(session, profile, tech_pvt, channel_name);
-
-			set_call_id(tech_pvt, sip);
+		if (profile->msg_workers_started && profile->msg_worker_thread[0]) {
+			/* leave the session setup to the worker of this call-id, later events of the call queue up behind it */
+			de->new_call = 1;
+			sofia_queue_message(de);
 		} else {
-			nua_respond(nh, 503, "Maximum Calls In Progress", SIPTAG_RETRY_AFTER_STR("300"), TAG_END());
-			nua_destroy_event(de->event);
-			su_free(nua_handle_get_home(nh), de);
-
-			switch_mutex_lock(profile->flag_mutex);
-			profile->queued_events--;
-			switch_mutex_unlock(profile->flag_mutex);
-
-			nua_handle_unref(nh);
-			nua_unref(nua);
-
-			goto end;
-		}
-
-
-		if (switch_core_session_thread_launch(session) != SWITCH_STATUS_SUCCESS) {
-			char *uuid;
-
-			if (!switch_core_session_running(session) && !switch_core_session_started(session)) {
-				nua_handle_bind(nh, NULL);
-				sofia_private_free(sofia_private);
-				switch_core_session_destroy(&session);
-				nua_respond(nh, 503, "Maximum Calls In Progress", SIPTAG_RETRY_AFTER_STR("300"), TAG_END());
-			}
-			switch_mutex_lock(profile->flag_mutex);
-			if ((uuid = switch_core_hash_find(profile->chat_hash, tech_pvt->call_id))) {
-				free(uuid);
-				uuid = NULL;
-				switch_core_hash_delete(profile->chat_hash, tech_pvt->call_id);
-			}
-			switch_mutex_unlock(profile->flag_mutex);
-
-			goto end;
+			sofia_event_new_call(de, sofia_private);
 		}
 
-		switch_copy_string(sofia_private->uuid_str, switch_core_session_get_uuid(session), sizeof(sofia_private->uuid_str));
-		sofia_private->uuid = sofia_private->uuid_str;
-
-		de->init_session = session;
-		switch_core_session_queue_signal_data(session, de);
 		goto end;
 	}
 
-	if (sofia_private && sofia_private != &mod_sofia_globals.destroy_private && sofia_private != &mod_sofia_globals.keep_private) {
-		switch_core_session_t *session;
-
-		if ((session = switch_core_session_locate(sofia_private->uuid))) {
-			switch_core_session_queue_signal_data(session, de);
-			switch_core_session_rwunlock(session);
-			goto end;
-		}
+	if (sofia_queue_session_event(sofia_private, de)) {
+		goto end;
 	}
 
 	sofia_queue_message(de);
@@ -2734,6 +2946,18 @@ void event_handler(switch_event_t *event)
 			return;
 		}
 
+		if (profile->reg_index) {
+			sofia_reg_index_match_t match = { 0 };
+
+			if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
+				match.call_id = call_id;
+			} else {
+				match.sip_user = from_user;
+				match.sip_host = from_host;
+			}
+			sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+		}
+
 		if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
 			sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
 		} else {
@@ -2798,6 +3022,18 @@ void event_handler(switch_event_t *event)
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Invalid Profile\n");
 			goto end;
 		}
+		if (profile->reg_index) {
+			sofia_reg_index_match_t match = { 0 };
+
+			if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
+				match.call_id = call_id;
+			} else {
+				match.sip_user = from_user;
+				match.sip_host = from_host;
+			}
+			sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+		}
+
 		if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
 			sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
 		} else {
@@ -2858,6 +3094,29 @@ void event_handler(switch_event_t *event)
 		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 
 		switch_find_local_ip(guess_ip4, sizeof(guess_ip4), NULL, AF_INET);
+
+		if (profile->reg_index) {
+			sofia_reg_index_row_t row = { 0 };
+
+			row.call_id = call_id;
+			row.sip_user = from_user;
+			row.sip_host = from_host;
+			row.presence_hosts = presence_hosts;
+			row.contact = contact_str;
+			row.status = "Registered";
+			row.rpid = rpid;
+			row.expires = expires;
+			row.user_agent = user_agent;
+			row.server_user = to_user;
+			row.server_host = guess_ip4;
+			row.profile_name = profile_name;
+			row.network_ip = network_ip;
+			row.network_port = network_port;
+			row.sip_username = username;
+			row.sip_realm = realm;
+			sofia_reg_index_add(profile->reg_index, &row);
+		}
+
 		sql = switch_mprintf("insert into sip_registrations "
 							 "(call_id, sip_user, sip_host, presence_hosts, contact, status, rpid, expires,"
 							 "user_agent, server_user, server_host, profile_name, hostname, network_ip, network_port, sip_username, sip_realm,"
@@ -3406,12 +3665,26 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		switch_event_fire(&s_event);
 	}
 
+	if (sofia_test_pflag(profile, PFLAG_REG_MEMORY_INDEX)) {
+		if (sofia_reg_index_create(&profile->reg_index, 0) == SWITCH_STATUS_SUCCESS) {
+			sofia_reg_index_load(profile);
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Cannot create the registration index for %s, using the database\n", profile->name);
+		}
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_PRESENCE_MEMORY_INDEX) &&
+		sofia_presence_index_create(&profile->pres_index) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Cannot create the presence index for %s, using the database\n", profile->name);
+	}
+
 	sofia_glue_add_profile(profile->name, profile);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Starting thread for %s\n", profile->name);
 
 	profile->started = switch_epoch_time_now(NULL);
 
+	sofia_msg_workers_start(profile);
 	sofia_set_pflag_locked(profile, PFLAG_RUNNING);
 	worker_thread = launch_sofia_worker_thread(profile);
 
@@ -3470,6 +3743,7 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		}
 	}
 	nua_destroy(profile->nua);
+	sofia_msg_workers_stop(profile);
 
 	switch_mutex_lock(profile->ireg_mutex);
 	switch_mutex_unlock(profile->ireg_mutex);
@@ -3518,6 +3792,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 	switch_core_hash_destroy(&profile->chat_hash);
 	switch_core_hash_destroy(&profile->reg_nh_hash);
 	switch_core_hash_destroy(&profile->mwi_debounce_hash);
+	sofia_reg_index_destroy(&profile->reg_index);
+	sofia_presence_index_destroy(&profile->pres_index);
 
 	switch_thread_rwlock_unlock(profile->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write unlock %s\n", profile->name);
@@ -4990,6 +5266,34 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						} else {
 							sofia_clear_pflag(profile, PFLAG_THREAD_PER_REG);
 						}
+					} else if (!strcasecmp(var, "reg-memory-index")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_REG_MEMORY_INDEX);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_REG_MEMORY_INDEX);
+						}
+					} else if (!strcasecmp(var, "presence-memory-index")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_PRESENCE_MEMORY_INDEX);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_PRESENCE_MEMORY_INDEX);
+						}
+					} else if (!strcasecmp(var, "sip-worker-threads") && val) {
+						int workers = !strcasecmp(val, "auto") ? mod_sofia_globals.cpu_count : atoi(val);
+
+						if (workers < 0) {
+							workers = 0;
+						} else if (workers > SOFIA_MAX_MSG_QUEUE) {
+							workers = SOFIA_MAX_MSG_QUEUE;
+						}
+
+						/* the workers are sized once when the profile starts, a rescan cannot resize them */
+						if (!profile_already_started) {
+							profile->msg_workers = workers;
+						} else if (workers != profile->msg_workers_started) {
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+											  "sip-worker-threads change ignored on rescan, restart profile %s to apply it\n", profile->name);
+						}
 					} else if (!strcasecmp(var, "inbound-use-callid-as-uuid")) {
 						if (switch_true(val)) {
 							sofia_set_pflag(profile, PFLAG_CALLID_AS_UUID);
@@ -5234,6 +5538,11 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
 											  "rtp-hold-timeout-sec deprecated use media_hold_timeout variable.\n"); 
 						}
+					} else if (!strcasecmp(var, "rtp-shared-ports") && !zstr(val)) {
+						int v = atoi(val);
+						if (v >= 0) {
+							profile->rtp_shared_ports = v;
+						}
 					} else if (!strcasecmp(var, "disable-transfer")) {
 						if (switch_true(val)) {
 							profile->mflags &= ~MFLAG_REFER;
@@ -6401,6 +6710,17 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Expire sip user '%s@%s' due to options failure\n",
 								  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 
+						if (profile->reg_index) {
+							sofia_reg_index_match_t match = { 0 };
+							sofia_reg_index_row_t row = { 0 };
+
+							match.sip_user = sip->sip_to->a_url->url_user;
+							match.sip_host = sip->sip_to->a_url->url_host;
+							match.call_id = call_id;
+							row.expires = (long) now;
+							sofia_reg_index_update(profile->reg_index, &match, &row);
+						}
+
 						sql = switch_mprintf("update sip_registrations set expires=%ld, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 											 (long) now, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
 						sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
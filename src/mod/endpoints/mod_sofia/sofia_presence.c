@@ -95,7 +95,8 @@ struct presence_helper {
 	char last_uuid[512];
 	int hup;
 	int calls_up;
-
+	/* pidf bodies already rendered for this event, only set while fanning out from the presence index */
+	switch_hash_t *bodies;
 };
 
 switch_status_t sofia_presence_chat_send(switch_event_t *message_event)
@@ -980,6 +981,10 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							 from_user, from_host, event_str);
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		if (profile->pres_index) {
+			sofia_presence_index_invalidate(profile->pres_index, from_user, NULL, SWITCH_FALSE);
+		}
 	}
 
 	if (call_id) {
@@ -992,6 +997,10 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							   from_user, from_host, event_str, call_id);
 
 		  sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		  if (profile->pres_index) {
+			  sofia_presence_index_invalidate(profile->pres_index, from_user, NULL, SWITCH_FALSE);
+		  }
 	   }
 
 		sql = switch_mprintf("select full_to, full_from, contact %q ';_;isfocus', expires, call_id, event, network_ip, network_port, "
@@ -1013,6 +1022,10 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							  from_user, from_host, event_str);
 
 		 sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		 if (profile->pres_index) {
+			 sofia_presence_index_invalidate(profile->pres_index, from_user, NULL, SWITCH_FALSE);
+		 }
 	  }
 
 		sql = switch_mprintf("select full_to, full_from, contact %q ';_;isfocus', expires, call_id, event, network_ip, network_port, "
@@ -1045,6 +1058,10 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 		}
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		if (profile->pres_index) {
+			sofia_presence_index_invalidate(profile->pres_index, from_user, NULL, SWITCH_FALSE);
+		}
 	}
 
 
@@ -1095,6 +1112,209 @@ static void conference_data_event_handler(switch_event_t *event)
 	switch_safe_free(dup_domain);
 }
 
+struct presence_index_rows {
+	sofia_presence_watcher_t *head;
+	sofia_presence_watcher_t **tail;
+};
+
+static int presence_index_rows_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct presence_index_rows *rows = (struct presence_index_rows *) pArg;
+	sofia_presence_watcher_t w = { 0 }, *c;
+
+	w.proto = argv[0];
+	w.sip_user = argv[1];
+	w.sip_host = argv[2];
+	w.sub_to_user = argv[3];
+	w.sub_to_host = argv[4];
+	w.presence_hosts = argv[5];
+	w.event = argv[6];
+	w.contact = argv[7];
+	w.call_id = argv[8];
+	w.full_from = argv[9];
+	w.full_via = argv[10];
+	w.expires = argv[11] ? atol(argv[11]) : 0;
+	w.user_agent = argv[12];
+	w.accept = argv[13];
+	w.profile_name = argv[14];
+	w.orig_proto = argv[15];
+	w.full_to = argv[16];
+	w.network_ip = argv[17];
+	w.network_port = argv[18];
+	w.version = argv[19] ? atol(argv[19]) : 0;
+
+	if (zstr(w.call_id)) {
+		return 0;
+	}
+
+	c = sofia_presence_watcher_dup(&w);
+	*rows->tail = c;
+	rows->tail = &c->next;
+
+	return 0;
+}
+
+struct presence_index_status {
+	char *sip_host;
+	char *status;
+	char *rpid;
+	char *open_closed;
+	struct presence_index_status *next;
+};
+
+static int presence_index_status_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct presence_index_status **list = (struct presence_index_status **) pArg, *ps;
+
+	switch_zmalloc(ps, sizeof(*ps));
+	ps->sip_host = strdup(switch_str_nil(argv[0]));
+	ps->status = strdup(switch_str_nil(argv[1]));
+	ps->rpid = strdup(switch_str_nil(argv[2]));
+	ps->open_closed = strdup(switch_str_nil(argv[3]));
+	ps->next = *list;
+	*list = ps;
+
+	return 0;
+}
+
+static void presence_index_bodies_destroy(switch_hash_t **bodies)
+{
+	switch_hash_index_t *hi;
+	const void *key;
+	void *val;
+
+	for (hi = switch_core_hash_first(*bodies); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, &key, NULL, &val);
+		free(val);
+	}
+
+	switch_core_hash_destroy(bodies);
+}
+
+/* Send a presence event to the watchers of euser the presence index has for this profile.
+   This is the lookup the select on sip_subscriptions left join sip_presence does without the index,
+   the subscriptions come from memory and only the presentity's sip_presence rows are read. */
+static int presence_index_fanout(sofia_profile_t *profile, struct presence_helper *helper, const char *proto,
+								 const char *event_type, const char *alt_event_type, const char *euser, const char *host,
+								 const char *status, const char *rpid, struct dialog_helper *dh)
+{
+	static const char *names[] = { "proto", "sip_user", "sip_host", "sub_to_user", "sub_to_host", "event", "contact", "call_id",
+								   "full_from", "full_via", "expires", "user_agent", "accept", "profile_name", "status", "rpid",
+								   "host", "sip_presence.status", "sip_presence.rpid", "sip_presence.open_closed", "dialog_status",
+								   "dialog_rpid", "version", "presence_id", "orig_proto", "full_to", "network_ip", "network_port" };
+	sofia_presence_index_match_t match = { 0 };
+	sofia_presence_watcher_t *watchers = NULL, *w;
+	struct presence_index_status *statuses = NULL, *ps;
+	char *sql;
+	int count;
+
+	match.proto = proto;
+	match.event = event_type;
+	match.alt_event = alt_event_type;
+	match.host = host;
+	match.sipip = profile->sipip;
+	match.extsipip = profile->extsipip;
+
+	if ((count = sofia_presence_index_watchers(profile->pres_index, euser, &match, &watchers)) < 0) {
+		struct presence_index_rows rows = { 0 };
+		uint64_t epoch = sofia_presence_index_epoch(profile->pres_index);
+
+		rows.tail = &rows.head;
+
+		sql = switch_mprintf("select proto,sip_user,sip_host,sub_to_user,sub_to_host,presence_hosts,event,contact,call_id,"
+							 "full_from,full_via,expires,user_agent,accept,profile_name,orig_proto,full_to,network_ip,network_port,version "
+							 "from sip_subscriptions where hostname='%q' and profile_name='%q' and sub_to_user='%q' and event != 'line-seize'",
+							 mod_sofia_globals.hostname, profile->name, euser);
+
+		if (mod_sofia_globals.debug_presence > 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "PRES INDEX LOAD SQL %s\n", sql);
+		}
+
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, presence_index_rows_callback, &rows);
+		switch_safe_free(sql);
+
+		count = sofia_presence_index_load(profile->pres_index, euser, rows.head, epoch, &match, &watchers);
+	}
+
+	if (count < 1) {
+		return 0;
+	}
+
+	/* the index already handed out the new versions, the table catches up behind */
+	sql = switch_mprintf("update sip_subscriptions set version=version+1 where hostname='%q' and profile_name='%q' and "
+						 "sip_subscriptions.event != 'line-seize' "
+						 "and sip_subscriptions.proto='%q' and (event='%q' or event='%q') and sub_to_user='%q' and "
+						 "(sub_to_host='%q' or sub_to_host='%q' or sub_to_host='%q' or "
+						 "presence_hosts like '%%%q%%')",
+						 mod_sofia_globals.hostname, profile->name,
+						 proto, event_type, alt_event_type, euser, host, profile->sipip,
+						 profile->extsipip ? profile->extsipip : "N/A", host);
+	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+
+	sql = switch_mprintf("select sip_host,status,rpid,open_closed from sip_presence where hostname='%q' and profile_name='%q' and sip_user='%q'",
+						 mod_sofia_globals.hostname, profile->name, euser);
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, presence_index_status_callback, &statuses);
+	switch_safe_free(sql);
+
+	switch_core_hash_init(&helper->bodies);
+
+	for (w = watchers; w; w = w->next) {
+		char expires[32], version[32];
+		char *argv[28];
+
+		for (ps = statuses; ps && strcmp(ps->sip_host, w->sub_to_host); ps = ps->next);
+
+		switch_snprintf(expires, sizeof(expires), "%ld", w->expires);
+		switch_snprintf(version, sizeof(version), "%ld", w->version);
+
+		argv[0] = w->proto;
+		argv[1] = w->sip_user;
+		argv[2] = w->sip_host;
+		argv[3] = w->sub_to_user;
+		argv[4] = w->sub_to_host;
+		argv[5] = w->event;
+		argv[6] = w->contact;
+		argv[7] = w->call_id;
+		argv[8] = w->full_from;
+		argv[9] = w->full_via;
+		argv[10] = expires;
+		argv[11] = w->user_agent;
+		argv[12] = w->accept;
+		argv[13] = w->profile_name;
+		argv[14] = (char *) switch_str_nil(status);
+		argv[15] = (char *) switch_str_nil(rpid);
+		argv[16] = (char *) host;
+		argv[17] = ps ? ps->status : NULL;
+		argv[18] = ps ? ps->rpid : NULL;
+		argv[19] = ps ? ps->open_closed : NULL;
+		argv[20] = dh->status;
+		argv[21] = dh->rpid;
+		argv[22] = version;
+		argv[23] = dh->presence_id;
+		argv[24] = w->orig_proto;
+		argv[25] = w->full_to;
+		argv[26] = w->network_ip;
+		argv[27] = w->network_port;
+
+		sofia_presence_sub_callback(helper, 28, argv, (char **) names);
+	}
+
+	presence_index_bodies_destroy(&helper->bodies);
+
+	while ((ps = statuses)) {
+		statuses = ps->next;
+		free(ps->sip_host);
+		free(ps->status);
+		free(ps->rpid);
+		free(ps->open_closed);
+		free(ps);
+	}
+
+	sofia_presence_watchers_free(&watchers);
+
+	return count;
+}
+
 static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event)
 {
 	sofia_profile_t *profile = NULL;
@@ -1115,6 +1335,7 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 	switch_console_callback_match_t *matches = NULL;
 	struct presence_helper helper = { 0 };
 	int hup = 0;
+	int index_fanout = 0;
 	switch_event_t *s_event = NULL;
 
 	if (!mod_sofia_globals.running) {
@@ -1418,7 +1639,11 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 					goto done;
 				}
 
-				if (zstr(call_id)) {
+				index_fanout = 0;
+
+				if (zstr(call_id) && profile->pres_index) {
+					index_fanout = 1;
+				} else if (zstr(call_id)) {
 
 					sql = switch_mprintf("update sip_subscriptions set version=version+1 where hostname='%q' and profile_name='%q' and "
 										 "sip_subscriptions.event != 'line-seize' "
@@ -1476,6 +1701,11 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 
 					sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+					/* the table is ahead of the watcher the index holds for this call_id now, reload it from there */
+					if (profile->pres_index) {
+						sofia_presence_index_invalidate(profile->pres_index, NULL, call_id, SWITCH_FALSE);
+					}
+
 
 					sql = switch_mprintf("select distinct sip_subscriptions.proto,sip_subscriptions.sip_user,sip_subscriptions.sip_host,"
 										 "sip_subscriptions.sub_to_user,sip_subscriptions.sub_to_host,sip_subscriptions.event,"
@@ -1516,15 +1746,19 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 					switch_event_serialize(event, &buf, SWITCH_FALSE);
 					switch_assert(buf);
 					if (mod_sofia_globals.debug_presence > 1) {
-						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DUMP PRESENCE SQL:\n%s\nEVENT DUMP:\n%s\n", sql, buf);
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DUMP PRESENCE SQL:\n%s\nEVENT DUMP:\n%s\n", switch_str_nil(sql), buf);
 					} else {
 						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "EVENT DUMP:\n%s\n", buf);
 					}
 					free(buf);
 				}
 
-				sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_sub_callback, &helper);
-				switch_safe_free(sql);
+				if (index_fanout) {
+					presence_index_fanout(profile, &helper, proto, event_type, alt_event_type, euser, host, status, rpid, &dh);
+				} else {
+					sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_sub_callback, &helper);
+					switch_safe_free(sql);
+				}
 
 				if (mod_sofia_globals.debug_presence > 0) {
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s END_PRESENCE_SQL (%s)\n",
@@ -2376,6 +2610,7 @@ static int sofia_dialog_probe_notify_callback(void *pArg, int argc, char **argv,
 {
 	struct rfc4235_helper *sh = (struct rfc4235_helper *) pArg;
 	char key[256] = "";
+	char version_buf[32] = "";
 	char *data = NULL;
 	char *call_id = argv[0];
 	char *expires = argv[1];
@@ -2417,6 +2652,12 @@ static int sofia_dialog_probe_notify_callback(void *pArg, int argc, char **argv,
 		version = "0";
 	}
 
+	if (sh->profile->pres_index) {
+		/* the index may have sent newer versions than the table has caught up with */
+		switch_snprintf(version_buf, sizeof(version_buf), "%ld", sofia_presence_index_version(sh->profile->pres_index, call_id, atol(version)));
+		version = version_buf;
+	}
+
 	stream.write_function(&stream,
 						  "<?xml version=\"1.0\"?>\n"
 						  "<dialog-info xmlns=\"urn:ietf:params:xml:ns:dialog-info\" "
@@ -2597,6 +2838,35 @@ static char *gen_pidf(char *user_agent, char *id, char *url, char *open, char *r
 	return ret;
 }
 
+#define pidf_key_part(_s) ((_s) ? (_s) : "\001")
+
+/* every watcher of a presentity with the same contact and state gets the same pidf, render it once per event */
+static char *presence_helper_pidf(struct presence_helper *helper, char *user_agent, char *id, char *url, char *open,
+								  char *rpid, char *prpid, char *status, const char **ct)
+{
+	char *key, *ret, *body;
+	int polycom;
+
+	if (!helper->bodies) {
+		return gen_pidf(user_agent, id, url, open, rpid, prpid, status, ct);
+	}
+
+	polycom = switch_stristr("polycom", user_agent) ? 1 : 0;
+	key = switch_mprintf("%d\n%s\n%s\n%s\n%s\n%s\n%s", polycom, pidf_key_part(id), pidf_key_part(url), pidf_key_part(open),
+						 pidf_key_part(rpid), pidf_key_part(prpid), pidf_key_part(status));
+
+	if ((body = switch_core_hash_find(helper->bodies, key))) {
+		*ct = polycom ? "application/xpidf+xml" : "application/pidf+xml";
+		ret = strdup(body);
+	} else if ((ret = gen_pidf(user_agent, id, url, open, rpid, prpid, status, ct))) {
+		switch_core_hash_insert(helper->bodies, key, strdup(ret));
+	}
+
+	free(key);
+
+	return ret;
+}
+
 static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	struct presence_helper *helper = (struct presence_helper *) pArg;
@@ -3176,7 +3446,7 @@ static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char *
 			}
 
 			contact_stripped = sofia_glue_strip_uri(contact_str);
-			pl = gen_pidf(user_agent, clean_id, contact_stripped, open, rpid, prpid, status_line, &ct);
+			pl = presence_helper_pidf(helper, user_agent, clean_id, contact_stripped, open, rpid, prpid, status_line, &ct);
 			free(contact_stripped);
 		}
 
@@ -3202,7 +3472,7 @@ static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char *
 		}
 
 		contact_stripped = sofia_glue_strip_uri(contact_str);
-		pl = gen_pidf(user_agent, clean_id, contact_stripped, open, rpid, prpid, status, &ct);
+		pl = presence_helper_pidf(helper, user_agent, clean_id, contact_stripped, open, rpid, prpid, status, &ct);
 		free(contact_stripped);
 	}
 
@@ -3924,6 +4194,10 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 		}
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		if (profile->pres_index) {
+			sofia_presence_index_invalidate(profile->pres_index, to_user, call_id, SWITCH_FALSE);
+		}
 	} else {
 
 		if (sub_state == nua_substate_terminated) {
@@ -3937,6 +4211,11 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 
 			switch_assert(sql != NULL);
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+			if (profile->pres_index) {
+				sofia_presence_index_invalidate(profile->pres_index, to_user, call_id, SWITCH_TRUE);
+			}
+
 			sstr = switch_mprintf("terminated;reason=noresource");
 
 		} else {
@@ -3971,6 +4250,11 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 
 
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+			if (profile->pres_index) {
+				sofia_presence_index_invalidate(profile->pres_index, to_user, call_id, SWITCH_TRUE);
+			}
+
 			sstr = switch_mprintf("active;expires=%ld", exp_delta);
 		}
 
@@ -5098,6 +5382,10 @@ void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 		}
+
+		if (profile->pres_index) {
+			sofia_presence_index_expire(profile->pres_index, now);
+		}
 	}
 
 
@@ -0,0 +1,456 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sofia_presence_index.c -- SOFIA SIP Endpoint (in memory presence watcher index)
+ *
+ * With presence-memory-index enabled the profile keeps the sip_subscriptions rows of every presentity
+ * it fanned out to, so the next state change of that presentity finds its watchers without a query.
+ * A presentity is loaded from the table on its first event and dropped again whenever one of its
+ * subscriptions is written. The dialog-info versions live here and are written behind.
+ *
+ */
+#include "mod_sofia.h"
+
+typedef struct {
+	char *presentity;
+	long version;
+	long expires;
+} sofia_presence_index_version_t;
+
+struct sofia_presence_index_s {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	/* sub_to_user -> cached watchers, a presentity without watchers is cached as an empty list */
+	switch_hash_t *presentities;
+	/* call_id -> last version handed out */
+	switch_hash_t *versions;
+	uint64_t epoch;
+	uint32_t cached;
+	uint32_t watchers;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t invalidations;
+};
+
+typedef struct {
+	sofia_presence_watcher_t *head;
+} sofia_presence_index_entry_t;
+
+#define PRESENCE_WATCHER_STRINGS 19
+
+static const char **watcher_strings(const sofia_presence_watcher_t *w, const char **s)
+{
+	s[0] = w->proto;
+	s[1] = w->sip_user;
+	s[2] = w->sip_host;
+	s[3] = w->sub_to_user;
+	s[4] = w->sub_to_host;
+	s[5] = w->presence_hosts;
+	s[6] = w->event;
+	s[7] = w->contact;
+	s[8] = w->call_id;
+	s[9] = w->full_from;
+	s[10] = w->full_via;
+	s[11] = w->user_agent;
+	s[12] = w->accept;
+	s[13] = w->profile_name;
+	s[14] = w->orig_proto;
+	s[15] = w->full_to;
+	s[16] = w->network_ip;
+	s[17] = w->network_port;
+	s[18] = NULL;
+
+	return s;
+}
+
+sofia_presence_watcher_t *sofia_presence_watcher_dup(const sofia_presence_watcher_t *src)
+{
+	sofia_presence_watcher_t *w;
+	const char *s[PRESENCE_WATCHER_STRINGS];
+	char **d[PRESENCE_WATCHER_STRINGS];
+	size_t len[PRESENCE_WATCHER_STRINGS], total = 0;
+	char *p;
+	int i;
+
+	watcher_strings(src, s);
+
+	for (i = 0; i < PRESENCE_WATCHER_STRINGS - 1; i++) {
+		len[i] = strlen(s[i] ? s[i] : "") + 1;
+		total += len[i];
+	}
+
+	switch_zmalloc(w, sizeof(*w) + total);
+
+	d[0] = &w->proto;
+	d[1] = &w->sip_user;
+	d[2] = &w->sip_host;
+	d[3] = &w->sub_to_user;
+	d[4] = &w->sub_to_host;
+	d[5] = &w->presence_hosts;
+	d[6] = &w->event;
+	d[7] = &w->contact;
+	d[8] = &w->call_id;
+	d[9] = &w->full_from;
+	d[10] = &w->full_via;
+	d[11] = &w->user_agent;
+	d[12] = &w->accept;
+	d[13] = &w->profile_name;
+	d[14] = &w->orig_proto;
+	d[15] = &w->full_to;
+	d[16] = &w->network_ip;
+	d[17] = &w->network_port;
+
+	p = (char *) (w + 1);
+
+	for (i = 0; i < PRESENCE_WATCHER_STRINGS - 1; i++) {
+		memcpy(p, s[i] ? s[i] : "", len[i]);
+		*d[i] = p;
+		p += len[i];
+	}
+
+	w->expires = src->expires;
+	w->version = src->version;
+
+	return w;
+}
+
+void sofia_presence_watchers_free(sofia_presence_watcher_t **list)
+{
+	sofia_presence_watcher_t *w;
+
+	while ((w = *list)) {
+		*list = w->next;
+		free(w);
+	}
+}
+
+static int presence_index_match(const sofia_presence_watcher_t *w, const sofia_presence_index_match_t *match)
+{
+	if (!match) {
+		return 1;
+	}
+
+	if (match->proto && strcmp(w->proto, match->proto)) {
+		return 0;
+	}
+
+	if (match->event && strcmp(w->event, match->event) && (!match->alt_event || strcmp(w->event, match->alt_event))) {
+		return 0;
+	}
+
+	/* sub_to_host is the host, our sip ip or our ext sip ip, or the host is one of the presence_hosts */
+	if (match->host && strcmp(w->sub_to_host, match->host) &&
+		(!match->sipip || strcmp(w->sub_to_host, match->sipip)) &&
+		(!match->extsipip || strcmp(w->sub_to_host, match->extsipip)) &&
+		!switch_stristr(match->host, w->presence_hosts)) {
+		return 0;
+	}
+
+	return 1;
+}
+
+static void presence_index_version_set(sofia_presence_index_t *index, const sofia_presence_watcher_t *w)
+{
+	sofia_presence_index_version_t *v;
+
+	if (!(v = switch_core_hash_find(index->versions, w->call_id))) {
+		switch_zmalloc(v, sizeof(*v) + strlen(w->sub_to_user) + 1);
+		v->presentity = (char *) (v + 1);
+		strcpy(v->presentity, w->sub_to_user);
+		switch_core_hash_insert(index->versions, w->call_id, v);
+		index->watchers++;
+	}
+
+	v->version = w->version;
+	v->expires = w->expires;
+}
+
+/* bump and copy out every matching watcher, the index must be locked */
+static int presence_index_collect(sofia_presence_index_t *index, sofia_presence_watcher_t *head,
+								  const sofia_presence_index_match_t *match, sofia_presence_watcher_t **list)
+{
+	sofia_presence_watcher_t *w, *c, **tail = list;
+	int count = 0;
+
+	for (w = head; w; w = w->next) {
+		if (!presence_index_match(w, match)) {
+			continue;
+		}
+
+		w->version++;
+		presence_index_version_set(index, w);
+
+		c = sofia_presence_watcher_dup(w);
+		*tail = c;
+		tail = &c->next;
+		count++;
+	}
+
+	return count;
+}
+
+static void presence_index_drop(sofia_presence_index_t *index, const char *presentity)
+{
+	sofia_presence_index_entry_t *entry;
+
+	if ((entry = switch_core_hash_delete(index->presentities, presentity))) {
+		sofia_presence_watchers_free(&entry->head);
+		free(entry);
+		index->cached--;
+	}
+}
+
+switch_status_t sofia_presence_index_create(sofia_presence_index_t **indexp)
+{
+	switch_memory_pool_t *pool = NULL;
+	sofia_presence_index_t *index;
+
+	if (switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	index = switch_core_alloc(pool, sizeof(*index));
+	index->pool = pool;
+	switch_mutex_init(&index->mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&index->presentities);
+	switch_core_hash_init(&index->versions);
+
+	*indexp = index;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void sofia_presence_index_destroy(sofia_presence_index_t **indexp)
+{
+	sofia_presence_index_t *index;
+	switch_memory_pool_t *pool;
+
+	if (!indexp || !(index = *indexp)) {
+		return;
+	}
+
+	*indexp = NULL;
+
+	sofia_presence_index_expire(index, 0);
+	switch_core_hash_destroy(&index->presentities);
+	switch_core_hash_destroy(&index->versions);
+
+	pool = index->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+int sofia_presence_index_watchers(sofia_presence_index_t *index, const char *presentity,
+								  const sofia_presence_index_match_t *match, sofia_presence_watcher_t **list)
+{
+	sofia_presence_index_entry_t *entry;
+	int count = -1;
+
+	*list = NULL;
+
+	switch_mutex_lock(index->mutex);
+
+	if ((entry = switch_core_hash_find(index->presentities, presentity))) {
+		count = presence_index_collect(index, entry->head, match, list);
+		index->hits++;
+	} else {
+		index->misses++;
+	}
+
+	switch_mutex_unlock(index->mutex);
+
+	return count;
+}
+
+uint64_t sofia_presence_index_epoch(sofia_presence_index_t *index)
+{
+	uint64_t epoch;
+
+	switch_mutex_lock(index->mutex);
+	epoch = index->epoch;
+	switch_mutex_unlock(index->mutex);
+
+	return epoch;
+}
+
+int sofia_presence_index_load(sofia_presence_index_t *index, const char *presentity, sofia_presence_watcher_t *rows, uint64_t epoch,
+							  const sofia_presence_index_match_t *match, sofia_presence_watcher_t **list)
+{
+	sofia_presence_watcher_t *w;
+	sofia_presence_index_version_t *v;
+	int count;
+
+	*list = NULL;
+
+	switch_mutex_lock(index->mutex);
+
+	/* the table may trail the versions we already sent by a queue flush, every row gets known by
+	   its call_id so a write that only knows the call_id can still find the presentity */
+	for (w = rows; w; w = w->next) {
+		if ((v = switch_core_hash_find(index->versions, w->call_id)) && v->version > w->version) {
+			w->version = v->version;
+		}
+		presence_index_version_set(index, w);
+	}
+
+	count = presence_index_collect(index, rows, match, list);
+
+	/* rows read before a write to one of the subscriptions are good for this event but not worth keeping */
+	if (epoch == index->epoch) {
+		sofia_presence_index_entry_t *entry;
+
+		presence_index_drop(index, presentity);
+		switch_zmalloc(entry, sizeof(*entry));
+		entry->head = rows;
+		switch_core_hash_insert(index->presentities, presentity, entry);
+		index->cached++;
+		rows = NULL;
+	}
+
+	switch_mutex_unlock(index->mutex);
+
+	sofia_presence_watchers_free(&rows);
+
+	return count;
+}
+
+void sofia_presence_index_invalidate(sofia_presence_index_t *index, const char *presentity, const char *call_id, switch_bool_t gone)
+{
+	sofia_presence_index_version_t *v;
+
+	switch_mutex_lock(index->mutex);
+
+	index->epoch++;
+	index->invalidations++;
+
+	if (presentity) {
+		presence_index_drop(index, presentity);
+	}
+
+	if (call_id && (v = switch_core_hash_find(index->versions, call_id))) {
+		presence_index_drop(index, v->presentity);
+
+		if (gone) {
+			switch_core_hash_delete(index->versions, call_id);
+			index->watchers--;
+			free(v);
+		}
+	}
+
+	switch_mutex_unlock(index->mutex);
+}
+
+long sofia_presence_index_version(sofia_presence_index_t *index, const char *call_id, long version)
+{
+	sofia_presence_index_version_t *v;
+
+	switch_mutex_lock(index->mutex);
+
+	if ((v = switch_core_hash_find(index->versions, call_id))) {
+		if (version <= v->version) {
+			version = v->version + 1;
+		}
+		v->version = version;
+	}
+
+	switch_mutex_unlock(index->mutex);
+
+	return version;
+}
+
+void sofia_presence_index_expire(sofia_presence_index_t *index, time_t now)
+{
+	switch_hash_index_t *hi;
+	switch_event_t *gone = NULL;
+	switch_event_header_t *hp;
+	const void *key;
+	void *val;
+
+	switch_event_create(&gone, SWITCH_EVENT_CLONE);
+
+	switch_mutex_lock(index->mutex);
+
+	index->epoch++;
+
+	for (hi = switch_core_hash_first(index->versions); hi; hi = switch_core_hash_next(&hi)) {
+		sofia_presence_index_version_t *v;
+
+		switch_core_hash_this(hi, &key, NULL, &val);
+		v = (sofia_presence_index_version_t *) val;
+
+		/* a version only has to outlive the queued update while its presentity is cached, a reload reads it back */
+		if (!now || (v->expires > 0 && v->expires <= now) || !switch_core_hash_find(index->presentities, v->presentity)) {
+			switch_event_add_header_string(gone, SWITCH_STACK_BOTTOM, "call_id", (const char *) key);
+		}
+	}
+
+	if (!now) {
+		for (hi = switch_core_hash_first(index->presentities); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, &key, NULL, &val);
+			switch_event_add_header_string(gone, SWITCH_STACK_BOTTOM, "presentity", (const char *) key);
+		}
+	}
+
+	/* the keys belong to the hashes, they are copied out before anything is deleted */
+	for (hp = gone ? gone->headers : NULL; hp; hp = hp->next) {
+		sofia_presence_index_version_t *v;
+
+		if (!strcmp(hp->name, "presentity")) {
+			presence_index_drop(index, hp->value);
+		} else if ((v = switch_core_hash_delete(index->versions, hp->value))) {
+			presence_index_drop(index, v->presentity);
+			index->watchers--;
+			free(v);
+		}
+	}
+
+	switch_mutex_unlock(index->mutex);
+
+	switch_event_destroy(&gone);
+}
+
+void sofia_presence_index_stats(sofia_presence_index_t *index, sofia_presence_index_stats_t *stats)
+{
+	switch_mutex_lock(index->mutex);
+	stats->presentities = index->cached;
+	stats->watchers = index->watchers;
+	stats->hits = index->hits;
+	stats->misses = index->misses;
+	stats->invalidations = index->invalidations;
+	switch_mutex_unlock(index->mutex);
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set shiftwidth=4 tabstop=4 softtabstop=4 noet:
+ */
@@ -597,6 +597,99 @@ int sofia_reg_find_reg_with_positive_expires_callback(void *pArg, int argc, char
 	return 0;
 }
 
+/* the registration index hands out whole rows, the find callbacks above only want "contact,expires" */
+struct reg_index_find_helper {
+	switch_core_db_callback_func_t callback;
+	void *pArg;
+};
+
+static int sofia_reg_index_find_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct reg_index_find_helper *h = (struct reg_index_find_helper *) pArg;
+	char *cols[2];
+
+	cols[0] = argv[3];
+	cols[1] = argv[6];
+
+	return h->callback(h->pArg, 2, cols, NULL);
+}
+
+static int sofia_reg_index_find(sofia_profile_t *profile, const char *user, const char *host,
+								switch_core_db_callback_func_t callback, void *pArg)
+{
+	sofia_reg_index_match_t match = { 0 };
+	struct reg_index_find_helper h = { 0 };
+
+	match.sip_user = user;
+	match.presence_host = host;
+	h.callback = callback;
+	h.pArg = pArg;
+
+	return sofia_reg_index_select(profile->reg_index, &match, 0, sofia_reg_index_find_callback, &h);
+}
+
+/* with the registration index the table is only kept for other readers so it can be written behind */
+static void sofia_reg_execute_sql(sofia_profile_t *profile, char **sqlp)
+{
+	if (profile->reg_index) {
+		sofia_glue_execute_sql(profile, sqlp, SWITCH_TRUE);
+	} else {
+		sofia_glue_execute_sql_now(profile, sqlp, SWITCH_TRUE);
+	}
+}
+
+static int sofia_reg_index_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) pArg;
+	sofia_reg_index_row_t row = { 0 };
+
+	if (argc < 16 || zstr(argv[1])) {
+		return 0;
+	}
+
+	row.call_id = argv[0];
+	row.sip_user = argv[1];
+	row.sip_host = argv[2];
+	row.presence_hosts = argv[3];
+	row.contact = argv[4];
+	row.status = argv[5];
+	row.rpid = argv[6];
+	row.expires = argv[7] ? atol(argv[7]) : 0;
+	row.user_agent = argv[8];
+	row.server_user = argv[9];
+	row.server_host = argv[10];
+	row.profile_name = argv[11];
+	row.network_ip = argv[12];
+	row.network_port = argv[13];
+	row.sip_username = argv[14];
+	row.sip_realm = argv[15];
+
+	sofia_reg_index_add(profile->reg_index, &row);
+
+	return 0;
+}
+
+void sofia_reg_index_load(sofia_profile_t *profile)
+{
+	sofia_reg_index_stats_t stats;
+	char *sql;
+
+	if (!profile->reg_index) {
+		return;
+	}
+
+	sql = switch_mprintf("select call_id,sip_user,sip_host,presence_hosts,contact,status,rpid,expires"
+						 ",user_agent,server_user,server_host,profile_name,network_ip,network_port,sip_username,sip_realm"
+						 " from sip_registrations where profile_name='%q' and hostname='%q'", profile->name, mod_sofia_globals.hostname);
+
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_index_load_callback, profile);
+	switch_safe_free(sql);
+
+	sofia_reg_index_stats(profile->reg_index, &stats);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Loaded %u registrations into the registration index for profile %s\n",
+					  stats.rows, profile->name);
+}
+
 
 int sofia_reg_nat_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
@@ -777,16 +870,28 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 		sqlextra = switch_mprintf(" or (sip_user='%q' and sip_host='%q')", user, host);
 	}
 
-	sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						 ",user_agent,server_user,server_host,profile_name,network_ip,network_port"
-						 ",%d,sip_realm from sip_registrations where call_id='%q' %s", reboot, call_id, sqlextra);
+	if (profile->reg_index) {
+		sofia_reg_index_match_t match = { 0 };
 
+		match.call_id = call_id;
+		sofia_reg_index_del(profile->reg_index, &match, reboot, sofia_reg_del_callback, profile);
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	switch_safe_free(sql);
+		memset(&match, 0, sizeof(match));
+		match.sip_user = user;
+		match.sip_host = host;
+		sofia_reg_index_del(profile->reg_index, &match, reboot, sofia_reg_del_callback, profile);
+	} else {
+		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							 ",user_agent,server_user,server_host,profile_name,network_ip,network_port"
+							 ",%d,sip_realm from sip_registrations where call_id='%q' %s", reboot, call_id, sqlextra);
+
+
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		switch_safe_free(sql);
+	}
 
 	sql = switch_mprintf("delete from sip_registrations where call_id='%q' %s", call_id, sqlextra);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	sofia_reg_execute_sql(profile, &sql);
 
 	switch_safe_free(sqlextra);
 	switch_safe_free(sql);
@@ -797,26 +902,34 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 {
 	char *sql;
+	int expired = 1;
 
-	if (now) {
-		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip, network_port"
-						",%d,sip_realm from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+	if (profile->reg_index) {
+		/* only the wheel slots that came due since the last pass are looked at */
+		expired = sofia_reg_index_expire(profile->reg_index, now, reboot, sofia_reg_del_callback, profile);
 	} else {
-		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip, network_port" ",%d,sip_realm from sip_registrations where expires > 0", reboot);
-	}
+		if (now) {
+			sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip, network_port"
+							",%d,sip_realm from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+		} else {
+			sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip, network_port" ",%d,sip_realm from sip_registrations where expires > 0", reboot);
+		}
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	free(sql);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		free(sql);
+	}
 
-	if (now) {
-		sql = switch_mprintf("delete from sip_registrations where expires > 0 and expires <= %ld and hostname='%q'",
-						(long) now, mod_sofia_globals.hostname);
-	} else {
-		sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
+	if (expired) {
+		if (now) {
+			sql = switch_mprintf("delete from sip_registrations where expires > 0 and expires <= %ld and hostname='%q'",
+							(long) now, mod_sofia_globals.hostname);
+		} else {
+			sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
+		}
+		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 	}
-	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 
 
 
@@ -1007,13 +1120,17 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 {
 	char *sql;
 
-	sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-					",user_agent,server_user,server_host,profile_name,network_ip,network_port,0,sip_realm"
-					" from sip_registrations where expires > 0");
+	if (profile->reg_index) {
+		sofia_reg_index_expire(profile->reg_index, 0, 0, sofia_reg_del_callback, profile);
+	} else {
+		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+						",user_agent,server_user,server_host,profile_name,network_ip,network_port,0,sip_realm"
+						" from sip_registrations where expires > 0");
 
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	switch_safe_free(sql);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		switch_safe_free(sql);
+	}
 
 	sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
@@ -1027,6 +1144,10 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 	sql = switch_mprintf("delete from sip_subscriptions where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+	if (profile->pres_index) {
+		sofia_presence_index_expire(profile->pres_index, 0);
+	}
+
 	sql = switch_mprintf("delete from sip_dialogs where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
@@ -1045,17 +1166,21 @@ char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const c
 	cbt.val = val;
 	cbt.len = len;
 
-	if (host) {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
+	if (profile->reg_index) {
+		sofia_reg_index_find(profile, user, host, sofia_reg_find_callback, &cbt);
 	} else {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
-	}
+		if (host) {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+							user, host, host);
+		} else {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
+		}
 
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
 
-	switch_safe_free(sql);
+		switch_safe_free(sql);
+	}
 
 	if (cbt.list) {
 		switch_console_free_matches(&cbt.list);
@@ -1079,6 +1204,11 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *p
 		return NULL;
 	}
 
+	if (profile->reg_index) {
+		sofia_reg_index_find(profile, user, host, sofia_reg_find_callback, &cbt);
+		return cbt.list;
+	}
+
 	if (host) {
 		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
 						user, host, host);
@@ -1105,6 +1235,15 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_mu
 		return NULL;
 	}
 
+	cbt.time = reg_time;
+	cbt.contact_str = contact_str;
+	cbt.exptime = exptime;
+
+	if (profile->reg_index) {
+		sofia_reg_index_find(profile, user, host, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
+		return cbt.list;
+	}
+
 	if (host) {
 		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
 						user, host, host);
@@ -1112,10 +1251,6 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_mu
 		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q'", user);
 	}
 
-	cbt.time = reg_time;
-	cbt.contact_str = contact_str;
-	cbt.exptime = exptime;
-
 	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
 	free(sql);
 
@@ -1164,6 +1299,15 @@ uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const c
 	char buf[32] = "";
 	char *sql;
 
+	if (profile->reg_index) {
+		sofia_reg_index_match_t match = { 0 };
+
+		match.sip_user = user;
+		match.presence_host = host;
+
+		return (uint32_t) sofia_reg_index_select(profile->reg_index, &match, 0, NULL, NULL);
+	}
+
 	sql = switch_mprintf("select count(*) from sip_registrations where profile_name='%q' and "
 						 "sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')", profile->name, user, host, host);
 
@@ -1886,18 +2030,41 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		}
 
 		if (auth_res != AUTH_RENEWED || !multi_reg) {
+			sofia_reg_index_match_t match = { 0 };
+
 			if (multi_reg) {
 				if (multi_reg_contact) {
 					sql =
 						switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+					match.sip_user = to_user;
+					match.sip_host = reg_host;
+					match.contact = contact_str;
 				} else {
 					sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+					match.call_id = call_id;
 				}
 			} else {
 				sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host);
+				match.sip_user = to_user;
+				match.sip_host = reg_host;
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			if (profile->reg_index) {
+				sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+			}
+
+			sofia_reg_execute_sql(profile, &sql);
+		} else if (profile->reg_index) {
+			sofia_reg_index_match_t match = { 0 };
+
+			match.sip_user = to_user;
+			match.sip_username = username;
+			match.sip_host = reg_host;
+			match.contact = contact_str;
+
+			if (sofia_reg_index_select(profile->reg_index, &match, 0, NULL, NULL) > 0) {
+				update_registration = SWITCH_TRUE;
+			}
 		} else {
 			char buf[32] = "";
 
@@ -1979,8 +2146,41 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 								 to_user, username, reg_host, contact_str);
 		}
 
+		if (profile->reg_index) {
+			sofia_reg_index_row_t row = { 0 };
+
+			row.call_id = call_id;
+			row.presence_hosts = profile->presence_hosts ? profile->presence_hosts : "";
+			row.network_ip = network_ip;
+			row.network_port = network_port_c;
+			row.server_host = guess_ip4;
+			row.expires = (long) reg_time + (long) exptime + profile->sip_expires_late_margin;
+
+			if (!update_registration) {
+				row.sip_user = to_user;
+				row.sip_host = reg_host;
+				row.contact = contact_str;
+				row.status = reg_desc;
+				row.rpid = rpid;
+				row.user_agent = agent;
+				row.server_user = from_user;
+				row.profile_name = profile->name;
+				row.sip_username = username;
+				row.sip_realm = realm;
+				sofia_reg_index_add(profile->reg_index, &row);
+			} else {
+				sofia_reg_index_match_t match = { 0 };
+
+				match.sip_user = to_user;
+				match.sip_username = username;
+				match.sip_host = reg_host;
+				match.contact = contact_str;
+				sofia_reg_index_update(profile->reg_index, &match, &row);
+			}
+		}
+
 		if (sql) {
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql);
 		}
 
 		if (!update_registration && sofia_reg_reg_count(profile, to_user, reg_host) == 1) {
@@ -1993,6 +2193,19 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		}
 
 		if (multi_reg) {
+			if (profile->reg_index) {
+				sofia_reg_index_match_t match = { 0 };
+
+				/* same rows as the sql below, the contact of any user */
+				if (multi_reg_contact) {
+					match.contact = contact_str;
+				} else {
+					match.call_id = call_id;
+				}
+				match.expires_not = (long) reg_time + (long) exptime + profile->sip_expires_late_margin;
+				sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+			}
+
 			if (multi_reg_contact) {
 				sql = switch_mprintf("delete from sip_registrations where contact='%q' and expires!=%ld", contact_str, (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
 			} else {
@@ -2072,6 +2285,19 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 				*p = '\0';
 			}
 
+			if (profile->reg_index) {
+				sofia_reg_index_match_t match = { 0 };
+
+				if (multi_reg_contact) {
+					match.sip_user = to_user;
+					match.sip_host = reg_host;
+					match.contact = contact_str;
+				} else {
+					match.call_id = call_id;
+				}
+				sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+			}
+
 			if (multi_reg_contact) {
 				sql =
 					switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
@@ -2079,13 +2305,20 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql);
 
 			switch_safe_free(icontact);
 		} else {
+			if (profile->reg_index) {
+				sofia_reg_index_match_t match = { 0 };
+
+				match.sip_user = to_user;
+				match.sip_host = reg_host;
+				sofia_reg_index_del(profile->reg_index, &match, 0, NULL, NULL);
+			}
 
 			if ((sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host))) {
-				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+				sofia_reg_execute_sql(profile, &sql);
 			}
 		}
 	}
@@ -2708,6 +2941,22 @@ static int sofia_reg_regcount_callback(void *pArg, int argc, char **argv, char *
 	return 0;
 }
 
+struct reg_index_other_calls {
+	const char *call_id;
+	uint32_t count;
+};
+
+static int sofia_reg_index_other_calls_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct reg_index_other_calls *other = (struct reg_index_other_calls *) pArg;
+
+	if (strcmp(argv[0], other->call_id)) {
+		other->count++;
+	}
+
+	return 0;
+}
+
 auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 								sip_authorization_t const *authorization,
 								sip_t const *sip,
@@ -3089,11 +3338,22 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 		call_id = sip->sip_call_id->i_id;
 		switch_assert(call_id);
 
-		sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
-							 sip->sip_to->a_url->url_user, call_id, domain_name);
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
-		free(sql);
+		if (profile->reg_index) {
+			sofia_reg_index_match_t match = { 0 };
+			struct reg_index_other_calls other = { 0 };
+
+			match.sip_user = sip->sip_to->a_url->url_user;
+			match.sip_host = domain_name;
+			other.call_id = call_id;
+			sofia_reg_index_select(profile->reg_index, &match, 0, sofia_reg_index_other_calls_callback, &other);
+			count = other.count;
+		} else {
+			sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
+								 sip->sip_to->a_url->url_user, call_id, domain_name);
+			switch_assert(sql != NULL);
+			sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
+			free(sql);
+		}
 
 		if (count + 1 > max_registrations_perext) {
 			ret = AUTH_FORBIDDEN;
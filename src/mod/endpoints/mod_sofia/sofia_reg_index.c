@@ -0,0 +1,645 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sofia_reg_index.c -- SOFIA SIP Endpoint (in memory registration index)
+ *
+ * With reg-memory-index enabled the profile keeps every sip_registrations row in memory too.
+ * Contact lookups and expiry are served from here and the table is only written, through the
+ * profile's sql queue, so it is there for other readers and to reload from on restart.
+ *
+ */
+#include "mod_sofia.h"
+
+#define SOFIA_REG_INDEX_SHARDS 16
+#define SOFIA_REG_INDEX_MAX_SHARDS 256
+#define SOFIA_REG_INDEX_SLOTS 1024
+
+/* column order of the sql the callbacks used to get, "select call_id,sip_user,sip_host,contact,status,rpid,expires,
+   user_agent,server_user,server_host,profile_name,network_ip,network_port,<reboot>,sip_realm" */
+typedef enum {
+	RI_CALL_ID,
+	RI_SIP_USER,
+	RI_SIP_HOST,
+	RI_CONTACT,
+	RI_STATUS,
+	RI_RPID,
+	RI_EXPIRES,
+	RI_USER_AGENT,
+	RI_SERVER_USER,
+	RI_SERVER_HOST,
+	RI_PROFILE_NAME,
+	RI_NETWORK_IP,
+	RI_NETWORK_PORT,
+	RI_REBOOT,
+	RI_SIP_REALM,
+	RI_ARGC,
+	RI_PRESENCE_HOSTS = RI_ARGC,
+	RI_SIP_USERNAME,
+	RI_COLS
+} sofia_reg_index_col_t;
+
+/* the columns rows are hashed on, each row is on one chain per key */
+typedef enum {
+	RI_BY_USER,
+	RI_BY_CALL_ID,
+	RI_BY_CONTACT,
+	RI_BY_MAX
+} sofia_reg_index_by_t;
+
+static const sofia_reg_index_col_t reg_index_by_col[RI_BY_MAX] = { RI_SIP_USER, RI_CALL_ID, RI_CONTACT };
+
+typedef struct sofia_reg_index_entry_s {
+	char *col[RI_COLS];
+	long expires;
+	int slot;
+	struct sofia_reg_index_entry_s *chain_next[RI_BY_MAX];
+	struct sofia_reg_index_entry_s *wheel_prev;
+	struct sofia_reg_index_entry_s *wheel_next;
+	struct sofia_reg_index_entry_s *next;
+} sofia_reg_index_entry_t;
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *by[RI_BY_MAX];
+	sofia_reg_index_entry_t *wheel[SOFIA_REG_INDEX_SLOTS];
+	time_t swept;
+	uint32_t rows;
+	uint64_t lookups;
+	uint64_t added;
+	uint64_t removed;
+	uint64_t expired;
+} sofia_reg_index_shard_t;
+
+struct sofia_reg_index_s {
+	switch_memory_pool_t *pool;
+	uint32_t nshards;
+	sofia_reg_index_shard_t *shards;
+};
+
+static uint32_t reg_index_hash(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	for (; key && *key; key++) {
+		h = (h ^ (uint8_t) *key) * 16777619u;
+	}
+
+	return h;
+}
+
+static sofia_reg_index_shard_t *reg_index_shard(sofia_reg_index_t *index, const char *sip_user)
+{
+	return &index->shards[reg_index_hash(sip_user) % index->nshards];
+}
+
+static sofia_reg_index_entry_t *reg_index_entry_create(const char *const *src, long expires)
+{
+	sofia_reg_index_entry_t *e;
+	size_t len[RI_COLS], total = 0;
+	char *p;
+	int i;
+
+	for (i = 0; i < RI_COLS; i++) {
+		len[i] = (i == RI_EXPIRES || i == RI_REBOOT) ? 0 : strlen(src[i] ? src[i] : "") + 1;
+		total += len[i];
+	}
+
+	switch_zmalloc(e, sizeof(*e) + total);
+	p = (char *) (e + 1);
+
+	for (i = 0; i < RI_COLS; i++) {
+		if (!len[i]) continue;
+		memcpy(p, src[i] ? src[i] : "", len[i]);
+		e->col[i] = p;
+		p += len[i];
+	}
+
+	e->expires = expires;
+	e->slot = -1;
+
+	return e;
+}
+
+static void reg_index_row_cols(const sofia_reg_index_row_t *row, const char **src)
+{
+	memset(src, 0, sizeof(*src) * RI_COLS);
+	src[RI_CALL_ID] = row->call_id;
+	src[RI_SIP_USER] = row->sip_user;
+	src[RI_SIP_HOST] = row->sip_host;
+	src[RI_CONTACT] = row->contact;
+	src[RI_STATUS] = row->status;
+	src[RI_RPID] = row->rpid;
+	src[RI_USER_AGENT] = row->user_agent;
+	src[RI_SERVER_USER] = row->server_user;
+	src[RI_SERVER_HOST] = row->server_host;
+	src[RI_PROFILE_NAME] = row->profile_name;
+	src[RI_NETWORK_IP] = row->network_ip;
+	src[RI_NETWORK_PORT] = row->network_port;
+	src[RI_SIP_REALM] = row->sip_realm;
+	src[RI_PRESENCE_HOSTS] = row->presence_hosts;
+	src[RI_SIP_USERNAME] = row->sip_username;
+}
+
+static void reg_index_wheel_add(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *e)
+{
+	time_t at = e->expires;
+
+	if (e->expires <= 0) {
+		e->slot = -1;
+		return;
+	}
+
+	/* a slot that was already swept would not be looked at again for a whole turn */
+	if (shard->swept && at <= shard->swept) {
+		at = shard->swept + 1;
+	}
+
+	e->slot = (int) (at % SOFIA_REG_INDEX_SLOTS);
+	e->wheel_prev = NULL;
+	e->wheel_next = shard->wheel[e->slot];
+
+	if (e->wheel_next) {
+		e->wheel_next->wheel_prev = e;
+	}
+
+	shard->wheel[e->slot] = e;
+}
+
+static void reg_index_wheel_del(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *e)
+{
+	if (e->slot < 0) {
+		return;
+	}
+
+	if (e->wheel_prev) {
+		e->wheel_prev->wheel_next = e->wheel_next;
+	} else {
+		shard->wheel[e->slot] = e->wheel_next;
+	}
+
+	if (e->wheel_next) {
+		e->wheel_next->wheel_prev = e->wheel_prev;
+	}
+
+	e->wheel_prev = e->wheel_next = NULL;
+	e->slot = -1;
+}
+
+static void reg_index_chain_del(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *e, sofia_reg_index_by_t by)
+{
+	const char *key = e->col[reg_index_by_col[by]];
+	sofia_reg_index_entry_t *p, *prev = NULL, *next;
+
+	for (p = switch_core_hash_find(shard->by[by], key); p && p != e; p = p->chain_next[by]) {
+		prev = p;
+	}
+
+	if (!p) {
+		return;
+	}
+
+	next = e->chain_next[by];
+
+	if (prev) {
+		prev->chain_next[by] = next;
+	} else if (next) {
+		switch_core_hash_insert(shard->by[by], key, next);
+	} else {
+		switch_core_hash_delete(shard->by[by], key);
+	}
+}
+
+static void reg_index_link(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *e)
+{
+	int by;
+
+	for (by = 0; by < RI_BY_MAX; by++) {
+		const char *key = e->col[reg_index_by_col[by]];
+
+		e->chain_next[by] = switch_core_hash_find(shard->by[by], key);
+		switch_core_hash_insert(shard->by[by], key, e);
+	}
+
+	reg_index_wheel_add(shard, e);
+	shard->rows++;
+}
+
+static void reg_index_unlink(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *e)
+{
+	int by;
+
+	for (by = 0; by < RI_BY_MAX; by++) {
+		reg_index_chain_del(shard, e, by);
+	}
+
+	reg_index_wheel_del(shard, e);
+	shard->rows--;
+}
+
+static int reg_index_match(const sofia_reg_index_entry_t *e, const sofia_reg_index_match_t *match)
+{
+	if (!match) {
+		return 1;
+	}
+
+	if ((match->call_id && strcmp(e->col[RI_CALL_ID], match->call_id)) ||
+		(match->sip_user && strcmp(e->col[RI_SIP_USER], match->sip_user)) ||
+		(match->sip_host && strcmp(e->col[RI_SIP_HOST], match->sip_host)) ||
+		(match->sip_username && strcmp(e->col[RI_SIP_USERNAME], match->sip_username)) ||
+		(match->contact && strcmp(e->col[RI_CONTACT], match->contact)) ||
+		(match->network_ip && strcmp(e->col[RI_NETWORK_IP], match->network_ip)) ||
+		(match->network_port && strcmp(e->col[RI_NETWORK_PORT], match->network_port))) {
+		return 0;
+	}
+
+	/* same as sip_host='x' or presence_hosts like '%x%' */
+	if (match->presence_host && strcmp(e->col[RI_SIP_HOST], match->presence_host) &&
+		!switch_stristr(match->presence_host, e->col[RI_PRESENCE_HOSTS])) {
+		return 0;
+	}
+
+	if (match->expires_not && e->expires == match->expires_not) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/* every matching row of one shard, chained on ->next, the shard must be locked */
+static sofia_reg_index_entry_t *reg_index_collect(sofia_reg_index_shard_t *shard, const sofia_reg_index_match_t *match)
+{
+	sofia_reg_index_entry_t *list = NULL, **tail = &list, *e;
+
+	int by = -1;
+
+	if (match && match->sip_user) {
+		by = RI_BY_USER;
+	} else if (match && match->call_id) {
+		by = RI_BY_CALL_ID;
+	} else if (match && match->contact) {
+		by = RI_BY_CONTACT;
+	}
+
+	if (by >= 0) {
+		const char *key = by == RI_BY_USER ? match->sip_user : by == RI_BY_CALL_ID ? match->call_id : match->contact;
+
+		for (e = switch_core_hash_find(shard->by[by], key); e; e = e->chain_next[by]) {
+			if (reg_index_match(e, match)) {
+				*tail = e;
+				tail = &e->next;
+			}
+		}
+	} else {
+		switch_hash_index_t *hi;
+		void *val;
+
+		for (hi = switch_core_hash_first(shard->by[RI_BY_USER]); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, NULL, NULL, &val);
+
+			for (e = (sofia_reg_index_entry_t *) val; e; e = e->chain_next[RI_BY_USER]) {
+				if (reg_index_match(e, match)) {
+					*tail = e;
+					tail = &e->next;
+				}
+			}
+		}
+	}
+
+	*tail = NULL;
+
+	return list;
+}
+
+static int reg_index_call(sofia_reg_index_entry_t *e, int reboot, switch_core_db_callback_func_t callback, void *pArg)
+{
+	char *argv[RI_ARGC];
+	char expires[32], reboot_str[16];
+
+	memcpy(argv, e->col, sizeof(argv));
+	switch_snprintf(expires, sizeof(expires), "%ld", e->expires);
+	switch_snprintf(reboot_str, sizeof(reboot_str), "%d", reboot);
+	argv[RI_EXPIRES] = expires;
+	argv[RI_REBOOT] = reboot_str;
+
+	return callback(pArg, RI_ARGC, argv, NULL);
+}
+
+/* shard range a match can live in, one shard when the user is known */
+static void reg_index_range(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, uint32_t *first, uint32_t *last)
+{
+	if (match && match->sip_user) {
+		*first = (uint32_t) (reg_index_shard(index, match->sip_user) - index->shards);
+		*last = *first + 1;
+	} else {
+		*first = 0;
+		*last = index->nshards;
+	}
+}
+
+/* call the callback for each removed row outside of the shard locks and free them */
+static int reg_index_release(sofia_reg_index_entry_t *list, int reboot, switch_core_db_callback_func_t callback, void *pArg)
+{
+	sofia_reg_index_entry_t *e;
+	int count = 0;
+
+	while ((e = list)) {
+		list = e->next;
+
+		if (callback) {
+			reg_index_call(e, reboot, callback, pArg);
+		}
+
+		free(e);
+		count++;
+	}
+
+	return count;
+}
+
+switch_status_t sofia_reg_index_create(sofia_reg_index_t **indexp, uint32_t shards)
+{
+	switch_memory_pool_t *pool = NULL;
+	sofia_reg_index_t *index;
+	uint32_t i;
+	int by;
+
+	if (!shards) {
+		shards = SOFIA_REG_INDEX_SHARDS;
+	} else if (shards > SOFIA_REG_INDEX_MAX_SHARDS) {
+		shards = SOFIA_REG_INDEX_MAX_SHARDS;
+	}
+
+	if (switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	index = switch_core_alloc(pool, sizeof(*index));
+	index->pool = pool;
+	index->nshards = shards;
+	index->shards = switch_core_alloc(pool, sizeof(*index->shards) * shards);
+
+	for (i = 0; i < shards; i++) {
+		switch_mutex_init(&index->shards[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		for (by = 0; by < RI_BY_MAX; by++) {
+			switch_core_hash_init(&index->shards[i].by[by]);
+		}
+	}
+
+	*indexp = index;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void sofia_reg_index_destroy(sofia_reg_index_t **indexp)
+{
+	sofia_reg_index_t *index;
+	switch_memory_pool_t *pool;
+	uint32_t i;
+	int by;
+
+	if (!indexp || !(index = *indexp)) {
+		return;
+	}
+
+	*indexp = NULL;
+
+	for (i = 0; i < index->nshards; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+
+		reg_index_release(reg_index_collect(shard, NULL), 0, NULL, NULL);
+		for (by = 0; by < RI_BY_MAX; by++) {
+			switch_core_hash_destroy(&shard->by[by]);
+		}
+	}
+
+	pool = index->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+void sofia_reg_index_add(sofia_reg_index_t *index, const sofia_reg_index_row_t *row)
+{
+	sofia_reg_index_shard_t *shard = reg_index_shard(index, row->sip_user);
+	const char *src[RI_COLS];
+	sofia_reg_index_entry_t *e;
+
+	reg_index_row_cols(row, src);
+	e = reg_index_entry_create(src, row->expires);
+
+	switch_mutex_lock(shard->mutex);
+	reg_index_link(shard, e);
+	shard->added++;
+	switch_mutex_unlock(shard->mutex);
+}
+
+int sofia_reg_index_update(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, const sofia_reg_index_row_t *row)
+{
+	const char *src[RI_COLS];
+	uint32_t i, first, last;
+	int count = 0;
+
+	reg_index_row_cols(row, src);
+	/* the user picks the shard, it can't be changed in place */
+	src[RI_SIP_USER] = NULL;
+	reg_index_range(index, match, &first, &last);
+
+	for (i = first; i < last; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+		sofia_reg_index_entry_t *list, *e, *n;
+
+		switch_mutex_lock(shard->mutex);
+
+		for (list = reg_index_collect(shard, match); (e = list); count++) {
+			const char *merged[RI_COLS];
+			int c;
+
+			list = e->next;
+
+			for (c = 0; c < RI_COLS; c++) {
+				merged[c] = src[c] ? src[c] : e->col[c];
+			}
+
+			/* the strings live with the row so a changed row is a new one */
+			n = reg_index_entry_create(merged, row->expires ? row->expires : e->expires);
+			reg_index_unlink(shard, e);
+			free(e);
+			reg_index_link(shard, n);
+		}
+
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return count;
+}
+
+int sofia_reg_index_select(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, int reboot, switch_core_db_callback_func_t callback, void *pArg)
+{
+	uint32_t i, first, last;
+	int count = 0, stop = 0;
+
+	reg_index_range(index, match, &first, &last);
+
+	for (i = first; i < last && !stop; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+		sofia_reg_index_entry_t *e;
+
+		switch_mutex_lock(shard->mutex);
+		shard->lookups++;
+
+		/* the callback runs under the shard lock, it must not come back into the index */
+		for (e = reg_index_collect(shard, match); e && !stop; e = e->next) {
+			count++;
+
+			if (callback && reg_index_call(e, reboot, callback, pArg)) {
+				stop = 1;
+			}
+		}
+
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return count;
+}
+
+int sofia_reg_index_del(sofia_reg_index_t *index, const sofia_reg_index_match_t *match, int reboot, switch_core_db_callback_func_t callback, void *pArg)
+{
+	sofia_reg_index_entry_t *removed = NULL;
+	uint32_t i, first, last;
+
+	reg_index_range(index, match, &first, &last);
+
+	for (i = first; i < last; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+		sofia_reg_index_entry_t *list, *e;
+
+		switch_mutex_lock(shard->mutex);
+
+		for (list = reg_index_collect(shard, match); (e = list); ) {
+			list = e->next;
+			reg_index_unlink(shard, e);
+			shard->removed++;
+			e->next = removed;
+			removed = e;
+		}
+
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return reg_index_release(removed, reboot, callback, pArg);
+}
+
+int sofia_reg_index_expire(sofia_reg_index_t *index, time_t now, int reboot, switch_core_db_callback_func_t callback, void *pArg)
+{
+	sofia_reg_index_entry_t *removed = NULL;
+	uint32_t i;
+
+	for (i = 0; i < index->nshards; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+		sofia_reg_index_entry_t *list, *due = NULL, *e, *next;
+
+		switch_mutex_lock(shard->mutex);
+
+		if (!now) {
+			/* everything with an expiry, like "where expires > 0" */
+			for (list = reg_index_collect(shard, NULL); (e = list); ) {
+				list = e->next;
+
+				if (e->expires > 0) {
+					e->next = due;
+					due = e;
+				}
+			}
+		} else if (now > shard->swept) {
+			time_t t = shard->swept ? shard->swept + 1 : now - SOFIA_REG_INDEX_SLOTS + 1;
+
+			if (now - t >= SOFIA_REG_INDEX_SLOTS) {
+				t = now - SOFIA_REG_INDEX_SLOTS + 1;
+			}
+
+			if (t < 0) {
+				t = 0;
+			}
+
+			/* only the slots that came due since the last sweep, rows further out wait for a later turn */
+			for (; t <= now; t++) {
+				for (e = shard->wheel[t % SOFIA_REG_INDEX_SLOTS]; e; e = next) {
+					next = e->wheel_next;
+
+					if (e->expires <= now) {
+						e->next = due;
+						due = e;
+					}
+				}
+			}
+
+			shard->swept = now;
+		}
+
+		while ((e = due)) {
+			due = e->next;
+			reg_index_unlink(shard, e);
+			shard->expired++;
+			e->next = removed;
+			removed = e;
+		}
+
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return reg_index_release(removed, reboot, callback, pArg);
+}
+
+void sofia_reg_index_stats(sofia_reg_index_t *index, sofia_reg_index_stats_t *stats)
+{
+	uint32_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->shards = index->nshards;
+
+	for (i = 0; i < index->nshards; i++) {
+		sofia_reg_index_shard_t *shard = &index->shards[i];
+
+		switch_mutex_lock(shard->mutex);
+		stats->rows += shard->rows;
+		stats->lookups += shard->lookups;
+		stats->added += shard->added;
+		stats->removed += shard->removed;
+		stats->expired += shard->expired;
+		switch_mutex_unlock(shard->mutex);
+	}
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set shiftwidth=4 tabstop=4 softtabstop=4 noet:
+ */
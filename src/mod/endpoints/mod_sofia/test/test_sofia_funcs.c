@@ -33,6 +33,105 @@
 #include <test/switch_test.h>
 #include "../mod_sofia.c"
 
+static int reg_index_contacts(void *pArg, int argc, char **argv, char **columnNames)
+{
+	switch_stream_handle_t *stream = (switch_stream_handle_t *) pArg;
+
+	stream->write_function(stream, "%s:%s;", argv[3], argv[6]);
+	return 0;
+}
+
+static void reg_index_row(sofia_reg_index_row_t *row, const char *call_id, const char *user, const char *contact, long expires)
+{
+	memset(row, 0, sizeof(*row));
+	row->call_id = call_id;
+	row->sip_user = user;
+	row->sip_host = "example.com";
+	row->presence_hosts = "example.com,example.org";
+	row->contact = contact;
+	row->status = "Registered(UDP)";
+	row->expires = expires;
+	row->profile_name = "internal";
+	row->network_ip = "192.0.2.1";
+	row->network_port = "5060";
+	row->sip_username = user;
+	row->sip_realm = "example.com";
+}
+
+static sofia_presence_watcher_t *presence_index_row(const char *call_id, const char *event, const char *host, long version, long expires)
+{
+	sofia_presence_watcher_t w = { 0 };
+
+	w.proto = "sip";
+	w.sip_user = "1001";
+	w.sip_host = "example.com";
+	w.sub_to_user = "1000";
+	w.sub_to_host = (char *) host;
+	w.presence_hosts = "example.com,example.org";
+	w.event = (char *) event;
+	w.contact = "sip:1001@192.0.2.1";
+	w.call_id = (char *) call_id;
+	w.profile_name = "internal";
+	w.version = version;
+	w.expires = expires;
+
+	return sofia_presence_watcher_dup(&w);
+}
+
+#define DISPATCH_WORKERS 4
+#define DISPATCH_CALLS 64
+
+typedef struct {
+	int call;
+	int seq;
+} dispatch_msg_t;
+
+typedef struct {
+	switch_queue_t *q;
+	int id;
+} dispatch_worker_t;
+
+static int dispatch_owner[DISPATCH_CALLS];
+static int dispatch_last_seq[DISPATCH_CALLS];
+static switch_atomic_t dispatch_misrouted;
+static switch_atomic_t dispatch_reordered;
+static switch_atomic_t dispatch_done;
+
+/* the same loop as sofia_msg_worker_run, minus the sip processing */
+static void *SWITCH_THREAD_FUNC dispatch_worker_run(switch_thread_t *thread, void *obj)
+{
+	dispatch_worker_t *worker = (dispatch_worker_t *) obj;
+	void *pop;
+
+	for(;;) {
+		dispatch_msg_t *msg;
+
+		if (switch_queue_pop(worker->q, &pop) != SWITCH_STATUS_SUCCESS) {
+			switch_cond_next();
+			continue;
+		}
+
+		if (!(msg = (dispatch_msg_t *) pop)) {
+			break;
+		}
+
+		if (dispatch_owner[msg->call] == -1) {
+			dispatch_owner[msg->call] = worker->id;
+		} else if (dispatch_owner[msg->call] != worker->id) {
+			switch_atomic_inc(&dispatch_misrouted);
+		}
+
+		if (msg->seq != dispatch_last_seq[msg->call] + 1) {
+			switch_atomic_inc(&dispatch_reordered);
+		}
+		dispatch_last_seq[msg->call] = msg->seq;
+
+		switch_atomic_inc(&dispatch_done);
+	}
+
+	return NULL;
+}
+
 FST_MINCORE_BEGIN("./conf")
 
 FST_SUITE_BEGIN(switch_hash)
@@ -94,6 +193,256 @@ FST_TEST_BEGIN(test_protect_url)
 }
 FST_TEST_END()
 
+FST_TEST_BEGIN(test_reg_index)
+{
+	sofia_reg_index_t *index = NULL;
+	sofia_reg_index_row_t row;
+	sofia_reg_index_match_t match = { 0 };
+	sofia_reg_index_stats_t stats;
+	switch_stream_handle_t stream = { 0 };
+
+	fst_requires(sofia_reg_index_create(&index, 4) == SWITCH_STATUS_SUCCESS);
+
+	reg_index_row(&row, "call-1", "1000", "sip:1000@192.0.2.1", 100);
+	sofia_reg_index_add(index, &row);
+	reg_index_row(&row, "call-2", "1000", "sip:1000@192.0.2.2", 200);
+	sofia_reg_index_add(index, &row);
+	reg_index_row(&row, "call-3", "1001", "sip:1001@192.0.2.3", 0);
+	sofia_reg_index_add(index, &row);
+
+	/* sip_host or any of the presence hosts */
+	match.sip_user = "1000";
+	match.presence_host = "example.org";
+	fst_check(sofia_reg_index_select(index, &match, 0, NULL, NULL) == 2);
+	match.presence_host = "example.net";
+	fst_check(sofia_reg_index_select(index, &match, 0, NULL, NULL) == 0);
+
+	memset(&match, 0, sizeof(match));
+	match.call_id = "call-2";
+	SWITCH_STANDARD_STREAM(stream);
+	fst_check(sofia_reg_index_select(index, &match, 0, reg_index_contacts, &stream) == 1);
+	fst_check_string_equals((char *) stream.data, "sip:1000@192.0.2.2:200;");
+	switch_safe_free(stream.data);
+
+	/* an update keeps the fields it does not set */
+	reg_index_row(&row, NULL, NULL, NULL, 300);
+	row.sip_host = NULL;
+	row.presence_hosts = NULL;
+	row.status = NULL;
+	row.profile_name = NULL;
+	row.sip_username = NULL;
+	row.sip_realm = NULL;
+	row.network_port = "5080";
+	fst_check(sofia_reg_index_update(index, &match, &row) == 1);
+	SWITCH_STANDARD_STREAM(stream);
+	sofia_reg_index_select(index, &match, 0, reg_index_contacts, &stream);
+	fst_check_string_equals((char *) stream.data, "sip:1000@192.0.2.2:300;");
+	switch_safe_free(stream.data);
+	match.network_port = "5080";
+	fst_check(sofia_reg_index_select(index, &match, 0, NULL, NULL) == 1);
+
+	/* only rows that are due go, rows without an expiry stay until they are deleted */
+	fst_check(sofia_reg_index_expire(index, 150, 0, NULL, NULL) == 1);
+	fst_check(sofia_reg_index_expire(index, 150, 0, NULL, NULL) == 0);
+	SWITCH_STANDARD_STREAM(stream);
+	fst_check(sofia_reg_index_expire(index, 400, 1, reg_index_contacts, &stream) == 1);
+	fst_check_string_equals((char *) stream.data, "sip:1000@192.0.2.2:300;");
+	switch_safe_free(stream.data);
+
+	memset(&match, 0, sizeof(match));
+	match.sip_user = "1001";
+	fst_check(sofia_reg_index_del(index, &match, 0, NULL, NULL) == 1);
+
+	/* a contact delete takes the contact from every user, like the sql it mirrors */
+	reg_index_row(&row, "call-4", "1002", "sip:shared@192.0.2.9", 0);
+	sofia_reg_index_add(index, &row);
+	reg_index_row(&row, "call-5", "1003", "sip:shared@192.0.2.9", 0);
+	sofia_reg_index_add(index, &row);
+	memset(&match, 0, sizeof(match));
+	match.contact = "sip:shared@192.0.2.9";
+	fst_check(sofia_reg_index_select(index, &match, 0, NULL, NULL) == 2);
+	fst_check(sofia_reg_index_del(index, &match, 0, NULL, NULL) == 2);
+
+	sofia_reg_index_stats(index, &stats);
+	fst_check(stats.shards == 4);
+	fst_check(stats.rows == 0);
+	fst_check(stats.added == 5);
+	fst_check(stats.removed == 3);
+	fst_check(stats.expired == 2);
+
+	sofia_reg_index_destroy(&index);
+	fst_check(index == NULL);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_presence_index)
+{
+	sofia_presence_index_t *index = NULL;
+	sofia_presence_index_match_t match = { 0 };
+	sofia_presence_index_stats_t stats;
+	sofia_presence_watcher_t *rows, *list = NULL;
+	uint64_t epoch;
+
+	fst_requires(sofia_presence_index_create(&index) == SWITCH_STATUS_SUCCESS);
+
+	match.proto = "sip";
+	match.event = "presence";
+	match.alt_event = "dialog";
+	match.host = "example.com";
+	match.sipip = "192.0.2.10";
+
+	fst_check(sofia_presence_index_watchers(index, "1000", &match, &list) == -1);
+
+	/* first event loads the presentity, the dialog watcher on our ip matches, message-summary does not */
+	epoch = sofia_presence_index_epoch(index);
+	rows = presence_index_row("call-1", "presence", "example.com", 3, 100);
+	rows->next = presence_index_row("call-2", "dialog", "192.0.2.10", -1, 200);
+	rows->next->next = presence_index_row("call-3", "message-summary", "example.com", 0, 300);
+	fst_check(sofia_presence_index_load(index, "1000", rows, epoch, &match, &list) == 2);
+	fst_check(list->version == 4);
+	fst_check(list->next->version == 0);
+	sofia_presence_watchers_free(&list);
+
+	fst_check(sofia_presence_index_watchers(index, "1000", &match, &list) == 2);
+	fst_check(list->version == 5);
+	sofia_presence_watchers_free(&list);
+
+	/* the table lags behind, a probe still gets the next version */
+	fst_check(sofia_presence_index_version(index, "call-2", 0) == 2);
+
+	/* a write by call_id drops the presentity and the reload keeps counting */
+	sofia_presence_index_invalidate(index, NULL, "call-2", SWITCH_FALSE);
+	fst_check(sofia_presence_index_watchers(index, "1000", &match, &list) == -1);
+	epoch = sofia_presence_index_epoch(index);
+	rows = presence_index_row("call-2", "dialog", "192.0.2.10", 1, 200);
+	fst_check(sofia_presence_index_load(index, "1000", rows, epoch, &match, &list) == 1);
+	fst_check(list->version == 3);
+	sofia_presence_watchers_free(&list);
+
+	/* a notify by call_id went out from the table, which is now ahead, the reload picks up from there */
+	sofia_presence_index_invalidate(index, NULL, "call-2", SWITCH_FALSE);
+	epoch = sofia_presence_index_epoch(index);
+	rows = presence_index_row("call-2", "dialog", "192.0.2.10", 9, 200);
+	fst_check(sofia_presence_index_load(index, "1000", rows, epoch, &match, &list) == 1);
+	fst_check(list->version == 10);
+	sofia_presence_watchers_free(&list);
+
+	/* rows read across a write are sent once but not kept */
+	epoch = sofia_presence_index_epoch(index);
+	sofia_presence_index_invalidate(index, "1000", NULL, SWITCH_FALSE);
+	rows = presence_index_row("call-2", "dialog", "192.0.2.10", 1, 200);
+	fst_check(sofia_presence_index_load(index, "1000", rows, epoch, &match, &list) == 1);
+	sofia_presence_watchers_free(&list);
+	fst_check(sofia_presence_index_watchers(index, "1000", &match, &list) == -1);
+
+	epoch = sofia_presence_index_epoch(index);
+	fst_check(sofia_presence_index_load(index, "2000", NULL, epoch, &match, &list) == 0);
+	fst_check(sofia_presence_index_watchers(index, "2000", &match, &list) == 0);
+
+	sofia_presence_index_expire(index, 0);
+	sofia_presence_index_stats(index, &stats);
+	fst_check(stats.presentities == 0);
+	fst_check(stats.watchers == 0);
+	fst_check(stats.hits == 2);
+
+	sofia_presence_index_destroy(&index);
+	fst_check(index == NULL);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_msg_worker_dispatch)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_threadattr_t *thd_attr = NULL;
+	switch_thread_t *threads[DISPATCH_WORKERS] = { 0 };
+	dispatch_worker_t workers[DISPATCH_WORKERS];
+	dispatch_msg_t *msgs;
+	switch_status_t st;
+	switch_time_t start_ts, end_ts;
+	uint64_t micro_total = 0;
+	int spread[DISPATCH_WORKERS] = { 0 };
+	int loops = 200000, i;
+	char call_id[64];
+
+	/* a call-id always lands on the same worker, whatever buffer it comes in */
+	for (i = 0; i < 1000; i++) {
+		char again[64];
+		int w;
+
+		switch_snprintf(call_id, sizeof(call_id), "%d-a84b4c76e66710@192.0.2.1", i);
+		switch_snprintf(again, sizeof(again), "%s", call_id);
+		w = sofia_msg_worker_index(call_id, NULL, DISPATCH_WORKERS);
+		fst_requires(w >= 0 && w < DISPATCH_WORKERS);
+		fst_check(sofia_msg_worker_index(again, NULL, DISPATCH_WORKERS) == w);
+		spread[w]++;
+	}
+
+	/* and the call-ids spread over all of them */
+	for (i = 0; i < DISPATCH_WORKERS; i++) {
+		fst_check(spread[i] > 1000 / DISPATCH_WORKERS / 2);
+	}
+
+	/* without a call-id the handle decides, without workers there is one queue */
+	fst_check(sofia_msg_worker_index(NULL, &spread[1], DISPATCH_WORKERS) == sofia_msg_worker_index("", &spread[1], DISPATCH_WORKERS));
+	fst_check(sofia_msg_worker_index(call_id, NULL, 0) == 0);
+
+	switch_core_new_memory_pool(&pool);
+	fst_requires(pool);
+	msgs = switch_core_alloc(pool, sizeof(*msgs) * loops);
+
+	for (i = 0; i < DISPATCH_CALLS; i++) {
+		dispatch_owner[i] = -1;
+		dispatch_last_seq[i] = 0;
+	}
+	switch_atomic_set(&dispatch_misrouted, 0);
+	switch_atomic_set(&dispatch_reordered, 0);
+	switch_atomic_set(&dispatch_done, 0);
+
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < DISPATCH_WORKERS; i++) {
+		workers[i].id = i;
+		switch_queue_create(&workers[i].q, SOFIA_MSG_QUEUE_SIZE, pool);
+		switch_thread_create(&threads[i], thd_attr, dispatch_worker_run, &workers[i], pool);
+	}
+
+	/* interleaved dialogs, every message routed by its call-id, a full queue is retried like a retransmission */
+	start_ts = switch_time_now();
+	for (i = 0; i < loops; i++) {
+		int call = i % DISPATCH_CALLS;
+
+		msgs[i].call = call;
+		msgs[i].seq = i / DISPATCH_CALLS + 1;
+		switch_snprintf(call_id, sizeof(call_id), "%d-a84b4c76e66710@192.0.2.1", call);
+
+		while (switch_queue_trypush(workers[sofia_msg_worker_index(call_id, NULL, DISPATCH_WORKERS)].q, &msgs[i]) != SWITCH_STATUS_SUCCESS) {
+			switch_cond_next();
+		}
+	}
+
+	while (switch_atomic_read(&dispatch_done) < (uint32_t) loops && switch_time_now() - start_ts < 30000000) {
+		switch_yield(1000);
+	}
+	end_ts = switch_time_now();
+
+	fst_check(switch_atomic_read(&dispatch_done) == (uint32_t) loops);
+	fst_check(switch_atomic_read(&dispatch_misrouted) == 0);
+	fst_check(switch_atomic_read(&dispatch_reordered) == 0);
+
+	micro_total = end_ts - start_ts;
+	printf("sofia msg workers: Total %" SWITCH_UINT64_T_FMT "us / %d msgs over %d workers, %.0f msgs per second\n",
+		   micro_total, loops, DISPATCH_WORKERS, loops * 1000000.0 / micro_total);
+
+	for (i = 0; i < DISPATCH_WORKERS; i++) {
+		switch_queue_push(workers[i].q, NULL);
+		switch_thread_join(&st, threads[i]);
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
 FST_SUITE_END()
 
 FST_MINCORE_END()
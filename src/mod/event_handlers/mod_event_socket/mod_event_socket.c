@@ -64,7 +64,8 @@ typedef enum {
 typedef enum {
 	EVENT_FORMAT_PLAIN,
 	EVENT_FORMAT_XML,
-	EVENT_FORMAT_JSON
+	EVENT_FORMAT_JSON,
+	EVENT_FORMAT_BINARY
 } event_format_t;
 
 struct listener {
@@ -143,6 +144,8 @@ static const char *format2str(event_format_t format)
 		return "xml";
 	case EVENT_FORMAT_JSON:
 		return "json";
+	case EVENT_FORMAT_BINARY:
+		return "binary";
 	}
 
 	return "invalid";
@@ -1189,7 +1192,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 	memset(&listen_list, 0, sizeof(listen_list));
 	switch_mutex_init(&listen_list.sock_mutex, SWITCH_MUTEX_NESTED, pool);
 
-	if (switch_event_bind_removable(modname, SWITCH_EVENT_ALL, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL, &globals.node) != SWITCH_STATUS_SUCCESS) {
+	/* the handler only reads the event and queues its own dup per listener */
+	if (switch_event_bind_removable_flags(modname, SWITCH_EVENT_ALL, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL, SEBF_READ_ONLY, &globals.node) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 		return SWITCH_STATUS_GENERR;
 	}
@@ -1415,6 +1419,15 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 					char *etype;
 
 					do_sleep = 0;
+
+					if (listener->format == EVENT_FORMAT_BINARY) {
+						/* framed straight out of the event, no intermediate string */
+						switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SIZE_T_FMT "\n" "Content-Type: text/event-binary\n" "\n",
+										switch_event_binary_frame_size(pevent));
+						switch_event_binary_frame_send(listener->sock, pevent, hbuf, strlen(hbuf));
+						goto endloop;
+					}
+
 					if (listener->format == EVENT_FORMAT_PLAIN) {
 						etype = "plain";
 						switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
@@ -2085,6 +2098,8 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 							listener->format = EVENT_FORMAT_PLAIN;
 						} else if (!strcasecmp(fmt, "json")) {
 							listener->format = EVENT_FORMAT_JSON;
+						} else if (!strcasecmp(fmt, "binary")) {
+							listener->format = EVENT_FORMAT_BINARY;
 						}
 					}
 
@@ -2126,6 +2141,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 			if (strstr(cmd, "json") || strstr(cmd, "JSON")) {
 				listener->format = EVENT_FORMAT_JSON;
 			}
+			if (strstr(cmd, "binary") || strstr(cmd, "BINARY")) {
+				listener->format = EVENT_FORMAT_BINARY;
+			}
 			switch_snprintf(reply, reply_len, "+OK Events Enabled");
 			goto done;
 		}
@@ -2482,6 +2500,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 					} else if (!strcasecmp(cur, "json")) {
 						listener->format = EVENT_FORMAT_JSON;
 						goto end;
+					} else if (!strcasecmp(cur, "binary")) {
+						listener->format = EVENT_FORMAT_BINARY;
+						goto end;
 					}
 				}
 
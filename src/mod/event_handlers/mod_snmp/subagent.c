@@ -133,11 +133,17 @@ int channelList_load(netsnmp_cache *cache, void *vmagic)
 
 	channelList_free(cache, NULL);
 
-	if (switch_core_db_handle(&dbh) != SWITCH_STATUS_SUCCESS) {
+	idx = 1;
+
+	/* the index has the columns of the channels table in the same order, only for this host and oldest first */
+	if (switch_core_channel_index_enabled()) {
+		switch_core_channel_index_query(SCI_VIEW_CHANNELS, NULL, SCIF_NONE, channelList_callback, NULL);
 		return 0;
 	}
 
-	idx = 1;
+	if (switch_core_db_handle(&dbh) != SWITCH_STATUS_SUCCESS) {
+		return 0;
+	}
 
 	switch_snprintfv(sql, sizeof(sql), "SELECT * FROM channels WHERE hostname='%q' ORDER BY created_epoch", switch_core_get_switchname());
 	switch_cache_db_execute_sql_callback(dbh, sql, channelList_callback, NULL, NULL);
@@ -239,6 +245,13 @@ int handle_systemStats(netsnmp_mib_handler *handler, netsnmp_handler_registratio
 			switch_cache_db_handle_t *dbh;
 			char sql[1024] = "";
 
+			/* one bridged basic_calls row per calls row */
+			if (switch_core_channel_index_enabled()) {
+				switch_core_channel_index_query(SCI_VIEW_BASIC_CALLS, NULL, SCIF_BRIDGED | SCIF_COUNT, sql_count_callback, &int_val);
+				snmp_set_var_typed_integer(requests->requestvb, ASN_GAUGE, int_val);
+				break;
+			}
+
 			if (switch_core_db_handle(&dbh) != SWITCH_STATUS_SUCCESS) {
 				return SNMP_ERR_GENERR;
 			}
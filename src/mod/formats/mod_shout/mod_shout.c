@@ -1454,14 +1454,35 @@ void do_broadcast(switch_stream_handle_t *stream)
 	}
 }
 
+/* the columns of the sql in do_index() picked out of a channel index row */
+static int web_index_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	static const char *cols[] = { "uuid", "created", "cid_name", "cid_num", "dest", "application", "application_data", "read_codec", "read_rate" };
+	char *picked[sizeof(cols) / sizeof(cols[0])] = { 0 };
+	size_t i;
+	int x;
+
+	for (i = 0; i < sizeof(cols) / sizeof(cols[0]); i++) {
+		for (x = 0; x < argc; x++) {
+			if (!strcmp(columnNames[x], cols[i])) {
+				picked[i] = argv[x];
+				break;
+			}
+		}
+	}
+
+	return web_callback(pArg, (int) i, picked, (char **) cols);
+}
+
 void do_index(switch_stream_handle_t *stream)
 {
-	switch_cache_db_handle_t *db;
+	switch_cache_db_handle_t *db = NULL;
 	const char *sql = "select uuid, created, cid_name, cid_num, dest, application, application_data, read_codec, read_rate from channels";
 	struct holder holder;
-	char *errmsg;
+	char *errmsg = NULL;
 
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
+	/* the channels table may not be written while the index is on */
+	if (!switch_core_channel_index_enabled() && switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
 		return;
 	}
 
@@ -1476,7 +1497,12 @@ void do_index(switch_stream_handle_t *stream)
 						   "<tr><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
 						   "Created", "CID Name", "CID Num", "Ext", "App", "Data", "Codec", "Rate", "Listen");
 
-	switch_cache_db_execute_sql_callback(db, sql, web_callback, &holder, &errmsg);
+	if (db) {
+		switch_cache_db_execute_sql_callback(db, sql, web_callback, &holder, &errmsg);
+		switch_cache_db_release_db_handle(&db);
+	} else {
+		switch_core_channel_index_query(SCI_VIEW_CHANNELS, NULL, SCIF_NONE, web_index_callback, &holder);
+	}
 
 	stream->write_function(stream, "</table>");
 
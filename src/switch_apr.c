@@ -775,6 +775,83 @@ SWITCH_DECLARE(switch_status_t) switch_socket_send(switch_socket_t *sock, const
 	return (switch_status_t)status;
 }
 
+#define SWITCH_SENDV_MAX 64
+
+SWITCH_DECLARE(switch_status_t) switch_socket_sendv(switch_socket_t *sock, const switch_io_vec_t *vec, int32_t nvec, switch_size_t *len)
+{
+	struct iovec iov[SWITCH_SENDV_MAX];
+	int status = SWITCH_STATUS_SUCCESS;
+	int32_t next = 0, cnt = 0, i;
+	switch_size_t skip = 0, wrote = 0, sent;
+	int to_count = 0;
+
+	if (!sock || !vec || !len) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	while (status == SWITCH_STATUS_SUCCESS || status == SWITCH_STATUS_BREAK || status == 730035 || status == 35) {
+		/* the first buffer may already be partly sent */
+		for (cnt = 0, i = next; i < nvec && cnt < SWITCH_SENDV_MAX; i++) {
+			const char *base = (const char *) vec[i].base;
+			switch_size_t blen = vec[i].len;
+
+			if (i == next) {
+				base += skip;
+				blen -= skip;
+			}
+
+			if (!blen) {
+				continue;
+			}
+
+			iov[cnt].iov_base = (void *) base;
+			iov[cnt].iov_len = blen;
+			cnt++;
+		}
+
+		if (!cnt) {
+			break;
+		}
+
+		sent = 0;
+		status = apr_socket_sendv(sock, iov, cnt, &sent);
+
+		if (status == SWITCH_STATUS_BREAK || status == 730035 || status == 35) {
+			if (++to_count > 60000) {
+				status = SWITCH_STATUS_FALSE;
+				break;
+			}
+			switch_yield(10000);
+		} else {
+			to_count = 0;
+		}
+
+		wrote += sent;
+
+		/* advance past what went out */
+		while (sent && next < nvec) {
+			switch_size_t left = vec[next].len - skip;
+
+			if (sent < left) {
+				skip += sent;
+				sent = 0;
+			} else {
+				sent -= left;
+				skip = 0;
+				next++;
+			}
+		}
+
+		while (next < nvec && vec[next].len == skip) {
+			skip = 0;
+			next++;
+		}
+	}
+
+	*len = wrote;
+	return (switch_status_t)status;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_socket_send_nonblock(switch_socket_t *sock, const char *buf, switch_size_t *len)
 {
 	if (!sock || !buf || !len) {
@@ -966,6 +1043,38 @@ SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom(switch_sockaddr_t *from,
 	return (switch_status_t)r;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_raw(switch_sockaddr_t *sa, const void *raw, size_t len)
+{
+	const struct sockaddr *in = (const struct sockaddr *) raw;
+
+	if (!sa || !in) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (in->sa_family == AF_INET && len >= sizeof(struct sockaddr_in)) {
+		memcpy(&sa->sa.sin, in, sizeof(struct sockaddr_in));
+		sa->salen = sizeof(struct sockaddr_in);
+		sa->addr_str_len = 16;
+		sa->ipaddr_ptr = &(sa->sa.sin.sin_addr);
+		sa->ipaddr_len = sizeof(struct in_addr);
+#if APR_HAVE_IPV6
+	} else if (in->sa_family == AF_INET6 && len >= sizeof(struct sockaddr_in6)) {
+		memcpy(&sa->sa.sin6, in, sizeof(struct sockaddr_in6));
+		sa->salen = sizeof(struct sockaddr_in6);
+		sa->addr_str_len = 46;
+		sa->ipaddr_ptr = &(sa->sa.sin6.sin6_addr);
+		sa->ipaddr_len = sizeof(struct in6_addr);
+#endif
+	} else {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	sa->family = in->sa_family;
+	sa->port = ntohs(sa->sa.sin.sin_port);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* poll stubs */
 
 SWITCH_DECLARE(switch_status_t) switch_pollset_create(switch_pollset_t ** pollset, uint32_t size, switch_memory_pool_t *pool, uint32_t flags)
@@ -581,6 +581,7 @@ static int comp_callback(void *pArg, int argc, char **argv, char **columnNames)
 
 struct match_helper {
 	switch_console_callback_match_t *my_matches;
+	const char *partial;
 };
 
 static int modulename_callback(void *pArg, const char *module_name)
@@ -662,6 +663,17 @@ static int uuid_callback(void *pArg, int argc, char **argv, char **columnNames)
 
 }
 
+static int uuid_index_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct match_helper *h = (struct match_helper *) pArg;
+
+	if (zstr(h->partial) || !strncmp(argv[0], h->partial, strlen(h->partial))) {
+		switch_console_push_match(&h->my_matches, argv[0]);
+	}
+
+	return 0;
+}
+
 SWITCH_DECLARE_NONSTD(switch_status_t) switch_console_list_uuid(const char *line, const char *cursor, switch_console_callback_match_t **matches)
 {
 	char *sql;
@@ -670,6 +682,11 @@ SWITCH_DECLARE_NONSTD(switch_status_t) switch_console_list_uuid(const char *line
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	char *errmsg;
 
+	if (switch_core_channel_index_enabled()) {
+		h.partial = cursor;
+		switch_core_channel_index_query(SCI_VIEW_CHANNELS, NULL, SCIF_NONE, uuid_index_callback, &h);
+		goto end;
+	}
 
 	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Database Error\n");
@@ -688,6 +705,8 @@ SWITCH_DECLARE_NONSTD(switch_status_t) switch_console_list_uuid(const char *line
 
 	switch_cache_db_release_db_handle(&db);
 
+ end:
+
 	if (h.my_matches) {
 		*matches = h.my_matches;
 		status = SWITCH_STATUS_SUCCESS;
@@ -1999,6 +1999,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	runtime.timer_affinity = -1;
 	runtime.microseconds_per_tick = 20000;
 
+	switch_resample_cache_init(runtime.memory_pool);
+	switch_core_file_cache_init(runtime.memory_pool);
+	switch_regex_cache_init(runtime.memory_pool);
+	runtime.regex_cache_size = SWITCH_REGEX_CACHE_DEFAULT_SIZE;
+	runtime.regex_jit = SWITCH_TRUE;
+
 	if (flags & SCF_MINIMAL) return SWITCH_STATUS_SUCCESS;
 
 	switch_load_core_config("switch.conf");
@@ -2012,6 +2018,14 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 
 	switch_rtp_init(runtime.memory_pool);
 
+	if (runtime.record_writer_threads >= 0) {
+		switch_ivr_record_writer_start((uint32_t) runtime.record_writer_threads);
+	}
+
+	if (runtime.media_bug_threads >= 0) {
+		switch_core_media_bug_pool_start((uint32_t) runtime.media_bug_threads);
+	}
+
 	runtime.running = 1;
 	runtime.initiated = switch_mono_micro_time_now();
 
@@ -2173,6 +2187,10 @@ static void switch_load_core_config(const char *file)
 
 				} else if (!strcasecmp(var, "multiple-registrations")) {
 					runtime.multiple_registrations = switch_true(val);
+				} else if (!strcasecmp(var, "channel-index")) {
+					runtime.channel_index = switch_true(val);
+				} else if (!strcasecmp(var, "channel-index-sql")) {
+					runtime.channel_index_sql = switch_true(val);
 				} else if (!strcasecmp(var, "auto-create-schemas")) {
 					if (switch_true(val)) {
 						switch_set_flag((&runtime), SCF_AUTO_SCHEMAS);
@@ -2245,6 +2263,8 @@ static void switch_load_core_config(const char *file)
 					if (val) {
 						if (switch_true(val)) {
 							ival = 2;
+						} else if (!strcasecmp(val, "shared")) {
+							ival = 3;
 						} else {
 							if (strcasecmp(val, "broadcast")) {
 								ival = 1;
@@ -2326,6 +2346,32 @@ static void switch_load_core_config(const char *file)
 					switch_rtp_set_end_port((switch_port_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-port-usage-robustness") && switch_true(val)) {
 					runtime.port_alloc_flags |= SPF_ROBUST_UDP;
+				} else if (!strcasecmp(var, "rtp-io-threads") && !zstr(val)) {
+					switch_core_set_variable("rtp_io_threads", val);
+				} else if (!strcasecmp(var, "record-writer-threads") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					/* 0 turns the shared writers off */
+					runtime.record_writer_threads = tmp > 0 ? tmp : -1;
+				} else if (!strcasecmp(var, "media-bug-threads") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					/* 0 runs every bug inline */
+					runtime.media_bug_threads = tmp > 0 ? tmp : -1;
+				} else if (!strcasecmp(var, "file-cache-size") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					runtime.file_cache_size = tmp > 0 ? (switch_size_t) tmp * 1024 * 1024 : 0;
+				} else if (!strcasecmp(var, "file-cache-mmap") && !zstr(val)) {
+					runtime.file_cache_mmap = switch_true(val);
+				} else if (!strcasecmp(var, "regex-cache-size") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					runtime.regex_cache_size = tmp > 0 ? (uint32_t) tmp : 0;
+				} else if (!strcasecmp(var, "regex-jit") && !zstr(val)) {
+					runtime.regex_jit = switch_true(val);
+				} else if (!strcasecmp(var, "resampler-polyphase") && !zstr(val)) {
+					switch_resample_set_polyphase(switch_true(val));
 				} else if (!strcasecmp(var, "core-db-name") && !zstr(val)) {
 					runtime.dbname = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-dsn") && !zstr(val)) {
@@ -2398,6 +2444,9 @@ static void switch_load_core_config(const char *file)
 			runtime.event_channel_key_separator = switch_core_strdup(runtime.memory_pool, ".");
 		}
 
+		switch_core_file_cache_set_size(runtime.file_cache_size, runtime.file_cache_mmap);
+		switch_regex_cache_set_size(runtime.regex_cache_size, runtime.regex_jit);
+
 		if ((settings = switch_xml_child(cfg, "variables"))) {
 			for (param = switch_xml_child(settings, "variable"); param; param = param->next) {
 				const char *var = switch_xml_attr_soft(param, "name");
@@ -3011,6 +3060,8 @@ void switch_core_sqldb_destroy()
 {
 	if (switch_test_flag((&runtime), SCF_USE_SQL)) {
 		switch_core_sqldb_stop();
+	} else {
+		switch_core_channel_index_stop();
 	}
 }
 
@@ -3040,6 +3091,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 
 	switch_rtp_shutdown();
 	switch_msrp_destroy();
+	switch_ivr_record_writer_stop();
+	switch_core_media_bug_pool_stop();
+	switch_core_file_cache_shutdown();
+	switch_regex_cache_shutdown();
+	switch_resample_cache_shutdown();
 
 	if (switch_test_flag((&runtime), SCF_USE_AUTO_NAT)) {
 		switch_nat_shutdown();
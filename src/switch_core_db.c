@@ -121,6 +121,11 @@ SWITCH_DECLARE(int) switch_core_db_prepare(switch_core_db_t *db, const char *zSq
 	return sqlite3_prepare(db, zSql, nBytes, ppStmt, pzTail);
 }
 
+SWITCH_DECLARE(int) switch_core_db_prepare_v2(switch_core_db_t *db, const char *zSql, int nBytes, switch_core_db_stmt_t **ppStmt, const char **pzTail)
+{
+	return sqlite3_prepare_v2(db, zSql, nBytes, ppStmt, pzTail);
+}
+
 SWITCH_DECLARE(int) switch_core_db_step(switch_core_db_stmt_t *stmt)
 {
 	return sqlite3_step(stmt);
@@ -141,6 +146,11 @@ SWITCH_DECLARE(int) switch_core_db_bind_int64(switch_core_db_stmt_t *pStmt, int
 	return sqlite3_bind_int64(pStmt, i, iValue);
 }
 
+SWITCH_DECLARE(int) switch_core_db_bind_null(switch_core_db_stmt_t *pStmt, int i)
+{
+	return sqlite3_bind_null(pStmt, i);
+}
+
 SWITCH_DECLARE(int) switch_core_db_bind_text(switch_core_db_stmt_t *pStmt, int i, const char *zData, int nData, switch_core_db_destructor_type_t xDel)
 {
 	return sqlite3_bind_text(pStmt, i, zData, nData, xDel);
@@ -35,6 +35,14 @@
 
 #include <switch.h>
 #include "private/switch_core_pvt.h"
+#ifndef WIN32
+#include <switch_private.h>
+#endif
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 
 static switch_status_t get_file_size(switch_file_handle_t *fh, const char **string)
@@ -62,6 +70,489 @@ static switch_status_t get_file_size(switch_file_handle_t *fh, const char **stri
 	return status;
 }
 
+/* Decoded file cache: prompts read through a format module are decoded once into memory and every later open of the
+   same file at the same rate is served from there, skipping the module's open and decode.  Entries are reference
+   counted so eviction never pulls audio from under a playing handle, the least recently used idle ones go first. */
+
+#define FILE_CACHE_RECHECK 1000000
+
+typedef struct file_cache_entry_s {
+	char *key;
+	char *path;
+	time_t mtime;
+	int64_t size;
+	uint32_t rate;
+	uint32_t channels;
+	unsigned int samples;
+	int format;
+	int sections;
+	int seekable;
+	int16_t *data;
+	switch_size_t bytes;
+	int mapped;
+	uint32_t refs;
+	int dead;
+	switch_time_t checked;
+	struct file_cache_entry_s *prev;
+	struct file_cache_entry_s *next;
+} file_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	file_cache_entry_t *head;
+	file_cache_entry_t *tail;
+	switch_size_t max_bytes;
+	switch_size_t bytes;
+	uint32_t entries;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	switch_bool_t use_mmap;
+} file_cache;
+
+static void file_cache_free(file_cache_entry_t *entry)
+{
+#ifdef HAVE_MMAP
+	if (entry->mapped) {
+		munmap(entry->data, entry->bytes);
+	} else
+#endif
+	{
+		free(entry->data);
+	}
+	free(entry->key);
+	free(entry->path);
+	free(entry);
+}
+
+/* call with the lock held */
+static void file_cache_unlink(file_cache_entry_t *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		file_cache.head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		file_cache.tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+}
+
+/* call with the lock held, the entry is freed now or by whoever drops the last reference */
+static void file_cache_remove(file_cache_entry_t *entry)
+{
+	switch_core_hash_delete(file_cache.hash, entry->key);
+	file_cache_unlink(entry);
+	file_cache.bytes -= entry->bytes;
+	file_cache.entries--;
+	entry->dead = 1;
+
+	if (!entry->refs) {
+		file_cache_free(entry);
+	}
+}
+
+/* call with the lock held */
+static void file_cache_trim(void)
+{
+	file_cache_entry_t *entry = file_cache.tail, *prev;
+
+	while (entry && file_cache.bytes > file_cache.max_bytes) {
+		prev = entry->prev;
+
+		if (!entry->refs) {
+			file_cache_remove(entry);
+			file_cache.evictions++;
+		}
+
+		entry = prev;
+	}
+}
+
+static void file_cache_release(switch_file_handle_t *fh)
+{
+	file_cache_entry_t *entry = fh->cache;
+
+	if (!entry) {
+		return;
+	}
+
+	fh->cache = NULL;
+
+	switch_mutex_lock(file_cache.mutex);
+	if (!--entry->refs) {
+		if (entry->dead) {
+			file_cache_free(entry);
+		} else {
+			file_cache_trim();
+		}
+	}
+	switch_mutex_unlock(file_cache.mutex);
+}
+
+/* the file the module will really open, the rate directories are tried first the way mod_sndfile does */
+static switch_bool_t file_cache_stat(const char *path, uint32_t rate, char *buf, switch_size_t len, struct stat *st)
+{
+	uint32_t rates[] = { 0, 48000, 32000, 16000, 8000 };
+	const char *base;
+	int i;
+
+	if ((base = strrchr(path, *SWITCH_PATH_SEPARATOR))) {
+		base++;
+		rates[0] = rate;
+
+		for (i = 0; i < 5; i++) {
+			switch_snprintf(buf, len, "%.*s%u%s%s", (int) (base - path), path, rates[i], SWITCH_PATH_SEPARATOR, base);
+			if (!stat(buf, st)) {
+				return SWITCH_TRUE;
+			}
+		}
+	}
+
+	switch_copy_string(buf, path, len);
+
+	return !stat(buf, st);
+}
+
+static switch_bool_t file_cache_usable(switch_file_handle_t *fh, const char *file_path, int is_stream, char *key, switch_size_t keylen)
+{
+	if (!file_cache.max_bytes || !file_cache.mutex || is_stream || fh->spool_path ||
+		(fh->flags & (SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_FLAG_VIDEO | SWITCH_FILE_NATIVE |
+					  SWITCH_FILE_DATA_INT | SWITCH_FILE_DATA_FLOAT | SWITCH_FILE_DATA_DOUBLE | SWITCH_FILE_DATA_RAW)) ||
+		!(fh->flags & SWITCH_FILE_FLAG_READ) || !(fh->flags & SWITCH_FILE_DATA_SHORT)) {
+		return SWITCH_FALSE;
+	}
+
+	switch_snprintf(key, keylen, "%s|%u|%u|%s", file_path, fh->samplerate, fh->channels, switch_str_nil(fh->modname));
+
+	return SWITCH_TRUE;
+}
+
+static switch_status_t file_cache_open(switch_file_handle_t *fh, const char *key)
+{
+	file_cache_entry_t *entry;
+	struct stat st;
+	switch_time_t now = switch_micro_time_now();
+
+	switch_mutex_lock(file_cache.mutex);
+	if ((entry = switch_core_hash_find(file_cache.hash, key)) && now - entry->checked > FILE_CACHE_RECHECK) {
+		/* somebody replaced the prompt, decode it again */
+		if (stat(entry->path, &st) || st.st_mtime != entry->mtime || (int64_t) st.st_size != entry->size) {
+			file_cache_remove(entry);
+			entry = NULL;
+		} else {
+			entry->checked = now;
+		}
+	}
+
+	if (entry) {
+		entry->refs++;
+		file_cache.hits++;
+		file_cache_unlink(entry);
+		entry->next = file_cache.head;
+		if (file_cache.head) {
+			file_cache.head->prev = entry;
+		}
+		file_cache.head = entry;
+		if (!file_cache.tail) {
+			file_cache.tail = entry;
+		}
+	} else {
+		file_cache.misses++;
+	}
+	switch_mutex_unlock(file_cache.mutex);
+
+	if (!entry) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	fh->cache = entry;
+	fh->samples = entry->samples;
+	fh->samplerate = entry->rate;
+	fh->channels = entry->channels;
+	fh->format = entry->format;
+	fh->sections = entry->sections;
+	fh->seekable = entry->seekable;
+	fh->speed = 0;
+	fh->pos = fh->offset_pos < entry->samples ? fh->offset_pos : entry->samples;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static int16_t *file_cache_alloc(switch_size_t bytes, int *mapped)
+{
+	int16_t *data = NULL;
+
+	*mapped = 0;
+
+#ifdef HAVE_MMAP
+	if (file_cache.use_mmap) {
+		char path[1024];
+		int fd;
+
+		/* page cache backed, the kernel can drop the pages of cold prompts and read them back in */
+		switch_snprintf(path, sizeof(path), "%s%sfs_file_cache_XXXXXX", SWITCH_GLOBAL_dirs.temp_dir, SWITCH_PATH_SEPARATOR);
+		if ((fd = mkstemp(path)) > -1) {
+			unlink(path);
+			if (!ftruncate(fd, (off_t) bytes)) {
+				void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+				if (map != MAP_FAILED) {
+					data = map;
+					*mapped = 1;
+				}
+			}
+			close(fd);
+		}
+	}
+#endif
+
+	if (!data) {
+		data = malloc(bytes);
+	}
+
+	return data;
+}
+
+/* decode a freshly opened file into the cache and serve the handle from there, the module is closed if it worked */
+static switch_status_t file_cache_fill(switch_file_handle_t *fh, const char *file_path, const char *key)
+{
+	file_cache_entry_t *entry, *found;
+	switch_size_t bytes, got = 0, len;
+	uint32_t channels = fh->channels ? fh->channels : 1;
+	char path[1024];
+	struct stat st;
+	int16_t *data;
+	int mapped;
+
+	/* a handle opened at an offset has already been moved past the start */
+	if (!fh->samples || fh->offset_pos || !fh->file_interface->file_read) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	bytes = (switch_size_t) fh->samples * channels * sizeof(int16_t);
+
+	/* one prompt may take a quarter of the cache */
+	if (bytes > file_cache.max_bytes / 4 || !file_cache_stat(file_path, fh->samplerate, path, sizeof(path), &st)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!(data = file_cache_alloc(bytes, &mapped))) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	while (got < fh->samples) {
+		len = fh->samples - got;
+		if (len > 8192) len = 8192;
+
+		if (fh->file_interface->file_read(fh, data + got * channels, &len) != SWITCH_STATUS_SUCCESS || !len) {
+			break;
+		}
+
+		got += len;
+	}
+
+	if (!got) {
+#ifdef HAVE_MMAP
+		if (mapped) {
+			munmap(data, bytes);
+		} else
+#endif
+		{
+			free(data);
+		}
+
+		if (fh->file_interface->file_seek) {
+			unsigned int pos = 0;
+			fh->file_interface->file_seek(fh, &pos, 0, SEEK_SET);
+		}
+
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->key = strdup(key);
+	entry->path = strdup(path);
+	entry->mtime = st.st_mtime;
+	entry->size = (int64_t) st.st_size;
+	entry->rate = fh->samplerate;
+	entry->channels = channels;
+	entry->samples = (unsigned int) got;
+	entry->format = fh->format;
+	entry->sections = fh->sections;
+	entry->seekable = 1;
+	entry->data = data;
+	entry->bytes = bytes;
+	entry->mapped = mapped;
+	entry->refs = 1;
+	entry->checked = switch_micro_time_now();
+
+	/* the whole file went into the cache so the module is done with it */
+	fh->file_interface->file_close(fh);
+	fh->private_info = NULL;
+
+	switch_mutex_lock(file_cache.mutex);
+	if ((found = switch_core_hash_find(file_cache.hash, key))) {
+		/* somebody else decoded it at the same time */
+		found->refs++;
+		file_cache_free(entry);
+		entry = found;
+	} else {
+		switch_core_hash_insert(file_cache.hash, entry->key, entry);
+		entry->next = file_cache.head;
+		if (file_cache.head) {
+			file_cache.head->prev = entry;
+		}
+		file_cache.head = entry;
+		if (!file_cache.tail) {
+			file_cache.tail = entry;
+		}
+		file_cache.bytes += entry->bytes;
+		file_cache.entries++;
+		file_cache_trim();
+	}
+	switch_mutex_unlock(file_cache.mutex);
+
+	fh->cache = entry;
+	fh->samples = entry->samples;
+	fh->seekable = 1;
+	fh->pos = fh->offset_pos < entry->samples ? fh->offset_pos : entry->samples;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t file_cache_read(switch_file_handle_t *fh, void *data, switch_size_t *len)
+{
+	file_cache_entry_t *entry = fh->cache;
+	switch_size_t avail = fh->pos < entry->samples ? entry->samples - fh->pos : 0;
+
+	if (*len > avail) {
+		*len = avail;
+	}
+
+	if (*len) {
+		memcpy(data, entry->data + (switch_size_t) fh->pos * entry->channels, *len * entry->channels * sizeof(int16_t));
+		fh->pos += (unsigned int) *len;
+		fh->sample_count += *len;
+	}
+
+	return *len ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t file_cache_seek(switch_file_handle_t *fh, unsigned int *cur_pos, int64_t samples, int whence)
+{
+	file_cache_entry_t *entry = fh->cache;
+	int64_t pos = samples;
+
+	if (whence == SEEK_CUR) {
+		pos += fh->pos;
+	} else if (whence == SEEK_END) {
+		pos += entry->samples;
+	}
+
+	if (pos < 0 || pos > entry->samples) {
+		*cur_pos = fh->pos = entry->samples;
+		return SWITCH_STATUS_BREAK;
+	}
+
+	*cur_pos = fh->pos = (unsigned int) pos;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t core_file_read(switch_file_handle_t *fh, void *data, switch_size_t *len)
+{
+	if (fh->cache) {
+		return file_cache_read(fh, data, len);
+	}
+
+	return fh->file_interface->file_read(fh, data, len);
+}
+
+static switch_status_t core_file_seek(switch_file_handle_t *fh, unsigned int *cur_pos, int64_t samples, int whence)
+{
+	if (fh->cache) {
+		return file_cache_seek(fh, cur_pos, samples, whence);
+	}
+
+	return fh->file_interface->file_seek(fh, cur_pos, samples, whence);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_init(switch_memory_pool_t *pool)
+{
+	if (!file_cache.mutex) {
+		switch_mutex_init(&file_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&file_cache.hash);
+	}
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_set_size(switch_size_t max_bytes, switch_bool_t use_mmap)
+{
+	if (!file_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(file_cache.mutex);
+	file_cache.max_bytes = max_bytes;
+	file_cache.use_mmap = use_mmap;
+	file_cache_trim();
+	switch_mutex_unlock(file_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_flush(void)
+{
+	if (!file_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(file_cache.mutex);
+	while (file_cache.head) {
+		file_cache_remove(file_cache.head);
+	}
+	switch_mutex_unlock(file_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_stats(switch_file_cache_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!file_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(file_cache.mutex);
+	stats->max_bytes = file_cache.max_bytes;
+	stats->bytes = file_cache.bytes;
+	stats->entries = file_cache.entries;
+	stats->hits = file_cache.hits;
+	stats->misses = file_cache.misses;
+	stats->evictions = file_cache.evictions;
+	switch_mutex_unlock(file_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_shutdown(void)
+{
+	switch_mutex_t *mutex = file_cache.mutex;
+
+	if (!mutex) {
+		return;
+	}
+
+	switch_core_file_cache_flush();
+
+	switch_mutex_lock(mutex);
+	switch_core_hash_destroy(&file_cache.hash);
+	file_cache.mutex = NULL;
+	file_cache.max_bytes = 0;
+	switch_mutex_unlock(mutex);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file, const char *func, int line,
 															  switch_file_handle_t *fh,
 															  const char *file_path,
@@ -77,6 +568,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 	int to = 0;
 	int force_channels = 0;
 	uint32_t core_channel_limit;
+	char cache_key[1024] = "";
+	int cacheable = 0;
 
 	if (switch_test_flag(fh, SWITCH_FILE_OPEN)) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Handle already open\n");
@@ -354,7 +847,16 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 
 	file_path = fh->spool_path ? fh->spool_path : fh->file_path;
 
-	if ((status = fh->file_interface->file_open(fh, file_path)) != SWITCH_STATUS_SUCCESS) {
+	fh->cache = NULL;
+	cacheable = file_cache_usable(fh, file_path, is_stream, cache_key, sizeof(cache_key));
+
+	if (cacheable && file_cache_open(fh, cache_key) == SWITCH_STATUS_SUCCESS) {
+		status = SWITCH_STATUS_SUCCESS;
+	} else if ((status = fh->file_interface->file_open(fh, file_path)) == SWITCH_STATUS_SUCCESS) {
+		if (cacheable) {
+			file_cache_fill(fh, file_path, cache_key);
+		}
+	} else {
 		if (fh->spool_path) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Spool dir is set.  Make sure [%s] is also a valid path\n", fh->spool_path);
 		}
@@ -370,7 +872,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 	core_channel_limit = switch_core_max_audio_channels(0);
 	if (core_channel_limit && fh->channels > core_channel_limit) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "File [%s] has more channels (%u) than limit (%u). Closing.\n", file_path, fh->channels, core_channel_limit);
-		fh->file_interface->file_close(fh);
+		if (fh->cache) {
+			file_cache_release(fh);
+		} else {
+			fh->file_interface->file_close(fh);
+		}
 		UNPROTECT_INTERFACE(fh->file_interface);
 		switch_goto_status(SWITCH_STATUS_FALSE, fail);
 	}
@@ -488,7 +994,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read(switch_file_handle_t *fh,
 			rlen = asis ? fh->pre_buffer_datalen : fh->pre_buffer_datalen / 2 / fh->real_channels;
 
 			if (switch_buffer_inuse(fh->pre_buffer) < rlen * 2 * fh->channels) {
-				if ((status = fh->file_interface->file_read(fh, fh->pre_buffer_data, &rlen)) == SWITCH_STATUS_BREAK) {
+				if ((status = core_file_read(fh, fh->pre_buffer_data, &rlen)) == SWITCH_STATUS_BREAK) {
 					return SWITCH_STATUS_BREAK;
 				}
 
@@ -517,7 +1023,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read(switch_file_handle_t *fh,
 
 	} else {
 
-		if ((status = fh->file_interface->file_read(fh, data, len)) == SWITCH_STATUS_BREAK) {
+		if ((status = core_file_read(fh, data, len)) == SWITCH_STATUS_BREAK) {
 			return SWITCH_STATUS_BREAK;
 		}
 
@@ -744,7 +1250,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_seek(switch_file_handle_t *fh,
 
 	switch_assert(fh != NULL);
 
-	if (!switch_test_flag(fh, SWITCH_FILE_OPEN) || !fh->file_interface->file_seek) {
+	if (!switch_test_flag(fh, SWITCH_FILE_OPEN) || !(fh->cache || fh->file_interface->file_seek)) {
 		ok = 0;
 	} else if (switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE)) {
 		if (!(switch_test_flag(fh, SWITCH_FILE_WRITE_APPEND) || switch_test_flag(fh, SWITCH_FILE_WRITE_OVER))) {
@@ -770,14 +1276,14 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_seek(switch_file_handle_t *fh,
 		unsigned int cur = 0;
 
 		if (switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE)) {
-			fh->file_interface->file_seek(fh, &cur, fh->samples_out, SEEK_SET);
+			core_file_seek(fh, &cur, fh->samples_out, SEEK_SET);
 		} else {
-			fh->file_interface->file_seek(fh, &cur, fh->offset_pos, SEEK_SET);
+			core_file_seek(fh, &cur, fh->offset_pos, SEEK_SET);
 		}
 	}
 
 	switch_set_flag_locked(fh, SWITCH_FILE_SEEK);
-	status = fh->file_interface->file_seek(fh, cur_pos, samples, whence);
+	status = core_file_seek(fh, cur_pos, samples, whence);
 
 	fh->offset_pos = *cur_pos;
 
@@ -797,7 +1303,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_set_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_set_string) {
+	if (fh->cache || !fh->file_interface->file_set_string) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -815,7 +1321,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_get_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_get_string) {
+	if (fh->cache || !fh->file_interface->file_get_string) {
 		if (col == SWITCH_AUDIO_COL_STR_FILE_SIZE) {
 			return get_file_size(fh, string);
 		}
@@ -885,7 +1391,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 		break;
 	}
 
-	if (fh->file_interface->file_command) {
+	if (!fh->cache && fh->file_interface->file_command) {
 		switch_mutex_lock(fh->flag_mutex);
 		status = fh->file_interface->file_command(fh, command);
 		switch_mutex_unlock(fh->flag_mutex);
@@ -933,7 +1439,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_pre_close(switch_file_handle_t
 	switch_clear_flag_locked(fh, SWITCH_FILE_OPEN);
 	switch_set_flag_locked(fh, SWITCH_FILE_PRE_CLOSED);
 
-	if (fh->file_interface->file_pre_close) {
+	if (!fh->cache && fh->file_interface->file_pre_close) {
 		status = fh->file_interface->file_pre_close(fh);
 	}
 
@@ -952,7 +1458,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_close(switch_file_handle_t *fh)
 
 	switch_clear_flag_locked(fh, SWITCH_FILE_PRE_CLOSED);
 
-	fh->file_interface->file_close(fh);
+	if (fh->cache) {
+		file_cache_release(fh);
+	} else {
+		fh->file_interface->file_close(fh);
+	}
 
 	if (fh->params) {
 		switch_event_destroy(&fh->params);
@@ -71,6 +71,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int need_codec, perfect, do_bugs = 0, do_resample = 0, is_cng = 0, tap_only = 0;
 	switch_codec_implementation_t codec_impl;
+	switch_frame_t *enc_frame = NULL, *read_frame = NULL;
 	unsigned int flag = 0;
 	int i;
 
@@ -121,6 +122,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 	switch_mutex_lock(session->read_codec->mutex);
 
+	session->stretch_len = 0;
+
   top:
 
 	for(i = 0; i < 2; i++) {
@@ -262,7 +265,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 						switch_set_flag((*frame), SFF_CNG);
 						break;
 					}
-					if (bp->callback) {
+					if (bp->callback && (!switch_test_flag(bp, SMBF_ASYNC) ||
+										 switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_TAP_NATIVE_READ, *frame) != SWITCH_STATUS_SUCCESS)) {
 						bp->native_read_frame = *frame;
 						ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_TAP_NATIVE_READ);
 						bp->native_read_frame = NULL;
@@ -330,9 +334,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 							switch_core_gen_encoded_silence(data, (*frame)->codec->implementation, tmp_frame.datalen);
 
-							bp->native_read_frame = &tmp_frame;
-							ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_TAP_NATIVE_READ);
-							bp->native_read_frame = NULL;
+							if (!switch_test_flag(bp, SMBF_ASYNC) ||
+								switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_TAP_NATIVE_READ, &tmp_frame) != SWITCH_STATUS_SUCCESS) {
+								bp->native_read_frame = &tmp_frame;
+								ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_TAP_NATIVE_READ);
+								bp->native_read_frame = NULL;
+							}
 						}
 					}
 				}
@@ -405,7 +412,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 
 	if (status == SWITCH_STATUS_SUCCESS && need_codec) {
-		switch_frame_t *enc_frame, *read_frame = *frame;
+		read_frame = *frame;
 
 		switch_set_flag(session, SSF_READ_TRANSCODE);
 
@@ -530,6 +537,53 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 			}
 
+			/* the jitter buffer handed us a frame early to shrink, squeeze it and the next one together into about one frame */
+			if (session->stretch_len && status == SWITCH_STATUS_SUCCESS) {
+				if (!do_bugs && session->read_impl.number_of_channels == 1 && session->raw_read_frame.channels == 1) {
+					uint32_t samples = session->raw_read_frame.datalen / 2, stashed = session->stretch_len / 2;
+					int16_t *data = session->raw_read_frame.data;
+
+					if ((stashed + samples) * 2 <= session->raw_read_frame.buflen) {
+						uint32_t buffered = 0;
+
+						if (session->raw_read_buffer && session->read_impl.actual_samples_per_second) {
+							buffered = (uint32_t) (switch_buffer_inuse(session->raw_read_buffer) / 2 *
+												   codec_impl.actual_samples_per_second / session->read_impl.actual_samples_per_second);
+						}
+
+						memmove(data + stashed, data, samples * 2);
+						memcpy(data, session->stretch_buf, stashed * 2);
+						samples = switch_accelerate_sln(data, stashed + samples, samples + buffered, codec_impl.actual_samples_per_second);
+						session->raw_read_frame.datalen = samples * 2;
+						session->raw_read_frame.samples = samples;
+					}
+				}
+
+				session->stretch_len = 0;
+			} else if (session->stretch_len) {
+				/* the next frame did not decode, the early one stands in for it */
+				memcpy(session->raw_read_frame.data, session->stretch_buf, session->stretch_len);
+				session->raw_read_frame.datalen = session->stretch_len;
+				session->raw_read_frame.samples = session->stretch_len / 2;
+				session->raw_read_frame.channels = 1;
+				session->stretch_len = 0;
+				status = SWITCH_STATUS_SUCCESS;
+			} else if (status == SWITCH_STATUS_SUCCESS && !do_bugs && session->read_impl.number_of_channels == 1 && session->raw_read_frame.channels == 1 &&
+					   switch_test_flag(*frame, SFF_JB_ACCELERATE) && session->raw_read_frame.datalen * 2 <= session->raw_read_frame.buflen) {
+				if (!session->stretch_buf) {
+					session->stretch_buf = switch_core_session_alloc(session, session->raw_read_frame.buflen);
+				}
+
+				memcpy(session->stretch_buf, session->raw_read_frame.data, session->raw_read_frame.datalen);
+				session->stretch_len = session->raw_read_frame.datalen;
+				session->stretch_frame = *read_frame;
+				session->stretch_frame.data = session->stretch_buf;
+				session->stretch_frame.datalen = session->stretch_len;
+				goto top;
+			}
+
+		  stretch_replay:
+
 			if (do_resample && ((status == SWITCH_STATUS_SUCCESS) || is_cng)) {
 				status = SWITCH_STATUS_RESAMPLE;
 			}
@@ -697,7 +751,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 		if (session->bugs) {
 			switch_media_bug_t *bp;
 			switch_bool_t ok = SWITCH_TRUE;
-			int prune = 0;
+			int prune = 0, tap_fed = 0;
 			switch_thread_rwlock_rdlock(session->bug_rwlock);
 
 			for (bp = session->bugs; bp; bp = bp->next) {
@@ -722,7 +776,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 				if (bp->ready && switch_test_flag(bp, SMBF_READ_STREAM)) {
 					switch_mutex_lock(bp->read_mutex);
-					if (bp->read_demux_frame) {
+					if (bp->read_demux_frame && bp->raw_read_buffer) {
 						uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
 						int bytes = read_frame->datalen;
 						uint32_t datalen = 0;
@@ -734,14 +788,31 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 													 bp->read_demux_frame->channels) * 2 * bp->read_demux_frame->channels;
 
 						switch_buffer_write(bp->raw_read_buffer, data, datalen);
-					} else {
+					} else if (bp->raw_read_buffer) {
 						switch_buffer_write(bp->raw_read_buffer, read_frame->data, read_frame->datalen);
+					} else {
+						/* one copy for every bug on the session */
+						if (!tap_fed) {
+							switch_core_media_bug_tap_write(session, SWITCH_RW_READ, read_frame->data, read_frame->datalen);
+							tap_fed = 1;
+						}
+						switch_core_media_bug_tap_take(bp, SWITCH_RW_READ);
 					}
 
-					if (bp->callback) {
-						ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_READ);
+					/* a blocking push waits on the worker, which may need this mutex to read the frame */
+					if (bp->callback && switch_test_flag(bp, SMBF_ASYNC)) {
+						switch_mutex_unlock(bp->read_mutex);
+						if (switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_READ, NULL) != SWITCH_STATUS_SUCCESS) {
+							switch_mutex_lock(bp->read_mutex);
+							ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_READ);
+							switch_mutex_unlock(bp->read_mutex);
+						}
+					} else {
+						if (bp->callback) {
+							ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_READ);
+						}
+						switch_mutex_unlock(bp->read_mutex);
 					}
-					switch_mutex_unlock(bp->read_mutex);
 				}
 
 				if ((bp->stop_time && bp->stop_time <= switch_epoch_time_now(NULL)) || ok == SWITCH_FALSE) {
@@ -869,6 +940,21 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 	}
 
   done:
+	if (session->stretch_len) {
+		/* the read after an early frame brought nothing to decode, hand out the early frame on its own */
+		memcpy(session->raw_read_frame.data, session->stretch_buf, session->stretch_len);
+		session->raw_read_frame.datalen = session->stretch_len;
+		session->raw_read_frame.samples = session->stretch_len / 2;
+		session->raw_read_frame.channels = 1;
+		session->stretch_len = 0;
+		read_frame = *frame = &session->stretch_frame;
+		codec_impl = *read_frame->codec->implementation;
+		do_resample = codec_impl.actual_samples_per_second != session->read_impl.actual_samples_per_second;
+		do_bugs = is_cng = perfect = 0;
+		status = SWITCH_STATUS_SUCCESS;
+		goto stretch_replay;
+	}
+
 	if (!(*frame)) {
 		status = SWITCH_STATUS_FALSE;
 	} else {
@@ -900,7 +986,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 					continue;
 				}
 
-				if (bp->ready && switch_test_flag(bp, SMBF_READ_PING)) {
+				if (bp->ready && switch_test_flag(bp, SMBF_READ_PING) && switch_test_flag(bp, SMBF_ASYNC) &&
+					switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_READ_PING, *frame) == SWITCH_STATUS_SUCCESS) {
+					if (bp->stop_time && bp->stop_time <= switch_epoch_time_now(NULL)) {
+						ok = SWITCH_FALSE;
+					}
+				} else if (bp->ready && switch_test_flag(bp, SMBF_READ_PING)) {
 					switch_mutex_lock(bp->read_mutex);
 					bp->ping_frame = *frame;
 					if (bp->callback) {
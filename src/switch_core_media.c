@@ -1987,6 +1987,10 @@ static void set_stats(switch_core_session_t *session, switch_media_type_t type,
 		add_stat(stats->inbound.cng_packet_count, "in_cng_packet_count");
 		add_stat(stats->inbound.flush_packet_count, "in_flush_packet_count");
 		add_stat(stats->inbound.largest_jb_size, "in_largest_jb_size");
+		add_stat(stats->inbound.jb_target_delay, "in_jb_target_delay_ms");
+		add_stat(stats->inbound.jb_delay, "in_jb_delay_ms");
+		add_stat(stats->inbound.jb_accelerate_count, "in_jb_accelerate_count");
+		add_stat(stats->inbound.jb_expand_count, "in_jb_expand_count");
 		add_stat_double(stats->inbound.min_variance, "in_jitter_min_variance");
 		add_stat_double(stats->inbound.max_variance, "in_jitter_max_variance");
 		add_stat_double(stats->inbound.lossrate, "in_jitter_loss_rate");
@@ -7136,7 +7140,8 @@ static switch_status_t perform_write(switch_core_session_t *session, switch_fram
 
 			if (bp->ready) {
 				if (switch_test_flag(bp, SMBF_TAP_NATIVE_WRITE)) {
-					if (bp->callback) {
+					if (bp->callback && (!switch_test_flag(bp, SMBF_ASYNC) ||
+										 switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_TAP_NATIVE_WRITE, frame) != SWITCH_STATUS_SUCCESS)) {
 						bp->native_write_frame = frame;
 						ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_TAP_NATIVE_WRITE);
 						bp->native_write_frame = NULL;
@@ -8173,8 +8178,15 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_choose_port(switch_core_sessio
 		switch_rtp_release_port(smh->mparams->rtpip, engine->local_sdp_port);
 	}
 
+	engine->local_sdp_port = 0;
+
+	/* Use one of the profile's shared ports when the io engine can demultiplex them */
+	if (smh->mparams->rtp_shared_ports) {
+		engine->local_sdp_port = switch_rtp_request_shared_port(smh->mparams->rtpip, smh->mparams->rtp_shared_ports);
+	}
+
 	/* Request a local port from the core's allocator */
-	if (!(engine->local_sdp_port = switch_rtp_request_port(smh->mparams->rtpip))) {
+	if (!engine->local_sdp_port && !(engine->local_sdp_port = switch_rtp_request_port(smh->mparams->rtpip))) {
 		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_CRIT, "No %s RTP ports available!\n", tstr);
 		return SWITCH_STATUS_FALSE;
 	}
@@ -8326,6 +8338,7 @@ SWITCH_DECLARE(void) switch_core_media_deactivate_rtp(switch_core_session_t *ses
 
 
 	if (v_engine->local_sdp_port > 0 && !zstr(smh->mparams->remote_ip) &&
+		!switch_rtp_port_is_shared(smh->mparams->rtpip, v_engine->local_sdp_port) &&
 		switch_core_media_check_nat(smh, smh->mparams->remote_ip)) {
 		switch_nat_del_mapping((switch_port_t) v_engine->local_sdp_port, SWITCH_NAT_UDP);
 		switch_nat_del_mapping((switch_port_t) v_engine->local_sdp_port + 1, SWITCH_NAT_UDP);
@@ -8349,6 +8362,7 @@ SWITCH_DECLARE(void) switch_core_media_deactivate_rtp(switch_core_session_t *ses
 
 
 	if (t_engine->local_sdp_port > 0 && !zstr(smh->mparams->remote_ip) &&
+		!switch_rtp_port_is_shared(smh->mparams->rtpip, t_engine->local_sdp_port) &&
 		switch_core_media_check_nat(smh, smh->mparams->remote_ip)) {
 		switch_nat_del_mapping((switch_port_t) t_engine->local_sdp_port, SWITCH_NAT_UDP);
 		switch_nat_del_mapping((switch_port_t) t_engine->local_sdp_port + 1, SWITCH_NAT_UDP);
@@ -8362,6 +8376,7 @@ SWITCH_DECLARE(void) switch_core_media_deactivate_rtp(switch_core_session_t *ses
 	}
 
 	if (a_engine->local_sdp_port > 0 && !zstr(smh->mparams->remote_ip) &&
+		!switch_rtp_port_is_shared(smh->mparams->rtpip, a_engine->local_sdp_port) &&
 		switch_core_media_check_nat(smh, smh->mparams->remote_ip)) {
 		switch_nat_del_mapping((switch_port_t) a_engine->local_sdp_port, SWITCH_NAT_UDP);
 		switch_nat_del_mapping((switch_port_t) a_engine->local_sdp_port + 1, SWITCH_NAT_UDP);
@@ -15939,7 +15954,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 
 	if (session->bugs) {
 		switch_media_bug_t *bp;
-		int prune = 0;
+		int prune = 0, tap_fed = 0;
 
 		switch_thread_rwlock_rdlock(session->bug_rwlock);
 		for (bp = session->bugs; bp; bp = bp->next) {
@@ -15963,11 +15978,20 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 			}
 
 			if (switch_test_flag(bp, SMBF_WRITE_STREAM)) {
-				switch_mutex_lock(bp->write_mutex);
-				switch_buffer_write(bp->raw_write_buffer, write_frame->data, write_frame->datalen);
-				switch_mutex_unlock(bp->write_mutex);
+				if (bp->raw_write_buffer) {
+					switch_mutex_lock(bp->write_mutex);
+					switch_buffer_write(bp->raw_write_buffer, write_frame->data, write_frame->datalen);
+					switch_mutex_unlock(bp->write_mutex);
+				} else {
+					if (!tap_fed) {
+						switch_core_media_bug_tap_write(session, SWITCH_RW_WRITE, write_frame->data, write_frame->datalen);
+						tap_fed = 1;
+					}
+					switch_core_media_bug_tap_take(bp, SWITCH_RW_WRITE);
+				}
 
-				if (bp->callback) {
+				if (bp->callback && (!switch_test_flag(bp, SMBF_ASYNC) ||
+									 switch_core_media_bug_async_push(bp, SWITCH_ABC_TYPE_WRITE, NULL) != SWITCH_STATUS_SUCCESS)) {
 					ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_WRITE);
 				}
 			}
@@ -15980,6 +16004,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 					if ((ok = bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_WRITE_REPLACE)) == SWITCH_TRUE) {
 						write_frame = bp->write_replace_frame_out;
 					}
+					/* bugs further down the list hear the replaced audio */
+					tap_fed = 0;
 				}
 			}
 
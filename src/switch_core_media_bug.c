@@ -35,6 +35,930 @@
 #include "switch.h"
 #include "private/switch_core_pvt.h"
 
+/* SMBF_ASYNC bugs: the media thread copies each frame into a small ring on the bug and one of a few shared
+   threads runs the callback, so a slow consumer only falls behind on its own queue instead of stalling the
+   call's audio.  A bug is on the pool queue at most once, its callbacks still run one at a time and in order. */
+
+#define MAX_BUG_BUFFER 1024 * 512
+#define MEDIA_BUG_POOL_MAX_THREADS 64
+#define MEDIA_BUG_ASYNC_DEPTH 50
+#define MEDIA_BUG_ASYNC_MAX_DEPTH 1000
+#define MEDIA_BUG_ASYNC_BATCH 16
+#define MEDIA_BUG_ASYNC_BLOCK_MAX 100000
+
+struct media_bug_async_event {
+	switch_abc_type_t type;
+	switch_frame_t frame;
+	switch_time_t queued_at;
+};
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_queue_t *queue;
+	switch_thread_t *thread[MEDIA_BUG_POOL_MAX_THREADS];
+	uint32_t threads;
+	uint32_t alive;
+	int running;
+	uint32_t bugs;
+	uint64_t processed;
+	uint64_t dropped;
+} media_bug_pool;
+
+static void media_bug_pool_count(uint64_t processed, uint64_t dropped)
+{
+	if (!media_bug_pool.mutex || (!processed && !dropped)) {
+		return;
+	}
+
+	switch_mutex_lock(media_bug_pool.mutex);
+	media_bug_pool.processed += processed;
+	media_bug_pool.dropped += dropped;
+	switch_mutex_unlock(media_bug_pool.mutex);
+}
+
+/* (re)size the ring, called with the bug's async_mutex held when the ring already exists */
+static switch_status_t media_bug_async_alloc(switch_media_bug_t *bug, uint32_t depth)
+{
+	struct media_bug_async_event *ring;
+	uint8_t *data;
+	uint32_t i, keep = bug->async_count, skip = 0;
+
+	ring = calloc(depth, sizeof(*ring));
+	data = malloc((size_t) depth * bug->async_slot_bytes);
+
+	if (!ring || !data) {
+		switch_safe_free(ring);
+		switch_safe_free(data);
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	for (i = 0; i < depth; i++) {
+		ring[i].frame.data = data + (size_t) i * bug->async_slot_bytes;
+		ring[i].frame.buflen = bug->async_slot_bytes;
+	}
+
+	/* a smaller ring keeps the newest events */
+	if (keep > depth) {
+		skip = keep - depth;
+		keep = depth;
+		bug->async_stats.dropped += skip;
+	}
+
+	for (i = 0; i < keep; i++) {
+		struct media_bug_async_event *from = &bug->async_ring[(bug->async_head + skip + i) % bug->async_depth];
+		void *to = ring[i].frame.data;
+
+		ring[i] = *from;
+		ring[i].frame.data = to;
+		ring[i].frame.buflen = bug->async_slot_bytes;
+		memcpy(to, from->frame.data, from->frame.datalen);
+	}
+
+	switch_safe_free(bug->async_ring);
+	switch_safe_free(bug->async_data);
+
+	bug->async_ring = ring;
+	bug->async_data = data;
+	bug->async_depth = depth;
+	bug->async_head = 0;
+	bug->async_count = keep;
+
+	media_bug_pool_count(0, skip);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void media_bug_async_attach(switch_media_bug_t *bug)
+{
+	switch_core_session_t *session = bug->session;
+	switch_media_bug_async_policy_t policy = SMBA_DROP;
+	uint32_t depth = MEDIA_BUG_ASYNC_DEPTH, bytes;
+	const char *var;
+
+	/* replace bugs hand their frame straight back to the call and video goes through the bug's own thread */
+	if ((bug->flags & (SMBF_READ_REPLACE | SMBF_WRITE_REPLACE | SMBF_READ_VIDEO_PING | SMBF_WRITE_VIDEO_PING |
+					   SMBF_READ_VIDEO_STREAM | SMBF_WRITE_VIDEO_STREAM | SMBF_READ_VIDEO_PATCH |
+					   SMBF_SPY_VIDEO_STREAM | SMBF_SPY_VIDEO_STREAM_BLEG | SMBF_READ_TEXT_STREAM))) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "BUG %s can't run on the worker pool, running it inline\n", bug->function);
+		switch_clear_flag(bug, SMBF_ASYNC);
+		return;
+	}
+
+	if (media_bug_pool.running != 1) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Media bug worker pool is not running, running BUG %s inline\n", bug->function);
+		switch_clear_flag(bug, SMBF_ASYNC);
+		return;
+	}
+
+	if ((var = switch_channel_get_variable(session->channel, "media_bug_async_policy"))) {
+		if (!strcasecmp(var, "oldest") || !strcasecmp(var, "drop_oldest")) {
+			policy = SMBA_DROP_OLDEST;
+		} else if (!strcasecmp(var, "block")) {
+			policy = SMBA_BLOCK;
+		}
+	}
+
+	if ((var = switch_channel_get_variable(session->channel, "media_bug_async_depth"))) {
+		int tmp = atoi(var);
+
+		if (tmp > 0) {
+			depth = tmp > MEDIA_BUG_ASYNC_MAX_DEPTH ? MEDIA_BUG_ASYNC_MAX_DEPTH : (uint32_t) tmp;
+		}
+	}
+
+	/* room for a packet of either leg even if the channel count or ptime goes up later */
+	bytes = bug->read_impl.decoded_bytes_per_packet > bug->write_impl.decoded_bytes_per_packet ?
+		bug->read_impl.decoded_bytes_per_packet : bug->write_impl.decoded_bytes_per_packet;
+	bytes *= 2;
+
+	if (bytes < 1280) {
+		bytes = 1280;
+	}
+
+	if (bytes > SWITCH_RECOMMENDED_BUFFER_SIZE) {
+		bytes = SWITCH_RECOMMENDED_BUFFER_SIZE;
+	}
+
+	bug->async_slot_bytes = bytes;
+	bug->async_policy = policy;
+
+	if (media_bug_async_alloc(bug, depth) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Memory Error, running BUG %s inline\n", bug->function);
+		switch_clear_flag(bug, SMBF_ASYNC);
+		return;
+	}
+
+	switch_mutex_init(&bug->async_mutex, SWITCH_MUTEX_NESTED, session->pool);
+
+	switch_mutex_lock(media_bug_pool.mutex);
+	media_bug_pool.bugs++;
+	switch_mutex_unlock(media_bug_pool.mutex);
+}
+
+static void media_bug_async_free(switch_media_bug_t *bug)
+{
+	if (!bug->async_ring) {
+		return;
+	}
+
+	switch_safe_free(bug->async_ring);
+	switch_safe_free(bug->async_data);
+
+	if (media_bug_pool.mutex) {
+		switch_mutex_lock(media_bug_pool.mutex);
+		media_bug_pool.bugs--;
+		switch_mutex_unlock(media_bug_pool.mutex);
+	}
+}
+
+static void media_bug_async_schedule(switch_media_bug_t *bug)
+{
+	if (media_bug_pool.running != 1 || switch_queue_trypush(media_bug_pool.queue, bug) != SWITCH_STATUS_SUCCESS) {
+		/* the next frame tries again */
+		switch_mutex_lock(bug->async_mutex);
+		bug->async_scheduled = 0;
+		switch_mutex_unlock(bug->async_mutex);
+	}
+}
+
+switch_status_t switch_core_media_bug_async_push(switch_media_bug_t *bug, switch_abc_type_t type, switch_frame_t *frame)
+{
+	struct media_bug_async_event *ev;
+	switch_time_t now = switch_micro_time_now();
+	uint64_t dropped = 0;
+	int schedule = 0, blocked = 0;
+	void *data;
+
+	if (!bug->async_ring || media_bug_pool.running != 1) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (frame && frame->datalen > bug->async_slot_bytes) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_mutex_lock(bug->async_mutex);
+
+	while (bug->async_count == bug->async_depth) {
+		if (bug->async_policy == SMBA_DROP_OLDEST) {
+			bug->async_head = (bug->async_head + 1) % bug->async_depth;
+			bug->async_count--;
+			bug->async_stats.dropped++;
+			dropped++;
+			break;
+		}
+
+		if (bug->async_policy == SMBA_BLOCK && media_bug_pool.running == 1 && switch_micro_time_now() - now < MEDIA_BUG_ASYNC_BLOCK_MAX) {
+			if (!blocked++) {
+				bug->async_stats.blocked++;
+			}
+			switch_mutex_unlock(bug->async_mutex);
+			switch_yield(1000);
+			switch_mutex_lock(bug->async_mutex);
+			continue;
+		}
+
+		bug->async_stats.dropped++;
+		switch_mutex_unlock(bug->async_mutex);
+		media_bug_pool_count(0, 1);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	ev = &bug->async_ring[(bug->async_head + bug->async_count) % bug->async_depth];
+	data = ev->frame.data;
+
+	if (frame) {
+		ev->frame = *frame;
+		ev->frame.packet = NULL;
+		ev->frame.packetlen = 0;
+		ev->frame.extra_data = NULL;
+		ev->frame.user_data = NULL;
+		ev->frame.pmap = NULL;
+		ev->frame.img = NULL;
+		memcpy(data, frame->data, frame->datalen);
+	} else {
+		memset(&ev->frame, 0, sizeof(ev->frame));
+	}
+
+	ev->frame.data = data;
+	ev->frame.buflen = bug->async_slot_bytes;
+	ev->type = type;
+	ev->queued_at = now;
+
+	bug->async_count++;
+	bug->async_stats.queued++;
+
+	if (bug->async_count > bug->async_stats.max_queued) {
+		bug->async_stats.max_queued = bug->async_count;
+	}
+
+	if (!bug->async_scheduled) {
+		bug->async_scheduled = 1;
+		schedule = 1;
+	}
+
+	switch_mutex_unlock(bug->async_mutex);
+
+	media_bug_pool_count(0, dropped);
+
+	if (schedule) {
+		media_bug_async_schedule(bug);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_bool_t media_bug_async_call(switch_media_bug_t *bug, struct media_bug_async_event *ev)
+{
+	switch_bool_t ok = SWITCH_TRUE;
+
+	if (!bug->callback) {
+		return ok;
+	}
+
+	switch (ev->type) {
+	case SWITCH_ABC_TYPE_TAP_NATIVE_READ:
+		bug->native_read_frame = &ev->frame;
+		ok = bug->callback(bug, bug->user_data, ev->type);
+		bug->native_read_frame = NULL;
+		break;
+	case SWITCH_ABC_TYPE_TAP_NATIVE_WRITE:
+		bug->native_write_frame = &ev->frame;
+		ok = bug->callback(bug, bug->user_data, ev->type);
+		bug->native_write_frame = NULL;
+		break;
+	case SWITCH_ABC_TYPE_READ_PING:
+		bug->ping_frame = &ev->frame;
+		ok = bug->callback(bug, bug->user_data, ev->type);
+		bug->ping_frame = NULL;
+		break;
+	default:
+		ok = bug->callback(bug, bug->user_data, ev->type);
+		break;
+	}
+
+	return ok;
+}
+
+/* run the queued callbacks, a batch at a time from the pool or everything that is left when the bug closes */
+static void media_bug_async_run(switch_media_bug_t *bug, uint8_t *data, switch_bool_t final)
+{
+	struct media_bug_async_event ev;
+	switch_time_t start, end;
+	uint32_t done = 0;
+	int requeue = 0;
+
+	switch_mutex_lock(bug->async_mutex);
+	bug->async_running = 1;
+
+	while (bug->async_count && (final || done < MEDIA_BUG_ASYNC_BATCH)) {
+		struct media_bug_async_event *slot = &bug->async_ring[bug->async_head];
+
+		ev = *slot;
+		ev.frame.data = data;
+		memcpy(data, slot->frame.data, slot->frame.datalen);
+
+		bug->async_head = (bug->async_head + 1) % bug->async_depth;
+		bug->async_count--;
+		switch_mutex_unlock(bug->async_mutex);
+
+		start = switch_micro_time_now();
+		if (media_bug_async_call(bug, &ev) == SWITCH_FALSE) {
+			switch_set_flag(bug, SMBF_PRUNE);
+		}
+		end = switch_micro_time_now();
+		done++;
+
+		switch_mutex_lock(bug->async_mutex);
+		bug->async_stats.processed++;
+		bug->async_latency_total += start - ev.queued_at;
+		bug->async_run_total += end - start;
+
+		if (start - ev.queued_at > bug->async_stats.max_latency_us) {
+			bug->async_stats.max_latency_us = (uint32_t) (start - ev.queued_at);
+		}
+
+		if (end - start > bug->async_stats.max_run_us) {
+			bug->async_stats.max_run_us = (uint32_t) (end - start);
+		}
+
+		/* the bug is on its way out, the rest would never be heard */
+		if (switch_test_flag(bug, SMBF_PRUNE)) {
+			bug->async_count = 0;
+		}
+	}
+
+	bug->async_running = 0;
+
+	if (!final) {
+		if (bug->async_count && media_bug_pool.running == 1) {
+			requeue = 1;
+		} else {
+			bug->async_scheduled = 0;
+		}
+	}
+
+	switch_mutex_unlock(bug->async_mutex);
+
+	media_bug_pool_count(done, 0);
+
+	if (requeue) {
+		media_bug_async_schedule(bug);
+	}
+}
+
+static void media_bug_async_detach(switch_media_bug_t *bug)
+{
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+
+	if (!bug->async_ring) {
+		return;
+	}
+
+	/* wait out the worker, unless every worker thread is already gone, then deliver the rest here
+	   so the close callback has seen every frame */
+	switch_mutex_lock(bug->async_mutex);
+	while (bug->async_running || (bug->async_scheduled && media_bug_pool.alive)) {
+		switch_mutex_unlock(bug->async_mutex);
+		switch_yield(1000);
+		switch_mutex_lock(bug->async_mutex);
+	}
+	switch_mutex_unlock(bug->async_mutex);
+
+	media_bug_async_run(bug, data, SWITCH_TRUE);
+}
+
+static void *SWITCH_THREAD_FUNC media_bug_pool_thread(switch_thread_t *thread, void *obj)
+{
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	void *pop = NULL;
+
+	while (media_bug_pool.running == 1) {
+		if (switch_queue_pop_timeout(media_bug_pool.queue, &pop, 500000) != SWITCH_STATUS_SUCCESS || !pop) {
+			continue;
+		}
+
+		media_bug_async_run((switch_media_bug_t *) pop, data, SWITCH_FALSE);
+	}
+
+	switch_mutex_lock(media_bug_pool.mutex);
+	media_bug_pool.alive--;
+	switch_mutex_unlock(media_bug_pool.mutex);
+
+	return NULL;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_pool_start(uint32_t threads)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	if (media_bug_pool.running) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!threads) {
+		threads = switch_core_cpu_count() / 4;
+		if (threads < 2) threads = 2;
+	}
+
+	if (threads > MEDIA_BUG_POOL_MAX_THREADS) {
+		threads = MEDIA_BUG_POOL_MAX_THREADS;
+	}
+
+	if (switch_core_new_memory_pool(&media_bug_pool.pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	switch_mutex_init(&media_bug_pool.mutex, SWITCH_MUTEX_NESTED, media_bug_pool.pool);
+	switch_queue_create(&media_bug_pool.queue, SWITCH_CORE_QUEUE_LEN, media_bug_pool.pool);
+	media_bug_pool.running = 1;
+
+	switch_threadattr_create(&thd_attr, media_bug_pool.pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < threads; i++) {
+		if (switch_thread_create(&media_bug_pool.thread[i], thd_attr, media_bug_pool_thread, NULL, media_bug_pool.pool) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+		media_bug_pool.alive++;
+	}
+
+	media_bug_pool.threads = i;
+
+	if (!i) {
+		media_bug_pool.running = 0;
+		switch_core_destroy_memory_pool(&media_bug_pool.pool);
+		memset(&media_bug_pool, 0, sizeof(media_bug_pool));
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Started %u media bug worker thread%s\n", i, i == 1 ? "" : "s");
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_core_media_bug_pool_stop(void)
+{
+	switch_status_t st;
+	void *pop;
+	uint32_t i;
+
+	if (media_bug_pool.running != 1) {
+		return;
+	}
+
+	media_bug_pool.running = -1;
+
+	for (i = 0; i < media_bug_pool.threads; i++) {
+		switch_queue_trypush(media_bug_pool.queue, NULL);
+	}
+
+	for (i = 0; i < media_bug_pool.threads; i++) {
+		switch_thread_join(&st, media_bug_pool.thread[i]);
+	}
+
+	/* bugs still queued deliver their frames when they close */
+	while (switch_queue_trypop(media_bug_pool.queue, &pop) == SWITCH_STATUS_SUCCESS);
+
+	if (media_bug_pool.bugs) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Stopping media bug workers with %u bug%s attached\n",
+						  media_bug_pool.bugs, media_bug_pool.bugs == 1 ? "" : "s");
+		return;
+	}
+
+	switch_core_destroy_memory_pool(&media_bug_pool.pool);
+	memset(&media_bug_pool, 0, sizeof(media_bug_pool));
+}
+
+SWITCH_DECLARE(void) switch_core_media_bug_pool_stats(switch_media_bug_pool_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!media_bug_pool.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(media_bug_pool.mutex);
+	stats->threads = media_bug_pool.running == 1 ? media_bug_pool.threads : 0;
+	stats->bugs = media_bug_pool.bugs;
+	stats->backlog = media_bug_pool.queue ? switch_queue_size(media_bug_pool.queue) : 0;
+	stats->processed = media_bug_pool.processed;
+	stats->dropped = media_bug_pool.dropped;
+	switch_mutex_unlock(media_bug_pool.mutex);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_set_async_policy(switch_media_bug_t *bug, switch_media_bug_async_policy_t policy, uint32_t depth)
+{
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+
+	if (!bug->async_ring) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (depth > MEDIA_BUG_ASYNC_MAX_DEPTH) {
+		depth = MEDIA_BUG_ASYNC_MAX_DEPTH;
+	}
+
+	switch_mutex_lock(bug->async_mutex);
+	bug->async_policy = policy;
+	if (depth && depth != bug->async_depth) {
+		status = media_bug_async_alloc(bug, depth);
+	}
+	switch_mutex_unlock(bug->async_mutex);
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_media_bug_get_async_stats(switch_media_bug_t *bug, switch_media_bug_async_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!bug->async_ring) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_mutex_lock(bug->async_mutex);
+	*stats = bug->async_stats;
+	stats->policy = bug->async_policy;
+	stats->depth = bug->async_depth;
+	stats->queued_now = bug->async_count;
+	if (stats->processed) {
+		stats->avg_latency_us = (uint32_t) (bug->async_latency_total / (switch_time_t) stats->processed);
+		stats->avg_run_us = (uint32_t) (bug->async_run_total / (switch_time_t) stats->processed);
+	}
+	switch_mutex_unlock(bug->async_mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* Shared tap: the session keeps one history ring per leg and each bug reading the audio keeps a cursor into it
+   instead of a buffer of its own, so a frame is copied once however many bugs are attached.  Bugs that read the
+   same span with the same layout, the usual case for bugs added together, get a copy of the last mix.
+   The rings start at a couple of seconds and double whenever a bug falls half a ring behind, up to the
+   MAX_BUG_BUFFER a bug with its own buffer could hold, so a slow or async reader keeps the same history. */
+
+#define MEDIA_BUG_TAP_FRAMES 100
+#define MEDIA_BUG_TAP_MIN 32000
+
+/* (re)size the rings keeping the history that fits, called with the tap locked once it is in use */
+static switch_status_t media_bug_tap_resize(switch_media_bug_tap_t *tap, switch_size_t size)
+{
+	uint8_t *ring[2];
+	int rw;
+
+	if (size < MEDIA_BUG_TAP_MIN) {
+		size = MEDIA_BUG_TAP_MIN;
+	}
+
+	if (size > MAX_BUG_BUFFER) {
+		size = MAX_BUG_BUFFER;
+	}
+
+	ring[SWITCH_RW_READ] = malloc(size);
+	ring[SWITCH_RW_WRITE] = malloc(size);
+
+	if (!ring[SWITCH_RW_READ] || !ring[SWITCH_RW_WRITE]) {
+		switch_safe_free(ring[SWITCH_RW_READ]);
+		switch_safe_free(ring[SWITCH_RW_WRITE]);
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	for (rw = SWITCH_RW_READ; rw <= SWITCH_RW_WRITE; rw++) {
+		uint64_t pos = tap->head[rw] > size ? tap->head[rw] - size : 0;
+
+		if (tap->ring[rw]) {
+			uint64_t low = tap->head[rw] > tap->size ? tap->head[rw] - tap->size : 0;
+
+			if (pos < low) {
+				pos = low;
+			}
+
+			if (pos < tap->floor[rw]) {
+				pos = tap->floor[rw];
+			}
+
+			/* anything before this point did not fit */
+			tap->floor[rw] = pos;
+
+			while (pos < tap->head[rw]) {
+				uint32_t from = (uint32_t) (pos % tap->size), to = (uint32_t) (pos % size);
+				switch_size_t bytes = (switch_size_t) (tap->head[rw] - pos);
+
+				if (bytes > tap->size - from) {
+					bytes = tap->size - from;
+				}
+
+				if (bytes > size - to) {
+					bytes = size - to;
+				}
+
+				memcpy(ring[rw] + to, tap->ring[rw] + from, bytes);
+				pos += bytes;
+			}
+
+			free(tap->ring[rw]);
+		} else {
+			tap->floor[rw] = tap->head[rw];
+		}
+
+		tap->ring[rw] = ring[rw];
+	}
+
+	tap->size = (uint32_t) size;
+	tap->grow = 0;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void switch_core_media_bug_tap_destroy(switch_core_session_t *session)
+{
+	switch_media_bug_tap_t *tap = session->bug_tap;
+
+	if (!tap) {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(session->bug_rwlock);
+	session->bug_tap = NULL;
+	switch_thread_rwlock_unlock(session->bug_rwlock);
+
+	switch_safe_free(tap->ring[SWITCH_RW_READ]);
+	switch_safe_free(tap->ring[SWITCH_RW_WRITE]);
+}
+
+static void media_bug_tap_attach(switch_media_bug_t *bug)
+{
+	switch_core_session_t *session = bug->session;
+	switch_media_bug_tap_t *tap;
+
+	switch_thread_rwlock_wrlock(session->bug_rwlock);
+	if (!(tap = session->bug_tap)) {
+		switch_size_t bytes = bug->read_impl.decoded_bytes_per_packet > bug->write_impl.decoded_bytes_per_packet ?
+			bug->read_impl.decoded_bytes_per_packet : bug->write_impl.decoded_bytes_per_packet;
+
+		tap = switch_core_session_alloc(session, sizeof(*tap));
+		switch_mutex_init(&tap->mutex, SWITCH_MUTEX_NESTED, session->pool);
+
+		/* without the rings the bug gets buffers of its own */
+		if (media_bug_tap_resize(tap, (bytes ? bytes : 320) * MEDIA_BUG_TAP_FRAMES) != SWITCH_STATUS_SUCCESS) {
+			switch_thread_rwlock_unlock(session->bug_rwlock);
+			return;
+		}
+
+		session->bug_tap = tap;
+	}
+	switch_thread_rwlock_unlock(session->bug_rwlock);
+
+	switch_mutex_lock(tap->mutex);
+	bug->tap_pos[SWITCH_RW_READ] = bug->tap_end[SWITCH_RW_READ] = tap->head[SWITCH_RW_READ];
+	bug->tap_pos[SWITCH_RW_WRITE] = bug->tap_end[SWITCH_RW_WRITE] = tap->head[SWITCH_RW_WRITE];
+	bug->tap = tap;
+	switch_mutex_unlock(tap->mutex);
+}
+
+/* bytes this bug has left to read on one leg, called with the tap locked */
+static switch_size_t media_bug_tap_avail(switch_media_bug_t *bug, switch_rw_t rw)
+{
+	switch_media_bug_tap_t *tap = bug->tap;
+	uint64_t low = tap->head[rw] > tap->size ? tap->head[rw] - tap->size : 0;
+
+	if (low < tap->floor[rw]) {
+		low = tap->floor[rw];
+	}
+
+	/* the writer lapped this bug, it loses the oldest audio */
+	if (bug->tap_pos[rw] < low) {
+		bug->tap_pos[rw] = low;
+	}
+
+	if (bug->tap_pos[rw] > bug->tap_end[rw]) {
+		bug->tap_pos[rw] = bug->tap_end[rw];
+	}
+
+	return (switch_size_t) (bug->tap_end[rw] - bug->tap_pos[rw]);
+}
+
+static void media_bug_tap_copy(switch_media_bug_tap_t *tap, switch_rw_t rw, uint64_t pos, void *data, switch_size_t bytes)
+{
+	uint32_t off = (uint32_t) (pos % tap->size);
+	switch_size_t first = tap->size - off;
+
+	if (first > bytes) {
+		first = bytes;
+	}
+
+	memcpy(data, tap->ring[rw] + off, first);
+
+	if (bytes > first) {
+		memcpy((uint8_t *) data + first, tap->ring[rw], bytes - first);
+	}
+}
+
+void switch_core_media_bug_tap_write(switch_core_session_t *session, switch_rw_t rw, const void *data, uint32_t datalen)
+{
+	switch_media_bug_tap_t *tap = session->bug_tap;
+	uint32_t off, first;
+
+	if (!tap || !datalen) {
+		return;
+	}
+
+	switch_mutex_lock(tap->mutex);
+
+	/* a bug is falling behind, or a higher rate or longer ptime than the rings were sized for */
+	if ((tap->grow || datalen * (MEDIA_BUG_TAP_FRAMES / 4) > tap->size) && tap->size < MAX_BUG_BUFFER) {
+		switch_size_t size = (switch_size_t) tap->size * 2;
+
+		if (size < (switch_size_t) datalen * MEDIA_BUG_TAP_FRAMES) {
+			size = (switch_size_t) datalen * MEDIA_BUG_TAP_FRAMES;
+		}
+
+		if (media_bug_tap_resize(tap, size) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Memory Error growing the media bug tap\n");
+			tap->grow = 0;
+		}
+	}
+
+	if (datalen > tap->size) {
+		datalen = tap->size;
+	}
+
+	off = (uint32_t) (tap->head[rw] % tap->size);
+	first = tap->size - off;
+
+	if (first > datalen) {
+		first = datalen;
+	}
+
+	memcpy(tap->ring[rw] + off, data, first);
+
+	if (datalen > first) {
+		memcpy(tap->ring[rw], (const uint8_t *) data + first, datalen - first);
+	}
+
+	tap->start[rw] = tap->head[rw];
+	tap->head[rw] += datalen;
+
+	switch_mutex_unlock(tap->mutex);
+}
+
+/* give the bug the frame last written to the tap, what switch_buffer_write was for a bug with its own buffer */
+void switch_core_media_bug_tap_take(switch_media_bug_t *bug, switch_rw_t rw)
+{
+	switch_media_bug_tap_t *tap = bug->tap;
+
+	if (!tap) {
+		return;
+	}
+
+	switch_mutex_lock(tap->mutex);
+	if (bug->tap_end[rw] != tap->head[rw]) {
+		/* it skipped frames while paused or waiting for answer, what it had is no longer contiguous */
+		if (bug->tap_end[rw] != tap->start[rw]) {
+			bug->tap_pos[rw] = tap->start[rw];
+		}
+
+		bug->tap_end[rw] = tap->head[rw];
+
+		if (bug->tap_end[rw] - bug->tap_pos[rw] > MAX_BUG_BUFFER) {
+			bug->tap_pos[rw] = bug->tap_end[rw] - MAX_BUG_BUFFER;
+		}
+
+		/* grow before the writer laps it */
+		if (bug->tap_end[rw] - bug->tap_pos[rw] > tap->size / 2 && tap->size < MAX_BUG_BUFFER) {
+			tap->grow = 1;
+		}
+	}
+	switch_mutex_unlock(tap->mutex);
+}
+
+/* A WRITE_REPLACE bug changes the write leg part way down the list, so the bugs before it and the bugs after it
+   hear different audio and one write stream can't serve both.  While one is attached every bug on the write leg
+   moves what it has not read yet into a buffer of its own and is fed from there, called with bug_rwlock write locked. */
+static void media_bug_tap_unshare_write(switch_core_session_t *session)
+{
+	switch_media_bug_t *bp;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int replace = 0;
+
+	for (bp = session->bugs; bp; bp = bp->next) {
+		if (switch_test_flag(bp, SMBF_WRITE_REPLACE)) {
+			replace = 1;
+			break;
+		}
+	}
+
+	if (!replace) {
+		return;
+	}
+
+	for (bp = session->bugs; bp; bp = bp->next) {
+		switch_buffer_t *buffer = NULL;
+		switch_size_t bytes;
+
+		if (!bp->tap || bp->raw_write_buffer || !switch_test_flag(bp, SMBF_WRITE_STREAM)) {
+			continue;
+		}
+
+		if (!(bytes = bp->write_impl.decoded_bytes_per_packet)) {
+			bytes = 320;
+		}
+
+		if (switch_buffer_create_dynamic(&buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER) != SWITCH_STATUS_SUCCESS) {
+			continue;
+		}
+
+		switch_mutex_lock(bp->write_mutex);
+		switch_mutex_lock(bp->tap->mutex);
+
+		while ((bytes = media_bug_tap_avail(bp, SWITCH_RW_WRITE))) {
+			if (bytes > sizeof(data)) {
+				bytes = sizeof(data);
+			}
+
+			media_bug_tap_copy(bp->tap, SWITCH_RW_WRITE, bp->tap_pos[SWITCH_RW_WRITE], data, bytes);
+			switch_buffer_write(buffer, data, bytes);
+			bp->tap_pos[SWITCH_RW_WRITE] += bytes;
+		}
+
+		bp->raw_write_buffer = buffer;
+
+		switch_mutex_unlock(bp->tap->mutex);
+		switch_mutex_unlock(bp->write_mutex);
+
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "BUG %s reads the write leg from its own buffer next to a replace bug\n", bp->function);
+	}
+}
+
+static switch_buffer_t *media_bug_buffer(switch_media_bug_t *bug, switch_rw_t rw, switch_mutex_t **mutex)
+{
+	*mutex = rw == SWITCH_RW_READ ? bug->read_mutex : bug->write_mutex;
+
+	return rw == SWITCH_RW_READ ? bug->raw_read_buffer : bug->raw_write_buffer;
+}
+
+static switch_size_t media_bug_inuse(switch_media_bug_t *bug, switch_rw_t rw)
+{
+	switch_mutex_t *mutex;
+	switch_buffer_t *buffer = media_bug_buffer(bug, rw, &mutex);
+	switch_size_t inuse = 0;
+
+	if (buffer) {
+		switch_mutex_lock(mutex);
+		inuse = switch_buffer_inuse(buffer);
+		switch_mutex_unlock(mutex);
+	} else if (bug->tap) {
+		switch_mutex_lock(bug->tap->mutex);
+		inuse = media_bug_tap_avail(bug, rw);
+		switch_mutex_unlock(bug->tap->mutex);
+	}
+
+	return inuse;
+}
+
+static switch_size_t media_bug_take(switch_media_bug_t *bug, switch_rw_t rw, void *data, switch_size_t bytes)
+{
+	switch_mutex_t *mutex;
+	switch_buffer_t *buffer = media_bug_buffer(bug, rw, &mutex);
+	switch_size_t got = 0;
+
+	if (buffer) {
+		switch_mutex_lock(mutex);
+		got = switch_buffer_read(buffer, data, bytes);
+		switch_mutex_unlock(mutex);
+	} else if (bug->tap) {
+		switch_mutex_lock(bug->tap->mutex);
+		if ((got = media_bug_tap_avail(bug, rw)) > bytes) {
+			got = bytes;
+		}
+		if (data) {
+			media_bug_tap_copy(bug->tap, rw, bug->tap_pos[rw], data, got);
+		}
+		bug->tap_pos[rw] += got;
+		switch_mutex_unlock(bug->tap->mutex);
+	}
+
+	return got;
+}
+
+static void media_bug_zero(switch_media_bug_t *bug, switch_rw_t rw)
+{
+	switch_mutex_t *mutex;
+	switch_buffer_t *buffer = media_bug_buffer(bug, rw, &mutex);
+
+	if (buffer) {
+		switch_mutex_lock(mutex);
+		switch_buffer_zero(buffer);
+		switch_mutex_unlock(mutex);
+	} else if (bug->tap) {
+		switch_mutex_lock(bug->tap->mutex);
+		bug->tap_pos[rw] = bug->tap_end[rw];
+		switch_mutex_unlock(bug->tap->mutex);
+	}
+}
+
 static void switch_core_media_bug_destroy(switch_media_bug_t **bug)
 {
 	switch_event_t *event = NULL;
@@ -73,6 +997,8 @@ static void switch_core_media_bug_destroy(switch_media_bug_t **bug)
 		switch_clear_flag(bp->session->video_read_codec, SWITCH_CODEC_FLAG_VIDEO_PATCHING);
 	}
 
+	media_bug_async_free(bp);
+
 	if (bp->raw_read_buffer) {
 		switch_buffer_destroy(&bp->raw_read_buffer);
 	}
@@ -174,6 +1100,15 @@ SWITCH_DECLARE(void) switch_core_media_bug_set_read_replace_frame(switch_media_b
 
 SWITCH_DECLARE(void) switch_core_media_bug_set_read_demux_frame(switch_media_bug_t *bug, switch_frame_t *frame)
 {
+	/* the demuxed audio is this bug's alone so it can't come from the shared tap */
+	if (frame && !bug->raw_read_buffer && bug->read_mutex) {
+		switch_size_t bytes = bug->read_impl.decoded_bytes_per_packet ? bug->read_impl.decoded_bytes_per_packet : 320;
+
+		switch_mutex_lock(bug->read_mutex);
+		switch_buffer_create_dynamic(&bug->raw_read_buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER);
+		switch_mutex_unlock(bug->read_mutex);
+	}
+
 	bug->read_demux_frame = frame;
 }
 
@@ -187,17 +1122,8 @@ SWITCH_DECLARE(void) switch_core_media_bug_flush(switch_media_bug_t *bug)
 
 	bug->record_pre_buffer_count = 0;
 
-	if (bug->raw_read_buffer) {
-		switch_mutex_lock(bug->read_mutex);
-		switch_buffer_zero(bug->raw_read_buffer);
-		switch_mutex_unlock(bug->read_mutex);
-	}
-
-	if (bug->raw_write_buffer) {
-		switch_mutex_lock(bug->write_mutex);
-		switch_buffer_zero(bug->raw_write_buffer);
-		switch_mutex_unlock(bug->write_mutex);
-	}
+	media_bug_zero(bug, SWITCH_RW_READ);
+	media_bug_zero(bug, SWITCH_RW_WRITE);
 
 	bug->record_frame_size = 0;
 	bug->record_pre_buffer_count = 0;
@@ -206,17 +1132,13 @@ SWITCH_DECLARE(void) switch_core_media_bug_flush(switch_media_bug_t *bug)
 SWITCH_DECLARE(void) switch_core_media_bug_inuse(switch_media_bug_t *bug, switch_size_t *readp, switch_size_t *writep)
 {
 	if (switch_test_flag(bug, SMBF_READ_STREAM)) {
-		switch_mutex_lock(bug->read_mutex);
-		*readp = bug->raw_read_buffer ? switch_buffer_inuse(bug->raw_read_buffer) : 0;
-		switch_mutex_unlock(bug->read_mutex);
+		*readp = media_bug_inuse(bug, SWITCH_RW_READ);
 	} else {
 		*readp = 0;
 	}
 
 	if (switch_test_flag(bug, SMBF_WRITE_STREAM)) {
-		switch_mutex_lock(bug->write_mutex);
-		*writep = bug->raw_write_buffer ? switch_buffer_inuse(bug->raw_write_buffer) : 0;
-		switch_mutex_unlock(bug->write_mutex);
+		*writep = media_bug_inuse(bug, SWITCH_RW_WRITE);
 	} else {
 		*writep = 0;
 	}
@@ -229,17 +1151,170 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_set_pre_buffer_framecount(
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* mix the read leg in frame->data with the write leg in bug->data, or interleave them for SMBF_STEREO */
+static void media_bug_mix(switch_media_bug_t *bug, switch_frame_t *frame, switch_size_t datalen, switch_size_t bytes)
+{
+	int16_t *dp, *fp, *tp;
+	size_t rlen, wlen;
+	uint32_t x, blen;
+
+	tp = bug->tmp;
+	dp = (int16_t *) bug->data;
+	fp = (int16_t *) frame->data;
+	rlen = frame->datalen / 2;
+	wlen = datalen / 2;
+	blen = (uint32_t)(bytes / 2);
+
+	if (switch_test_flag(bug, SMBF_STEREO)) {
+		int16_t *left, *right;
+		size_t left_len, right_len;
+		if (switch_test_flag(bug, SMBF_STEREO_SWAP)) {
+			left = dp; /* write stream */
+			left_len = wlen;
+			right = fp; /* read stream */
+			right_len = rlen;
+		} else {
+			left = fp; /* read stream */
+			left_len = rlen;
+			right = dp; /* write stream */
+			right_len = wlen;
+		}
+		for (x = 0; x < blen; x++) {
+			if (x < left_len) {
+				*(tp++) = *(left + x);
+			} else {
+				*(tp++) = 0;
+			}
+			if (x < right_len) {
+				*(tp++) = *(right + x);
+			} else {
+				*(tp++) = 0;
+			}
+		}
+		memcpy(frame->data, bug->tmp, bytes * 2);
+	} else {
+		for (x = 0; x < blen; x++) {
+			int32_t w = 0, r = 0, z = 0;
+
+			if (x < rlen) {
+				r = (int32_t) * (fp + x);
+			}
+
+			if (x < wlen) {
+				w = (int32_t) * (dp + x);
+			}
+
+			z = w + r;
+
+			if (z > SWITCH_SMAX || z < SWITCH_SMIN) {
+				if (r) z += (r/2);
+				if (w) z += (w/2);
+			}
+
+			switch_normalize_to_16bit(z);
+
+			*(fp + x) = (int16_t) z;
+		}
+	}
+}
+
+#define MEDIA_BUG_MIX_STEREO (1 << 0)
+#define MEDIA_BUG_MIX_SWAP (1 << 1)
+#define MEDIA_BUG_MIX_FILL_READ (1 << 2)
+#define MEDIA_BUG_MIX_FILL_WRITE (1 << 3)
+
+/* switch_core_media_bug_read for a bug reading both legs from the session tap */
+static switch_status_t media_bug_tap_read(switch_media_bug_t *bug, switch_frame_t *frame, switch_size_t do_read, switch_size_t do_write,
+										  switch_size_t fill_read, switch_size_t fill_write, switch_size_t bytes)
+{
+	switch_media_bug_tap_t *tap = bug->tap;
+	switch_size_t datalen = 0;
+	uint32_t flags = 0, out = (uint32_t) bytes;
+
+	if (switch_test_flag(bug, SMBF_STEREO)) {
+		flags |= MEDIA_BUG_MIX_STEREO;
+		out *= 2;
+		if (switch_test_flag(bug, SMBF_STEREO_SWAP)) {
+			flags |= MEDIA_BUG_MIX_SWAP;
+		}
+	}
+
+	if (!do_read && fill_read) {
+		flags |= MEDIA_BUG_MIX_FILL_READ;
+	}
+
+	if (!do_write && fill_write) {
+		flags |= MEDIA_BUG_MIX_FILL_WRITE;
+	}
+
+	switch_mutex_lock(tap->mutex);
+
+	if ((do_read && media_bug_tap_avail(bug, SWITCH_RW_READ) < do_read) || (do_write && media_bug_tap_avail(bug, SWITCH_RW_WRITE) < do_write)) {
+		switch_mutex_unlock(tap->mutex);
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR, "Framing Error Reading!\n");
+		switch_core_media_bug_flush(bug);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	tap->mixes++;
+
+	if (tap->mix_out == out && tap->mix_flags == flags && tap->mix_bytes == bytes &&
+		tap->mix_len[SWITCH_RW_READ] == do_read && tap->mix_len[SWITCH_RW_WRITE] == do_write &&
+		(!do_read || tap->mix_pos[SWITCH_RW_READ] == bug->tap_pos[SWITCH_RW_READ]) &&
+		(!do_write || tap->mix_pos[SWITCH_RW_WRITE] == bug->tap_pos[SWITCH_RW_WRITE])) {
+		memcpy(frame->data, tap->mix, out);
+		bug->tap_pos[SWITCH_RW_READ] += do_read;
+		bug->tap_pos[SWITCH_RW_WRITE] += do_write;
+		tap->mix_hits++;
+		switch_mutex_unlock(tap->mutex);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	tap->mix_pos[SWITCH_RW_READ] = bug->tap_pos[SWITCH_RW_READ];
+	tap->mix_pos[SWITCH_RW_WRITE] = bug->tap_pos[SWITCH_RW_WRITE];
+
+	if (do_read) {
+		media_bug_tap_copy(tap, SWITCH_RW_READ, bug->tap_pos[SWITCH_RW_READ], frame->data, do_read);
+		bug->tap_pos[SWITCH_RW_READ] += do_read;
+		frame->datalen = (uint32_t) do_read;
+	} else if (fill_read) {
+		frame->datalen = (uint32_t) bytes;
+		memset(frame->data, 255, frame->datalen);
+	}
+
+	if (do_write) {
+		media_bug_tap_copy(tap, SWITCH_RW_WRITE, bug->tap_pos[SWITCH_RW_WRITE], bug->data, do_write);
+		bug->tap_pos[SWITCH_RW_WRITE] += do_write;
+		datalen = do_write;
+	} else if (fill_write) {
+		datalen = bytes;
+		memset(bug->data, 255, datalen);
+	}
+
+	media_bug_mix(bug, frame, datalen, bytes);
+
+	if (out <= sizeof(tap->mix)) {
+		memcpy(tap->mix, frame->data, out);
+		tap->mix_len[SWITCH_RW_READ] = do_read;
+		tap->mix_len[SWITCH_RW_WRITE] = do_write;
+		tap->mix_bytes = bytes;
+		tap->mix_flags = flags;
+		tap->mix_out = out;
+	} else {
+		tap->mix_out = 0;
+	}
+
+	switch_mutex_unlock(tap->mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_media_bug_read(switch_media_bug_t *bug, switch_frame_t *frame, switch_bool_t fill)
 {
 	switch_size_t bytes = 0, datalen = 0;
-	int16_t *dp, *fp;
-	uint32_t x;
-	size_t rlen = 0;
-	size_t wlen = 0;
-	uint32_t blen;
 	switch_codec_implementation_t read_impl = { 0 };
-	int16_t *tp;
 	switch_size_t do_read = 0, do_write = 0, has_read = 0, has_write = 0, fill_read = 0, fill_write = 0;
+	int read_source, write_source;
 
 	switch_core_session_get_read_impl(bug->session, &read_impl);
 
@@ -251,11 +1326,14 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_read(switch_media_bug_t *b
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if ((!bug->raw_read_buffer && (!bug->raw_write_buffer || !switch_test_flag(bug, SMBF_WRITE_STREAM)))) {
+	read_source = bug->raw_read_buffer || (bug->tap && (switch_test_flag(bug, SMBF_READ_STREAM) || switch_test_flag(bug, SMBF_READ_PING)));
+	write_source = (bug->raw_write_buffer || bug->tap) && switch_test_flag(bug, SMBF_WRITE_STREAM);
+
+	if (!read_source && !write_source) {
 		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR,
-				"%s Buffer Error (raw_read_buffer=%p, raw_write_buffer=%p, read=%s, write=%s)\n",
+				"%s Buffer Error (raw_read_buffer=%p, raw_write_buffer=%p, tap=%p, read=%s, write=%s)\n",
 			        switch_channel_get_name(bug->session->channel),
-				(void *)bug->raw_read_buffer, (void *)bug->raw_write_buffer,
+				(void *)bug->raw_read_buffer, (void *)bug->raw_write_buffer, (void *)bug->tap,
 				switch_test_flag(bug, SMBF_READ_STREAM) ? "yes" : "no",
 				switch_test_flag(bug, SMBF_WRITE_STREAM) ? "yes" : "no");
 		return SWITCH_STATUS_FALSE;
@@ -266,16 +1344,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_read(switch_media_bug_t *b
 
 	if (switch_test_flag(bug, SMBF_READ_STREAM)) {
 		has_read = 1;
-		switch_mutex_lock(bug->read_mutex);
-		do_read = switch_buffer_inuse(bug->raw_read_buffer);
-		switch_mutex_unlock(bug->read_mutex);
+		do_read = media_bug_inuse(bug, SWITCH_RW_READ);
 	}
 
 	if (switch_test_flag(bug, SMBF_WRITE_STREAM)) {
 		has_write = 1;
-		switch_mutex_lock(bug->write_mutex);
-		do_write = switch_buffer_inuse(bug->raw_write_buffer);
-		switch_mutex_unlock(bug->write_mutex);
+		do_write = media_bug_inuse(bug, SWITCH_RW_WRITE);
 	}
 
 
@@ -292,10 +1366,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_read(switch_media_bug_t *b
 	}
 
 	if (bug->record_frame_size && do_write > do_read && do_write > (bug->record_frame_size * 2)) {
-		switch_mutex_lock(bug->write_mutex);
-		switch_buffer_toss(bug->raw_write_buffer, bug->record_frame_size);
-		do_write = switch_buffer_inuse(bug->raw_write_buffer);
-		switch_mutex_unlock(bug->write_mutex);
+		media_bug_take(bug, SWITCH_RW_WRITE, NULL, bug->record_frame_size);
+		do_write = media_bug_inuse(bug, SWITCH_RW_WRITE);
 	}
 
 
@@ -335,94 +1407,36 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_read(switch_media_bug_t *b
 		do_write = 1280;
 	}
 
-	if (do_read) {
-		switch_mutex_lock(bug->read_mutex);
-		frame->datalen = (uint32_t) switch_buffer_read(bug->raw_read_buffer, frame->data, do_read);
-		if (frame->datalen != do_read) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR, "Framing Error Reading!\n");
-			switch_core_media_bug_flush(bug);
-			switch_mutex_unlock(bug->read_mutex);
-			return SWITCH_STATUS_FALSE;
-		}
-		switch_mutex_unlock(bug->read_mutex);
-	} else if (fill_read) {
-		frame->datalen = (uint32_t)bytes;
-		memset(frame->data, 255, frame->datalen);
-	}
-
-	if (do_write) {
-		switch_assert(bug->raw_write_buffer);
-		switch_mutex_lock(bug->write_mutex);
-		datalen = (uint32_t) switch_buffer_read(bug->raw_write_buffer, bug->data, do_write);
-		if (datalen != do_write) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR, "Framing Error Writing!\n");
-			switch_core_media_bug_flush(bug);
-			switch_mutex_unlock(bug->write_mutex);
+	if (bug->tap && !bug->raw_read_buffer && !bug->raw_write_buffer) {
+		if (media_bug_tap_read(bug, frame, do_read, do_write, fill_read, fill_write, bytes) != SWITCH_STATUS_SUCCESS) {
 			return SWITCH_STATUS_FALSE;
 		}
-		switch_mutex_unlock(bug->write_mutex);
-	} else if (fill_write) {
-		datalen = bytes;
-		memset(bug->data, 255, datalen);
-	}
-
-	tp = bug->tmp;
-	dp = (int16_t *) bug->data;
-	fp = (int16_t *) frame->data;
-	rlen = frame->datalen / 2;
-	wlen = datalen / 2;
-	blen = (uint32_t)(bytes / 2);
-
-	if (switch_test_flag(bug, SMBF_STEREO)) {
-		int16_t *left, *right;
-		size_t left_len, right_len;
-		if (switch_test_flag(bug, SMBF_STEREO_SWAP)) {
-			left = dp; /* write stream */
-			left_len = wlen;
-			right = fp; /* read stream */
-			right_len = rlen;
-		} else {
-			left = fp; /* read stream */
-			left_len = rlen;
-			right = dp; /* write stream */
-			right_len = wlen;
-		}
-		for (x = 0; x < blen; x++) {
-			if (x < left_len) {
-				*(tp++) = *(left + x);
-			} else {
-				*(tp++) = 0;
-			}
-			if (x < right_len) {
-				*(tp++) = *(right + x);
-			} else {
-				*(tp++) = 0;
-			}
-		}
-		memcpy(frame->data, bug->tmp, bytes * 2);
 	} else {
-		for (x = 0; x < blen; x++) {
-			int32_t w = 0, r = 0, z = 0;
-
-			if (x < rlen) {
-				r = (int32_t) * (fp + x);
-			}
-
-			if (x < wlen) {
-				w = (int32_t) * (dp + x);
+		if (do_read) {
+			frame->datalen = (uint32_t) media_bug_take(bug, SWITCH_RW_READ, frame->data, do_read);
+			if (frame->datalen != do_read) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR, "Framing Error Reading!\n");
+				switch_core_media_bug_flush(bug);
+				return SWITCH_STATUS_FALSE;
 			}
+		} else if (fill_read) {
+			frame->datalen = (uint32_t)bytes;
+			memset(frame->data, 255, frame->datalen);
+		}
 
-			z = w + r;
-
-			if (z > SWITCH_SMAX || z < SWITCH_SMIN) {
-				if (r) z += (r/2);
-				if (w) z += (w/2);
+		if (do_write) {
+			datalen = media_bug_take(bug, SWITCH_RW_WRITE, bug->data, do_write);
+			if (datalen != do_write) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(switch_core_media_bug_get_session(bug)), SWITCH_LOG_ERROR, "Framing Error Writing!\n");
+				switch_core_media_bug_flush(bug);
+				return SWITCH_STATUS_FALSE;
 			}
-
-			switch_normalize_to_16bit(z);
-
-			*(fp + x) = (int16_t) z;
+		} else if (fill_write) {
+			datalen = bytes;
+			memset(bug->data, 255, datalen);
 		}
+
+		media_bug_mix(bug, frame, datalen, bytes);
 	}
 
 	frame->datalen = (uint32_t)bytes;
@@ -792,7 +1806,6 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_push_spy_frame(switch_medi
 	return SWITCH_STATUS_FALSE;
 }
 
-#define MAX_BUG_BUFFER 1024 * 512
 SWITCH_DECLARE(switch_status_t) switch_core_media_bug_add(switch_core_session_t *session,
 														  const char *function,
 														  const char *target,
@@ -900,15 +1913,23 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_add(switch_core_session_t
 		bug->flags = (SMBF_READ_STREAM | SMBF_WRITE_STREAM);
 	}
 
+	if (switch_test_flag(bug, SMBF_READ_STREAM) || switch_test_flag(bug, SMBF_READ_PING) || switch_test_flag(bug, SMBF_WRITE_STREAM)) {
+		media_bug_tap_attach(bug);
+	}
+
 	if (switch_test_flag(bug, SMBF_READ_STREAM) || switch_test_flag(bug, SMBF_READ_PING)) {
-		switch_buffer_create_dynamic(&bug->raw_read_buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER);
+		if (!bug->tap) {
+			switch_buffer_create_dynamic(&bug->raw_read_buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER);
+		}
 		switch_mutex_init(&bug->read_mutex, SWITCH_MUTEX_NESTED, session->pool);
 	}
 
 	bytes = bug->write_impl.decoded_bytes_per_packet;
 
 	if (switch_test_flag(bug, SMBF_WRITE_STREAM)) {
-		switch_buffer_create_dynamic(&bug->raw_write_buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER);
+		if (!bug->tap) {
+			switch_buffer_create_dynamic(&bug->raw_write_buffer, bytes * SWITCH_BUFFER_BLOCK_FRAMES, bytes * SWITCH_BUFFER_START_FRAMES, MAX_BUG_BUFFER);
+		}
 		switch_mutex_init(&bug->write_mutex, SWITCH_MUTEX_NESTED, session->pool);
 	}
 
@@ -956,6 +1977,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_add(switch_core_session_t
 		}
 	}
 
+	if (switch_test_flag(bug, SMBF_ASYNC)) {
+		media_bug_async_attach(bug);
+	}
+
 	bug->ready = 1;
 
 	if ((switch_test_flag(bug, SMBF_READ_VIDEO_STREAM) || switch_test_flag(bug, SMBF_WRITE_VIDEO_STREAM))) {
@@ -992,6 +2017,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_add(switch_core_session_t
 		}
 	}
 
+	media_bug_tap_unshare_write(session);
+
 	switch_thread_rwlock_unlock(session->bug_rwlock);
 	*new_bug = bug;
 
@@ -1194,18 +2221,36 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_enumerate(switch_core_sess
 		switch_thread_rwlock_rdlock(session->bug_rwlock);
 		for (bp = session->bugs; bp; bp = bp->next) {
 			int thread_locked = (bp->thread_id && bp->thread_id == switch_thread_self());
+			switch_media_bug_async_stats_t async_stats;
+
 			stream->write_function(stream,
 								   " <media-bug>\n"
 								   "  <function>%s</function>\n"
 								   "  <target>%s</target>\n"
-								   "  <thread-locked>%d</thread-locked>\n"
-								   " </media-bug>\n",
+								   "  <thread-locked>%d</thread-locked>\n",
 								   bp->function, bp->target, thread_locked);
 
+			if (switch_core_media_bug_get_async_stats(bp, &async_stats) == SWITCH_STATUS_SUCCESS) {
+				stream->write_function(stream,
+									   "  <async queued=\"%u\" depth=\"%u\" dropped=\"%" SWITCH_UINT64_T_FMT "\" blocked=\"%" SWITCH_UINT64_T_FMT "\""
+									   " latency-avg-us=\"%u\" latency-max-us=\"%u\" run-avg-us=\"%u\" run-max-us=\"%u\"/>\n",
+									   async_stats.queued_now, async_stats.depth, async_stats.dropped, async_stats.blocked,
+									   async_stats.avg_latency_us, async_stats.max_latency_us, async_stats.avg_run_us, async_stats.max_run_us);
+			}
+
+			stream->write_function(stream, " </media-bug>\n");
+
 		}
 		switch_thread_rwlock_unlock(session->bug_rwlock);
 	}
 
+	if (session->bug_tap) {
+		switch_mutex_lock(session->bug_tap->mutex);
+		stream->write_function(stream, " <shared-tap size=\"%u\" mixes=\"%" SWITCH_UINT64_T_FMT "\" reused=\"%" SWITCH_UINT64_T_FMT "\"/>\n",
+							   session->bug_tap->size, session->bug_tap->mixes, session->bug_tap->mix_hits);
+		switch_mutex_unlock(session->bug_tap->mutex);
+	}
+
 	stream->write_function(stream, "</media-bugs>\n");
 
 	return SWITCH_STATUS_SUCCESS;
@@ -1274,6 +2319,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_close(switch_media_bug_t *
 			return SWITCH_STATUS_FALSE;
 		}
 
+		media_bug_async_detach(bp);
+
 		if (bp->callback) {
 			bp->callback(bp, bp->user_data, SWITCH_ABC_TYPE_CLOSE);
 		}
@@ -1540,6 +1540,7 @@ SWITCH_DECLARE(void) switch_core_session_perform_destroy(switch_core_session_t *
 	switch_core_session_reset(*session, SWITCH_TRUE, SWITCH_TRUE);
 
 	switch_core_media_bug_remove_all(*session);
+	switch_core_media_bug_tap_destroy(*session);
 	switch_ivr_deactivate_unicast(*session);
 
 	switch_scheduler_del_task_group((*session)->uuid_str);
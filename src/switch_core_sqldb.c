@@ -55,9 +55,33 @@ struct switch_cache_db_handle {
 	char last_user[CACHE_DB_LEN];
 	uint32_t use_count;
 	uint64_t total_used_count;
+	switch_hash_t *stmt_hash;
+	switch_cache_db_stmt_t *stmt_head;
+	switch_cache_db_stmt_t *stmt_tail;
+	uint32_t stmt_count;
+	uint64_t stmt_hits;
+	uint64_t stmt_misses;
 	struct switch_cache_db_handle *next;
 };
 
+#define SQL_STMT_CACHE_SIZE 64
+
+struct switch_cache_db_stmt {
+	switch_cache_db_handle_t *dbh;
+	char *sql;
+	int argc;
+	char **argv;
+	uint8_t *ints;
+	union {
+		switch_core_db_stmt_t *core_db;
+		switch_odbc_prepared_t *odbc;
+		void *database_interface;
+	} native;
+	int busy;
+	struct switch_cache_db_stmt *prev;
+	struct switch_cache_db_stmt *next;
+};
+
 static struct {
 	switch_memory_pool_t *memory_pool;
 	switch_thread_t *db_thread;
@@ -95,6 +119,8 @@ static switch_cache_db_handle_t *create_handle(switch_cache_db_handle_type_t typ
 	return new_dbh;
 }
 
+static void stmt_cache_flush(switch_cache_db_handle_t *dbh);
+
 static void destroy_handle(switch_cache_db_handle_t **dbh)
 {
 	if (dbh && *dbh && (*dbh)->pool) {
@@ -167,6 +193,7 @@ top:
 
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "Dropping DB connection %s\n", dbh_ptr->name);
 
+			stmt_cache_flush(dbh_ptr);
 			database_interface->handle_destroy(&dbh_ptr->native_handle.database_interface_dbh);
 
 			del_handle(dbh_ptr);
@@ -284,6 +311,8 @@ static void sql_close(time_t prune)
 		if (switch_mutex_trylock(dbh->mutex) == SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "Dropping idle DB connection %s\n", dbh->name);
 
+			stmt_cache_flush(dbh);
+
 			switch (dbh->type) {
 				case SCDB_TYPE_DATABASE_INTERFACE:
 				{
@@ -879,6 +908,378 @@ SWITCH_DECLARE(int) switch_cache_db_load_extension(switch_cache_db_handle_t *dbh
 }
 
 
+/*
+  Prepared statements are cached per handle, keyed by their sql text and kept in LRU order.  Parameters are
+  marked with ? and bound as text (or integers) right before the statement runs.  Database interfaces that
+  cannot prepare get the parameters quoted into the sql text instead.
+*/
+
+static int stmt_count_params(const char *sql)
+{
+	const char *p;
+	int quoted = 0, count = 0;
+
+	for (p = sql; p && *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		} else if (*p == '?' && !quoted) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void stmt_clear(switch_cache_db_stmt_t *stmt)
+{
+	int i;
+
+	for (i = 0; i < stmt->argc; i++) {
+		switch_safe_free(stmt->argv[i]);
+		stmt->ints[i] = 0;
+	}
+}
+
+static void stmt_unlink(switch_cache_db_handle_t *dbh, switch_cache_db_stmt_t *stmt)
+{
+	if (stmt->prev) {
+		stmt->prev->next = stmt->next;
+	} else {
+		dbh->stmt_head = stmt->next;
+	}
+
+	if (stmt->next) {
+		stmt->next->prev = stmt->prev;
+	} else {
+		dbh->stmt_tail = stmt->prev;
+	}
+
+	stmt->prev = stmt->next = NULL;
+}
+
+static void stmt_link_head(switch_cache_db_handle_t *dbh, switch_cache_db_stmt_t *stmt)
+{
+	stmt->prev = NULL;
+	stmt->next = dbh->stmt_head;
+
+	if (dbh->stmt_head) {
+		dbh->stmt_head->prev = stmt;
+	} else {
+		dbh->stmt_tail = stmt;
+	}
+
+	dbh->stmt_head = stmt;
+}
+
+static void stmt_destroy(switch_cache_db_stmt_t **stmtp)
+{
+	switch_cache_db_stmt_t *stmt = *stmtp;
+
+	*stmtp = NULL;
+
+	switch (stmt->dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		if (stmt->native.core_db) {
+			switch_core_db_finalize(stmt->native.core_db);
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		switch_odbc_prepared_destroy(&stmt->native.odbc);
+		break;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		if (stmt->native.database_interface) {
+			switch_database_interface_t *database_interface = stmt->dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+			database_interface->finalize(stmt->dbh->native_handle.database_interface_dbh, &stmt->native.database_interface);
+		}
+		break;
+	}
+
+	stmt_clear(stmt);
+	switch_safe_free(stmt->argv);
+	switch_safe_free(stmt->ints);
+	switch_safe_free(stmt->sql);
+	free(stmt);
+}
+
+/* must run before the native handle goes away */
+static void stmt_cache_flush(switch_cache_db_handle_t *dbh)
+{
+	switch_cache_db_stmt_t *stmt;
+
+	while ((stmt = dbh->stmt_head)) {
+		stmt_unlink(dbh, stmt);
+		stmt_destroy(&stmt);
+	}
+
+	if (dbh->stmt_hash) {
+		switch_core_hash_destroy(&dbh->stmt_hash);
+	}
+
+	dbh->stmt_count = 0;
+}
+
+static switch_status_t stmt_prepare_native(switch_cache_db_stmt_t *stmt, char **err)
+{
+	switch_cache_db_handle_t *dbh = stmt->dbh;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch (dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		{
+			switch_core_db_t *db = dbh->native_handle.core_db_dbh->handle;
+
+			/* cached statements outlive schema changes, v2 re-prepares them inside step */
+			if (switch_core_db_prepare_v2(db, stmt->sql, -1, &stmt->native.core_db, NULL) == SWITCH_CORE_DB_OK && stmt->native.core_db) {
+				status = SWITCH_STATUS_SUCCESS;
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] NATIVE SQL ERR [%s]\n%s\n", dbh->name, switch_core_db_errmsg(db), stmt->sql);
+				if (err) {
+					*err = strdup(switch_core_db_errmsg(db));
+				}
+			}
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		{
+			if (switch_odbc_prepared_new(dbh->native_handle.odbc_dbh, stmt->sql, &stmt->native.odbc, err) == SWITCH_ODBC_SUCCESS) {
+				status = SWITCH_STATUS_SUCCESS;
+			}
+		}
+		break;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		{
+			switch_database_interface_t *database_interface = dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+
+			if (database_interface->prepare && database_interface->exec_prepared && database_interface->finalize) {
+				status = database_interface->prepare(dbh->native_handle.database_interface_dbh, stmt->sql, &stmt->native.database_interface, err);
+			} else {
+				status = SWITCH_STATUS_SUCCESS;
+			}
+		}
+		break;
+	}
+
+	return status;
+}
+
+/* quote the bound values into the sql text for backends without native prepared statements */
+static char *stmt_expand(switch_cache_db_stmt_t *stmt)
+{
+	switch_stream_handle_t stream = { 0 };
+	const char *p;
+	int quoted = 0, i = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = stmt->sql; *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		} else if (*p == '?' && !quoted && i < stmt->argc) {
+			if (!stmt->argv[i]) {
+				stream.write_function(&stream, "NULL");
+			} else if (stmt->ints[i]) {
+				stream.write_function(&stream, "%s", stmt->argv[i]);
+			} else {
+				stream.write_function(&stream, "'%q'", stmt->argv[i]);
+			}
+			i++;
+			continue;
+		}
+
+		stream.raw_write_function(&stream, (uint8_t *) p, 1);
+	}
+
+	return (char *) stream.data;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_prepare(switch_cache_db_handle_t *dbh, const char *sql, switch_cache_db_stmt_t **stmtp, char **err)
+{
+	switch_cache_db_stmt_t *stmt, *victim;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+
+	*stmtp = NULL;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	if (!dbh->stmt_hash) {
+		switch_core_hash_init(&dbh->stmt_hash);
+	}
+
+	if ((stmt = switch_core_hash_find(dbh->stmt_hash, sql))) {
+		dbh->stmt_hits++;
+		if (stmt != dbh->stmt_head) {
+			stmt_unlink(dbh, stmt);
+			stmt_link_head(dbh, stmt);
+		}
+		goto end;
+	}
+
+	dbh->stmt_misses++;
+
+	switch_zmalloc(stmt, sizeof(*stmt));
+	stmt->dbh = dbh;
+	stmt->sql = strdup(sql);
+
+	if ((stmt->argc = stmt_count_params(sql))) {
+		switch_zmalloc(stmt->argv, sizeof(char *) * stmt->argc);
+		switch_zmalloc(stmt->ints, stmt->argc);
+	}
+
+	if ((status = stmt_prepare_native(stmt, err)) != SWITCH_STATUS_SUCCESS) {
+		stmt_destroy(&stmt);
+		goto end;
+	}
+
+	switch_core_hash_insert(dbh->stmt_hash, sql, stmt);
+	stmt_link_head(dbh, stmt);
+	dbh->stmt_count++;
+
+	for (victim = dbh->stmt_tail; victim && dbh->stmt_count > SQL_STMT_CACHE_SIZE; ) {
+		switch_cache_db_stmt_t *prev = victim->prev;
+
+		if (victim != stmt && !victim->busy) {
+			switch_core_hash_delete(dbh->stmt_hash, victim->sql);
+			stmt_unlink(dbh, victim);
+			stmt_destroy(&victim);
+			dbh->stmt_count--;
+		}
+
+		victim = prev;
+	}
+
+ end:
+
+	if (stmt) {
+		stmt_clear(stmt);
+		stmt->busy = 1;
+		*stmtp = stmt;
+	}
+
+	if (io_mutex) switch_mutex_unlock(io_mutex);
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_bind(switch_cache_db_stmt_t *stmt, int index, const char *value)
+{
+	if (!stmt || index < 1 || index > stmt->argc) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	index--;
+	switch_safe_free(stmt->argv[index]);
+	stmt->argv[index] = value ? strdup(value) : NULL;
+	stmt->ints[index] = 0;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_bind_int64(switch_cache_db_stmt_t *stmt, int index, int64_t value)
+{
+	if (!stmt || index < 1 || index > stmt->argc) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	index--;
+	switch_safe_free(stmt->argv[index]);
+	stmt->argv[index] = switch_mprintf("%" SWITCH_INT64_T_FMT, value);
+	stmt->ints[index] = 1;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_step(switch_cache_db_stmt_t *stmt, char **err)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_cache_db_handle_t *dbh;
+	switch_mutex_t *io_mutex;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (!stmt) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	dbh = stmt->dbh;
+	io_mutex = dbh->io_mutex;
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	switch (dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		{
+			switch_core_db_stmt_t *native = stmt->native.core_db;
+			int i, result, running = 1;
+
+			for (i = 0; i < stmt->argc; i++) {
+				if (!stmt->argv[i]) {
+					switch_core_db_bind_null(native, i + 1);
+				} else if (stmt->ints[i]) {
+					switch_core_db_bind_int64(native, i + 1, strtoll(stmt->argv[i], NULL, 10));
+				} else {
+					switch_core_db_bind_text(native, i + 1, stmt->argv[i], -1, SWITCH_CORE_DB_STATIC);
+				}
+			}
+
+			while ((result = switch_core_db_step(native)) == SWITCH_CORE_DB_ROW || (result == SWITCH_CORE_DB_BUSY && running++ < 5000)) {
+				if (result == SWITCH_CORE_DB_BUSY) {
+					switch_cond_next();
+				}
+			}
+
+			if (result == SWITCH_CORE_DB_DONE) {
+				status = SWITCH_STATUS_SUCCESS;
+			} else {
+				const char *errmsg = switch_core_db_errmsg(dbh->native_handle.core_db_dbh->handle);
+
+				if (!switch_stristr("already exists", errmsg)) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] NATIVE SQL ERR [%s]\n%s\n", dbh->name, errmsg, stmt->sql);
+				}
+				if (err) {
+					*err = strdup(errmsg);
+				}
+			}
+
+			switch_core_db_reset(native);
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		{
+			if (switch_odbc_prepared_exec(stmt->native.odbc, stmt->argc, (const char * const *) stmt->argv, err) == SWITCH_ODBC_SUCCESS) {
+				status = SWITCH_STATUS_SUCCESS;
+			}
+		}
+		break;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		{
+			if (stmt->native.database_interface) {
+				switch_database_interface_t *database_interface = dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+				status = database_interface->exec_prepared(dbh->native_handle.database_interface_dbh, stmt->native.database_interface,
+														   stmt->argc, (const char * const *) stmt->argv, err);
+			} else {
+				char *sql = stmt_expand(stmt);
+				status = switch_cache_db_execute_sql_real(dbh, sql, err);
+				free(sql);
+			}
+		}
+		break;
+	}
+
+	stmt_clear(stmt);
+	stmt->busy = 0;
+
+	if (io_mutex) switch_mutex_unlock(io_mutex);
+
+	return status;
+}
+
 SWITCH_DECLARE(char *) switch_cache_db_execute_sql2str(switch_cache_db_handle_t *dbh, char *sql, char *str, size_t len, char **err)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
@@ -1800,6 +2201,74 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_execute_sql_event_callback_err(swi
 }
 
 
+/* prepared statements travel through the queues as one allocation: a mark, the sql, then 't' value or 'n' per parameter */
+#define SQL_PACKED_MARK '\001'
+
+static char *sql_pack(const char *sql, int argc, const char * const *argv)
+{
+	switch_size_t len = strlen(sql) + 3, slen;
+	char *packed, *p;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		len += argv[i] ? strlen(argv[i]) + 2 : 1;
+	}
+
+	switch_malloc(packed, len);
+	p = packed;
+	*p++ = SQL_PACKED_MARK;
+
+	slen = strlen(sql) + 1;
+	memcpy(p, sql, slen);
+	p += slen;
+
+	for (i = 0; i < argc; i++) {
+		if (argv[i]) {
+			*p++ = 't';
+			slen = strlen(argv[i]) + 1;
+			memcpy(p, argv[i], slen);
+			p += slen;
+		} else {
+			*p++ = 'n';
+		}
+	}
+
+	*p = '\0';
+
+	return packed;
+}
+
+static switch_status_t sql_packed_exec(switch_cache_db_handle_t *dbh, const char *packed, char **err)
+{
+	const char *sql = packed + 1, *p;
+	switch_cache_db_stmt_t *stmt;
+	int i;
+
+	if (switch_cache_db_prepare(dbh, sql, &stmt, err) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	for (i = 1, p = sql + strlen(sql) + 1; *p; i++) {
+		if (*p++ == 't') {
+			switch_cache_db_bind(stmt, i, p);
+			p += strlen(p) + 1;
+		} else {
+			switch_cache_db_bind(stmt, i, NULL);
+		}
+	}
+
+	return switch_cache_db_step(stmt, err);
+}
+
+static switch_status_t qm_execute_sql(switch_cache_db_handle_t *dbh, char *sql)
+{
+	if (*sql == SQL_PACKED_MARK) {
+		return sql_packed_exec(dbh, sql, NULL);
+	}
+
+	return switch_cache_db_execute_sql(dbh, sql, NULL);
+}
+
 static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_handle_t *dbh)
 {
 	void *pop = NULL;
@@ -1809,7 +2278,7 @@ static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_hand
 	while (switch_queue_trypop(q, &pop) == SWITCH_STATUS_SUCCESS) {
 		if (pop) {
 			if (dbh) {
-				switch_cache_db_execute_sql(dbh, (char *) pop, NULL);
+				qm_execute_sql(dbh, (char *) pop);
 			}
 			switch_safe_free(pop);
 		}
@@ -1988,6 +2457,12 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_m
 }
 
 
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_prepared(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos,
+																	   int argc, const char * const *argv)
+{
+	return switch_sql_queue_manager_push(qm, sql_pack(sql, argc, argv), pos, SWITCH_FALSE);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
 {
 #define EXEC_NOW
@@ -2194,7 +2669,7 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 		}
 
 		if (pop) {
-			if ((status = switch_cache_db_execute_sql(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
+			if ((status = qm_execute_sql(qm->event_db, (char *) pop)) == SWITCH_STATUS_SUCCESS) {
 				switch_mutex_lock(qm->mutex);
 				qm->pre_written[i]++;
 				switch_mutex_unlock(qm->mutex);
@@ -2378,51 +2853,1219 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 }
 
 
-static char *parse_presence_data_cols(switch_event_t *event)
+#define MAX_SQL_ARGS 160
+
+typedef struct {
+	const char *argv[MAX_SQL_ARGS];
+	int argc;
+} core_sql_args_t;
+
+static void sql_arg(core_sql_args_t *args, const char *value)
+{
+	switch_assert(args->argc < MAX_SQL_ARGS);
+	args->argv[args->argc++] = value;
+}
+
+/* the channel and call writers go through the prepared statement cache, the values stay bound parameters */
+static char *sql_args_pack(const char *sql, core_sql_args_t *args)
+{
+	char *packed = sql_pack(sql, args->argc, args->argv);
+
+	args->argc = 0;
+
+	return packed;
+}
+
+static char *parse_presence_data_cols(switch_event_t *event, core_sql_args_t *args)
 {
 	char *cols[128] = { 0 };
 	int col_count = 0;
 	char *data_copy;
 	switch_stream_handle_t stream = { 0 };
 	int i;
-	char *r;
-	char col_name[128] = "";
-	const char *data = switch_event_get_header(event, "presence-data-cols");
+	char *r;
+	char col_name[128] = "";
+	const char *data = switch_event_get_header(event, "presence-data-cols");
+
+	if (zstr(data)) {
+		return NULL;
+	}
+
+	data_copy = strdup(data);
+
+	col_count = switch_split(data_copy, ':', cols);
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (i = 0; i < col_count; i++) {
+		const char *val = NULL;
+
+		switch_snprintfv(col_name, sizeof(col_name), "PD-%q", cols[i]);
+		val = switch_event_get_header_nil(event, col_name);
+		stream.write_function(&stream, "%q=?,", cols[i]);
+		sql_arg(args, zstr(val) ? NULL : val);
+	}
+
+	r = (char *) stream.data;
+
+	if (end_of(r) == ',') {
+		end_of(r) = '\0';
+	}
+
+	switch_safe_free(data_copy);
+
+	return r;
+
+}
+
+
+/*
+  In-memory copy of the channels and calls tables (switch.conf channel-index).
+
+  The rows are kept in a few lock striped hashes keyed by uuid and are fed from the same channel events
+  core_event_handler turns into SQL, so "show channels" and friends see the same columns without a
+  database round trip.  With channel-index-sql=false core_event_handler stops writing those tables.
+*/
+
+#define CHANNEL_INDEX_STRIPES 16
+
+typedef enum {
+	CI_UUID,
+	CI_DIRECTION,
+	CI_CREATED,
+	CI_CREATED_EPOCH,
+	CI_NAME,
+	CI_STATE,
+	CI_CID_NAME,
+	CI_CID_NUM,
+	CI_IP_ADDR,
+	CI_DEST,
+	CI_APPLICATION,
+	CI_APPLICATION_DATA,
+	CI_DIALPLAN,
+	CI_CONTEXT,
+	CI_READ_CODEC,
+	CI_READ_RATE,
+	CI_READ_BIT_RATE,
+	CI_WRITE_CODEC,
+	CI_WRITE_RATE,
+	CI_WRITE_BIT_RATE,
+	CI_SECURE,
+	CI_HOSTNAME,
+	CI_PRESENCE_ID,
+	CI_PRESENCE_DATA,
+	CI_ACCOUNTCODE,
+	CI_CALLSTATE,
+	CI_CALLEE_NAME,
+	CI_CALLEE_NUM,
+	CI_CALLEE_DIRECTION,
+	CI_CALL_UUID,
+	CI_SENT_CALLEE_NAME,
+	CI_SENT_CALLEE_NUM,
+	CI_INITIAL_CID_NAME,
+	CI_INITIAL_CID_NUM,
+	CI_INITIAL_IP_ADDR,
+	CI_INITIAL_DEST,
+	CI_INITIAL_DIALPLAN,
+	CI_INITIAL_CONTEXT,
+	CI_MAX
+} channel_index_col_t;
+
+/* same order as create_channels_sql */
+static const char *channel_index_names[CI_MAX] = {
+	"uuid", "direction", "created", "created_epoch", "name", "state", "cid_name", "cid_num", "ip_addr", "dest",
+	"application", "application_data", "dialplan", "context", "read_codec", "read_rate", "read_bit_rate",
+	"write_codec", "write_rate", "write_bit_rate", "secure", "hostname", "presence_id", "presence_data",
+	"accountcode", "callstate", "callee_name", "callee_num", "callee_direction", "call_uuid",
+	"sent_callee_name", "sent_callee_num", "initial_cid_name", "initial_cid_num", "initial_ip_addr",
+	"initial_dest", "initial_dialplan", "initial_context"
+};
+
+/* the a and b leg columns of basic_calls_sql, detailed_calls_sql uses everything up to sent_callee_num */
+static const channel_index_col_t basic_calls_a_cols[] = {
+	CI_UUID, CI_DIRECTION, CI_CREATED, CI_CREATED_EPOCH, CI_NAME, CI_STATE, CI_CID_NAME, CI_CID_NUM, CI_IP_ADDR, CI_DEST,
+	CI_PRESENCE_ID, CI_PRESENCE_DATA, CI_ACCOUNTCODE, CI_CALLSTATE, CI_CALLEE_NAME, CI_CALLEE_NUM, CI_CALLEE_DIRECTION,
+	CI_CALL_UUID, CI_HOSTNAME, CI_SENT_CALLEE_NAME, CI_SENT_CALLEE_NUM
+};
+
+static const channel_index_col_t basic_calls_b_cols[] = {
+	CI_UUID, CI_DIRECTION, CI_CREATED, CI_CREATED_EPOCH, CI_NAME, CI_STATE, CI_CID_NAME, CI_CID_NUM, CI_IP_ADDR, CI_DEST,
+	CI_PRESENCE_ID, CI_PRESENCE_DATA, CI_ACCOUNTCODE, CI_CALLSTATE, CI_CALLEE_NAME, CI_CALLEE_NUM, CI_CALLEE_DIRECTION,
+	CI_SENT_CALLEE_NAME, CI_SENT_CALLEE_NUM
+};
+
+#define DETAILED_CALLS_COLS (CI_SENT_CALLEE_NUM + 1)
+#define CHANNEL_INDEX_MAX_COLS (CI_MAX * 2 + 1)
+
+typedef struct {
+	channel_index_col_t col;
+	const char *header;
+} channel_index_map_t;
+
+static const channel_index_map_t ci_create_map[] = {
+	{ CI_DIRECTION, "call-direction" },
+	{ CI_CREATED, "event-date-local" },
+	{ CI_NAME, "channel-name" },
+	{ CI_STATE, "channel-state" },
+	{ CI_CALLSTATE, "channel-call-state" },
+	{ CI_DIALPLAN, "caller-dialplan" },
+	{ CI_CONTEXT, "caller-context" },
+	{ CI_INITIAL_CID_NAME, "caller-caller-id-name" },
+	{ CI_INITIAL_CID_NUM, "caller-caller-id-number" },
+	{ CI_INITIAL_IP_ADDR, "caller-network-addr" },
+	{ CI_INITIAL_DEST, "caller-destination-number" },
+	{ CI_INITIAL_DIALPLAN, "caller-dialplan" },
+	{ CI_INITIAL_CONTEXT, "caller-context" }
+};
+
+static const channel_index_map_t ci_codec_map[] = {
+	{ CI_READ_CODEC, "channel-read-codec-name" },
+	{ CI_READ_RATE, "channel-read-codec-rate" },
+	{ CI_READ_BIT_RATE, "channel-read-codec-bit-rate" },
+	{ CI_WRITE_CODEC, "channel-write-codec-name" },
+	{ CI_WRITE_RATE, "channel-write-codec-rate" },
+	{ CI_WRITE_BIT_RATE, "channel-write-codec-bit-rate" }
+};
+
+static const channel_index_map_t ci_execute_map[] = {
+	{ CI_APPLICATION, "application" },
+	{ CI_APPLICATION_DATA, "application-data" },
+	{ CI_PRESENCE_ID, "channel-presence-id" },
+	{ CI_PRESENCE_DATA, "channel-presence-data" },
+	{ CI_ACCOUNTCODE, "variable_accountcode" }
+};
+
+static const channel_index_map_t ci_originate_map[] = {
+	{ CI_PRESENCE_ID, "channel-presence-id" },
+	{ CI_PRESENCE_DATA, "channel-presence-data" },
+	{ CI_ACCOUNTCODE, "variable_accountcode" },
+	{ CI_CALL_UUID, "channel-call-uuid" }
+};
+
+static const channel_index_map_t ci_call_update_map[] = {
+	{ CI_CALLEE_NAME, "caller-callee-id-name" },
+	{ CI_CALLEE_NUM, "caller-callee-id-number" },
+	{ CI_SENT_CALLEE_NAME, "sent-callee-id-name" },
+	{ CI_SENT_CALLEE_NUM, "sent-callee-id-number" },
+	{ CI_CALLEE_DIRECTION, "direction" },
+	{ CI_CID_NAME, "caller-caller-id-name" },
+	{ CI_CID_NUM, "caller-caller-id-number" }
+};
+
+static const channel_index_map_t ci_callstate_map[] = {
+	{ CI_CALLSTATE, "channel-call-state" }
+};
+
+static const channel_index_map_t ci_state_map[] = {
+	{ CI_STATE, "channel-state" }
+};
+
+static const channel_index_map_t ci_routing_map[] = {
+	{ CI_STATE, "channel-state" },
+	{ CI_CID_NAME, "caller-caller-id-name" },
+	{ CI_CID_NUM, "caller-caller-id-number" },
+	{ CI_CALLEE_NAME, "caller-callee-id-name" },
+	{ CI_CALLEE_NUM, "caller-callee-id-number" },
+	{ CI_SENT_CALLEE_NAME, "sent-callee-id-name" },
+	{ CI_SENT_CALLEE_NUM, "sent-callee-id-number" },
+	{ CI_IP_ADDR, "caller-network-addr" },
+	{ CI_DEST, "caller-destination-number" },
+	{ CI_DIALPLAN, "caller-dialplan" },
+	{ CI_CONTEXT, "caller-context" },
+	{ CI_PRESENCE_ID, "channel-presence-id" },
+	{ CI_PRESENCE_DATA, "channel-presence-data" },
+	{ CI_ACCOUNTCODE, "variable_accountcode" }
+};
+
+#define ci_map_len(_map) (sizeof(_map) / sizeof(_map[0]))
+
+typedef struct channel_index_row_s {
+	char *col[CI_MAX];
+	/* our side of a calls row, callee_uuid when we are the caller and caller_uuid when we are the callee */
+	char *callee_uuid;
+	char *caller_uuid;
+	char *call_created_epoch;
+	switch_time_t created;
+	switch_time_t call_created;
+	/* the b leg row, only set on the copies made by switch_core_channel_index_query() */
+	struct channel_index_row_s *b;
+} channel_index_row_t;
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+} channel_index_stripe_t;
+
+static struct {
+	int running;
+	/* the channels and calls tables are left to the index, only set once it has been seeded */
+	int owns;
+	/* held for reading by the event handler and queries, for writing while the stripes are set up or torn down */
+	switch_thread_rwlock_t *rwlock;
+	/* serializes start and stop */
+	switch_mutex_t *ctl_mutex;
+	channel_index_stripe_t stripe[CHANNEL_INDEX_STRIPES];
+	char b_names[CI_MAX][64];
+} channel_index;
+
+static channel_index_stripe_t *ci_stripe(const char *uuid)
+{
+	uint32_t h = 2166136261u;
+	const char *p;
+
+	for (p = uuid; *p; p++) {
+		h = (h ^ (uint8_t) *p) * 16777619u;
+	}
+
+	return &channel_index.stripe[h % CHANNEL_INDEX_STRIPES];
+}
+
+static void ci_set(char **dst, const char *val)
+{
+	if (*dst && val && !strcmp(*dst, val)) {
+		return;
+	}
+
+	switch_safe_free(*dst);
+
+	if (val) {
+		*dst = strdup(val);
+	}
+}
+
+static void ci_row_free(channel_index_row_t *row)
+{
+	int i;
+
+	for (i = 0; i < CI_MAX; i++) {
+		switch_safe_free(row->col[i]);
+	}
+
+	switch_safe_free(row->callee_uuid);
+	switch_safe_free(row->caller_uuid);
+	switch_safe_free(row->call_created_epoch);
+	free(row);
+}
+
+static channel_index_row_t *ci_row_dup(const channel_index_row_t *row)
+{
+	channel_index_row_t *dup;
+	int i;
+
+	switch_zmalloc(dup, sizeof(*dup));
+
+	for (i = 0; i < CI_MAX; i++) {
+		ci_set(&dup->col[i], row->col[i]);
+	}
+
+	ci_set(&dup->callee_uuid, row->callee_uuid);
+	ci_set(&dup->caller_uuid, row->caller_uuid);
+	ci_set(&dup->call_created_epoch, row->call_created_epoch);
+	dup->created = row->created;
+	dup->call_created = row->call_created;
+
+	return dup;
+}
+
+static void ci_row_apply(channel_index_row_t *row, switch_event_t *event, const channel_index_map_t *map, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		ci_set(&row->col[map[i].col], switch_event_get_header_nil(event, map[i].header));
+	}
+}
+
+static void ci_apply(const char *uuid, switch_event_t *event, const channel_index_map_t *map, size_t len)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = ci_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_find(stripe->hash, uuid))) {
+		ci_row_apply(row, event, map, len);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* the row insert into channels makes on CHANNEL_CREATE */
+static channel_index_row_t *ci_row_new(const char *uuid, switch_event_t *event)
+{
+	channel_index_row_t *row;
+	char epoch[32];
+
+	switch_zmalloc(row, sizeof(*row));
+	row->created = switch_time_now();
+	switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+	ci_set(&row->col[CI_UUID], uuid);
+	ci_set(&row->col[CI_CREATED_EPOCH], epoch);
+	ci_set(&row->col[CI_HOSTNAME], switch_core_get_switchname());
+	ci_row_apply(row, event, ci_create_map, ci_map_len(ci_create_map));
+
+	return row;
+}
+
+/* add a row for a channel that existed before the index was started, unless its events got there first */
+static void ci_seed_row(channel_index_row_t *row)
+{
+	const char *uuid = row->col[CI_UUID];
+	channel_index_stripe_t *stripe = ci_stripe(uuid);
+
+	switch_mutex_lock(stripe->mutex);
+	/* a channel already out of the session table has fired its destroy, a live one will still fire it to us */
+	if (switch_core_hash_find(stripe->hash, uuid) || !switch_ivr_uuid_exists(uuid)) {
+		ci_row_free(row);
+	} else {
+		switch_core_hash_insert(stripe->hash, uuid, row);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+static void ci_set_col(const char *uuid, channel_index_col_t col, const char *val)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = ci_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_find(stripe->hash, uuid))) {
+		ci_set(&row->col[col], val);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* update channels set call_uuid=uuid where call_uuid=? for one channel */
+static void ci_reset_call_uuid(const char *uuid, const char *call_uuid)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = ci_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_find(stripe->hash, uuid)) && row->col[CI_CALL_UUID] && !strcmp(row->col[CI_CALL_UUID], call_uuid)) {
+		ci_set(&row->col[CI_CALL_UUID], row->col[CI_UUID]);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* insert into calls, only one call per caller is tracked, a new bridge replaces the old one */
+static void ci_link(const char *a_uuid, const char *b_uuid, const char *epoch)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row;
+
+	if (zstr(a_uuid) || zstr(b_uuid)) {
+		return;
+	}
+
+	stripe = ci_stripe(a_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_find(stripe->hash, a_uuid))) {
+		ci_set(&row->callee_uuid, b_uuid);
+		ci_set(&row->call_created_epoch, epoch);
+		row->call_created = switch_time_now();
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	stripe = ci_stripe(b_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_find(stripe->hash, b_uuid))) {
+		ci_set(&row->caller_uuid, a_uuid);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* delete from calls where caller_uuid=? or callee_uuid=? */
+static void ci_unlink(const char *uuid, channel_index_row_t *row)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *peer;
+	char *callee = NULL, *caller = NULL;
+
+	if (row) {
+		callee = row->callee_uuid;
+		caller = row->caller_uuid;
+		row->callee_uuid = row->caller_uuid = NULL;
+		switch_safe_free(row->call_created_epoch);
+	} else {
+		stripe = ci_stripe(uuid);
+		switch_mutex_lock(stripe->mutex);
+		if ((peer = switch_core_hash_find(stripe->hash, uuid))) {
+			callee = peer->callee_uuid;
+			caller = peer->caller_uuid;
+			peer->callee_uuid = peer->caller_uuid = NULL;
+			switch_safe_free(peer->call_created_epoch);
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	if (callee) {
+		stripe = ci_stripe(callee);
+		switch_mutex_lock(stripe->mutex);
+		if ((peer = switch_core_hash_find(stripe->hash, callee)) && peer->caller_uuid && !strcmp(peer->caller_uuid, uuid)) {
+			switch_safe_free(peer->caller_uuid);
+		}
+		switch_mutex_unlock(stripe->mutex);
+		free(callee);
+	}
+
+	if (caller) {
+		stripe = ci_stripe(caller);
+		switch_mutex_lock(stripe->mutex);
+		if ((peer = switch_core_hash_find(stripe->hash, caller)) && peer->callee_uuid && !strcmp(peer->callee_uuid, uuid)) {
+			switch_safe_free(peer->callee_uuid);
+			switch_safe_free(peer->call_created_epoch);
+		}
+		switch_mutex_unlock(stripe->mutex);
+		free(caller);
+	}
+}
+
+static void ci_rename(const char *uuid, const char *old_uuid)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row;
+	switch_hash_index_t *hi;
+	void *val;
+	int i;
+
+	if (zstr(uuid) || zstr(old_uuid)) {
+		return;
+	}
+
+	stripe = ci_stripe(old_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((row = switch_core_hash_delete(stripe->hash, old_uuid))) {
+		ci_set(&row->col[CI_UUID], uuid);
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	if (row) {
+		stripe = ci_stripe(uuid);
+		switch_mutex_lock(stripe->mutex);
+		if ((val = switch_core_hash_delete(stripe->hash, uuid))) {
+			ci_row_free((channel_index_row_t *) val);
+		}
+		switch_core_hash_insert(stripe->hash, uuid, row);
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	/* update channels set call_uuid=? where call_uuid=? and the calls rows pointing at the old uuid */
+	for (i = 0; i < CHANNEL_INDEX_STRIPES; i++) {
+		stripe = &channel_index.stripe[i];
+		switch_mutex_lock(stripe->mutex);
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			row = (channel_index_row_t *) val;
+
+			if (row->col[CI_CALL_UUID] && !strcmp(row->col[CI_CALL_UUID], old_uuid)) {
+				ci_set(&row->col[CI_CALL_UUID], uuid);
+			}
+
+			if (row->callee_uuid && !strcmp(row->callee_uuid, old_uuid)) {
+				ci_set(&row->callee_uuid, uuid);
+			}
+
+			if (row->caller_uuid && !strcmp(row->caller_uuid, old_uuid)) {
+				ci_set(&row->caller_uuid, uuid);
+			}
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+static void ci_clear(void)
+{
+	channel_index_stripe_t *stripe;
+	switch_hash_index_t *hi;
+	void *val;
+	int i;
+
+	for (i = 0; i < CHANNEL_INDEX_STRIPES; i++) {
+		stripe = &channel_index.stripe[i];
+		switch_mutex_lock(stripe->mutex);
+		while ((hi = switch_core_hash_first(stripe->hash))) {
+			const void *key;
+
+			switch_core_hash_this(hi, &key, NULL, &val);
+			switch_safe_free(hi);
+			switch_core_hash_delete(stripe->hash, (const char *) key);
+			ci_row_free((channel_index_row_t *) val);
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+static void channel_index_event_apply(switch_event_t *event)
+{
+	const char *uuid = switch_event_get_header(event, "unique-id");
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row, *old;
+	char epoch[32];
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_CHANNEL_CREATE:
+		if (zstr(uuid)) {
+			break;
+		}
+
+		/* a repeated create must not throw away what is already known about the channel */
+		stripe = ci_stripe(uuid);
+		switch_mutex_lock(stripe->mutex);
+		old = switch_core_hash_find(stripe->hash, uuid);
+		switch_mutex_unlock(stripe->mutex);
+
+		if (old) {
+			break;
+		}
+
+		row = ci_row_new(uuid, event);
+
+		switch_mutex_lock(stripe->mutex);
+		if ((old = switch_core_hash_find(stripe->hash, uuid))) {
+			ci_row_free(row);
+		} else {
+			switch_core_hash_insert(stripe->hash, uuid, row);
+		}
+		switch_mutex_unlock(stripe->mutex);
+		break;
+	case SWITCH_EVENT_CHANNEL_DESTROY:
+		if (zstr(uuid)) {
+			break;
+		}
+
+		stripe = ci_stripe(uuid);
+		switch_mutex_lock(stripe->mutex);
+		row = switch_core_hash_delete(stripe->hash, uuid);
+		switch_mutex_unlock(stripe->mutex);
+
+		if (row) {
+			ci_unlink(uuid, row);
+			ci_row_free(row);
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_UUID:
+		ci_rename(uuid, switch_event_get_header(event, "old-unique-id"));
+		break;
+	case SWITCH_EVENT_CHANNEL_ANSWER:
+	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+	case SWITCH_EVENT_CODEC:
+		ci_apply(uuid, event, ci_codec_map, ci_map_len(ci_codec_map));
+		break;
+	case SWITCH_EVENT_CHANNEL_HOLD:
+	case SWITCH_EVENT_CHANNEL_UNHOLD:
+	case SWITCH_EVENT_CHANNEL_EXECUTE:
+		ci_apply(uuid, event, ci_execute_map, ci_map_len(ci_execute_map));
+		break;
+	case SWITCH_EVENT_CHANNEL_ORIGINATE:
+		ci_apply(uuid, event, ci_originate_map, ci_map_len(ci_originate_map));
+		break;
+	case SWITCH_EVENT_CALL_UPDATE:
+		ci_apply(uuid, event, ci_call_update_map, ci_map_len(ci_call_update_map));
+		break;
+	case SWITCH_EVENT_CHANNEL_CALLSTATE:
+		{
+			char *num = switch_event_get_header_nil(event, "channel-call-state-number");
+			switch_channel_callstate_t callstate = CCS_DOWN;
+
+			if (num) {
+				callstate = atoi(num);
+			}
+
+			if (callstate != CCS_DOWN && callstate != CCS_HANGUP) {
+				ci_apply(uuid, event, ci_callstate_map, ci_map_len(ci_callstate_map));
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_STATE:
+		{
+			char *state = switch_event_get_header_nil(event, "channel-state-number");
+			switch_channel_state_t state_i = CS_DESTROY;
+
+			if (!zstr(state)) {
+				state_i = atoi(state);
+			}
+
+			switch (state_i) {
+			case CS_NEW:
+			case CS_DESTROY:
+			case CS_REPORTING:
+#ifndef SWITCH_DEPRECATED_CORE_DB
+			case CS_HANGUP:
+#endif
+			case CS_INIT:
+				break;
+			case CS_ROUTING:
+				ci_apply(uuid, event, ci_routing_map, ci_map_len(ci_routing_map));
+				break;
+			default:
+				ci_apply(uuid, event, ci_state_map, ci_map_len(ci_state_map));
+				break;
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+		{
+			const char *a_uuid, *b_uuid, *call_uuid = switch_event_get_header_nil(event, "channel-call-uuid");
+
+			a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
+			b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
+
+			if (zstr(a_uuid) || zstr(b_uuid)) {
+				a_uuid = switch_event_get_header_nil(event, "caller-unique-id");
+				b_uuid = switch_event_get_header_nil(event, "other-leg-unique-id");
+			}
+
+			ci_set_col(a_uuid, CI_CALL_UUID, call_uuid);
+			ci_set_col(b_uuid, CI_CALL_UUID, call_uuid);
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			ci_link(a_uuid, b_uuid, epoch);
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		{
+			const char *cuuid = switch_event_get_header_nil(event, "caller-unique-id");
+			const char *call_uuid = switch_event_get_header_nil(event, "channel-call-uuid");
+			char *callee = NULL, *caller = NULL;
+
+			if (!zstr(cuuid)) {
+				stripe = ci_stripe(cuuid);
+				switch_mutex_lock(stripe->mutex);
+				if ((row = switch_core_hash_find(stripe->hash, cuuid))) {
+					ci_set(&callee, row->callee_uuid);
+					ci_set(&caller, row->caller_uuid);
+				}
+				switch_mutex_unlock(stripe->mutex);
+			}
+
+			/* the channels sharing a call_uuid are the legs of that bridge, no need to walk the whole index */
+			ci_reset_call_uuid(uuid, call_uuid);
+			ci_reset_call_uuid(cuuid, call_uuid);
+			ci_reset_call_uuid(callee, call_uuid);
+			ci_reset_call_uuid(caller, call_uuid);
+			ci_reset_call_uuid(switch_event_get_header(event, "other-leg-unique-id"), call_uuid);
+
+			if (!zstr(cuuid)) {
+				ci_unlink(cuuid, NULL);
+			}
+
+			switch_safe_free(callee);
+			switch_safe_free(caller);
+		}
+		break;
+	case SWITCH_EVENT_CALL_SECURE:
+		{
+			const char *type = switch_event_get_header_nil(event, "secure_type");
+
+			if (!zstr(type)) {
+				ci_set_col(switch_event_get_header_nil(event, "caller-unique-id"), CI_SECURE, type);
+			}
+		}
+		break;
+	case SWITCH_EVENT_SHUTDOWN:
+		ci_clear();
+		break;
+	default:
+		break;
+	}
+}
+
+/* events queued before a stop may still be delivered, they must not touch the stripes once they are gone */
+static void channel_index_event_handler(switch_event_t *event)
+{
+	switch_thread_rwlock_rdlock(channel_index.rwlock);
+	if (channel_index.running) {
+		channel_index_event_apply(event);
+	}
+	switch_thread_rwlock_unlock(channel_index.rwlock);
+}
+
+static switch_bool_t channel_index_owns_tables(void)
+{
+	return (channel_index.owns && !runtime.channel_index_sql) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+/* SQL LIKE, case insensitive, % and _ wildcards */
+static int ci_like(const char *str, const char *pat)
+{
+	for (; *pat; pat++, str++) {
+		if (*pat == '%') {
+			while (*pat == '%') {
+				pat++;
+			}
+
+			if (!*pat) {
+				return 1;
+			}
+
+			for (; *str; str++) {
+				if (ci_like(str, pat)) {
+					return 1;
+				}
+			}
+
+			return 0;
+		}
+
+		if (!*str || (*pat != '_' && switch_tolower(*pat) != switch_tolower(*str))) {
+			return 0;
+		}
+	}
+
+	return !*str;
+}
+
+static int ci_row_like(const channel_index_row_t *row, const char *like)
+{
+	static const channel_index_col_t cols[] = { CI_UUID, CI_NAME, CI_CID_NAME, CI_CID_NUM, CI_PRESENCE_DATA, CI_ACCOUNTCODE };
+	size_t i;
+
+	for (i = 0; i < ci_map_len(cols); i++) {
+		if (row->col[cols[i]] && ci_like(row->col[cols[i]], like)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int ci_row_cmp(const void *a, const void *b)
+{
+	const channel_index_row_t *ra = *(const channel_index_row_t * const *) a;
+	const channel_index_row_t *rb = *(const channel_index_row_t * const *) b;
+
+	if (ra->created == rb->created) {
+		return 0;
+	}
+
+	return ra->created < rb->created ? -1 : 1;
+}
+
+static int ci_row_call_cmp(const void *a, const void *b)
+{
+	const channel_index_row_t *ra = *(const channel_index_row_t * const *) a;
+	const channel_index_row_t *rb = *(const channel_index_row_t * const *) b;
+
+	/* rows without a call sort first like NULL does */
+	switch_time_t ta = ra->call_created_epoch ? ra->call_created : 0;
+	switch_time_t tb = rb->call_created_epoch ? rb->call_created : 0;
+
+	if (ta == tb) {
+		return ci_row_cmp(a, b);
+	}
+
+	return ta < tb ? -1 : 1;
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_core_channel_index_enabled(void)
+{
+	return channel_index.running ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+SWITCH_DECLARE(uint32_t) switch_core_channel_index_query(switch_channel_index_view_t view, const char *like, switch_channel_index_flag_t flags,
+														 switch_core_db_callback_func_t callback, void *pArg)
+{
+	channel_index_stripe_t *stripe;
+	channel_index_row_t *row, **all = NULL, **rows = NULL;
+	switch_hash_t *lookup = NULL;
+	switch_hash_index_t *hi;
+	char *argv[CHANNEL_INDEX_MAX_COLS];
+	char *names[CHANNEL_INDEX_MAX_COLS];
+	uint32_t total = 0, matched = 0, alloced = 0, x;
+	int argc = 0, i;
+	void *val;
+
+	if (!channel_index.running) {
+		return 0;
+	}
+
+	if (zstr(like)) {
+		like = NULL;
+	}
+
+	switch_thread_rwlock_rdlock(channel_index.rwlock);
+
+	if (!channel_index.running) {
+		switch_thread_rwlock_unlock(channel_index.rwlock);
+		return 0;
+	}
+
+	/* copy the matching rows so the stripes are not held while the callback runs */
+	for (i = 0; i < CHANNEL_INDEX_STRIPES; i++) {
+		stripe = &channel_index.stripe[i];
+		switch_mutex_lock(stripe->mutex);
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			row = (channel_index_row_t *) val;
+
+			/* the calls views need every row for the b legs, they are filtered after the join */
+			if (view == SCI_VIEW_CHANNELS && like && !ci_row_like(row, like)) {
+				continue;
+			}
+
+			if (view == SCI_VIEW_CHANNELS && (flags & SCIF_COUNT)) {
+				total++;
+				continue;
+			}
+
+			if (total == alloced) {
+				alloced = alloced ? alloced * 2 : 128;
+				switch_assert((all = realloc(all, alloced * sizeof(*all))));
+			}
+
+			all[total++] = ci_row_dup(row);
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	switch_thread_rwlock_unlock(channel_index.rwlock);
+
+	if (view != SCI_VIEW_CHANNELS && total) {
+		switch_core_hash_init(&lookup);
+		switch_zmalloc(rows, total * sizeof(*rows));
+
+		for (x = 0; x < total; x++) {
+			switch_core_hash_insert(lookup, all[x]->col[CI_UUID], all[x]);
+		}
+
+		/* a.uuid = c.caller_uuid or a.uuid not in (select callee_uuid from calls) */
+		for (x = 0; x < total; x++) {
+			row = all[x];
+
+			if (row->callee_uuid) {
+				row->b = switch_core_hash_find(lookup, row->callee_uuid);
+			}
+
+			if ((row->caller_uuid && !row->callee_uuid) || ((flags & SCIF_BRIDGED) && !row->b) || (like && !ci_row_like(row, like))) {
+				continue;
+			}
+
+			rows[matched++] = row;
+		}
+	} else {
+		rows = all;
+		matched = total;
+	}
+
+	if (flags & SCIF_COUNT) {
+		char count[32];
+
+		switch_snprintf(count, sizeof(count), "%u", matched);
+		argv[0] = count;
+		names[0] = "count";
+
+		if (callback) {
+			callback(pArg, 1, argv, names);
+		}
+
+		goto end;
+	}
+
+	if (!callback || !matched) {
+		goto end;
+	}
+
+	qsort(rows, matched, sizeof(*rows), (flags & SCIF_ORDER_BY_CALL) ? ci_row_call_cmp : ci_row_cmp);
+
+	switch (view) {
+	case SCI_VIEW_CHANNELS:
+		for (i = 0; i < CI_MAX; i++) {
+			names[argc++] = (char *) channel_index_names[i];
+		}
+		break;
+	case SCI_VIEW_BASIC_CALLS:
+		for (i = 0; i < (int) ci_map_len(basic_calls_a_cols); i++) {
+			names[argc++] = (char *) channel_index_names[basic_calls_a_cols[i]];
+		}
+		for (i = 0; i < (int) ci_map_len(basic_calls_b_cols); i++) {
+			names[argc++] = channel_index.b_names[basic_calls_b_cols[i]];
+		}
+		names[argc++] = "call_created_epoch";
+		break;
+	case SCI_VIEW_DETAILED_CALLS:
+		for (i = 0; i < DETAILED_CALLS_COLS; i++) {
+			names[argc++] = (char *) channel_index_names[i];
+		}
+		for (i = 0; i < DETAILED_CALLS_COLS; i++) {
+			names[argc++] = channel_index.b_names[i];
+		}
+		names[argc++] = "call_created_epoch";
+		break;
+	}
+
+	for (x = 0; x < matched; x++) {
+		channel_index_row_t *b;
+
+		row = rows[x];
+		b = row->b;
+		argc = 0;
+
+		switch (view) {
+		case SCI_VIEW_CHANNELS:
+			for (i = 0; i < CI_MAX; i++) {
+				argv[argc++] = row->col[i];
+			}
+			break;
+		case SCI_VIEW_BASIC_CALLS:
+			for (i = 0; i < (int) ci_map_len(basic_calls_a_cols); i++) {
+				argv[argc++] = row->col[basic_calls_a_cols[i]];
+			}
+			for (i = 0; i < (int) ci_map_len(basic_calls_b_cols); i++) {
+				argv[argc++] = b ? b->col[basic_calls_b_cols[i]] : NULL;
+			}
+			argv[argc++] = row->call_created_epoch;
+			break;
+		case SCI_VIEW_DETAILED_CALLS:
+			for (i = 0; i < DETAILED_CALLS_COLS; i++) {
+				argv[argc++] = row->col[i];
+			}
+			for (i = 0; i < DETAILED_CALLS_COLS; i++) {
+				argv[argc++] = b ? b->col[i] : NULL;
+			}
+			argv[argc++] = row->call_created_epoch;
+			break;
+		}
+
+		if (callback(pArg, argc, argv, names)) {
+			break;
+		}
+	}
+
+ end:
+
+	if (lookup) {
+		switch_core_hash_destroy(&lookup);
+	}
+
+	if (all) {
+		for (x = 0; x < total; x++) {
+			ci_row_free(all[x]);
+		}
+
+		if (rows != all) {
+			free(rows);
+		}
+
+		free(all);
+	}
+
+	return matched;
+}
+
+/* select * from channels, the columns are in the order of the index */
+static int ci_seed_channel_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	channel_index_row_t *row;
+	int i;
 
-	if (zstr(data)) {
-		return NULL;
+	if (argc < CI_MAX || zstr(argv[CI_UUID])) {
+		return 0;
 	}
 
-	data_copy = strdup(data);
+	switch_zmalloc(row, sizeof(*row));
 
-	col_count = switch_split(data_copy, ':', cols);
+	for (i = 0; i < CI_MAX; i++) {
+		ci_set(&row->col[i], argv[i]);
+	}
 
-	SWITCH_STANDARD_STREAM(stream);
+	row->created = (switch_time_t) atol(switch_str_nil(argv[CI_CREATED_EPOCH])) * 1000000;
+	ci_seed_row(row);
 
-	for (i = 0; i < col_count; i++) {
-		const char *val = NULL;
+	return 0;
+}
 
-		switch_snprintfv(col_name, sizeof(col_name), "PD-%q", cols[i]);
-		val = switch_event_get_header_nil(event, col_name);
-		if (zstr(val)) {
-			stream.write_function(&stream, "%q=NULL,", cols[i]);
-		} else {
-			stream.write_function(&stream, "%q='%q',", cols[i], val);
+/* select caller_uuid, callee_uuid, call_created_epoch from calls */
+static int ci_seed_call_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	if (argc == 3) {
+		ci_link(argv[0], argv[1], argv[2]);
+	}
+
+	return 0;
+}
+
+/*
+  Channels that are already up when the index is enabled at runtime never send it a CHANNEL_CREATE.
+  Their rows come from the tables core_event_handler kept so far, and whatever the sql queue has not
+  written yet is rebuilt from the session itself, the same way CHANNEL_CREATE and CS_ROUTING would.
+*/
+static void channel_index_seed(void)
+{
+	switch_console_callback_match_t *matches;
+	switch_console_callback_match_node_t *m;
+	switch_cache_db_handle_t *dbh = NULL;
+	channel_index_row_t *row;
+	switch_core_session_t *session;
+	switch_event_t *event;
+	char *sql;
+
+	if (!switch_core_session_count()) {
+		return;
+	}
+
+	if (switch_test_flag((&runtime), SCF_USE_SQL) && switch_core_db_handle(&dbh) == SWITCH_STATUS_SUCCESS) {
+		sql = switch_mprintf("select * from channels where hostname='%q'", switch_core_get_switchname());
+		switch_cache_db_execute_sql_callback(dbh, sql, ci_seed_channel_callback, NULL, NULL);
+		switch_safe_free(sql);
+
+		sql = switch_mprintf("select caller_uuid, callee_uuid, call_created_epoch from calls where hostname='%q'", switch_core_get_switchname());
+		switch_cache_db_execute_sql_callback(dbh, sql, ci_seed_call_callback, NULL, NULL);
+		switch_safe_free(sql);
+
+		switch_cache_db_release_db_handle(&dbh);
+	}
+
+	if (!(matches = switch_core_session_findall())) {
+		return;
+	}
+
+	for (m = matches->head; m; m = m->next) {
+		if (!(session = switch_core_session_locate(m->val))) {
+			continue;
+		}
+
+		if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_DATA) == SWITCH_STATUS_SUCCESS) {
+			switch_channel_event_set_data(switch_core_session_get_channel(session), event);
+			row = ci_row_new(m->val, event);
+			ci_row_apply(row, event, ci_routing_map, ci_map_len(ci_routing_map));
+			ci_row_apply(row, event, ci_codec_map, ci_map_len(ci_codec_map));
+			ci_row_apply(row, event, ci_originate_map, ci_map_len(ci_originate_map));
+			ci_seed_row(row);
+			switch_event_destroy(&event);
 		}
+
+		switch_core_session_rwunlock(session);
 	}
 
-	r = (char *) stream.data;
+	switch_console_free_matches(&matches);
+}
 
-	if (end_of(r) == ',') {
-		end_of(r) = '\0';
+static void channel_index_start(void)
+{
+	int i;
+
+	if (!runtime.channel_index || !channel_index.ctl_mutex) {
+		return;
 	}
 
-	switch_safe_free(data_copy);
+	switch_mutex_lock(channel_index.ctl_mutex);
 
-	return r;
+	if (channel_index.running) {
+		switch_mutex_unlock(channel_index.ctl_mutex);
+		return;
+	}
+
+	for (i = 0; i < CI_MAX; i++) {
+		switch_snprintf(channel_index.b_names[i], sizeof(channel_index.b_names[i]), "b_%s", channel_index_names[i]);
+	}
+
+	switch_thread_rwlock_wrlock(channel_index.rwlock);
+	for (i = 0; i < CHANNEL_INDEX_STRIPES; i++) {
+		if (!channel_index.stripe[i].mutex) {
+			switch_mutex_init(&channel_index.stripe[i].mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
+		}
+		switch_core_hash_init(&channel_index.stripe[i].hash);
+	}
+	channel_index.running = 1;
+	switch_thread_rwlock_unlock(channel_index.rwlock);
+
+	/* bind before seeding so nothing that happens to a channel in between is missed */
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_DESTROY, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_UUID, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_CREATE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_ANSWER, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_HOLD, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_UNHOLD, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_EXECUTE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_ORIGINATE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CALL_UPDATE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_CALLSTATE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_STATE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_BRIDGE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CHANNEL_UNBRIDGE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CALL_SECURE, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_CODEC, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+	switch_event_bind("core_channel_index", SWITCH_EVENT_SHUTDOWN, SWITCH_EVENT_SUBCLASS_ANY, channel_index_event_handler, NULL);
+
+	channel_index_seed();
+
+	/* only now core_event_handler may stop writing the tables */
+	channel_index.owns = 1;
+
+	switch_mutex_unlock(channel_index.ctl_mutex);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Channel index enabled%s\n",
+					  runtime.channel_index_sql ? ", channels and calls are still written to the core db" : "");
+}
+
+void switch_core_channel_index_stop(void)
+{
+	int i;
+
+	if (!channel_index.ctl_mutex) {
+		return;
+	}
+
+	switch_mutex_lock(channel_index.ctl_mutex);
+
+	if (!channel_index.running) {
+		switch_mutex_unlock(channel_index.ctl_mutex);
+		return;
+	}
+
+	if (channel_index.owns && !runtime.channel_index_sql && switch_core_session_count()) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Channel index disabled, the channels and calls tables only hold channels created from now on\n");
+	}
+
+	channel_index.owns = 0;
+
+	/* handlers still queued see running cleared and leave the stripes alone */
+	switch_thread_rwlock_wrlock(channel_index.rwlock);
+	channel_index.running = 0;
+	switch_thread_rwlock_unlock(channel_index.rwlock);
+
+	switch_event_unbind_callback(channel_index_event_handler);
+
+	/* wait for any handler or query that got in before running was cleared */
+	switch_thread_rwlock_wrlock(channel_index.rwlock);
+	ci_clear();
 
+	for (i = 0; i < CHANNEL_INDEX_STRIPES; i++) {
+		switch_core_hash_destroy(&channel_index.stripe[i].hash);
+	}
+	switch_thread_rwlock_unlock(channel_index.rwlock);
+
+	switch_mutex_unlock(channel_index.ctl_mutex);
 }
 
+SWITCH_DECLARE(void) switch_core_channel_index_enable(switch_bool_t enable)
+{
+	runtime.channel_index = enable ? 1 : 0;
+
+	if (runtime.channel_index) {
+		/* before the sql manager is up the setting is just picked up when it starts */
+		if (sql_manager.memory_pool) {
+			channel_index_start();
+		}
+	} else {
+		switch_core_channel_index_stop();
+	}
+}
 
 #define MAX_SQL 5
 #define new_sql()   switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql[sql_idx++]
@@ -2432,9 +4075,11 @@ static void core_event_handler(switch_event_t *event)
 {
 	char *sql[MAX_SQL] = { 0 };
 	int sql_idx = 0;
-	char *extra_cols;
+	char *extra_cols, *tmp;
 	int exists = 1;
 	char *uuid = NULL;
+	core_sql_args_t args = { { 0 } };
+	char epoch[32];
 
 	switch_assert(event);
 
@@ -2454,11 +4099,21 @@ static void core_event_handler(switch_event_t *event)
 	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
 	case SWITCH_EVENT_CALL_SECURE:
 		{
+			if (channel_index_owns_tables()) {
+				return;
+			}
+
 			if ((uuid = switch_event_get_header(event, "unique-id"))) {
 				exists = switch_ivr_uuid_exists(uuid);
 			}
 		}
 		break;
+	case SWITCH_EVENT_CHANNEL_DESTROY:
+	case SWITCH_EVENT_CODEC:
+		if (channel_index_owns_tables()) {
+			return;
+		}
+		break;
 	default:
 		break;
 	}
@@ -2509,99 +4164,93 @@ static void core_event_handler(switch_event_t *event)
 			const char *uuid = switch_event_get_header(event, "unique-id");
 
 			if (uuid) {
-				new_sql() = switch_mprintf("delete from channels where uuid='%q'",
-										   uuid);
+				sql_arg(&args, uuid);
+				new_sql() = sql_args_pack("delete from channels where uuid=?", &args);
 
-				new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
-										   uuid, uuid);
+				sql_arg(&args, uuid);
+				sql_arg(&args, uuid);
+				new_sql() = sql_args_pack("delete from calls where (caller_uuid=? or callee_uuid=?)", &args);
 
 			}
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_UUID:
 		{
-			new_sql() = switch_mprintf("update channels set uuid='%q' where uuid='%q'",
-									   switch_event_get_header_nil(event, "unique-id"),
-									   switch_event_get_header_nil(event, "old-unique-id")
-									   );
+			sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+			sql_arg(&args, switch_event_get_header_nil(event, "old-unique-id"));
+			new_sql() = sql_args_pack("update channels set uuid=? where uuid=?", &args);
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where call_uuid='%q'",
-									   switch_event_get_header_nil(event, "unique-id"),
-									   switch_event_get_header_nil(event, "old-unique-id")
-									   );
+			sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+			sql_arg(&args, switch_event_get_header_nil(event, "old-unique-id"));
+			new_sql() = sql_args_pack("update channels set call_uuid=? where call_uuid=?", &args);
 			break;
 		}
 	case SWITCH_EVENT_CHANNEL_CREATE:
-		new_sql() = switch_mprintf("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
-								   "values('%q','%q','%q','%ld','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q')",
-								   switch_event_get_header_nil(event, "unique-id"),
-								   switch_event_get_header_nil(event, "call-direction"),
-								   switch_event_get_header_nil(event, "event-date-local"),
-								   (long) switch_epoch_time_now(NULL),
-								   switch_event_get_header_nil(event, "channel-name"),
-								   switch_event_get_header_nil(event, "channel-state"),
-								   switch_event_get_header_nil(event, "channel-call-state"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context"), switch_core_get_switchname(),
-								   switch_event_get_header_nil(event, "caller-caller-id-name"),
-								   switch_event_get_header_nil(event, "caller-caller-id-number"),
-								   switch_event_get_header_nil(event, "caller-network-addr"),
-								   switch_event_get_header_nil(event, "caller-destination-number"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context")
-								   );
+		switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+		sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+		sql_arg(&args, switch_event_get_header_nil(event, "call-direction"));
+		sql_arg(&args, switch_event_get_header_nil(event, "event-date-local"));
+		sql_arg(&args, epoch);
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-name"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-state"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-call-state"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-dialplan"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-context"));
+		sql_arg(&args, switch_core_get_switchname());
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-name"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-number"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-network-addr"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-destination-number"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-dialplan"));
+		sql_arg(&args, switch_event_get_header_nil(event, "caller-context"));
+		new_sql() = sql_args_pack("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
+								  "values(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", &args);
 		break;
 	case SWITCH_EVENT_CHANNEL_ANSWER:
 	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
 	case SWITCH_EVENT_CODEC:
-		new_sql() =
-			switch_mprintf
-			("update channels set read_codec='%q',read_rate='%q',read_bit_rate='%q',write_codec='%q',write_rate='%q',write_bit_rate='%q' where uuid='%q'",
-			 switch_event_get_header_nil(event, "channel-read-codec-name"),
-			 switch_event_get_header_nil(event, "channel-read-codec-rate"),
-			 switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
-			 switch_event_get_header_nil(event, "channel-write-codec-name"),
-			 switch_event_get_header_nil(event, "channel-write-codec-rate"),
-			 switch_event_get_header_nil(event, "channel-write-codec-bit-rate"),
-			 switch_event_get_header_nil(event, "unique-id"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-read-codec-name"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-read-codec-rate"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-read-codec-bit-rate"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-write-codec-name"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-write-codec-rate"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-write-codec-bit-rate"));
+		sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+		new_sql() = sql_args_pack("update channels set read_codec=?,read_rate=?,read_bit_rate=?,write_codec=?,write_rate=?,write_bit_rate=? where uuid=?",
+								  &args);
 		break;
 	case SWITCH_EVENT_CHANNEL_HOLD:
 	case SWITCH_EVENT_CHANNEL_UNHOLD:
 	case SWITCH_EVENT_CHANNEL_EXECUTE: {
 
-		new_sql() = switch_mprintf("update channels set application='%q',application_data='%q',"
-								   "presence_id='%q',presence_data='%q',accountcode='%q' where uuid='%q'",
-								   switch_event_get_header_nil(event, "application"),
-								   switch_event_get_header_nil(event, "application-data"),
-								   switch_event_get_header_nil(event, "channel-presence-id"),
-								   switch_event_get_header_nil(event, "channel-presence-data"),
-								   switch_event_get_header_nil(event, "variable_accountcode"),
-								   switch_event_get_header_nil(event, "unique-id")
-								   );
+		sql_arg(&args, switch_event_get_header_nil(event, "application"));
+		sql_arg(&args, switch_event_get_header_nil(event, "application-data"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-id"));
+		sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-data"));
+		sql_arg(&args, switch_event_get_header_nil(event, "variable_accountcode"));
+		sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+		new_sql() = sql_args_pack("update channels set application=?,application_data=?,"
+								  "presence_id=?,presence_data=?,accountcode=? where uuid=?", &args);
 
 	}
 		break;
 
 	case SWITCH_EVENT_CHANNEL_ORIGINATE:
 		{
-			if ((extra_cols = parse_presence_data_cols(event))) {
-				new_sql() = switch_mprintf("update channels set "
-										   "presence_id='%q',presence_data='%q',accountcode='%q',call_uuid='%q',%s where uuid='%q'",
-										   switch_event_get_header_nil(event, "channel-presence-id"),
-										   switch_event_get_header_nil(event, "channel-presence-data"),
-										   switch_event_get_header_nil(event, "variable_accountcode"),
-										   switch_event_get_header_nil(event, "channel-call-uuid"),
-										   extra_cols,
-										   switch_event_get_header_nil(event, "unique-id"));
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-id"));
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-data"));
+			sql_arg(&args, switch_event_get_header_nil(event, "variable_accountcode"));
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-call-uuid"));
+
+			if ((extra_cols = parse_presence_data_cols(event, &args))) {
+				sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+				tmp = switch_mprintf("update channels set presence_id=?,presence_data=?,accountcode=?,call_uuid=?,%s where uuid=?", extra_cols);
+				new_sql() = sql_args_pack(tmp, &args);
+				free(tmp);
 				free(extra_cols);
 			} else {
-				new_sql() = switch_mprintf("update channels set "
-										   "presence_id='%q',presence_data='%q',accountcode='%q',call_uuid='%q' where uuid='%q'",
-										   switch_event_get_header_nil(event, "channel-presence-id"),
-										   switch_event_get_header_nil(event, "channel-presence-data"),
-										   switch_event_get_header_nil(event, "variable_accountcode"),
-										   switch_event_get_header_nil(event, "channel-call-uuid"),
-										   switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+				new_sql() = sql_args_pack("update channels set presence_id=?,presence_data=?,accountcode=?,call_uuid=? where uuid=?", &args);
 			}
 
 		}
@@ -2609,17 +4258,16 @@ static void core_event_handler(switch_event_t *event)
 		break;
 	case SWITCH_EVENT_CALL_UPDATE:
 		{
-			new_sql() = switch_mprintf("update channels set callee_name='%q',callee_num='%q',sent_callee_name='%q',sent_callee_num='%q',callee_direction='%q',"
-									   "cid_name='%q',cid_num='%q' where uuid='%q'",
-									   switch_event_get_header_nil(event, "caller-callee-id-name"),
-									   switch_event_get_header_nil(event, "caller-callee-id-number"),
-									   switch_event_get_header_nil(event, "sent-callee-id-name"),
-									   switch_event_get_header_nil(event, "sent-callee-id-number"),
-									   switch_event_get_header_nil(event, "direction"),
-									   switch_event_get_header_nil(event, "caller-caller-id-name"),
-									   switch_event_get_header_nil(event, "caller-caller-id-number"),
-									   switch_event_get_header_nil(event, "unique-id")
-									   );
+			sql_arg(&args, switch_event_get_header_nil(event, "caller-callee-id-name"));
+			sql_arg(&args, switch_event_get_header_nil(event, "caller-callee-id-number"));
+			sql_arg(&args, switch_event_get_header_nil(event, "sent-callee-id-name"));
+			sql_arg(&args, switch_event_get_header_nil(event, "sent-callee-id-number"));
+			sql_arg(&args, switch_event_get_header_nil(event, "direction"));
+			sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-name"));
+			sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-number"));
+			sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+			new_sql() = sql_args_pack("update channels set callee_name=?,callee_num=?,sent_callee_name=?,sent_callee_num=?,callee_direction=?,"
+									  "cid_name=?,cid_num=? where uuid=?", &args);
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_CALLSTATE:
@@ -2632,16 +4280,17 @@ static void core_event_handler(switch_event_t *event)
 			}
 
 			if (callstate != CCS_DOWN && callstate != CCS_HANGUP) {
-				if ((extra_cols = parse_presence_data_cols(event))) {
-					new_sql() = switch_mprintf("update channels set callstate='%q',%s where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-call-state"),
-											   extra_cols,
-											   switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-call-state"));
+
+				if ((extra_cols = parse_presence_data_cols(event, &args))) {
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					tmp = switch_mprintf("update channels set callstate=?,%s where uuid=?", extra_cols);
+					new_sql() = sql_args_pack(tmp, &args);
+					free(tmp);
 					free(extra_cols);
 				} else {
-					new_sql() = switch_mprintf("update channels set callstate='%q' where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-call-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					new_sql() = sql_args_pack("update channels set callstate=? where uuid=?", &args);
 				}
 			}
 
@@ -2667,74 +4316,63 @@ static void core_event_handler(switch_event_t *event)
 				break;
 #ifdef SWITCH_DEPRECATED_CORE_DB
 			case CS_HANGUP: /* marked for deprication */
-				new_sql_a() = switch_mprintf("update channels set state='%q' where uuid='%q'",
-											 switch_event_get_header_nil(event, "channel-state"),
-											 switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-state"));
+				sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+				new_sql_a() = sql_args_pack("update channels set state=? where uuid=?", &args);
 				break;
 #endif
 			case CS_EXECUTE:
-				if ((extra_cols = parse_presence_data_cols(event))) {
-					new_sql() = switch_mprintf("update channels set state='%q',%s where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   extra_cols,
-											   switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-state"));
+
+				if ((extra_cols = parse_presence_data_cols(event, &args))) {
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					tmp = switch_mprintf("update channels set state=?,%s where uuid=?", extra_cols);
+					new_sql() = sql_args_pack(tmp, &args);
+					free(tmp);
 					free(extra_cols);
 
 				} else {
-					new_sql() = switch_mprintf("update channels set state='%q' where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					new_sql() = sql_args_pack("update channels set state=? where uuid=?", &args);
 				}
 				break;
 			case CS_ROUTING:
-				if ((extra_cols = parse_presence_data_cols(event))) {
-					new_sql() = switch_mprintf("update channels set state='%q',cid_name='%q',cid_num='%q',callee_name='%q',callee_num='%q',"
-											   "sent_callee_name='%q',sent_callee_num='%q',"
-											   "ip_addr='%q',dest='%q',dialplan='%q',context='%q',presence_id='%q',presence_data='%q',accountcode='%q',%s "
-											   "where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "caller-caller-id-name"),
-											   switch_event_get_header_nil(event, "caller-caller-id-number"),
-											   switch_event_get_header_nil(event, "caller-callee-id-name"),
-											   switch_event_get_header_nil(event, "caller-callee-id-number"),
-											   switch_event_get_header_nil(event, "sent-callee-id-name"),
-											   switch_event_get_header_nil(event, "sent-callee-id-number"),
-											   switch_event_get_header_nil(event, "caller-network-addr"),
-											   switch_event_get_header_nil(event, "caller-destination-number"),
-											   switch_event_get_header_nil(event, "caller-dialplan"),
-											   switch_event_get_header_nil(event, "caller-context"),
-											   switch_event_get_header_nil(event, "channel-presence-id"),
-											   switch_event_get_header_nil(event, "channel-presence-data"),
-											   switch_event_get_header_nil(event, "variable_accountcode"),
-											   extra_cols,
-											   switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-state"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-name"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-caller-id-number"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-callee-id-name"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-callee-id-number"));
+				sql_arg(&args, switch_event_get_header_nil(event, "sent-callee-id-name"));
+				sql_arg(&args, switch_event_get_header_nil(event, "sent-callee-id-number"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-network-addr"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-destination-number"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-dialplan"));
+				sql_arg(&args, switch_event_get_header_nil(event, "caller-context"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-presence-data"));
+				sql_arg(&args, switch_event_get_header_nil(event, "variable_accountcode"));
+
+				if ((extra_cols = parse_presence_data_cols(event, &args))) {
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					tmp = switch_mprintf("update channels set state=?,cid_name=?,cid_num=?,callee_name=?,callee_num=?,"
+										 "sent_callee_name=?,sent_callee_num=?,"
+										 "ip_addr=?,dest=?,dialplan=?,context=?,presence_id=?,presence_data=?,accountcode=?,%s "
+										 "where uuid=?", extra_cols);
+					new_sql() = sql_args_pack(tmp, &args);
+					free(tmp);
 					free(extra_cols);
 				} else {
-					new_sql() = switch_mprintf("update channels set state='%q',cid_name='%q',cid_num='%q',callee_name='%q',callee_num='%q',"
-											   "sent_callee_name='%q',sent_callee_num='%q',"
-											   "ip_addr='%q',dest='%q',dialplan='%q',context='%q',presence_id='%q',presence_data='%q',accountcode='%q' "
-											   "where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "caller-caller-id-name"),
-											   switch_event_get_header_nil(event, "caller-caller-id-number"),
-											   switch_event_get_header_nil(event, "caller-callee-id-name"),
-											   switch_event_get_header_nil(event, "caller-callee-id-number"),
-											   switch_event_get_header_nil(event, "sent-callee-id-name"),
-											   switch_event_get_header_nil(event, "sent-callee-id-number"),
-											   switch_event_get_header_nil(event, "caller-network-addr"),
-											   switch_event_get_header_nil(event, "caller-destination-number"),
-											   switch_event_get_header_nil(event, "caller-dialplan"),
-											   switch_event_get_header_nil(event, "caller-context"),
-											   switch_event_get_header_nil(event, "channel-presence-id"),
-											   switch_event_get_header_nil(event, "channel-presence-data"),
-											   switch_event_get_header_nil(event, "variable_accountcode"),
-											   switch_event_get_header_nil(event, "unique-id"));
+					sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+					new_sql() = sql_args_pack("update channels set state=?,cid_name=?,cid_num=?,callee_name=?,callee_num=?,"
+											  "sent_callee_name=?,sent_callee_num=?,"
+											  "ip_addr=?,dest=?,dialplan=?,context=?,presence_id=?,presence_data=?,accountcode=? "
+											  "where uuid=?", &args);
 				}
 				break;
 			default:
-				new_sql() = switch_mprintf("update channels set state='%q' where uuid='%q'",
-										   switch_event_get_header_nil(event, "channel-state"),
-										   switch_event_get_header_nil(event, "unique-id"));
+				sql_arg(&args, switch_event_get_header_nil(event, "channel-state"));
+				sql_arg(&args, switch_event_get_header_nil(event, "unique-id"));
+				new_sql() = sql_args_pack("update channels set state=? where uuid=?", &args);
 				break;
 			}
 
@@ -2755,25 +4393,30 @@ static void core_event_handler(switch_event_t *event)
 				b_uuid = switch_event_get_header_nil(event, "other-leg-unique-id");
 			}
 
-			if (uuid && (extra_cols = parse_presence_data_cols(event))) {
-				new_sql() = switch_mprintf("update channels set %s where uuid='%q'", extra_cols, uuid);
+			if (uuid && (extra_cols = parse_presence_data_cols(event, &args))) {
+				sql_arg(&args, uuid);
+				tmp = switch_mprintf("update channels set %s where uuid=?", extra_cols);
+				new_sql() = sql_args_pack(tmp, &args);
+				free(tmp);
 				switch_safe_free(extra_cols);
 			}
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where uuid='%q' or uuid='%q'",
-									   switch_event_get_header_nil(event, "channel-call-uuid"), a_uuid, b_uuid);
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-call-uuid"));
+			sql_arg(&args, a_uuid);
+			sql_arg(&args, b_uuid);
+			new_sql() = sql_args_pack("update channels set call_uuid=? where uuid=? or uuid=?", &args);
 
 
-			new_sql() = switch_mprintf("insert into calls (call_uuid,call_created,call_created_epoch,"
-									   "caller_uuid,callee_uuid,hostname) "
-									   "values ('%q','%q','%ld','%q','%q','%q')",
-									   switch_event_get_header_nil(event, "channel-call-uuid"),
-									   switch_event_get_header_nil(event, "event-date-local"),
-									   (long) switch_epoch_time_now(NULL),
-									   a_uuid,
-									   b_uuid,
-									   switch_core_get_switchname()
-									   );
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-call-uuid"));
+			sql_arg(&args, switch_event_get_header_nil(event, "event-date-local"));
+			sql_arg(&args, epoch);
+			sql_arg(&args, a_uuid);
+			sql_arg(&args, b_uuid);
+			sql_arg(&args, switch_core_get_switchname());
+			new_sql() = sql_args_pack("insert into calls (call_uuid,call_created,call_created_epoch,"
+									  "caller_uuid,callee_uuid,hostname) "
+									  "values (?,?,?,?,?,?)", &args);
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
@@ -2781,16 +4424,20 @@ static void core_event_handler(switch_event_t *event)
 			char *cuuid = switch_event_get_header_nil(event, "caller-unique-id");
 			char *uuid = switch_event_get_header(event, "unique-id");
 
-			if (uuid && (extra_cols = parse_presence_data_cols(event))) {
-				new_sql() = switch_mprintf("update channels set %s where uuid='%q'", extra_cols, uuid);
+			if (uuid && (extra_cols = parse_presence_data_cols(event, &args))) {
+				sql_arg(&args, uuid);
+				tmp = switch_mprintf("update channels set %s where uuid=?", extra_cols);
+				new_sql() = sql_args_pack(tmp, &args);
+				free(tmp);
 				switch_safe_free(extra_cols);
 			}
 
-			new_sql() = switch_mprintf("update channels set call_uuid=uuid where call_uuid='%q'",
-									   switch_event_get_header_nil(event, "channel-call-uuid"));
+			sql_arg(&args, switch_event_get_header_nil(event, "channel-call-uuid"));
+			new_sql() = sql_args_pack("update channels set call_uuid=uuid where call_uuid=?", &args);
 
-			new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
-									   cuuid, cuuid);
+			sql_arg(&args, cuuid);
+			sql_arg(&args, cuuid);
+			new_sql() = sql_args_pack("delete from calls where (caller_uuid=? or callee_uuid=?)", &args);
 			break;
 		}
 	case SWITCH_EVENT_SHUTDOWN:
@@ -2837,9 +4484,9 @@ static void core_event_handler(switch_event_t *event)
 			if (zstr(type)) {
 				break;
 			}
-			new_sql() = switch_mprintf("update channels set secure='%q' where uuid='%q'",
-									   type, switch_event_get_header_nil(event, "caller-unique-id")
-									   );
+			sql_arg(&args, type);
+			sql_arg(&args, switch_event_get_header_nil(event, "caller-unique-id"));
+			new_sql() = sql_args_pack("update channels set secure=? where uuid=?", &args);
 			break;
 		}
 	case SWITCH_EVENT_NAT:
@@ -3628,6 +5275,13 @@ switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_
 	switch_mutex_init(&sql_manager.io_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
 	switch_mutex_init(&sql_manager.ctl_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
 
+	if (!channel_index.ctl_mutex) {
+		switch_mutex_init(&channel_index.ctl_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
+		switch_thread_rwlock_create(&channel_index.rwlock, sql_manager.memory_pool);
+	}
+
+	channel_index_start();
+
 	if (!sql_manager.manage) goto skip;
 
  top:
@@ -3976,6 +5630,7 @@ void switch_core_sqldb_stop(void)
 	switch_status_t st;
 
 	switch_event_unbind_callback(core_event_handler);
+	switch_core_channel_index_stop();
 
 	if (sql_manager.db_thread && sql_manager.db_thread_running) {
 		sql_manager.db_thread_running = -1;
@@ -4048,13 +5703,14 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 		}
 
 		stream->write_function(stream, "%s\n\tType: %s\n\tLast used: %d\n\tTotal used: %ld\n\tFlags: %s, %s(%d)%s\n"
-							   "\tCreator: %s\n\tLast User: %s\n",
+							   "\tCreator: %s\n\tLast User: %s\n\tPrepared: %u cached, %" SWITCH_UINT64_T_FMT " hits, %" SWITCH_UINT64_T_FMT " misses\n",
 							   cleankey_str,
 							   switch_cache_db_type_name(dbh->type),
 							   diff,
 							   dbh->total_used_count,
 							   locked ? "Locked" : "Unlocked",
-							   dbh->use_count ? "Attached" : "Detached", dbh->use_count, switch_test_flag(dbh, CDF_NONEXPIRING) ? ", Non-expiring" : "", dbh->creator, dbh->last_user);
+							   dbh->use_count ? "Attached" : "Detached", dbh->use_count, switch_test_flag(dbh, CDF_NONEXPIRING) ? ", Non-expiring" : "", dbh->creator, dbh->last_user,
+							   dbh->stmt_count, dbh->stmt_hits, dbh->stmt_misses);
 	}
 
 	stream->write_function(stream, "%d total. %d in use.\n", count, used);
@@ -316,6 +316,441 @@ SWITCH_DECLARE(void) switch_img_free(switch_image_t **img)
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #endif
 
+/* Row kernels behind switch_img_patch, switch_img_overlay, switch_img_fill_noalpha and switch_img_chromakey.
+   The vector versions give the same bytes as the scalar ones, only faster. */
+
+static inline uint8_t img_blend_px(uint8_t d, uint8_t s, uint8_t a)
+{
+	if (a == 255) return s;
+	if (a == 0) return d;
+
+	return ((d * (255 - a)) >> 8) + ((s * a) >> 8);
+}
+
+static void img_blend_argb_y_scalar(uint8_t *dst, const uint8_t *argb, int w)
+{
+	const switch_rgb_color_t *rgb = (const switch_rgb_color_t *)argb;
+	int i;
+
+	for (i = 0; i < w; i++, rgb++) {
+		uint8_t y = ((66 * rgb->r + 129 * rgb->g + 25 * rgb->b + 128) >> 8) + 16;
+
+		dst[i] = img_blend_px(dst[i], y, rgb->a);
+	}
+}
+
+/* argb starts on a pixel at an even column, every other pixel of the w is sampled */
+static void img_blend_argb_uv_scalar(uint8_t *u, uint8_t *v, const uint8_t *argb, int w)
+{
+	const switch_rgb_color_t *rgb = (const switch_rgb_color_t *)argb;
+	int i;
+
+	for (i = 0; i * 2 < w; i++, rgb += 2) {
+		uint8_t su = ((-38 * rgb->r - 74 * rgb->g + 112 * rgb->b + 128) >> 8) + 128;
+		uint8_t sv = ((112 * rgb->r - 94 * rgb->g - 18 * rgb->b + 128) >> 8) + 128;
+
+		u[i] = img_blend_px(u[i], su, rgb->a);
+		v[i] = img_blend_px(v[i], sv, rgb->a);
+	}
+}
+
+static void img_blend_plane_scalar(uint8_t *dst, const uint8_t *src, uint8_t alpha, int w)
+{
+	int i;
+
+	for (i = 0; i < w; i++) {
+		dst[i] = ((dst[i] * (255 - alpha)) >> 8) + ((src[i] * alpha) >> 8);
+	}
+}
+
+static void img_fill_noalpha_scalar(uint32_t *px, uint32_t color, int w)
+{
+	int i;
+
+	for (i = 0; i < w; i++) {
+		if (!((switch_rgb_color_t *)&px[i])->a) {
+			px[i] = color;
+		}
+	}
+}
+
+static void img_chromakey_scalar(uint32_t *px, const switch_rgb_color_t *mask, int w)
+{
+	int i, threshold = 0;
+
+	for (i = 0; i < w; i++) {
+		switch_rgb_color_t *pixel = (switch_rgb_color_t *)&px[i];
+
+		/* runs of one color are the usual case, only work out the distance when it changes */
+		if (!i || (px[i] & 0xFFFFFF) != (px[i - 1] & 0xFFFFFF)) {
+			threshold = switch_color_distance(pixel, (switch_rgb_color_t *)mask);
+		}
+
+		if (threshold) {
+			pixel->a = 0;
+		}
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(SWITCH_DISABLE_SIMD)
+#define SWITCH_IMG_SIMD 1
+#include <immintrin.h>
+
+/* one 8 bit channel of 8 packed pixels (b, g, r, a from the low byte up) widened to 16 bits */
+__attribute__((target("sse4.1")))
+static inline __m128i img_argb_chan_sse41(__m128i p0, __m128i p1, int shift)
+{
+	__m128i m = _mm_set1_epi32(0xFF);
+
+	return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, shift), m), _mm_and_si128(_mm_srli_epi32(p1, shift), m));
+}
+
+/* the even pixels of p0 and p1 in order */
+__attribute__((target("sse4.1")))
+static inline __m128i img_argb_even_sse41(__m128i p0, __m128i p1)
+{
+	return _mm_unpacklo_epi64(_mm_shuffle_epi32(p0, 0x88), _mm_shuffle_epi32(p1, 0x88));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i img_blend_sse41(__m128i d, __m128i s, __m128i a)
+{
+	__m128i ff = _mm_set1_epi16(255);
+	__m128i r = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(ff, a)), 8), _mm_srli_epi16(_mm_mullo_epi16(s, a), 8));
+
+	r = _mm_blendv_epi8(r, s, _mm_cmpeq_epi16(a, ff));
+	return _mm_blendv_epi8(r, d, _mm_cmpeq_epi16(a, _mm_setzero_si128()));
+}
+
+/* the products fit 16 bits unsigned for y and signed for u and v, so no widening is needed */
+__attribute__((target("sse4.1")))
+static inline __m128i img_rgb2y_sse41(__m128i r, __m128i g, __m128i b)
+{
+	__m128i y = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+							  _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+
+	return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i img_rgb2yuv_sse41(__m128i r, __m128i g, __m128i b, short kr, short kg, short kb)
+{
+	__m128i c = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(kr)), _mm_mullo_epi16(g, _mm_set1_epi16(kg))),
+							  _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(kb)), _mm_set1_epi16(128)));
+
+	return _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+}
+
+__attribute__((target("sse4.1")))
+static void img_blend_argb_y_sse41(uint8_t *dst, const uint8_t *argb, int w)
+{
+	int i = 0;
+
+	for (; i + 8 <= w; i += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i *)(argb + i * 4));
+		__m128i p1 = _mm_loadu_si128((const __m128i *)(argb + i * 4 + 16));
+		__m128i y = img_rgb2y_sse41(img_argb_chan_sse41(p0, p1, 16), img_argb_chan_sse41(p0, p1, 8), img_argb_chan_sse41(p0, p1, 0));
+		__m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(dst + i)));
+
+		y = img_blend_sse41(d, y, img_argb_chan_sse41(p0, p1, 24));
+		_mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(y, y));
+	}
+
+	img_blend_argb_y_scalar(dst + i, argb + i * 4, w - i);
+}
+
+__attribute__((target("sse4.1")))
+static void img_blend_argb_uv_sse41(uint8_t *u, uint8_t *v, const uint8_t *argb, int w)
+{
+	int i = 0;
+
+	for (; i * 2 + 16 <= w; i += 8) {
+		const uint8_t *p = argb + i * 8;
+		__m128i e0 = img_argb_even_sse41(_mm_loadu_si128((const __m128i *)p), _mm_loadu_si128((const __m128i *)(p + 16)));
+		__m128i e1 = img_argb_even_sse41(_mm_loadu_si128((const __m128i *)(p + 32)), _mm_loadu_si128((const __m128i *)(p + 48)));
+		__m128i r = img_argb_chan_sse41(e0, e1, 16), g = img_argb_chan_sse41(e0, e1, 8), b = img_argb_chan_sse41(e0, e1, 0);
+		__m128i a = img_argb_chan_sse41(e0, e1, 24);
+		__m128i su = img_rgb2yuv_sse41(r, g, b, -38, -74, 112);
+		__m128i sv = img_rgb2yuv_sse41(r, g, b, 112, -94, -18);
+
+		su = img_blend_sse41(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + i))), su, a);
+		sv = img_blend_sse41(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + i))), sv, a);
+		_mm_storel_epi64((__m128i *)(u + i), _mm_packus_epi16(su, su));
+		_mm_storel_epi64((__m128i *)(v + i), _mm_packus_epi16(sv, sv));
+	}
+
+	img_blend_argb_uv_scalar(u + i, v + i, argb + i * 8, w - i * 2);
+}
+
+__attribute__((target("sse4.1")))
+static void img_blend_plane_sse41(uint8_t *dst, const uint8_t *src, uint8_t alpha, int w)
+{
+	__m128i a = _mm_set1_epi16(alpha), na = _mm_set1_epi16(255 - alpha);
+	int i = 0;
+
+	for (; i + 8 <= w; i += 8) {
+		__m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(dst + i)));
+		__m128i s = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(src + i)));
+
+		d = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(d, na), 8), _mm_srli_epi16(_mm_mullo_epi16(s, a), 8));
+		_mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(d, d));
+	}
+
+	img_blend_plane_scalar(dst + i, src + i, alpha, w - i);
+}
+
+__attribute__((target("sse4.1")))
+static void img_fill_noalpha_sse41(uint32_t *px, uint32_t color, int w)
+{
+	__m128i c = _mm_set1_epi32(color), am = _mm_set1_epi32((int)0xFF000000), z = _mm_setzero_si128();
+	int i = 0;
+
+	for (; i + 4 <= w; i += 4) {
+		__m128i p = _mm_loadu_si128((const __m128i *)(px + i));
+
+		_mm_storeu_si128((__m128i *)(px + i), _mm_blendv_epi8(p, c, _mm_cmpeq_epi32(_mm_and_si128(p, am), z)));
+	}
+
+	img_fill_noalpha_scalar(px + i, color, w - i);
+}
+
+/* switch_color_distance() is non zero exactly when
+   100 * (2 dr2^2 + 4 dg2^2 + 3 db2^2) + 2 dr^2 + 4 dg^2 + 3 db^2 >= 900 (d?2 being the difference of the halved channels),
+   the sum is built from pairs of 16 bit products with madd */
+__attribute__((target("sse4.1")))
+static void img_chromakey_sse41(uint32_t *px, const switch_rgb_color_t *mask, int w)
+{
+	__m128i mr = _mm_set1_epi16(mask->r), mg = _mm_set1_epi16(mask->g), mb = _mm_set1_epi16(mask->b);
+	__m128i mr2 = _mm_set1_epi16(mask->r / 2), mg2 = _mm_set1_epi16(mask->g / 2), mb2 = _mm_set1_epi16(mask->b / 2);
+	__m128i limit = _mm_set1_epi32(899), am = _mm_set1_epi32((int)0xFF000000);
+	int i = 0;
+
+	for (; i + 8 <= w; i += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i *)(px + i));
+		__m128i p1 = _mm_loadu_si128((const __m128i *)(px + i + 4));
+		__m128i r = img_argb_chan_sse41(p0, p1, 16), g = img_argb_chan_sse41(p0, p1, 8), b = img_argb_chan_sse41(p0, p1, 0);
+		__m128i dr = _mm_sub_epi16(r, mr), dg = _mm_sub_epi16(g, mg), db = _mm_sub_epi16(b, mb);
+		__m128i dr2 = _mm_sub_epi16(_mm_srli_epi16(r, 1), mr2);
+		__m128i dg2 = _mm_mullo_epi16(_mm_sub_epi16(_mm_srli_epi16(g, 1), mg2), _mm_set1_epi16(20));
+		__m128i db2 = _mm_sub_epi16(_mm_srli_epi16(b, 1), mb2);
+		__m128i a0 = _mm_unpacklo_epi16(dr, dg), b0 = _mm_unpacklo_epi16(_mm_slli_epi16(dr, 1), _mm_slli_epi16(dg, 2));
+		__m128i a1 = _mm_unpacklo_epi16(db, _mm_mullo_epi16(dr2, _mm_set1_epi16(10)));
+		__m128i b1 = _mm_unpacklo_epi16(_mm_mullo_epi16(db, _mm_set1_epi16(3)), _mm_mullo_epi16(dr2, _mm_set1_epi16(20)));
+		__m128i a2 = _mm_unpacklo_epi16(dg2, _mm_mullo_epi16(db2, _mm_set1_epi16(10)));
+		__m128i b2 = _mm_unpacklo_epi16(dg2, _mm_mullo_epi16(db2, _mm_set1_epi16(30)));
+		__m128i lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(a0, b0), _mm_madd_epi16(a1, b1)), _mm_madd_epi16(a2, b2));
+
+		a0 = _mm_unpackhi_epi16(dr, dg);
+		b0 = _mm_unpackhi_epi16(_mm_slli_epi16(dr, 1), _mm_slli_epi16(dg, 2));
+		a1 = _mm_unpackhi_epi16(db, _mm_mullo_epi16(dr2, _mm_set1_epi16(10)));
+		b1 = _mm_unpackhi_epi16(_mm_mullo_epi16(db, _mm_set1_epi16(3)), _mm_mullo_epi16(dr2, _mm_set1_epi16(20)));
+		a2 = _mm_unpackhi_epi16(dg2, _mm_mullo_epi16(db2, _mm_set1_epi16(10)));
+		b2 = _mm_unpackhi_epi16(dg2, _mm_mullo_epi16(db2, _mm_set1_epi16(30)));
+
+		p0 = _mm_andnot_si128(_mm_and_si128(_mm_cmpgt_epi32(lo, limit), am), p0);
+		p1 = _mm_andnot_si128(_mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(a0, b0), _mm_madd_epi16(a1, b1)), _mm_madd_epi16(a2, b2)), limit), am), p1);
+
+		_mm_storeu_si128((__m128i *)(px + i), p0);
+		_mm_storeu_si128((__m128i *)(px + i + 4), p1);
+	}
+
+	img_chromakey_scalar(px + i, mask, w - i);
+}
+
+/* packs works per 128 bit lane so the 16 bit channel is put back in pixel order with a permute */
+__attribute__((target("avx2")))
+static inline __m256i img_argb_chan_avx2(__m256i p0, __m256i p1, int shift)
+{
+	__m256i m = _mm256_set1_epi32(0xFF);
+
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, shift), m),
+													   _mm256_and_si256(_mm256_srli_epi32(p1, shift), m)), 0xD8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i img_argb_even_avx2(__m256i p0, __m256i p1)
+{
+	return _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(_mm256_shuffle_epi32(p0, 0x88), _mm256_shuffle_epi32(p1, 0x88)), 0xD8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i img_blend_avx2(__m256i d, __m256i s, __m256i a)
+{
+	__m256i ff = _mm256_set1_epi16(255);
+	__m256i r = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(ff, a)), 8),
+								 _mm256_srli_epi16(_mm256_mullo_epi16(s, a), 8));
+
+	r = _mm256_blendv_epi8(r, s, _mm256_cmpeq_epi16(a, ff));
+	return _mm256_blendv_epi8(r, d, _mm256_cmpeq_epi16(a, _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i img_rgb2yuv_avx2(__m256i r, __m256i g, __m256i b, short kr, short kg, short kb)
+{
+	__m256i c = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(kr)), _mm256_mullo_epi16(g, _mm256_set1_epi16(kg))),
+								 _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(kb)), _mm256_set1_epi16(128)));
+
+	return _mm256_add_epi16(_mm256_srai_epi16(c, 8), _mm256_set1_epi16(128));
+}
+
+__attribute__((target("avx2")))
+static inline void img_store_avx2(uint8_t *dst, __m256i v)
+{
+	_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("avx2")))
+static void img_blend_argb_y_avx2(uint8_t *dst, const uint8_t *argb, int w)
+{
+	int i = 0;
+
+	for (; i + 16 <= w; i += 16) {
+		__m256i p0 = _mm256_loadu_si256((const __m256i *)(argb + i * 4));
+		__m256i p1 = _mm256_loadu_si256((const __m256i *)(argb + i * 4 + 32));
+		__m256i r = img_argb_chan_avx2(p0, p1, 16), g = img_argb_chan_avx2(p0, p1, 8), b = img_argb_chan_avx2(p0, p1, 0);
+		__m256i y = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)), _mm256_mullo_epi16(g, _mm256_set1_epi16(129))),
+									 _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(25)), _mm256_set1_epi16(128)));
+
+		y = _mm256_add_epi16(_mm256_srli_epi16(y, 8), _mm256_set1_epi16(16));
+		y = img_blend_avx2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(dst + i))), y, img_argb_chan_avx2(p0, p1, 24));
+		img_store_avx2(dst + i, y);
+	}
+
+	img_blend_argb_y_scalar(dst + i, argb + i * 4, w - i);
+}
+
+__attribute__((target("avx2")))
+static void img_blend_argb_uv_avx2(uint8_t *u, uint8_t *v, const uint8_t *argb, int w)
+{
+	int i = 0;
+
+	for (; i * 2 + 32 <= w; i += 16) {
+		const uint8_t *p = argb + i * 8;
+		__m256i e0 = img_argb_even_avx2(_mm256_loadu_si256((const __m256i *)p), _mm256_loadu_si256((const __m256i *)(p + 32)));
+		__m256i e1 = img_argb_even_avx2(_mm256_loadu_si256((const __m256i *)(p + 64)), _mm256_loadu_si256((const __m256i *)(p + 96)));
+		__m256i r = img_argb_chan_avx2(e0, e1, 16), g = img_argb_chan_avx2(e0, e1, 8), b = img_argb_chan_avx2(e0, e1, 0);
+		__m256i a = img_argb_chan_avx2(e0, e1, 24);
+		__m256i su = img_rgb2yuv_avx2(r, g, b, -38, -74, 112);
+		__m256i sv = img_rgb2yuv_avx2(r, g, b, 112, -94, -18);
+
+		img_store_avx2(u + i, img_blend_avx2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + i))), su, a));
+		img_store_avx2(v + i, img_blend_avx2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + i))), sv, a));
+	}
+
+	img_blend_argb_uv_scalar(u + i, v + i, argb + i * 8, w - i * 2);
+}
+
+__attribute__((target("avx2")))
+static void img_blend_plane_avx2(uint8_t *dst, const uint8_t *src, uint8_t alpha, int w)
+{
+	__m256i a = _mm256_set1_epi16(alpha), na = _mm256_set1_epi16(255 - alpha);
+	int i = 0;
+
+	for (; i + 16 <= w; i += 16) {
+		__m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(dst + i)));
+		__m256i s = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+
+		img_store_avx2(dst + i, _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(d, na), 8), _mm256_srli_epi16(_mm256_mullo_epi16(s, a), 8)));
+	}
+
+	img_blend_plane_scalar(dst + i, src + i, alpha, w - i);
+}
+
+__attribute__((target("avx2")))
+static void img_fill_noalpha_avx2(uint32_t *px, uint32_t color, int w)
+{
+	__m256i c = _mm256_set1_epi32(color), am = _mm256_set1_epi32((int)0xFF000000), z = _mm256_setzero_si256();
+	int i = 0;
+
+	for (; i + 8 <= w; i += 8) {
+		__m256i p = _mm256_loadu_si256((const __m256i *)(px + i));
+
+		_mm256_storeu_si256((__m256i *)(px + i), _mm256_blendv_epi8(p, c, _mm256_cmpeq_epi32(_mm256_and_si256(p, am), z)));
+	}
+
+	img_fill_noalpha_scalar(px + i, color, w - i);
+}
+#endif
+
+typedef void (*img_blend_argb_y_func_t)(uint8_t *dst, const uint8_t *argb, int w);
+typedef void (*img_blend_argb_uv_func_t)(uint8_t *u, uint8_t *v, const uint8_t *argb, int w);
+typedef void (*img_blend_plane_func_t)(uint8_t *dst, const uint8_t *src, uint8_t alpha, int w);
+typedef void (*img_fill_noalpha_func_t)(uint32_t *px, uint32_t color, int w);
+typedef void (*img_chromakey_func_t)(uint32_t *px, const switch_rgb_color_t *mask, int w);
+
+static struct {
+	img_blend_argb_y_func_t blend_y;
+	img_blend_argb_uv_func_t blend_uv;
+	img_blend_plane_func_t blend_plane;
+	img_fill_noalpha_func_t fill_noalpha;
+	img_chromakey_func_t chromakey;
+	const char *name;
+} img_kernel = { NULL, NULL, NULL, NULL, NULL, NULL };
+
+static switch_status_t img_kernel_select(const char *name)
+{
+	int best = zstr(name) || !strcasecmp(name, "auto");
+
+#ifdef SWITCH_IMG_SIMD
+	__builtin_cpu_init();
+
+	if ((best || !strcasecmp(name, "avx2")) && __builtin_cpu_supports("avx2")) {
+		img_kernel.blend_y = img_blend_argb_y_avx2;
+		img_kernel.blend_uv = img_blend_argb_uv_avx2;
+		img_kernel.blend_plane = img_blend_plane_avx2;
+		img_kernel.fill_noalpha = img_fill_noalpha_avx2;
+		/* avx2 implies sse4.1, there is no wider chromakey kernel */
+		img_kernel.chromakey = img_chromakey_sse41;
+		img_kernel.name = "avx2";
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if ((best || !strcasecmp(name, "sse4.1")) && __builtin_cpu_supports("sse4.1")) {
+		img_kernel.blend_y = img_blend_argb_y_sse41;
+		img_kernel.blend_uv = img_blend_argb_uv_sse41;
+		img_kernel.blend_plane = img_blend_plane_sse41;
+		img_kernel.fill_noalpha = img_fill_noalpha_sse41;
+		img_kernel.chromakey = img_chromakey_sse41;
+		img_kernel.name = "sse4.1";
+		return SWITCH_STATUS_SUCCESS;
+	}
+#endif
+
+	if (best || !strcasecmp(name, "scalar")) {
+		img_kernel.blend_y = img_blend_argb_y_scalar;
+		img_kernel.blend_uv = img_blend_argb_uv_scalar;
+		img_kernel.blend_plane = img_blend_plane_scalar;
+		img_kernel.fill_noalpha = img_fill_noalpha_scalar;
+		img_kernel.chromakey = img_chromakey_scalar;
+		img_kernel.name = "scalar";
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	return SWITCH_STATUS_FALSE;
+}
+
+static void img_kernel_init(void)
+{
+	if (img_kernel.name) {
+		return;
+	}
+
+	/* plain writes of the same values, safe if two threads race to get here first */
+	img_kernel_select(NULL);
+}
+
+SWITCH_DECLARE(const char *) switch_img_kernel_name(void)
+{
+	img_kernel_init();
+	return img_kernel.name;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_img_set_kernel(const char *name)
+{
+	img_kernel_init();
+	return img_kernel_select(name);
+}
+
 #ifdef SWITCH_HAVE_YUV
 static void switch_img_patch_rgb_noalpha(switch_image_t *IMG, switch_image_t *img, int x, int y)
 {
@@ -437,32 +872,28 @@ SWITCH_DECLARE(void) switch_img_patch(switch_image_t *IMG, switch_image_t *img,
 	switch_assert(IMG->fmt == SWITCH_IMG_FMT_I420);
 
 	if (img->fmt == SWITCH_IMG_FMT_ARGB) {
+#ifdef SWITCH_HAVE_YUV
 		int max_w = MIN(img->d_w, IMG->d_w - abs(x));
 		int max_h = MIN(img->d_h, IMG->d_h - abs(y));
-		int j;
-		uint8_t alpha;
-		switch_rgb_color_t *rgb;
+		int j = x < 0 ? -x : 0;
+		int w = max_w - j;
 
-		for (i = 0; i < max_h; i++) {
-			for (j = 0; j < max_w; j++) {
-				rgb = (switch_rgb_color_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED] + j * 4);
-				alpha = rgb->a;
+		img_kernel_init();
 
-				if (alpha == 255) {
-					switch_img_draw_pixel(IMG, x + j, y + i, rgb);
-				} else if (alpha != 0) {
-					switch_rgb_color_t RGB = { 0 };
-					
-					switch_img_get_rgb_pixel(IMG, &RGB, x + j, y + i);
-					RGB.a = 255;
-					RGB.r = ((RGB.r * (255 - alpha)) >> 8) + ((rgb->r * alpha) >> 8);
-					RGB.g = ((RGB.g * (255 - alpha)) >> 8) + ((rgb->g * alpha) >> 8);
-					RGB.b = ((RGB.b * (255 - alpha)) >> 8) + ((rgb->b * alpha) >> 8);
-					
-					switch_img_draw_pixel(IMG, x + j, y + i, &RGB);
-				}
+		/* the color is blended in yuv space, the chroma of each 2x2 block comes from its top left pixel */
+		for (i = y < 0 ? -y : 0; w > 0 && i < max_h; i++) {
+			int dy = y + i, odd = (x + j) & 1;
+			const uint8_t *argb = img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED] + j * 4;
+
+			img_kernel.blend_y(IMG->planes[SWITCH_PLANE_Y] + dy * IMG->stride[SWITCH_PLANE_Y] + x + j, argb, w);
+
+			if (!(dy & 1) && w > odd) {
+				img_kernel.blend_uv(IMG->planes[SWITCH_PLANE_U] + dy / 2 * IMG->stride[SWITCH_PLANE_U] + (x + j + odd) / 2,
+									IMG->planes[SWITCH_PLANE_V] + dy / 2 * IMG->stride[SWITCH_PLANE_V] + (x + j + odd) / 2,
+									argb + odd * 4, w - odd);
 			}
 		}
+#endif
 
 		return;
 
@@ -1364,30 +1795,12 @@ SWITCH_DECLARE(void) switch_chromakey_process(switch_chromakey_t *ck, switch_ima
 
 SWITCH_DECLARE(void) switch_img_chromakey(switch_image_t *img, switch_rgb_color_t *mask, int threshold)
 {
-	switch_rgb_color_t *pixel, *last_pixel = NULL;
-	int last_threshold = 0;
 	switch_assert(img);
 
 	if (img->fmt != SWITCH_IMG_FMT_ARGB) return;
 
-	pixel = (switch_rgb_color_t *)img->planes[SWITCH_PLANE_PACKED];
-
-	for (; pixel < ((switch_rgb_color_t *)img->planes[SWITCH_PLANE_PACKED] + img->d_w * img->d_h); pixel++) {
-		int threshold = 0;
-
-		if (last_pixel && (*(uint32_t *)pixel & 0xFFFFFF) == (*(uint32_t *)last_pixel & 0xFFFFFF)) {
-			threshold = last_threshold;
-		} else {
-			threshold = switch_color_distance(pixel, mask);
-		}
-
-		last_threshold = threshold;
-		last_pixel = pixel;
-
-		if (threshold) {
-			pixel->a = 0;
-		}
-	}
+	img_kernel_init();
+	img_kernel.chromakey((uint32_t *)img->planes[SWITCH_PLANE_PACKED], mask, img->d_w * img->d_h);
 
 	return;
 }
@@ -1420,21 +1833,13 @@ SWITCH_DECLARE(void) switch_img_fill_noalpha(switch_image_t *img, int x, int y,
 	int i;
 
 	if (img->fmt == SWITCH_IMG_FMT_ARGB) {
-		int max_w = img->d_w;
-		int max_h = img->d_h;
-		int j;
-		switch_rgb_color_t *rgb; 
+		uint32_t c;
 
-		for (i = 0; i < max_h; i++) {		
-			for (j = 0; j < max_w; j++) {
-				rgb = (switch_rgb_color_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED] + j * 4);
+		memcpy(&c, color, sizeof(c));
+		img_kernel_init();
 
-				if (rgb->a != 0) {
-					continue;
-				}
-				
-				*rgb = *color;
-			}
+		for (i = 0; i < img->d_h; i++) {
+			img_kernel.fill_noalpha((uint32_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED]), c, img->d_w);
 		}
 	}
 
@@ -1651,6 +2056,29 @@ SWITCH_DECLARE(void) switch_img_overlay(switch_image_t *IMG, switch_image_t *img
 	if (y & 1) y++;
 	if (len <= 0) return;
 
+#ifdef SWITCH_HAVE_YUV
+	if (img->fmt == SWITCH_IMG_FMT_I420) {
+		img_kernel_init();
+
+		/* the blend is linear so blending the planes matches the rgb round trip up to rounding, without the conversions */
+		for (i = y; i < max_h; i++) {
+			int sy = i - y + yoff;
+
+			img_kernel.blend_plane(IMG->planes[SWITCH_PLANE_Y] + IMG->stride[SWITCH_PLANE_Y] * i + x,
+								   img->planes[SWITCH_PLANE_Y] + img->stride[SWITCH_PLANE_Y] * sy + xoff, alpha, len);
+
+			if (!(i & 1)) {
+				img_kernel.blend_plane(IMG->planes[SWITCH_PLANE_U] + IMG->stride[SWITCH_PLANE_U] * (i / 2) + x / 2,
+									   img->planes[SWITCH_PLANE_U] + img->stride[SWITCH_PLANE_U] * (sy / 2) + xoff / 2, alpha, (len + 1) / 2);
+				img_kernel.blend_plane(IMG->planes[SWITCH_PLANE_V] + IMG->stride[SWITCH_PLANE_V] * (i / 2) + x / 2,
+									   img->planes[SWITCH_PLANE_V] + img->stride[SWITCH_PLANE_V] * (sy / 2) + xoff / 2, alpha, (len + 1) / 2);
+			}
+		}
+
+		return;
+	}
+#endif
+
 	for (i = y; i < max_h; i++) {
 		for (j = 0; j < len; j++) {
 			switch_img_get_rgb_pixel(IMG, &RGB, x + j, i);
@@ -42,6 +42,8 @@
 
 //#define SWITCH_EVENT_RECYCLE
 #define DISPATCH_QUEUE_LEN 10000
+#define SUBSCRIBER_QUEUE_LEN 10000
+#define SUBSCRIBER_BATCH 64
 //#define DEBUG_DISPATCH_QUEUES
 
 /*! \brief A node to store binded events */
@@ -57,8 +59,37 @@ struct switch_event_node {
 	/*! private data */
 	void *user_data;
 	struct switch_event_node *next;
+	/*! events waiting for this subscriber when events are dispatched */
+	switch_queue_t *queue;
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	/*! the node sits in EVENT_DISPATCH_QUEUE or a dispatch thread is draining it */
+	int scheduled;
+	/*! the callback is running on running_thread */
+	int running;
+	switch_thread_id_t running_thread;
+	/*! the node was unbound, pending events are discarded */
+	int unbound;
+	/*! one reference for the binding and one while scheduled */
+	switch_atomic_t refs;
+	switch_atomic_t delivered;
+	switch_atomic_t dropped;
+	uint32_t max_backlog;
+	switch_event_bind_flag_t flags;
 };
 
+/*! \brief One fired event shared by every subscriber queue it was pushed to */
+typedef struct switch_event_shared_s {
+	switch_event_t *event;
+	/*! one reference per queue holding it, plus one while it is being fanned out */
+	switch_atomic_t refs;
+} switch_event_shared_t;
+
+/*! \brief The nodes bound to one exact subclass name */
+typedef struct event_subclass_nodes_s {
+	switch_event_node_t *head;
+} event_subclass_nodes_t;
+
 /*! \brief A registered custom event subclass  */
 struct switch_event_subclass {
 	/*! the owner of the subclass */
@@ -85,6 +116,7 @@ static unsigned int SOFT_MAX_DISPATCH = 0;
 static char guess_ip_v4[80] = "";
 static char guess_ip_v6[80] = "";
 static switch_event_node_t *EVENT_NODES[SWITCH_EVENT_ALL + 1] = { NULL };
+static switch_hash_t *EVENT_SUBCLASS_NODES = NULL;
 static switch_thread_rwlock_t *RWLOCK = NULL;
 static switch_mutex_t *BLOCK = NULL;
 static switch_mutex_t *POOL_LOCK = NULL;
@@ -105,7 +137,6 @@ static int SYSTEM_RUNNING = 0;
 static uint64_t EVENT_SEQUENCE_NR = 0;
 #ifdef SWITCH_EVENT_RECYCLE
 static switch_queue_t *EVENT_RECYCLE_QUEUE = NULL;
-static switch_queue_t *EVENT_HEADER_RECYCLE_QUEUE = NULL;
 #endif
 
 static void unsub_all_switch_event_channel(void);
@@ -129,6 +160,321 @@ static char *my_dup(const char *s)
 #define FREE(ptr) switch_safe_free(ptr)
 #endif
 
+/*
+  Every event carries its own arena.  Header structs, header names and short values are carved out of it
+  and an open addressed index on the header name hash lives there too, so switch_event_get_header_ptr
+  no longer walks the list.  event->headers stays authoritative for ordering and iteration.
+  Destroying an event gives the whole arena back at once, only strings that came from the caller
+  (SWITCH_STACK_NODUP, switch_event_add_header) or did not fit the arena are freed one by one.
+*/
+
+#define EVENT_ARENA_FIRST_BLOCK 4096
+#define EVENT_ARENA_MAX_BLOCK 32768
+#define EVENT_ARENA_MAX_STRING 512
+#define EVENT_ARENA_MAX_WASTE 16384
+#define EVENT_INDEX_MIN_SIZE 32
+
+typedef struct event_arena_block_s {
+	struct event_arena_block_s *next;
+	switch_size_t size;
+	switch_size_t used;
+	char *data;
+} event_arena_block_t;
+
+struct switch_event_arena {
+	/*! the block currently carved from, older blocks follow it */
+	event_arena_block_t *blocks;
+	/*! headers released by switch_event_del_header waiting to be reused */
+	switch_event_header_t *free_headers;
+	/*! one slot per distinct header name pointing at the first header with that name */
+	switch_event_header_t **index;
+	uint32_t index_size;
+	uint32_t index_count;
+	/*! bytes of arena strings released before the event was destroyed */
+	switch_size_t wasted;
+	event_arena_block_t first;
+};
+
+/* the event, its arena and the first arena block are a single allocation */
+typedef struct event_alloc_s {
+	switch_event_t event;
+	struct switch_event_arena arena;
+	char first_block[EVENT_ARENA_FIRST_BLOCK];
+} event_alloc_t;
+
+static void event_arena_init(switch_event_t *event)
+{
+	event_alloc_t *ea = (event_alloc_t *) event;
+	struct switch_event_arena *arena = &ea->arena;
+
+	memset(arena, 0, sizeof(*arena));
+	arena->first.data = ea->first_block;
+	arena->first.size = sizeof(ea->first_block);
+	arena->blocks = &arena->first;
+	event->arena = arena;
+}
+
+static void event_arena_release(struct switch_event_arena *arena)
+{
+	event_arena_block_t *bp, *next;
+
+	for (bp = arena->blocks; bp; bp = next) {
+		next = bp->next;
+
+		if (bp != &arena->first) {
+			FREE(bp);
+		}
+	}
+
+	arena->blocks = NULL;
+}
+
+static void *event_arena_alloc(struct switch_event_arena *arena, switch_size_t len, switch_size_t align)
+{
+	event_arena_block_t *bp = arena->blocks;
+	switch_size_t pad = (align - ((uintptr_t) (bp->data + bp->used) & (align - 1))) & (align - 1);
+	void *ptr;
+
+	if (bp->used + pad + len > bp->size) {
+		switch_size_t size = bp->size * 2;
+
+		if (size > EVENT_ARENA_MAX_BLOCK) {
+			size = EVENT_ARENA_MAX_BLOCK;
+		}
+
+		if (size < len + align) {
+			size = len + align;
+		}
+
+		bp = ALLOC(sizeof(*bp) + size);
+		switch_assert(bp);
+		bp->data = (char *) (bp + 1);
+		bp->size = size;
+		bp->used = 0;
+		bp->next = arena->blocks;
+		arena->blocks = bp;
+		pad = (align - ((uintptr_t) bp->data & (align - 1))) & (align - 1);
+	}
+
+	ptr = bp->data + bp->used + pad;
+	bp->used += pad + len;
+
+	return ptr;
+}
+
+static event_arena_block_t *event_arena_owner(struct switch_event_arena *arena, const void *ptr)
+{
+	event_arena_block_t *bp;
+
+	for (bp = arena->blocks; bp; bp = bp->next) {
+		if ((const char *) ptr >= bp->data && (const char *) ptr < bp->data + bp->size) {
+			return bp;
+		}
+	}
+
+	return NULL;
+}
+
+static char *event_strdup(switch_event_t *event, const char *s)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_size_t len = strlen(s) + 1;
+
+	/* long strings and events that keep replacing their values (channel variables) fall back to the heap */
+	if (len > EVENT_ARENA_MAX_STRING || arena->wasted > EVENT_ARENA_MAX_WASTE) {
+		return DUP(s);
+	}
+
+	return (char *) memcpy(event_arena_alloc(arena, len, 1), s, len);
+}
+
+static void event_strfree(switch_event_t *event, char *s)
+{
+	event_arena_block_t *bp;
+	switch_size_t len;
+
+	if (!s) {
+		return;
+	}
+
+	if (!(bp = event_arena_owner(event->arena, s))) {
+		free(s);
+		return;
+	}
+
+	len = strlen(s) + 1;
+
+	if (s + len == bp->data + bp->used) {
+		bp->used -= len;
+	} else {
+		event->arena->wasted += len;
+	}
+}
+
+static char *event_strrealloc(switch_event_t *event, char *s, switch_size_t len)
+{
+	char *r;
+	switch_size_t slen;
+
+	if (!s || !event_arena_owner(event->arena, s)) {
+		return realloc(s, len);
+	}
+
+	if ((r = ALLOC(len))) {
+		slen = strlen(s) + 1;
+		memcpy(r, s, slen < len ? slen : len);
+		event_strfree(event, s);
+	}
+
+	return r;
+}
+
+static switch_event_header_t *event_index_find(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_event_header_t *hp;
+	uint32_t mask = arena->index_size - 1, slot;
+
+	if (!arena->index_size) {
+		return NULL;
+	}
+
+	for (slot = hash & mask; (hp = arena->index[slot]); slot = (slot + 1) & mask) {
+		if (hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			return hp;
+		}
+	}
+
+	return NULL;
+}
+
+static void event_index_grow(switch_event_t *event)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_event_header_t **old = arena->index;
+	uint32_t old_size = arena->index_size, mask, slot, i;
+
+	arena->index_size = old_size ? old_size * 2 : EVENT_INDEX_MIN_SIZE;
+	arena->index = event_arena_alloc(arena, arena->index_size * sizeof(*arena->index), sizeof(void *));
+	memset(arena->index, 0, arena->index_size * sizeof(*arena->index));
+	mask = arena->index_size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		if (old[i]) {
+			for (slot = old[i]->hash & mask; arena->index[slot]; slot = (slot + 1) & mask);
+			arena->index[slot] = old[i];
+		}
+	}
+}
+
+/* point the index at hp unless its name is already there, replace when hp now precedes the indexed header */
+static void event_index_insert(switch_event_t *event, switch_event_header_t *hp, switch_bool_t replace)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_event_header_t *cur;
+	uint32_t mask, slot;
+
+	if ((arena->index_count + 1) * 4 > arena->index_size * 3) {
+		event_index_grow(event);
+	}
+
+	mask = arena->index_size - 1;
+
+	for (slot = hp->hash & mask; (cur = arena->index[slot]); slot = (slot + 1) & mask) {
+		if (cur->hash == hp->hash && !strcasecmp(cur->name, hp->name)) {
+			if (replace) {
+				arena->index[slot] = hp;
+			}
+			return;
+		}
+	}
+
+	arena->index[slot] = hp;
+	arena->index_count++;
+}
+
+static void event_index_remove(switch_event_t *event, switch_event_header_t *hp)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_event_header_t *cur;
+	uint32_t mask = arena->index_size - 1, i, j, k;
+
+	if (!arena->index_size) {
+		return;
+	}
+
+	for (i = hp->hash & mask; (cur = arena->index[i]) && cur != hp; i = (i + 1) & mask);
+
+	if (!cur) {
+		return;
+	}
+
+	/* backward shift so the probe sequences of the following entries stay intact */
+	for (;;) {
+		arena->index[i] = NULL;
+		j = i;
+
+		for (;;) {
+			j = (j + 1) & mask;
+
+			if (!(cur = arena->index[j])) {
+				arena->index_count--;
+				return;
+			}
+
+			k = cur->hash & mask;
+
+			if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+				continue;
+			}
+
+			break;
+		}
+
+		arena->index[i] = cur;
+		i = j;
+	}
+}
+
+static void event_index_rebuild(switch_event_t *event)
+{
+	struct switch_event_arena *arena = event->arena;
+	switch_event_header_t *hp;
+
+	if (arena->index_size) {
+		memset(arena->index, 0, arena->index_size * sizeof(*arena->index));
+	}
+
+	arena->index_count = 0;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		event_index_insert(event, hp, SWITCH_FALSE);
+	}
+}
+
+static void event_free_header(switch_event_t *event, switch_event_header_t *hp)
+{
+	if (hp->idx) {
+		if (!hp->array) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "INDEX WITH NO ARRAY WTF?? [%s][%s]\n", hp->name, hp->value);
+		} else {
+			int i = 0;
+
+			for (i = 0; i < hp->idx; i++) {
+				event_strfree(event, hp->array[i]);
+			}
+			FREE(hp->array);
+		}
+	}
+
+	event_strfree(event, hp->name);
+	event_strfree(event, hp->value);
+
+	memset(hp, 0, sizeof(*hp));
+	hp->next = event->arena->free_headers;
+	event->arena->free_headers = hp;
+}
+
 /* make sure this is synced with the switch_event_types_t enum in switch_types.h
    also never put any new ones before EVENT_ALL
 */
@@ -266,6 +612,198 @@ static int switch_events_match(switch_event_t *event, switch_event_node_t *node)
 }
 
 
+/* exact subclass bindings live in EVENT_SUBCLASS_NODES, the file: and func: filters stay on the event id list */
+static int switch_event_node_by_subclass(const char *subclass_name)
+{
+	return subclass_name && strncasecmp(subclass_name, "file:", 5) && strncasecmp(subclass_name, "func:", 5);
+}
+
+/* call with RWLOCK held, returns the subscriber after node (or the first one when node is NULL) that wants the event */
+static switch_event_node_t *switch_event_next_subscriber(switch_event_t *event, switch_event_node_t *node, int *stage)
+{
+	event_subclass_nodes_t *nodes;
+
+	for (;;) {
+		node = node ? node->next : NULL;
+
+		while (!node) {
+			switch ((*stage)++) {
+			case 0:
+				node = EVENT_NODES[event->event_id];
+				break;
+			case 1:
+				if (event->event_id != SWITCH_EVENT_ALL) {
+					node = EVENT_NODES[SWITCH_EVENT_ALL];
+				}
+				break;
+			case 2:
+				if (event->subclass_name && (nodes = switch_core_hash_find(EVENT_SUBCLASS_NODES, event->subclass_name))) {
+					node = nodes->head;
+				}
+				break;
+			default:
+				return NULL;
+			}
+		}
+
+		if (*stage == 3) {
+			if ((node->event_id == SWITCH_EVENT_ALL || node->event_id == event->event_id) && !strcmp(node->subclass_name, event->subclass_name)) {
+				return node;
+			}
+		} else if (switch_events_match(event, node)) {
+			return node;
+		}
+	}
+}
+
+static void switch_event_shared_release(switch_event_shared_t **sharedp)
+{
+	switch_event_shared_t *shared = *sharedp;
+
+	*sharedp = NULL;
+
+	if (!switch_atomic_dec(&shared->refs)) {
+		switch_event_destroy(&shared->event);
+		free(shared);
+	}
+}
+
+static void switch_event_node_flush(switch_event_node_t *node)
+{
+	void *pop = NULL;
+	switch_event_shared_t *shared;
+
+	while (switch_queue_trypop(node->queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		shared = (switch_event_shared_t *) pop;
+		switch_event_shared_release(&shared);
+	}
+}
+
+static void switch_event_node_release(switch_event_node_t *node)
+{
+	switch_memory_pool_t *pool = node->pool;
+
+	if (switch_atomic_dec(&node->refs)) {
+		return;
+	}
+
+	switch_event_node_flush(node);
+	FREE(node->subclass_name);
+	FREE(node->id);
+	FREE(node);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* the node is out of the lists, make sure its callback is not running anymore and will never run again */
+static void switch_event_node_unbound(switch_event_node_t *node)
+{
+	int self;
+
+	switch_mutex_lock(node->mutex);
+	node->unbound = 1;
+	self = node->running && switch_thread_equal(node->running_thread, switch_thread_self());
+	switch_mutex_unlock(node->mutex);
+
+	while (!self && node->running) {
+		switch_yield(1000);
+	}
+
+	switch_event_node_release(node);
+}
+
+/* call with RWLOCK held for reading, the queue takes its own reference on the shared event */
+static void switch_event_node_push(switch_event_node_t *node, switch_event_shared_t *shared)
+{
+	uint32_t backlog, dropped;
+	int schedule = 0;
+
+	switch_atomic_inc(&shared->refs);
+
+	if (switch_queue_trypush(node->queue, shared) != SWITCH_STATUS_SUCCESS) {
+		switch_atomic_inc(&node->dropped);
+
+		if ((dropped = switch_atomic_read(&node->dropped)) % 1000 == 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Event queue for %s:%s is full, %u event(s) dropped so far\n",
+							  node->id, switch_event_name(node->event_id), dropped);
+		}
+
+		switch_event_shared_release(&shared);
+		return;
+	}
+
+	if ((backlog = switch_queue_size(node->queue)) > node->max_backlog) {
+		node->max_backlog = backlog;
+	}
+
+	switch_mutex_lock(node->mutex);
+	if (!node->scheduled && !node->unbound) {
+		node->scheduled = 1;
+		switch_atomic_inc(&node->refs);
+		schedule = 1;
+	}
+	switch_mutex_unlock(node->mutex);
+
+	if (schedule) {
+		switch_queue_push(EVENT_DISPATCH_QUEUE, node);
+	}
+}
+
+/* drain a batch of events for one subscriber, only one dispatch thread at a time works on a given node */
+static void switch_event_node_run(switch_event_node_t *node)
+{
+	void *pop = NULL;
+	switch_event_shared_t *shared;
+	switch_event_t view, *clone;
+	int x, reschedule = 0;
+
+	switch_mutex_lock(node->mutex);
+	node->running = 1;
+	node->running_thread = switch_thread_self();
+	switch_mutex_unlock(node->mutex);
+
+	for (x = 0; x < SUBSCRIBER_BATCH && !node->unbound; x++) {
+		if (switch_queue_trypop(node->queue, &pop) != SWITCH_STATUS_SUCCESS || !pop) {
+			break;
+		}
+
+		shared = (switch_event_shared_t *) pop;
+
+		if (switch_atomic_read(&shared->refs) == 1) {
+			/* nobody else can see it anymore, the subscriber gets the event itself */
+			shared->event->bind_user_data = node->user_data;
+			node->callback(shared->event);
+		} else if ((node->flags & SEBF_READ_ONLY)) {
+			/* other subscribers may be reading the same headers right now on other threads */
+			view = *shared->event;
+			view.bind_user_data = node->user_data;
+			node->callback(&view);
+		} else if (switch_event_dup(&clone, shared->event) == SWITCH_STATUS_SUCCESS) {
+			/* the callback may change its event, it gets one nobody else is reading */
+			clone->bind_user_data = node->user_data;
+			node->callback(clone);
+			switch_event_destroy(&clone);
+		}
+
+		switch_atomic_inc(&node->delivered);
+		switch_event_shared_release(&shared);
+	}
+
+	switch_mutex_lock(node->mutex);
+	node->running = 0;
+	node->scheduled = 0;
+	if (!node->unbound && switch_queue_size(node->queue)) {
+		node->scheduled = reschedule = 1;
+	}
+	switch_mutex_unlock(node->mutex);
+
+	if (reschedule) {
+		/* back of the line so the other subscribers get their turn */
+		switch_queue_push(EVENT_DISPATCH_QUEUE, node);
+	} else {
+		switch_event_node_release(node);
+	}
+}
+
 static void *SWITCH_THREAD_FUNC switch_event_deliver_thread(switch_thread_t *thread, void *obj)
 {
 	switch_event_t *event = (switch_event_t *) obj;
@@ -319,7 +857,6 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 
 	for (;;) {
 		void *pop = NULL;
-		switch_event_t *event = NULL;
 
 		if (!SYSTEM_RUNNING) {
 			break;
@@ -333,8 +870,7 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 			break;
 		}
 
-		event = (switch_event_t *) pop;
-		switch_event_deliver(&event);
+		switch_event_node_run((switch_event_node_t *) pop);
 		switch_os_yield();
 	}
 
@@ -354,41 +890,47 @@ static int PENDING = 0;
 
 static switch_status_t switch_event_queue_dispatch_event(switch_event_t **eventp)
 {
-
-	switch_event_t *event = *eventp;
+	switch_event_node_t *node = NULL;
+	switch_event_shared_t *shared;
+	int stage = 0, launch = 0;
 
 	if (!SYSTEM_RUNNING) {
 		return SWITCH_STATUS_FALSE;
 	}
 
-	while (event) {
-		int launch = 0;
-
-		switch_mutex_lock(EVENT_QUEUE_MUTEX);
+	switch_zmalloc(shared, sizeof(*shared));
+	shared->event = *eventp;
+	*eventp = NULL;
+	switch_atomic_set(&shared->refs, 1);
 
-		if (!PENDING && switch_queue_size(EVENT_DISPATCH_QUEUE) > (unsigned int)(DISPATCH_QUEUE_LEN * DISPATCH_THREAD_COUNT)) {
-			if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
-				launch++;
-				PENDING++;
-			}
-		}
+	/* every subscriber queue references the same event, it is freed after the last one is done with it */
+	switch_thread_rwlock_rdlock(RWLOCK);
+	while ((node = switch_event_next_subscriber(shared->event, node, &stage))) {
+		switch_event_node_push(node, shared);
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
 
-		switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+	switch_event_shared_release(&shared);
 
-		if (launch) {
-			if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
-				switch_event_launch_dispatch_threads(SOFT_MAX_DISPATCH + 1);
-			}
+	switch_mutex_lock(EVENT_QUEUE_MUTEX);
 
-			switch_mutex_lock(EVENT_QUEUE_MUTEX);
-			PENDING--;
-			switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+	if (!PENDING && switch_queue_size(EVENT_DISPATCH_QUEUE) > (unsigned int) DISPATCH_THREAD_COUNT) {
+		if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
+			launch++;
+			PENDING++;
 		}
+	}
+
+	switch_mutex_unlock(EVENT_QUEUE_MUTEX);
 
-		*eventp = NULL;
-		switch_queue_push(EVENT_DISPATCH_QUEUE, event);
-		event = NULL;
+	if (launch) {
+		if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
+			switch_event_launch_dispatch_threads(SOFT_MAX_DISPATCH + 1);
+		}
 
+		switch_mutex_lock(EVENT_QUEUE_MUTEX);
+		PENDING--;
+		switch_mutex_unlock(EVENT_QUEUE_MUTEX);
 	}
 
 	return SWITCH_STATUS_SUCCESS;
@@ -396,22 +938,14 @@ static switch_status_t switch_event_queue_dispatch_event(switch_event_t **eventp
 
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 {
-	switch_event_types_t e;
-	switch_event_node_t *node;
+	switch_event_node_t *node = NULL;
+	int stage = 0;
 
 	if (SYSTEM_RUNNING) {
 		switch_thread_rwlock_rdlock(RWLOCK);
-		for (e = (*event)->event_id;; e = SWITCH_EVENT_ALL) {
-			for (node = EVENT_NODES[e]; node; node = node->next) {
-				if (switch_events_match(*event, node)) {
-					(*event)->bind_user_data = node->user_data;
-					node->callback(*event);
-				}
-			}
-
-			if (e == SWITCH_EVENT_ALL) {
-				break;
-			}
+		while ((node = switch_event_next_subscriber(*event, node, &stage))) {
+			(*event)->bind_user_data = node->user_data;
+			node->callback(*event);
 		}
 		switch_thread_rwlock_unlock(RWLOCK);
 	}
@@ -526,14 +1060,7 @@ SWITCH_DECLARE(void) switch_core_memory_reclaim_events(void)
 	int size;
 	size = switch_queue_size(EVENT_RECYCLE_QUEUE);
 
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled event(s) %d bytes\n", size, (int) sizeof(switch_event_t) * size);
-	size = switch_queue_size(EVENT_HEADER_RECYCLE_QUEUE);
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled event header(s) %d bytes\n",
-					  size, (int) sizeof(switch_event_header_t) * size);
-
-	while (switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-		free(pop);
-	}
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled event(s) %d bytes\n", size, (int) sizeof(event_alloc_t) * size);
 	while (switch_queue_trypop(EVENT_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
 		free(pop);
 	}
@@ -597,11 +1124,32 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 
 	if (runtime.events_use_dispatch) {
 		void *pop = NULL;
-		switch_event_t *event = NULL;
+		switch_event_node_t *node;
 
 		while (switch_queue_trypop(EVENT_DISPATCH_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-			event = (switch_event_t *) pop;
-			switch_event_destroy(&event);
+			node = (switch_event_node_t *) pop;
+			switch_event_node_flush(node);
+			switch_event_node_release(node);
+		}
+	}
+
+	for (x = 0; x <= SWITCH_EVENT_ALL; x++) {
+		switch_event_node_t *node;
+
+		for (node = EVENT_NODES[x]; node; node = node->next) {
+			switch_event_node_flush(node);
+		}
+	}
+
+	for (hi = switch_core_hash_first(EVENT_SUBCLASS_NODES); hi; hi = switch_core_hash_next(&hi)) {
+		event_subclass_nodes_t *nodes;
+		switch_event_node_t *node;
+
+		switch_core_hash_this(hi, &var, NULL, &val);
+		if ((nodes = (event_subclass_nodes_t *) val)) {
+			for (node = nodes->head; node; node = node->next) {
+				switch_event_node_flush(node);
+			}
 		}
 	}
 
@@ -702,6 +1250,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 	switch_mutex_init(&EVENT_QUEUE_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_mutex_init(&CUSTOM_HASH_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_core_hash_init(&CUSTOM_HASH);
+	switch_core_hash_init_case(&EVENT_SUBCLASS_NODES, SWITCH_TRUE);
 
 	if (switch_core_test_flag(SCF_MINIMAL)) {
 		return SWITCH_STATUS_SUCCESS;
@@ -728,7 +1277,6 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 
 #ifdef SWITCH_EVENT_RECYCLE
 	switch_queue_create(&EVENT_RECYCLE_QUEUE, 250000, THRUNTIME_POOL);
-	switch_queue_create(&EVENT_HEADER_RECYCLE_QUEUE, 250000, THRUNTIME_POOL);
 #endif
 
 	check_dispatch();
@@ -757,13 +1305,14 @@ SWITCH_DECLARE(switch_status_t) switch_event_create_subclass_detailed(const char
 		*event = (switch_event_t *) pop;
 	} else {
 #endif
-		*event = ALLOC(sizeof(switch_event_t));
+		*event = ALLOC(sizeof(event_alloc_t));
 		switch_assert(*event);
 #ifdef SWITCH_EVENT_RECYCLE
 	}
 #endif
 
 	memset(*event, 0, sizeof(switch_event_t));
+	event_arena_init(*event);
 
 	if (event_id == SWITCH_EVENT_REQUEST_PARAMS || event_id == SWITCH_EVENT_CHANNEL_DATA || event_id == SWITCH_EVENT_MESSAGE) {
 		(*event)->flags |= EF_UNIQ_HEADERS;
@@ -806,21 +1355,24 @@ SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event
 
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
-			FREE(hp->name);
-			hp->name = DUP(new_header_name);
+			event_strfree(event, hp->name);
+			hp->name = event_strdup(event, new_header_name);
 			hlen = -1;
 			hp->hash = switch_ci_hashfunc_default(hp->name, &hlen);
 			x++;
 		}
 	}
 
+	if (x) {
+		event_index_rebuild(event);
+	}
+
 	return x ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
 }
 
 
 SWITCH_DECLARE(switch_event_header_t *) switch_event_get_header_ptr(switch_event_t *event, const char *header_name)
 {
-	switch_event_header_t *hp;
 	switch_ssize_t hlen = -1;
 	unsigned long hash = 0;
 
@@ -831,12 +1383,7 @@ SWITCH_DECLARE(switch_event_header_t *) switch_event_get_header_ptr(switch_event
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
-	for (hp = event->headers; hp; hp = hp->next) {
-		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
-			return hp;
-		}
-	}
-	return NULL;
+	return event_index_find(event, header_name, hash);
 }
 
 SWITCH_DECLARE(char *) switch_event_get_header_idx(switch_event_t *event, const char *header_name, int idx)
@@ -867,7 +1414,7 @@ SWITCH_DECLARE(char *) switch_event_get_body(switch_event_t *event)
 
 SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *event, const char *header_name, const char *val)
 {
-	switch_event_header_t *hp, *lp = NULL, *tp;
+	switch_event_header_t *hp, *lp = NULL, *tp, *first = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int x = 0;
 	switch_ssize_t hlen = -1;
@@ -882,66 +1429,88 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 		x++;
 		switch_assert(x < 1000000);
 
-		if ((!hp->hash || hash == hp->hash) && !strcasecmp(header_name, hp->name) && (zstr(val) || !strcmp(hp->value, val))) {
-			if (lp) {
-				lp->next = hp->next;
-			} else {
-				event->headers = hp->next;
-			}
-			if (hp == event->last_header || !hp->next) {
-				event->last_header = lp;
-			}
-			FREE(hp->name);
-
-			if (hp->idx) {
-				int i = 0;
-
-				for (i = 0; i < hp->idx; i++) {
-					FREE(hp->array[i]);
+		if ((!hp->hash || hash == hp->hash) && !strcasecmp(header_name, hp->name)) {
+			if (zstr(val) || !strcmp(hp->value, val)) {
+				if (lp) {
+					lp->next = hp->next;
+				} else {
+					event->headers = hp->next;
+				}
+				if (hp == event->last_header || !hp->next) {
+					event->last_header = lp;
 				}
-				FREE(hp->array);
-			}
 
-			FREE(hp->value);
+				event_index_remove(event, hp);
+				event_free_header(event, hp);
+				status = SWITCH_STATUS_SUCCESS;
+				continue;
+			}
 
-			memset(hp, 0, sizeof(*hp));
-#ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, hp) != SWITCH_STATUS_SUCCESS) {
-				FREE(hp);
+			if (!first) {
+				first = hp;
 			}
-#else
-			FREE(hp);
-#endif
-			status = SWITCH_STATUS_SUCCESS;
-		} else {
-			lp = hp;
 		}
+
+		lp = hp;
+	}
+
+	/* the indexed header may have been deleted while others with the same name survived */
+	if (status == SWITCH_STATUS_SUCCESS && first) {
+		event_index_insert(event, first, SWITCH_FALSE);
 	}
 
 	return status;
 }
 
-static switch_event_header_t *new_header(const char *header_name)
+static switch_event_header_t *new_header(switch_event_t *event, const char *header_name)
 {
+	struct switch_event_arena *arena = event->arena;
 	switch_event_header_t *header;
 
-#ifdef SWITCH_EVENT_RECYCLE
-		void *pop;
-		if (EVENT_HEADER_RECYCLE_QUEUE && switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS) {
-			header = (switch_event_header_t *) pop;
-		} else {
-#endif
-			header = ALLOC(sizeof(*header));
-			switch_assert(header);
-#ifdef SWITCH_EVENT_RECYCLE
+	if ((header = arena->free_headers)) {
+		arena->free_headers = header->next;
+	} else {
+		header = event_arena_alloc(arena, sizeof(*header), sizeof(void *));
+	}
+
+	memset(header, 0, sizeof(*header));
+	header->name = event_strdup(event, header_name);
+
+	return header;
+}
+
+/* append a copy of a header from a well formed event without going through the add_header parsing */
+static void event_copy_header(switch_event_t *event, switch_event_header_t *src)
+{
+	switch_event_header_t *header = new_header(event, src->name);
+	switch_ssize_t hlen = -1;
+	int i;
+
+	if (src->value) {
+		header->value = event_strdup(event, src->value);
+	}
+
+	if (src->idx && src->array) {
+		header->array = ALLOC(sizeof(char *) * src->idx);
+		switch_assert(header->array);
+
+		for (i = 0; i < src->idx; i++) {
+			header->array[i] = src->array[i] ? event_strdup(event, src->array[i]) : NULL;
 		}
-#endif
 
-		memset(header, 0, sizeof(*header));
-		header->name = DUP(header_name);
+		header->idx = src->idx;
+	}
+
+	header->hash = src->hash ? src->hash : switch_ci_hashfunc_default(header->name, &hlen);
 
-		return header;
+	if (event->last_header) {
+		event->last_header->next = header;
+	} else {
+		event->headers = header;
+	}
 
+	event->last_header = header;
+	event_index_insert(event, header, SWITCH_FALSE);
 }
 
 SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *var, const char *val)
@@ -1015,7 +1584,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (!(header = switch_event_get_header_ptr(event, header_name)) && index_ptr) {
 
-			header = new_header(header_name);
+			header = new_header(event, header_name);
 
 			if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
 				switch_event_del_header(event, header_name);
@@ -1029,8 +1598,8 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 			if (index_ptr) {
 				if (index > -1 && index <= 4000) {
 					if (index < header->idx) {
-						FREE(header->array[index]);
-						header->array[index] = DUP(data);
+						event_strfree(event, header->array[index]);
+						header->array[index] = data;
 					} else {
 						int i;
 						char **m;
@@ -1039,9 +1608,9 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 						switch_assert(m);
 						header->array = m;
 						for (i = header->idx; i < index; i++) {
-							m[i] = DUP("");
+							m[i] = event_strdup(event, "");
 						}
-						m[index] = DUP(data);
+						m[index] = data;
 						header->idx = index + 1;
 						if (!fly) {
 							exists = 1;
@@ -1049,6 +1618,8 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 						goto redraw;
 					}
+				} else {
+					event_strfree(event, data);
 				}
 				goto end;
 			} else {
@@ -1067,7 +1638,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (zstr(data)) {
 			switch_event_del_header(event, header_name);
-			FREE(data);
+			event_strfree(event, data);
 			goto end;
 		}
 
@@ -1077,12 +1648,12 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (!strncmp(data, "ARRAY::", 7)) {
 			switch_event_add_array(event, header_name, data);
-			FREE(data);
+			event_strfree(event, data);
 			goto end;
 		}
 
 
-		header = new_header(header_name);
+		header = new_header(event, header_name);
 	}
 
 	if ((stack & SWITCH_STACK_PUSH) || (stack & SWITCH_STACK_UNSHIFT)) {
@@ -1129,7 +1700,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (len) {
 			len += 8;
-			hv = realloc(header->value, len);
+			hv = event_strrealloc(event, header->value, len);
 			switch_assert(hv);
 			header->value = hv;
 
@@ -1155,7 +1726,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 		}
 
 	} else {
-		switch_safe_free(header->value);
+		event_strfree(event, header->value);
 		header->value = data;
 	}
 
@@ -1168,6 +1739,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 			if (!event->last_header) {
 				event->last_header = header;
 			}
+			event_index_insert(event, header, SWITCH_TRUE);
 		} else {
 			if (event->last_header) {
 				event->last_header->next = header;
@@ -1176,6 +1748,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 				header->next = NULL;
 			}
 			event->last_header = header;
+			event_index_insert(event, header, SWITCH_FALSE);
 		}
 	}
 
@@ -1218,7 +1791,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *e
 SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *event, switch_stack_t stack, const char *header_name, const char *data)
 {
 	if (data) {
-		return switch_event_base_add_header(event, stack, header_name, (stack & SWITCH_STACK_NODUP) ? (char *)data : DUP(data));
+		return switch_event_base_add_header(event, stack, header_name, (stack & SWITCH_STACK_NODUP) ? (char *)data : event_strdup(event, data));
 	}
 	return SWITCH_STATUS_GENERR;
 }
@@ -1266,34 +1839,9 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 		for (hp = ep->headers; hp;) {
 			this = hp;
 			hp = hp->next;
-
-			if (this->idx) {
-				if (!this->array) {
-					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "INDEX WITH NO ARRAY WTF?? [%s][%s]\n", this->name, this->value);
-				} else {
-					int i = 0;
-
-					for (i = 0; i < this->idx; i++) {
-						FREE(this->array[i]);
-					}
-					FREE(this->array);
-				}
-			}
-
-			FREE(this->name);
-			FREE(this->value);
-
-
-#ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, this) != SWITCH_STATUS_SUCCESS) {
-				FREE(this);
-			}
-#else
-			FREE(this);
-#endif
-
-
+			event_free_header(ep, this);
 		}
+		event_arena_release(ep->arena);
 		FREE(ep->body);
 		FREE(ep->subclass_name);
 #ifdef SWITCH_EVENT_RECYCLE
@@ -1345,14 +1893,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_
 			continue;
 		}
 
-		if (hp->idx) {
-			int i;
-			for (i = 0; i < hp->idx; i++) {
-				switch_event_add_header_string(*event, SWITCH_STACK_PUSH, hp->name, hp->array[i]);
-			}
-		} else {
-			switch_event_add_header_string(*event, SWITCH_STACK_BOTTOM, hp->name, hp->value);
-		}
+		event_copy_header(*event, hp);
 	}
 
 	if (todup->body) {
@@ -1521,6 +2062,223 @@ SWITCH_DECLARE(switch_status_t) switch_event_binary_serialize(switch_event_t *ev
 }
 
 
+/*
+  Length prefixed binary frame, every integer is a 32 bit big endian word:
+
+  magic "FSB1" | event id | header count | body length
+  header count times: name length | value length | name | value
+  body
+
+  The lengths include the terminating NUL of each string so a receiver can use the strings in place.
+  A body length of 0 means there is no body.
+*/
+#define EVENT_BINARY_MAGIC 0x46534231
+#define EVENT_BINARY_PREAMBLE 16
+
+static void event_binary_put32(unsigned char *p, uint32_t v)
+{
+	p[0] = (unsigned char) (v >> 24);
+	p[1] = (unsigned char) (v >> 16);
+	p[2] = (unsigned char) (v >> 8);
+	p[3] = (unsigned char) v;
+}
+
+static uint32_t event_binary_get32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+SWITCH_DECLARE(switch_size_t) switch_event_binary_frame_size(switch_event_t *event)
+{
+	switch_event_header_t *hp;
+	switch_size_t len = EVENT_BINARY_PREAMBLE;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		len += 8 + strlen(hp->name) + 1 + strlen(switch_str_nil(hp->value)) + 1;
+	}
+
+	if (event->body) {
+		len += strlen(event->body) + 1;
+	}
+
+	return len;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_send(switch_socket_t *sock, switch_event_t *event, const char *prefix, switch_size_t prefix_len)
+{
+	switch_event_header_t *hp;
+	switch_io_vec_t *vec;
+	unsigned char *words, *w;
+	uint32_t count = 0;
+	int32_t nvec = 0;
+	switch_size_t len = 0;
+	switch_status_t status;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		count++;
+	}
+
+	/* the length words are the only thing built here, names and values go out straight from the event */
+	switch_zmalloc(vec, (3 + count * 3) * sizeof(*vec) + EVENT_BINARY_PREAMBLE + count * 8);
+	w = words = (unsigned char *) (vec + 3 + count * 3);
+
+	if (prefix && prefix_len) {
+		vec[nvec].base = prefix;
+		vec[nvec++].len = prefix_len;
+	}
+
+	event_binary_put32(w, EVENT_BINARY_MAGIC);
+	event_binary_put32(w + 4, (uint32_t) event->event_id);
+	event_binary_put32(w + 8, count);
+	event_binary_put32(w + 12, event->body ? (uint32_t) strlen(event->body) + 1 : 0);
+	vec[nvec].base = w;
+	vec[nvec++].len = EVENT_BINARY_PREAMBLE;
+	w += EVENT_BINARY_PREAMBLE;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		const char *value = switch_str_nil(hp->value);
+		switch_size_t nlen = strlen(hp->name) + 1, vlen = strlen(value) + 1;
+
+		event_binary_put32(w, (uint32_t) nlen);
+		event_binary_put32(w + 4, (uint32_t) vlen);
+		vec[nvec].base = w;
+		vec[nvec++].len = 8;
+		vec[nvec].base = hp->name;
+		vec[nvec++].len = nlen;
+		vec[nvec].base = value;
+		vec[nvec++].len = vlen;
+		w += 8;
+	}
+
+	if (event->body) {
+		vec[nvec].base = event->body;
+		vec[nvec++].len = strlen(event->body) + 1;
+	}
+
+	status = switch_socket_sendv(sock, vec, nvec, &len);
+
+	free(vec);
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_render(switch_event_t *event, char **data, switch_size_t *len)
+{
+	switch_event_header_t *hp;
+	switch_size_t total = switch_event_binary_frame_size(event);
+	unsigned char *buf, *p;
+	uint32_t count = 0;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		count++;
+	}
+
+	switch_malloc(buf, total);
+	p = buf;
+
+	event_binary_put32(p, EVENT_BINARY_MAGIC);
+	event_binary_put32(p + 4, (uint32_t) event->event_id);
+	event_binary_put32(p + 8, count);
+	event_binary_put32(p + 12, event->body ? (uint32_t) strlen(event->body) + 1 : 0);
+	p += EVENT_BINARY_PREAMBLE;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		const char *value = switch_str_nil(hp->value);
+		switch_size_t nlen = strlen(hp->name) + 1, vlen = strlen(value) + 1;
+
+		event_binary_put32(p, (uint32_t) nlen);
+		event_binary_put32(p + 4, (uint32_t) vlen);
+		memcpy(p + 8, hp->name, nlen);
+		memcpy(p + 8 + nlen, value, vlen);
+		p += 8 + nlen + vlen;
+	}
+
+	if (event->body) {
+		memcpy(p, event->body, strlen(event->body) + 1);
+	}
+
+	*data = (char *) buf;
+	*len = total;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_binary_frame_parse(switch_event_t **eventp, const char *data, switch_size_t len)
+{
+	const unsigned char *p = (const unsigned char *) data, *end = p + len;
+	switch_event_t *event = NULL;
+	uint32_t event_id, count, blen, i;
+	const char *subclass;
+
+	*eventp = NULL;
+
+	if (len < EVENT_BINARY_PREAMBLE || event_binary_get32(p) != EVENT_BINARY_MAGIC) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	event_id = event_binary_get32(p + 4);
+	count = event_binary_get32(p + 8);
+	blen = event_binary_get32(p + 12);
+	p += EVENT_BINARY_PREAMBLE;
+
+	if (event_id > SWITCH_EVENT_ALL) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_event_create(&event, SWITCH_EVENT_CLONE);
+	switch_assert(event);
+	event->event_id = (switch_event_types_t) event_id;
+
+	for (i = 0; i < count; i++) {
+		uint32_t nlen, vlen;
+		const char *name, *value;
+
+		if ((switch_size_t) (end - p) < 8) {
+			goto fail;
+		}
+
+		nlen = event_binary_get32(p);
+		vlen = event_binary_get32(p + 4);
+		p += 8;
+
+		if (!nlen || !vlen || nlen > (switch_size_t) (end - p) || vlen > (switch_size_t) (end - p) - nlen) {
+			goto fail;
+		}
+
+		name = (const char *) p;
+		value = name + nlen;
+
+		if (name[nlen - 1] != '\0' || value[vlen - 1] != '\0') {
+			goto fail;
+		}
+
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, name, value);
+		p += nlen + vlen;
+	}
+
+	if (blen) {
+		if (blen > (switch_size_t) (end - p) || p[blen - 1] != '\0') {
+			goto fail;
+		}
+
+		event->body = DUP((const char *) p);
+	}
+
+	if ((subclass = switch_event_get_header(event, "Event-Subclass"))) {
+		event->subclass_name = DUP(subclass);
+	}
+
+	*eventp = event;
+
+	return SWITCH_STATUS_SUCCESS;
+
+ fail:
+
+	switch_event_destroy(&event);
+
+	return SWITCH_STATUS_FALSE;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_serialize(switch_event_t *event, char **str, switch_bool_t encode)
 {
 	switch_size_t len = 0;
@@ -2054,6 +2812,13 @@ SWITCH_DECLARE(switch_status_t) switch_event_get_custom_events(switch_console_ca
 
 SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, switch_event_types_t event, const char *subclass_name,
 															switch_event_callback_t callback, void *user_data, switch_event_node_t **node)
+{
+	return switch_event_bind_removable_flags(id, event, subclass_name, callback, user_data, SEBF_NONE, node);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_bind_removable_flags(const char *id, switch_event_types_t event, const char *subclass_name,
+																  switch_event_callback_t callback, void *user_data, switch_event_bind_flag_t flags,
+																  switch_event_node_t **node)
 {
 	switch_event_node_t *event_node;
 	switch_event_subclass_t *subclass = NULL;
@@ -2083,7 +2848,16 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 	}
 
 	if (event <= SWITCH_EVENT_ALL) {
+		switch_memory_pool_t *pool = NULL;
+		switch_event_node_t **head = &EVENT_NODES[event];
+
+		switch_core_new_memory_pool(&pool);
 		switch_zmalloc(event_node, sizeof(*event_node));
+		event_node->pool = pool;
+		switch_queue_create(&event_node->queue, SUBSCRIBER_QUEUE_LEN, pool);
+		switch_mutex_init(&event_node->mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_atomic_set(&event_node->refs, 1);
+
 		switch_thread_rwlock_wrlock(RWLOCK);
 		switch_mutex_lock(BLOCK);
 		/* <LOCKED> ----------------------------------------------- */
@@ -2094,12 +2868,24 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 		}
 		event_node->callback = callback;
 		event_node->user_data = user_data;
+		event_node->flags = flags;
 
-		if (EVENT_NODES[event]) {
-			event_node->next = EVENT_NODES[event];
+		if (switch_event_node_by_subclass(subclass_name)) {
+			event_subclass_nodes_t *nodes;
+
+			if (!(nodes = switch_core_hash_find(EVENT_SUBCLASS_NODES, subclass_name))) {
+				switch_zmalloc(nodes, sizeof(*nodes));
+				switch_core_hash_insert_destructor(EVENT_SUBCLASS_NODES, subclass_name, nodes, free);
+			}
+
+			head = &nodes->head;
+		}
+
+		if (*head) {
+			event_node->next = *head;
 		}
 
-		EVENT_NODES[event] = event_node;
+		*head = event_node;
 		switch_mutex_unlock(BLOCK);
 		switch_thread_rwlock_unlock(RWLOCK);
 		/* </LOCKED> ----------------------------------------------- */
@@ -2122,83 +2908,155 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_t
 }
 
 
-SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
+/* call with RWLOCK and BLOCK held, moves the nodes for callback (or the node match) from the list at head to removed */
+static int switch_event_unlink_nodes(switch_event_node_t **head, switch_event_callback_t callback, switch_event_node_t *match, switch_event_node_t **removed)
 {
 	switch_event_node_t *n, *np, *lnp = NULL;
-	switch_status_t status = SWITCH_STATUS_FALSE;
-	int id;
+	int x = 0;
+
+	for (np = *head; np;) {
+		n = np;
+		np = np->next;
+		if ((callback && n->callback == callback) || n == match) {
+			if (lnp) {
+				lnp->next = n->next;
+			} else {
+				*head = n->next;
+			}
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
+			n->next = *removed;
+			*removed = n;
+			x++;
+		} else {
+			lnp = n;
+		}
+	}
+
+	return x;
+}
+
+static void switch_event_unbound_nodes(switch_event_node_t *removed)
+{
+	switch_event_node_t *n;
+
+	while ((n = removed)) {
+		removed = n->next;
+		n->next = NULL;
+		switch_event_node_unbound(n);
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
+{
+	switch_event_node_t *removed = NULL;
+	switch_hash_index_t *hi;
+	void *val;
+	int id, x = 0;
 
 	switch_thread_rwlock_wrlock(RWLOCK);
 	switch_mutex_lock(BLOCK);
 	/* <LOCKED> ----------------------------------------------- */
 	for (id = 0; id <= SWITCH_EVENT_ALL; id++) {
-		lnp = NULL;
-
-		for (np = EVENT_NODES[id]; np;) {
-			n = np;
-			np = np->next;
-			if (n->callback == callback) {
-				if (lnp) {
-					lnp->next = n->next;
-				} else {
-					EVENT_NODES[n->event_id] = n->next;
-				}
+		x += switch_event_unlink_nodes(&EVENT_NODES[id], callback, NULL, &removed);
+	}
 
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-				FREE(n->subclass_name);
-				FREE(n->id);
-				FREE(n);
-				status = SWITCH_STATUS_SUCCESS;
-			} else {
-				lnp = n;
-			}
-		}
+	for (hi = switch_core_hash_first(EVENT_SUBCLASS_NODES); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		x += switch_event_unlink_nodes(&((event_subclass_nodes_t *) val)->head, callback, NULL, &removed);
 	}
 	switch_mutex_unlock(BLOCK);
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
-	return status;
+	switch_event_unbound_nodes(removed);
+
+	return x ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
 }
 
 
 
 SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 {
-	switch_event_node_t *n, *np, *lnp = NULL;
-	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_event_node_t *n, *removed = NULL, **head;
+	event_subclass_nodes_t *nodes;
 
 	n = *node;
 
 	if (!n) {
-		return status;
+		return SWITCH_STATUS_FALSE;
 	}
 
 	switch_thread_rwlock_wrlock(RWLOCK);
 	switch_mutex_lock(BLOCK);
 	/* <LOCKED> ----------------------------------------------- */
-	for (np = EVENT_NODES[n->event_id]; np; np = np->next) {
-		if (np == n) {
-			if (lnp) {
-				lnp->next = n->next;
-			} else {
-				EVENT_NODES[n->event_id] = n->next;
-			}
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-			FREE(n->subclass_name);
-			FREE(n->id);
-			FREE(n);
-			*node = NULL;
-			status = SWITCH_STATUS_SUCCESS;
-			break;
-		}
-		lnp = np;
+	head = &EVENT_NODES[n->event_id];
+
+	if (switch_event_node_by_subclass(n->subclass_name) && (nodes = switch_core_hash_find(EVENT_SUBCLASS_NODES, n->subclass_name))) {
+		head = &nodes->head;
 	}
+
+	switch_event_unlink_nodes(head, NULL, n, &removed);
 	switch_mutex_unlock(BLOCK);
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
-	return status;
+	if (!removed) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*node = NULL;
+	switch_event_unbound_nodes(removed);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static int switch_event_node_stats(switch_event_node_t *node, switch_core_db_callback_func_t callback, void *pArg)
+{
+	char *names[] = { "id", "event", "subclass", "backlog", "max_backlog", "delivered", "dropped" };
+	char *vals[7];
+	char backlog[32], max_backlog[32], delivered[32], dropped[32];
+	int r = 0;
+
+	for (; node && !r; node = node->next) {
+		switch_snprintf(backlog, sizeof(backlog), "%u", switch_queue_size(node->queue));
+		switch_snprintf(max_backlog, sizeof(max_backlog), "%u", node->max_backlog);
+		switch_snprintf(delivered, sizeof(delivered), "%u", switch_atomic_read(&node->delivered));
+		switch_snprintf(dropped, sizeof(dropped), "%u", switch_atomic_read(&node->dropped));
+
+		vals[0] = node->id;
+		vals[1] = (char *) switch_event_name(node->event_id);
+		vals[2] = node->subclass_name ? node->subclass_name : "";
+		vals[3] = backlog;
+		vals[4] = max_backlog;
+		vals[5] = delivered;
+		vals[6] = dropped;
+
+		r = callback(pArg, 7, vals, names);
+	}
+
+	return r;
+}
+
+SWITCH_DECLARE(void) switch_event_subscriber_stats(switch_core_db_callback_func_t callback, void *pArg)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	int id, r = 0;
+
+	switch_thread_rwlock_rdlock(RWLOCK);
+	for (id = 0; id <= SWITCH_EVENT_ALL && !r; id++) {
+		r = switch_event_node_stats(EVENT_NODES[id], callback, pArg);
+	}
+
+	for (hi = switch_core_hash_first(EVENT_SUBCLASS_NODES); hi; hi = switch_core_hash_next(&hi)) {
+		if (r) {
+			continue;
+		}
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		r = switch_event_node_stats(((event_subclass_nodes_t *) val)->head, callback, pArg);
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
 }
 
 SWITCH_DECLARE(switch_status_t) switch_event_create_pres_in_detailed(char *file, char *func, int line,
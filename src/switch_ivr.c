@@ -2693,6 +2693,10 @@ SWITCH_DECLARE(int) switch_ivr_set_xml_call_stats(switch_xml_t xml, switch_core_
 	add_stat(x_in, stats->inbound.cng_packet_count, "cng_packet_count");
 	add_stat(x_in, stats->inbound.flush_packet_count, "flush_packet_count");
 	add_stat(x_in, stats->inbound.largest_jb_size, "largest_jb_size");
+	add_stat(x_in, stats->inbound.jb_target_delay, "jb_target_delay_ms");
+	add_stat(x_in, stats->inbound.jb_delay, "jb_delay_ms");
+	add_stat(x_in, stats->inbound.jb_accelerate_count, "jb_accelerate_count");
+	add_stat(x_in, stats->inbound.jb_expand_count, "jb_expand_count");
 	add_stat_double(x_in, stats->inbound.min_variance, "jitter_min_variance");
 	add_stat_double(x_in, stats->inbound.max_variance, "jitter_max_variance");
 	add_stat_double(x_in, stats->inbound.lossrate, "jitter_loss_rate");
@@ -3200,6 +3204,10 @@ SWITCH_DECLARE(void) switch_ivr_set_json_call_stats(cJSON *json, switch_core_ses
 	add_jstat(j_in, stats->inbound.cng_packet_count, "cng_packet_count");
 	add_jstat(j_in, stats->inbound.flush_packet_count, "flush_packet_count");
 	add_jstat(j_in, stats->inbound.largest_jb_size, "largest_jb_size");
+	add_jstat(j_in, stats->inbound.jb_target_delay, "jb_target_delay_ms");
+	add_jstat(j_in, stats->inbound.jb_delay, "jb_delay_ms");
+	add_jstat(j_in, stats->inbound.jb_accelerate_count, "jb_accelerate_count");
+	add_jstat(j_in, stats->inbound.jb_expand_count, "jb_expand_count");
 	add_jstat(j_in, stats->inbound.min_variance, "jitter_min_variance");
 	add_jstat(j_in, stats->inbound.max_variance, "jitter_max_variance");
 	add_jstat(j_in, stats->inbound.lossrate, "jitter_loss_rate");
@@ -1151,6 +1151,15 @@ struct record_helper {
 	const char *completion_cause;
 	int start_event_sent;
 	switch_event_t *variables;
+	int writer;
+	int writer_queued;
+	int writer_busy;
+	int writer_closing;
+	int writer_error;
+	int writer_channels;
+	uint32_t writer_chunk;
+	switch_time_t writer_since;
+	switch_time_t writer_queued_at;
 };
 
 /**
@@ -1298,6 +1307,331 @@ static void *SWITCH_THREAD_FUNC recording_thread(switch_thread_t *thread, void *
 	return NULL;
 }
 
+/* Recording writer pool: a few threads shared by every recording instead of one thread each.  The media bug only
+   appends to the recording's buffer and queues the recording once enough audio has gathered, a writer drains it
+   in page sized multiples so the file sees a handful of large writes instead of one per frame. */
+
+#define RECORD_WRITER_MAX_THREADS 64
+#define RECORD_WRITER_ALIGN 4096
+#define RECORD_WRITER_COALESCE (RECORD_WRITER_ALIGN * 8)
+#define RECORD_WRITER_BUFFER (RECORD_WRITER_ALIGN * 64)
+#define RECORD_WRITER_MAX_DELAY 1000000
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_queue_t *queue;
+	switch_thread_t *thread[RECORD_WRITER_MAX_THREADS];
+	uint32_t threads;
+	uint32_t alive;
+	int running;
+	uint32_t recordings;
+	uint32_t errors;
+	uint64_t writes;
+	uint64_t bytes;
+	switch_time_t latency_total;
+	switch_time_t latency_max;
+} record_writer;
+
+static void record_writer_drain(struct record_helper *rh, uint8_t *data, switch_size_t datalen, switch_bool_t final)
+{
+	switch_size_t inuse, bytes, samples;
+	switch_time_t queued_at, now;
+
+	switch_mutex_lock(rh->buffer_mutex);
+	if (!final) {
+		rh->writer_queued = 0;
+
+		if (rh->writer_closing) {
+			switch_mutex_unlock(rh->buffer_mutex);
+			return;
+		}
+
+		rh->writer_busy = 1;
+	}
+	queued_at = rh->writer_queued_at;
+	switch_mutex_unlock(rh->buffer_mutex);
+
+	for (;;) {
+		switch_mutex_lock(rh->buffer_mutex);
+		inuse = switch_buffer_inuse(rh->thread_buffer);
+
+		if (final) {
+			bytes = inuse > datalen ? datalen : inuse;
+			bytes -= bytes % (2 * rh->writer_channels);
+		} else if (rh->writer_chunk) {
+			bytes = inuse >= rh->writer_chunk ? rh->writer_chunk : 0;
+		} else {
+			bytes = inuse > datalen ? datalen : inuse;
+			bytes -= bytes % RECORD_WRITER_ALIGN;
+		}
+
+		if (!bytes) {
+			switch_mutex_unlock(rh->buffer_mutex);
+			break;
+		}
+
+		bytes = switch_buffer_read(rh->thread_buffer, data, bytes);
+		rh->writer_since = inuse > bytes ? switch_micro_time_now() : 0;
+		switch_mutex_unlock(rh->buffer_mutex);
+
+		samples = bytes / 2 / rh->writer_channels;
+
+		if (switch_core_file_write(rh->fh, data, &samples) != SWITCH_STATUS_SUCCESS) {
+			rh->writer_error = 1;
+			switch_mutex_lock(record_writer.mutex);
+			record_writer.errors++;
+			switch_mutex_unlock(record_writer.mutex);
+			break;
+		}
+
+		now = switch_micro_time_now();
+		switch_mutex_lock(record_writer.mutex);
+		record_writer.writes++;
+		record_writer.bytes += bytes;
+		if (!final && queued_at && now > queued_at) {
+			record_writer.latency_total += now - queued_at;
+			if (now - queued_at > record_writer.latency_max) {
+				record_writer.latency_max = now - queued_at;
+			}
+		}
+		switch_mutex_unlock(record_writer.mutex);
+	}
+
+	if (!final) {
+		switch_mutex_lock(rh->buffer_mutex);
+		rh->writer_busy = 0;
+		switch_mutex_unlock(rh->buffer_mutex);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC record_writer_thread(switch_thread_t *thread, void *obj)
+{
+	uint8_t *data = malloc(RECORD_WRITER_BUFFER);
+	void *pop = NULL;
+
+	switch_assert(data);
+
+	while (record_writer.running == 1) {
+		if (switch_queue_pop_timeout(record_writer.queue, &pop, 500000) != SWITCH_STATUS_SUCCESS || !pop) {
+			continue;
+		}
+
+		record_writer_drain((struct record_helper *) pop, data, RECORD_WRITER_BUFFER, SWITCH_FALSE);
+	}
+
+	free(data);
+
+	switch_mutex_lock(record_writer.mutex);
+	record_writer.alive--;
+	switch_mutex_unlock(record_writer.mutex);
+
+	return NULL;
+}
+
+static switch_bool_t record_writer_attach(switch_media_bug_t *bug, struct record_helper *rh)
+{
+	switch_bool_t attached = SWITCH_FALSE;
+
+	if (record_writer.running != 1) {
+		return SWITCH_FALSE;
+	}
+
+	rh->writer_queued = rh->writer_busy = rh->writer_closing = rh->writer_error = 0;
+	rh->writer_since = rh->writer_queued_at = 0;
+	rh->writer_chunk = 0;
+	rh->writer_channels = switch_core_media_bug_test_flag(bug, SMBF_STEREO) ? 2 : rh->read_impl.number_of_channels;
+
+	if (rh->writer_channels < 1) {
+		rh->writer_channels = 1;
+	}
+
+	/* video files want their audio a packet at a time to stay in step with the frames */
+	if (switch_core_file_has_video(rh->fh, SWITCH_TRUE) &&
+		rh->read_impl.decoded_bytes_per_packet > 0 && rh->read_impl.decoded_bytes_per_packet <= SWITCH_RECOMMENDED_BUFFER_SIZE) {
+		rh->writer_chunk = rh->read_impl.decoded_bytes_per_packet;
+	}
+
+	switch_buffer_create_dynamic(&rh->thread_buffer, 1024 * 512, 1024 * 64, 0);
+
+	switch_mutex_lock(record_writer.mutex);
+	if (record_writer.running == 1) {
+		record_writer.recordings++;
+		rh->writer = 1;
+		attached = SWITCH_TRUE;
+	}
+	switch_mutex_unlock(record_writer.mutex);
+
+	if (!attached) {
+		switch_buffer_destroy(&rh->thread_buffer);
+	}
+
+	return attached;
+}
+
+static void record_writer_queue(struct record_helper *rh)
+{
+	switch_time_t now = switch_micro_time_now();
+	switch_size_t inuse;
+	int push = 0;
+
+	switch_mutex_lock(rh->buffer_mutex);
+	inuse = switch_buffer_inuse(rh->thread_buffer);
+
+	if (inuse && !rh->writer_since) {
+		rh->writer_since = now;
+	}
+
+	if (!rh->writer_queued && !rh->writer_busy && inuse) {
+		if (rh->writer_chunk) {
+			push = inuse >= rh->writer_chunk;
+		} else {
+			push = inuse >= RECORD_WRITER_COALESCE || (inuse >= RECORD_WRITER_ALIGN && now - rh->writer_since >= RECORD_WRITER_MAX_DELAY);
+		}
+
+		if (push) {
+			rh->writer_queued = 1;
+			rh->writer_queued_at = now;
+		}
+	}
+	switch_mutex_unlock(rh->buffer_mutex);
+
+	/* a full queue only means the audio waits for the next frame */
+	if (push && (record_writer.running != 1 || switch_queue_trypush(record_writer.queue, rh) != SWITCH_STATUS_SUCCESS)) {
+		switch_mutex_lock(rh->buffer_mutex);
+		rh->writer_queued = 0;
+		switch_mutex_unlock(rh->buffer_mutex);
+	}
+}
+
+static void record_writer_detach(struct record_helper *rh)
+{
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+
+	/* wait out the writer, unless every writer thread is already gone */
+	switch_mutex_lock(rh->buffer_mutex);
+	rh->writer_closing = 1;
+	while (rh->writer_busy || (rh->writer_queued && record_writer.alive)) {
+		switch_mutex_unlock(rh->buffer_mutex);
+		switch_yield(1000);
+		switch_mutex_lock(rh->buffer_mutex);
+	}
+	switch_mutex_unlock(rh->buffer_mutex);
+
+	if (!rh->writer_error) {
+		record_writer_drain(rh, data, sizeof(data), SWITCH_TRUE);
+	}
+
+	switch_mutex_lock(record_writer.mutex);
+	record_writer.recordings--;
+	switch_mutex_unlock(record_writer.mutex);
+
+	rh->writer = 0;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_ivr_record_writer_start(uint32_t threads)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	if (record_writer.running) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!threads) {
+		threads = switch_core_cpu_count() / 4;
+		if (threads < 2) threads = 2;
+	}
+
+	if (threads > RECORD_WRITER_MAX_THREADS) {
+		threads = RECORD_WRITER_MAX_THREADS;
+	}
+
+	if (switch_core_new_memory_pool(&record_writer.pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	switch_mutex_init(&record_writer.mutex, SWITCH_MUTEX_NESTED, record_writer.pool);
+	switch_queue_create(&record_writer.queue, SWITCH_CORE_QUEUE_LEN, record_writer.pool);
+	record_writer.running = 1;
+
+	switch_threadattr_create(&thd_attr, record_writer.pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < threads; i++) {
+		if (switch_thread_create(&record_writer.thread[i], thd_attr, record_writer_thread, NULL, record_writer.pool) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+		record_writer.alive++;
+	}
+
+	record_writer.threads = i;
+
+	if (!i) {
+		record_writer.running = 0;
+		switch_core_destroy_memory_pool(&record_writer.pool);
+		memset(&record_writer, 0, sizeof(record_writer));
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Started %u recording writer thread%s\n", i, i == 1 ? "" : "s");
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_ivr_record_writer_stop(void)
+{
+	switch_status_t st;
+	void *pop;
+	uint32_t i;
+
+	if (record_writer.running != 1) {
+		return;
+	}
+
+	record_writer.running = -1;
+
+	for (i = 0; i < record_writer.threads; i++) {
+		switch_queue_trypush(record_writer.queue, NULL);
+	}
+
+	for (i = 0; i < record_writer.threads; i++) {
+		switch_thread_join(&st, record_writer.thread[i]);
+	}
+
+	/* anything still queued belongs to a recording that will flush it when it closes */
+	while (switch_queue_trypop(record_writer.queue, &pop) == SWITCH_STATUS_SUCCESS);
+
+	if (record_writer.recordings) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Stopping recording writers with %u recording%s open\n",
+						  record_writer.recordings, record_writer.recordings == 1 ? "" : "s");
+		return;
+	}
+
+	switch_core_destroy_memory_pool(&record_writer.pool);
+	memset(&record_writer, 0, sizeof(record_writer));
+}
+
+SWITCH_DECLARE(void) switch_ivr_record_writer_stats(switch_ivr_record_writer_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!record_writer.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(record_writer.mutex);
+	stats->threads = record_writer.running == 1 ? record_writer.threads : 0;
+	stats->recordings = record_writer.recordings;
+	stats->queue_depth = record_writer.queue ? switch_queue_size(record_writer.queue) : 0;
+	stats->writes = record_writer.writes;
+	stats->bytes = record_writer.bytes;
+	stats->errors = record_writer.errors;
+	stats->avg_latency_us = record_writer.writes ? (uint32_t) (record_writer.latency_total / (switch_time_t) record_writer.writes) : 0;
+	stats->max_latency_us = (uint32_t) record_writer.latency_max;
+	switch_mutex_unlock(record_writer.mutex);
+}
+
 static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
 {
 	switch_core_session_t *session = switch_core_media_bug_get_session(bug);
@@ -1322,12 +1656,15 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 
 				switch_core_session_get_read_impl(session, &rh->read_impl);
 				switch_mutex_init(&rh->buffer_mutex, SWITCH_MUTEX_NESTED, pool);
-				switch_threadattr_create(&thd_attr, pool);
-				switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-				switch_thread_create(&rh->thread, thd_attr, recording_thread, bug, pool);
 
-				while(--sanity > 0 && !rh->thread_ready) {
-					switch_yield(10000);
+				if (!record_writer_attach(bug, rh)) {
+					switch_threadattr_create(&thd_attr, pool);
+					switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+					switch_thread_create(&rh->thread, thd_attr, recording_thread, bug, pool);
+
+					while(--sanity > 0 && !rh->thread_ready) {
+						switch_yield(10000);
+					}
 				}
 			}
 
@@ -1463,6 +1800,10 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 					switch_thread_join(&st, rh->thread);
 				}
 
+				if (rh->writer) {
+					record_writer_detach(rh);
+				}
+
 				if (rh->thread_buffer) {
 					switch_buffer_destroy(&rh->thread_buffer);
 				}
@@ -1582,11 +1923,16 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 				} else {
 					len = (switch_size_t) frame.datalen / 2 / frame.channels;
 
-					if (rh->thread_buffer) {
+					if (rh->writer && !rh->writer_error) {
+						switch_mutex_lock(rh->buffer_mutex);
+						switch_buffer_write(rh->thread_buffer, mask ? null_data : data, frame.datalen);
+						switch_mutex_unlock(rh->buffer_mutex);
+						record_writer_queue(rh);
+					} else if (rh->thread_buffer && !rh->writer) {
 						switch_mutex_lock(rh->buffer_mutex);
 						switch_buffer_write(rh->thread_buffer, mask ? null_data : data, frame.datalen);
 						switch_mutex_unlock(rh->buffer_mutex);
-					} else if (switch_core_file_write(rh->fh, mask ? null_data : data, &len) != SWITCH_STATUS_SUCCESS) {
+					} else if (rh->writer_error || switch_core_file_write(rh->fh, mask ? null_data : data, &len) != SWITCH_STATUS_SUCCESS) {
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
 						/* File write failed */
 						set_completion_cause(rh, "uri-failure");
@@ -1787,6 +2133,8 @@ static void* switch_ivr_record_user_data_dup(switch_core_session_t *session, voi
 	dup->fh = switch_core_session_alloc(session, sizeof(switch_file_handle_t));
 	memcpy(dup->fh, rh->fh, sizeof(switch_file_handle_t));
 	dup->variables = NULL;
+	/* the old bug still owns its writer state, the new one attaches on init */
+	dup->writer = dup->writer_queued = dup->writer_busy = dup->writer_closing = dup->writer_error = 0;
 	if (rh->variables) {
 		switch_event_dup(&dup->variables, rh->variables);
 		switch_event_safe_destroy(rh->variables);
@@ -37,6 +37,13 @@
 #define RENACK_TIME 100000
 #define MAX_FRAME_PADDING 2
 #define MAX_MISSING_SEQ 20
+/* adaptive audio: packets the relative delay is measured over, histogram size in frames and its memory */
+#define JB_DELAY_WINDOW 64
+#define JB_DELAY_BUCKETS 64
+#define JB_DELAY_FORGET 0.9983
+#define JB_DELAY_QUANTILE 0.95
+#define JB_LEVEL_FILTER 16
+#define JB_STRETCH_WAIT 4
 #define jb_debug(_jb, _level, _format, ...) if (_jb->debug_level >= _level) switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(_jb->session), SWITCH_LOG_ALERT, "JB:%p:%s:%d/%d lv:%d ln:%.4d sz:%.3u/%.3u/%.3u/%.3u c:%.3u %.3u/%.3u/%.3u/%.3u %.2f%% ->" _format, (void *) _jb, (jb->type == SJB_TEXT ? "txt" : (jb->type == SJB_AUDIO ? "aud" : "vid")), _jb->allocated_nodes, _jb->visible_nodes, _level, __LINE__,  _jb->min_frame_len, _jb->max_frame_len, _jb->frame_len, _jb->complete_frames, _jb->period_count, _jb->consec_good_count, _jb->period_good_count, _jb->consec_miss_count, _jb->period_miss_count, _jb->period_miss_pct, __VA_ARGS__)
 
 //const char *TOKEN_1 = "ONE";
@@ -50,14 +57,30 @@ typedef struct switch_jb_node_s {
 	uint32_t len;
 	uint8_t visible;
 	uint8_t bad_hits;
-	struct switch_jb_node_s *prev;
+	/* the seq the node is filed under in the ring, reading by ts rewrites the one in the packet */
+	uint16_t ring_seq;
+	/* position in the timestamp heap */
+	uint32_t heap_pos;
+	/* other nodes of the same frame */
+	struct switch_jb_node_s *ts_prev;
+	struct switch_jb_node_s *ts_next;
+	/* free list, last hidden first */
 	struct switch_jb_node_s *next;
 	/* used for counting the number of partial or complete frames currently in the JB */
 	switch_bool_t complete_frame_mark;
 } switch_jb_node_t;
 
 struct switch_jb_s {
-	struct switch_jb_node_s *node_list;
+	/* visible nodes indexed by seq modulo ring_size, ring_low and ring_high are the oldest and newest seq */
+	struct switch_jb_node_s **ring;
+	uint32_t ring_size;
+	uint16_t ring_low;
+	uint16_t ring_high;
+	/* visible nodes ordered by timestamp, oldest on top */
+	struct switch_jb_node_s **ts_heap;
+	uint32_t heap_len;
+	uint32_t heap_size;
+	struct switch_jb_node_s *free_list;
 	uint32_t last_target_seq;
 	uint32_t highest_read_ts;
 	uint32_t highest_dropped_ts;
@@ -94,7 +117,6 @@ struct switch_jb_s {
 	uint16_t next_seq;
 	switch_size_t last_len;
 	switch_inthash_t *missing_seq_hash;
-	switch_inthash_t *node_hash;
 	switch_inthash_t *node_hash_ts;
 	switch_mutex_t *mutex;
 	switch_mutex_t *list_mutex;
@@ -112,115 +134,205 @@ struct switch_jb_s {
 	uint32_t period_len;
 	uint32_t nack_saved_the_day;
 	uint32_t nack_didnt_save_the_day;
+	/* adaptive audio, transit is arrival time minus ts in samples */
+	uint32_t delay_spf;
+	uint32_t delay_rate;
+	uint32_t transit[JB_DELAY_WINDOW];
+	uint32_t transit_count;
+	uint32_t transit_pos;
+	double delay_hist[JB_DELAY_BUCKETS];
+	uint32_t target_frames;
+	double level_avg;
+	uint32_t stretch_wait;
+	int last_accelerate;
+	uint32_t accelerate_count;
+	uint32_t expand_count;
 };
 
+#define JB_RING_MIN 64
+#define JB_RING_MAX 65536
 
-static int node_cmp(const void *l, const void *r)
+static inline int ts_before(uint32_t a, uint32_t b)
 {
-	switch_jb_node_t *a = (switch_jb_node_t *) l;
-	switch_jb_node_t *b = (switch_jb_node_t *) r;
+	return (int32_t) (ntohl(a) - ntohl(b)) < 0;
+}
 
-	if (!a->visible) return 0;
-	if (!b->visible) return 1;
+static inline void heap_swap(switch_jb_t *jb, uint32_t a, uint32_t b)
+{
+	switch_jb_node_t *np = jb->ts_heap[a];
 
-	return ntohs(a->packet.header.seq) - ntohs(b->packet.header.seq);
+	jb->ts_heap[a] = jb->ts_heap[b];
+	jb->ts_heap[b] = np;
+	jb->ts_heap[a]->heap_pos = a;
+	jb->ts_heap[b]->heap_pos = b;
 }
 
-//http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.c
-switch_jb_node_t *sort_nodes(switch_jb_node_t *list, int (*cmp)(const void *, const void *)) {
-	switch_jb_node_t *p, *q, *e, *tail;
-	int insize, nmerges, psize, qsize, i;
-
-	if (!list) {
-		return NULL;
+static void heap_up(switch_jb_t *jb, uint32_t pos)
+{
+	while (pos && ts_before(jb->ts_heap[pos]->packet.header.ts, jb->ts_heap[(pos - 1) / 2]->packet.header.ts)) {
+		heap_swap(jb, pos, (pos - 1) / 2);
+		pos = (pos - 1) / 2;
 	}
+}
 
-	insize = 1;
+static void heap_down(switch_jb_t *jb, uint32_t pos)
+{
+	uint32_t child;
 
-	while (1) {
-		p = list;
-		list = NULL;
-		tail = NULL;
+	while ((child = pos * 2 + 1) < jb->heap_len) {
+		if (child + 1 < jb->heap_len && ts_before(jb->ts_heap[child + 1]->packet.header.ts, jb->ts_heap[child]->packet.header.ts)) {
+			child++;
+		}
 
-		nmerges = 0;  /* count number of merges we do in this pass */
+		if (!ts_before(jb->ts_heap[child]->packet.header.ts, jb->ts_heap[pos]->packet.header.ts)) {
+			break;
+		}
 
-		while (p) {
-			nmerges++;  /* there exists a merge to be done */
-			            /* step `insize' places along from p */
-			q = p;
-			psize = 0;
-			for (i = 0; i < insize; i++) {
-				psize++;
-				q = q->next;
-				if (!q) break;
-			}
+		heap_swap(jb, pos, child);
+		pos = child;
+	}
+}
 
-			/* if q hasn't fallen off end, we have two lists to merge */
-			qsize = insize;
-
-			/* now we have two lists; merge them */
-			while (psize > 0 || (qsize > 0 && q)) {
-
-				/* decide whether next switch_jb_node_t of merge comes from p or q */
-				if (psize == 0) {
-					/* p is empty; e must come from q. */
-					e = q; q = q->next; qsize--;
-				} else if (qsize == 0 || !q) {
-					/* q is empty; e must come from p. */
-					e = p; p = p->next; psize--;
-				} else if (cmp(p,q) <= 0) {
-					/* First switch_jb_node_t of p is lower (or same);
-					 * e must come from p. */
-					e = p; p = p->next; psize--;
-				} else {
-					/* First switch_jb_node_t of q is lower; e must come from q. */
-					e = q; q = q->next; qsize--;
-				}
+static void heap_remove(switch_jb_t *jb, switch_jb_node_t *node)
+{
+	uint32_t pos = node->heap_pos;
 
-				/* add the next switch_jb_node_t to the merged list */
-				if (tail) {
-					tail->next = e;
-				} else {
-					list = e;
-				}
+	if (pos >= jb->heap_len || jb->ts_heap[pos] != node) {
+		return;
+	}
 
-				/* Maintain reverse pointers in a doubly linked list. */
-				e->prev = tail;
+	if (pos != --jb->heap_len) {
+		jb->ts_heap[pos] = jb->ts_heap[jb->heap_len];
+		jb->ts_heap[pos]->heap_pos = pos;
+		heap_down(jb, pos);
+		heap_up(jb, pos);
+	}
+}
 
-				tail = e;
-			}
+static switch_status_t heap_insert(switch_jb_t *jb, switch_jb_node_t *node)
+{
+	if (jb->heap_len == jb->heap_size) {
+		uint32_t size = jb->heap_size ? jb->heap_size * 2 : JB_RING_MIN;
+		switch_jb_node_t **heap = realloc(jb->ts_heap, size * sizeof(*heap));
 
-			/* now p has stepped `insize' places along, and q has too */
-			p = q;
+		if (!heap) {
+			return SWITCH_STATUS_MEMERR;
 		}
 
-		tail->next = NULL;
+		jb->ts_heap = heap;
+		jb->heap_size = size;
+	}
+
+	node->heap_pos = jb->heap_len++;
+	jb->ts_heap[node->heap_pos] = node;
+	heap_up(jb, node->heap_pos);
+
+	return SWITCH_STATUS_SUCCESS;
+}
 
-		/* If we have done only one merge, we're finished. */
-		if (nmerges <= 1)   /* allow for nmerges==0, the empty list case */
-			return list;
+static inline switch_jb_node_t *ring_find(switch_jb_t *jb, uint16_t seq)
+{
+	switch_jb_node_t *np;
 
-		/* Otherwise repeat, merging lists twice the size */
-		insize *= 2;
+	if (!jb->ring || !jb->visible_nodes) {
+		return NULL;
 	}
+
+	seq = ntohs(seq);
+	np = jb->ring[seq & (jb->ring_size - 1)];
+
+	return (np && np->ring_seq == seq) ? np : NULL;
 }
 
-// static inline void thin_frames(switch_jb_t *jb, int freq, int max);
+static switch_status_t ring_resize(switch_jb_t *jb, uint32_t span)
+{
+	switch_jb_node_t **ring;
+	uint32_t size = jb->ring_size ? jb->ring_size : JB_RING_MIN;
+	uint32_t i;
+
+	while (size < span) {
+		size *= 2;
+	}
 
+	if (size == jb->ring_size) {
+		return SWITCH_STATUS_SUCCESS;
+	}
 
-static inline switch_jb_node_t *new_node(switch_jb_t *jb)
+	switch_zmalloc(ring, size * sizeof(*ring));
+
+	for (i = 0; i < jb->ring_size; i++) {
+		if (jb->ring[i]) {
+			ring[jb->ring[i]->ring_seq & (size - 1)] = jb->ring[i];
+		}
+	}
+
+	switch_safe_free(jb->ring);
+	jb->ring = ring;
+	jb->ring_size = size;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void hide_node(switch_jb_node_t *node);
+static inline void hide_nodes(switch_jb_t *jb);
+
+/* file a new visible node by seq, a repeated seq replaces the old copy */
+static void ring_insert(switch_jb_t *jb, switch_jb_node_t *node)
 {
+	uint16_t seq = ntohs(node->packet.header.seq);
+	uint32_t span = 1;
 	switch_jb_node_t *np;
 
-	switch_mutex_lock(jb->list_mutex);
+	if ((np = ring_find(jb, node->packet.header.seq)) && np != node) {
+		hide_node(np);
+	}
 
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) {
-			break;
+	node->ring_seq = seq;
+
+	/* the new node is already counted as visible */
+	if (jb->visible_nodes > 1) {
+		if ((int16_t) (seq - jb->ring_low) < 0) {
+			span = (uint16_t) (jb->ring_high - seq) + 1;
+		} else if ((int16_t) (seq - jb->ring_high) > 0) {
+			span = (uint16_t) (seq - jb->ring_low) + 1;
+		} else {
+			span = 0;
+		}
+
+		if (span > JB_RING_MAX / 2) {
+			/* a jump this big is a new stream, nothing buffered can be read along with it */
+			jb_debug(jb, 2, "SEQ JUMP %u -> %u, dropping %u buffered nodes\n", jb->ring_low, seq, jb->visible_nodes - 1);
+			hide_nodes(jb);
+			span = 1;
 		}
 	}
 
-	if (!np) {
+	if (jb->visible_nodes <= 1) {
+		jb->ring_low = jb->ring_high = seq;
+	} else if (span) {
+		if ((int16_t) (seq - jb->ring_low) < 0) {
+			jb->ring_low = seq;
+		} else {
+			jb->ring_high = seq;
+		}
+	}
+
+	if (span > jb->ring_size) {
+		ring_resize(jb, span);
+	}
+
+	jb->ring[seq & (jb->ring_size - 1)] = node;
+}
+
+static inline switch_jb_node_t *new_node(switch_jb_t *jb)
+{
+	switch_jb_node_t *np;
+
+	switch_mutex_lock(jb->list_mutex);
+
+	if ((np = jb->free_list)) {
+		jb->free_list = np->next;
+	} else {
 		int mult = 2;
 
 		if (jb->type != SJB_VIDEO) {
@@ -237,18 +349,13 @@ static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 			switch_mutex_unlock(jb->list_mutex);
 			return NULL;
 		}
-		
+
 		np = switch_core_alloc(jb->pool, sizeof(*np));
 		jb->allocated_nodes++;
-		np->next = jb->node_list;
-		if (np->next) {
-			np->next->prev = np;
-		}
-		jb->node_list = np;
-
 	}
 
 	switch_assert(np);
+	np->next = NULL;
 	np->bad_hits = 0;
 	np->visible = 1;
 	jb->visible_nodes++;
@@ -259,112 +366,135 @@ static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 	return np;
 }
 
-static inline void push_to_top(switch_jb_t *jb, switch_jb_node_t *node)
+/* make a filled node findable by seq and ts */
+static inline void index_node(switch_jb_t *jb, switch_jb_node_t *node)
 {
-	if (node == jb->node_list) {
-		jb->node_list = node->next;
-	} else if (node->prev) {
-		node->prev->next = node->next;
-	}
+	switch_jb_node_t *head;
 
-	if (node->next) {
-		node->next->prev = node->prev;
-	}
+	switch_mutex_lock(jb->list_mutex);
 
-	node->next = jb->node_list;
-	node->prev = NULL;
+	ring_insert(jb, node);
 
-	if (node->next) {
-		node->next->prev = node;
+	/* the hash only points at the first node of a ts, the rest of the frame hangs off it */
+	if ((head = switch_core_inthash_find(jb->node_hash_ts, node->packet.header.ts))) {
+		node->ts_prev = head;
+		if ((node->ts_next = head->ts_next)) {
+			node->ts_next->ts_prev = node;
+		}
+		head->ts_next = node;
+	} else {
+		node->ts_prev = node->ts_next = NULL;
+		switch_core_inthash_insert(jb->node_hash_ts, node->packet.header.ts, node);
 	}
 
-	jb->node_list = node;
+	if (heap_insert(jb, node) != SWITCH_STATUS_SUCCESS) {
+		/* can't be ordered, don't keep it */
+		hide_node(node);
+	}
 
-	switch_assert(node->next != node);
-	switch_assert(node->prev != node);
+	switch_mutex_unlock(jb->list_mutex);
 }
 
-static inline void hide_node(switch_jb_node_t *node, switch_bool_t pop)
+static void hide_node(switch_jb_node_t *node)
 {
 	switch_jb_t *jb = node->parent;
+	switch_jb_node_t *np;
+	uint32_t mask = jb->ring_size - 1;
 
 	switch_mutex_lock(jb->list_mutex);
 
-	if (node->visible) {
-		node->visible = 0;
-		node->bad_hits = 0;
-		jb->visible_nodes--;
-
-		if (pop) {
-			push_to_top(jb, node);
-		}
+	if (!node->visible) {
+		switch_mutex_unlock(jb->list_mutex);
+		return;
 	}
 
-	if (jb->node_hash_ts) {
-		switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
-	}
+	node->visible = 0;
+	node->bad_hits = 0;
+	jb->visible_nodes--;
+
+	if (jb->ring && jb->ring[node->ring_seq & mask] == node) {
+		jb->ring[node->ring_seq & mask] = NULL;
 
-	if (switch_core_inthash_delete(jb->node_hash, node->packet.header.seq)) {
 		if (node->complete_frame_mark && jb->type == SJB_VIDEO) {
 			jb->complete_frames--;
 			node->complete_frame_mark = FALSE;
 		}
+
+		/* keep the window tight, each end only ever walks over slots once */
+		if (node->ring_seq == jb->ring_low) {
+			while (jb->ring_low != jb->ring_high) {
+				jb->ring_low++;
+				if ((np = jb->ring[jb->ring_low & mask]) && np->ring_seq == jb->ring_low) {
+					break;
+				}
+			}
+		} else if (node->ring_seq == jb->ring_high) {
+			while (jb->ring_high != jb->ring_low) {
+				jb->ring_high--;
+				if ((np = jb->ring[jb->ring_high & mask]) && np->ring_seq == jb->ring_high) {
+					break;
+				}
+			}
+		}
 	}
 
-	switch_mutex_unlock(jb->list_mutex);
-}
+	if (node->ts_prev) {
+		node->ts_prev->ts_next = node->ts_next;
+	} else if (node->ts_next) {
+		switch_core_inthash_insert(jb->node_hash_ts, node->packet.header.ts, node->ts_next);
+	} else if (switch_core_inthash_find(jb->node_hash_ts, node->packet.header.ts) == node) {
+		switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
+	}
+
+	if (node->ts_next) {
+		node->ts_next->ts_prev = node->ts_prev;
+	}
+
+	node->ts_prev = node->ts_next = NULL;
+
+	heap_remove(jb, node);
+
+	node->next = jb->free_list;
+	jb->free_list = node;
 
-static inline void sort_free_nodes(switch_jb_t *jb)
-{
-	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
 	switch_mutex_unlock(jb->list_mutex);
 }
 
 static inline void hide_nodes(switch_jb_t *jb)
 {
-	switch_jb_node_t *np;
-
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		hide_node(np, SWITCH_FALSE);
+	while (jb->heap_len) {
+		hide_node(jb->ts_heap[jb->heap_len - 1]);
 	}
 	switch_mutex_unlock(jb->list_mutex);
 }
 
 static inline void drop_ts(switch_jb_t *jb, uint32_t ts)
 {
-	switch_jb_node_t *np;
-	int x = 0;
+	switch_jb_node_t *np, *next;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	if ((np = switch_core_inthash_find(jb->node_hash_ts, ts))) {
+		switch_core_inthash_delete(jb->node_hash_ts, ts);
 
-		if (ts == np->packet.header.ts) {
-			hide_node(np, SWITCH_FALSE);
-			x++;
+		for (; np; np = next) {
+			next = np->ts_next;
+			np->ts_prev = np->ts_next = NULL;
+			hide_node(np);
 		}
 	}
-
-	if (x) {
-		sort_free_nodes(jb);
-	}
-
 	switch_mutex_unlock(jb->list_mutex);
 }
 
-static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb, uint32_t ts)
+static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb)
 {
 	switch_jb_node_t *np, *lowest = NULL;
+	uint16_t seq;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (ts && ts != np->packet.header.ts) continue;
-
-		if (!lowest || ntohs(lowest->packet.header.seq) > ntohs(np->packet.header.seq)) {
+	if (jb->visible_nodes && jb->ring) {
+		seq = jb->ring_low;
+		if ((np = jb->ring[seq & (jb->ring_size - 1)]) && np->ring_seq == seq) {
 			lowest = np;
 		}
 	}
@@ -375,19 +505,15 @@ static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb, uint32_t ts)
 
 static inline switch_jb_node_t *jb_find_lowest_node(switch_jb_t *jb)
 {
-	switch_jb_node_t *np, *lowest = NULL;
+	switch_jb_node_t *lowest = NULL;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!lowest || ntohl(lowest->packet.header.ts) > ntohl(np->packet.header.ts)) {
-			lowest = np;
-		}
+	if (jb->heap_len) {
+		lowest = jb->ts_heap[0];
 	}
 	switch_mutex_unlock(jb->list_mutex);
 
-	return lowest ? lowest : NULL;
+	return lowest;
 }
 
 static inline uint32_t jb_find_lowest_ts(switch_jb_t *jb)
@@ -397,91 +523,6 @@ static inline uint32_t jb_find_lowest_ts(switch_jb_t *jb)
 	return lowest ? lowest->packet.header.ts : 0;
 }
 
-#if 0
-static inline void thin_frames(switch_jb_t *jb, int freq, int max)
-{
-	switch_jb_node_t *node, *this_node;
-	int i = -1;
-	int dropped = 0;
-
-	switch_mutex_lock(jb->list_mutex);
-	node = jb->node_list;
-
-	while (node && dropped <= max) {
-		this_node = node;
-		node = node->next;
-		
-		if (this_node->visible) {
-			i++;
-		} else {
-			continue;
-		}
-
-		if ((i % freq) == 0) {
-			drop_ts(jb, this_node->packet.header.ts);
-			dropped++;
-		}
-	}
-
-	sort_free_nodes(jb);
-	switch_mutex_unlock(jb->list_mutex);
-}
-
-static inline switch_jb_node_t *jb_find_highest_node(switch_jb_t *jb)
-{
-	switch_jb_node_t *np, *highest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			highest = np;
-		}
-	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return highest ? highest : NULL;
-}
-
-
-static inline uint32_t jb_find_highest_ts(switch_jb_t *jb)
-{
-	switch_jb_node_t *highest = jb_find_highest_node(jb);
-
-	return highest ? highest->packet.header.ts : 0;
-}
-
-static inline void drop_newest_frame(switch_jb_t *jb)
-{
-	uint32_t ts = jb_find_highest_ts(jb);
-
-	drop_ts(jb, ts);
-	jb_debug(jb, 1, "Dropping highest frame ts:%u\n", ntohl(ts));
-}
-
-
-
-
-static inline switch_jb_node_t *jb_find_penultimate_node(switch_jb_t *jb)
-{
-	switch_jb_node_t *np, *highest = NULL, *second_highest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			if (highest) second_highest = highest;
-			highest = np;
-		}
-	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return second_highest ? second_highest : highest;
-}
-#endif
-
 static inline void jb_hit(switch_jb_t *jb)
 {
 	jb->period_good_count++;
@@ -541,47 +582,6 @@ static inline void jb_miss(switch_jb_t *jb)
 	jb->consec_good_count = 0;
 }
 
-#if 0
-static inline int verify_oldest_frame(switch_jb_t *jb)
-{
-	switch_jb_node_t *lowest = NULL, *np = NULL;
-	int r = 0;
-
-	lowest = jb_find_lowest_node(jb);
-
-	if (!lowest || !(lowest = jb_find_lowest_seq(jb, lowest->packet.header.ts))) {
-		goto end;
-	}
-
-	switch_mutex_lock(jb->mutex);
-
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
-
-	for (np = lowest->next; np; np = np->next) {
-
-		if (!np->visible) continue;
-
-		if (ntohs(np->packet.header.seq) != ntohs(np->prev->packet.header.seq) + 1) {
-			uint32_t val = (uint32_t)htons(ntohs(np->prev->packet.header.seq) + 1);
-
-			if (!switch_core_inthash_find(jb->missing_seq_hash, val)) {
-				switch_core_inthash_insert(jb->missing_seq_hash, val, (void *)(intptr_t)1);
-			}
-			break;
-		}
-
-		if (np->packet.header.ts != lowest->packet.header.ts || !np->next) {
-			r = 1;
-		}
-	}
-
-	switch_mutex_unlock(jb->mutex);
-
- end:
-
-	return r;
-}
-#endif
 
 static inline void drop_oldest_frame(switch_jb_t *jb)
 {
@@ -591,20 +591,6 @@ static inline void drop_oldest_frame(switch_jb_t *jb)
 	jb_debug(jb, 1, "Dropping oldest frame ts:%u\n", ntohl(ts));
 }
 
-
-
-#if 0
-static inline void drop_second_newest_frame(switch_jb_t *jb)
-{
-	switch_jb_node_t *second_newest = jb_find_penultimate_node(jb);
-
-	if (second_newest) {
-		drop_ts(jb, second_newest->packet.header.ts);
-		jb_debug(jb, 1, "Dropping second highest frame ts:%u\n", ntohl(second_newest->packet.header.ts));
-	}
-}
-#endif
-
 static inline int check_seq(uint16_t a, uint16_t b)
 {
 	a = ntohs(a);
@@ -642,11 +628,7 @@ static inline void add_node(switch_jb_t *jb, switch_rtp_packet_t *packet, switch
 	node->len = len;
 	memcpy(node->packet.body, packet->body, len);
 
-	switch_core_inthash_insert(jb->node_hash, node->packet.header.seq, node);
-
-	if (jb->node_hash_ts) {
-		switch_core_inthash_insert(jb->node_hash_ts, node->packet.header.ts, node);
-	}
+	index_node(jb, node);
 
 	jb_debug(jb, (packet->header.m ? 2 : 3), "PUT packet last_ts:%u ts:%u seq:%u%s\n",
 			 ntohl(jb->highest_wrote_ts), ntohl(node->packet.header.ts), ntohs(node->packet.header.seq), packet->header.m ? " <MARK>" : "");
@@ -706,6 +688,106 @@ static inline void add_node(switch_jb_t *jb, switch_rtp_packet_t *packet, switch
 	if (!jb->write_init) jb->write_init = 1;
 }
 
+/* how late this packet is compared to the fastest one in the window, the target depth is the JB_DELAY_QUANTILE of that in frames */
+static void jb_update_delay(switch_jb_t *jb, uint32_t ts)
+{
+	uint32_t now = (uint32_t) ((switch_time_now() / 1000) * jb->delay_rate / 1000);
+	uint32_t transit = now - ntohl(ts);
+	uint32_t i, bucket, target;
+	int32_t delay = 0;
+	double sum = 0, acc = 0;
+
+	jb->transit[jb->transit_pos] = transit;
+	jb->transit_pos = (jb->transit_pos + 1) % JB_DELAY_WINDOW;
+	if (jb->transit_count < JB_DELAY_WINDOW) {
+		jb->transit_count++;
+	}
+
+	for (i = 0; i < jb->transit_count; i++) {
+		int32_t d = (int32_t) (transit - jb->transit[i]);
+
+		if (d > delay) {
+			delay = d;
+		}
+	}
+
+	bucket = (delay + jb->delay_spf - 1) / jb->delay_spf;
+	if (bucket >= JB_DELAY_BUCKETS) {
+		bucket = JB_DELAY_BUCKETS - 1;
+	}
+
+	for (i = 0; i < JB_DELAY_BUCKETS; i++) {
+		jb->delay_hist[i] *= JB_DELAY_FORGET;
+		sum += jb->delay_hist[i];
+	}
+
+	jb->delay_hist[bucket] += 1 - JB_DELAY_FORGET;
+	sum += 1 - JB_DELAY_FORGET;
+
+	for (target = 0; target < JB_DELAY_BUCKETS - 1; target++) {
+		acc += jb->delay_hist[target];
+		if (acc >= sum * JB_DELAY_QUANTILE) {
+			break;
+		}
+	}
+
+	/* one frame is being played out while the late ones catch up */
+	target++;
+
+	if (target < jb->min_frame_len) {
+		target = jb->min_frame_len;
+	} else if (target > jb->max_frame_len) {
+		target = jb->max_frame_len;
+	}
+
+	if (target != jb->target_frames) {
+		jb_debug(jb, 2, "TARGET %u -> %u frames (delay %d samples)\n", jb->target_frames, target, delay);
+		jb->target_frames = target;
+	}
+
+	jb->frame_len = target;
+
+	if (jb->frame_len > jb->highest_frame_len) {
+		jb->highest_frame_len = jb->frame_len;
+	}
+}
+
+/* 1 to read ahead and shrink, -1 to conceal a frame and grow, 0 to play on */
+static int jb_stretch(switch_jb_t *jb)
+{
+	uint32_t target = jb->target_frames ? jb->target_frames : jb->frame_len;
+	uint32_t margin;
+
+	jb->level_avg += ((double) jb->complete_frames - jb->level_avg) / JB_LEVEL_FILTER;
+
+	if (jb->stretch_wait) {
+		jb->stretch_wait--;
+		return 0;
+	}
+
+	margin = target / 3 > 1 ? target / 3 : 1;
+
+	if (jb->complete_frames > 1 && jb->level_avg >= target + margin) {
+		jb_debug(jb, 2, "ACCELERATE level %.2f target %u\n", jb->level_avg, target);
+		jb->level_avg -= 1;
+		jb->stretch_wait = JB_STRETCH_WAIT;
+		jb->accelerate_count++;
+		return 1;
+	}
+
+	margin = target / 4 > 1 ? target / 4 : 1;
+
+	if (jb->complete_frames < target && jb->level_avg + margin <= target) {
+		jb_debug(jb, 2, "EXPAND level %.2f target %u\n", jb->level_avg, target);
+		jb->level_avg += 1;
+		jb->stretch_wait = JB_STRETCH_WAIT;
+		jb->expand_count++;
+		return -1;
+	}
+
+	return 0;
+}
+
 static inline void increment_ts(switch_jb_t *jb)
 {
 	if (!jb->target_ts) return;
@@ -758,15 +840,15 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 	}
 
 	if (!jb->target_seq) {
-		if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+		if ((node = ring_find(jb, jb->target_seq))) {
 			jb_debug(jb, 2, "FOUND rollover seq: %u\n", ntohs(jb->target_seq));
-		} else if ((node = jb_find_lowest_seq(jb, 0))) {
+		} else if ((node = jb_find_lowest_seq(jb))) {
 			jb_debug(jb, 2, "No target seq using seq: %u as a starting point\n", ntohs(node->packet.header.seq));
 		} else {
 			jb_debug(jb, 1, "%s", "No nodes available....\n");
 		}
 		jb_hit(jb);
-	} else if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+	} else if ((node = ring_find(jb, jb->target_seq))) {
 		jb_debug(jb, 2, "FOUND desired seq: %u\n", ntohs(jb->target_seq));
 		jb_hit(jb);
 	} else {
@@ -782,7 +864,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 
 			for (x = 0; x < 10; x++) {
 				increment_seq(jb);
-				if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+				if ((node = ring_find(jb, jb->target_seq))) {
 					jb_debug(jb, 2, "FOUND incremental seq: %u\n", ntohs(jb->target_seq));
 
 					if (node->packet.header.m ||  node->packet.header.ts == jb->highest_read_ts) {
@@ -867,7 +949,12 @@ static inline switch_status_t jb_next_packet(switch_jb_t *jb, switch_jb_node_t *
 static inline void free_nodes(switch_jb_t *jb)
 {
 	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = NULL;
+	/* the nodes themselves live in the pool */
+	jb->free_list = NULL;
+	jb->heap_len = jb->heap_size = 0;
+	jb->ring_size = 0;
+	switch_safe_free(jb->ts_heap);
+	switch_safe_free(jb->ring);
 	switch_mutex_unlock(jb->list_mutex);
 }
 
@@ -875,7 +962,45 @@ SWITCH_DECLARE(void) switch_jb_ts_mode(switch_jb_t *jb, uint32_t samples_per_fra
 {
 	jb->samples_per_frame = samples_per_frame;
 	jb->samples_per_second = samples_per_second;
-	switch_core_inthash_init(&jb->node_hash_ts);
+}
+
+SWITCH_DECLARE(void) switch_jb_set_adaptive(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second)
+{
+	if (jb->type != SJB_AUDIO || !samples_per_frame || !samples_per_second) {
+		return;
+	}
+
+	switch_mutex_lock(jb->mutex);
+	jb->delay_spf = samples_per_frame;
+	jb->delay_rate = samples_per_second;
+	jb->target_frames = jb->frame_len;
+	switch_set_flag(jb, SJB_ADAPTIVE);
+	switch_mutex_unlock(jb->mutex);
+}
+
+SWITCH_DECLARE(void) switch_jb_get_delay_stats(switch_jb_t *jb, uint32_t *target_ms, uint32_t *delay_ms, uint32_t *accelerate_count, uint32_t *expand_count)
+{
+	uint32_t frame_ms = jb->delay_rate ? jb->delay_spf * 1000 / jb->delay_rate : 0;
+
+	switch_mutex_lock(jb->mutex);
+
+	if (target_ms) {
+		*target_ms = jb->target_frames * frame_ms;
+	}
+
+	if (delay_ms) {
+		*delay_ms = (uint32_t) (jb->level_avg * frame_ms);
+	}
+
+	if (accelerate_count) {
+		*accelerate_count = jb->accelerate_count;
+	}
+
+	if (expand_count) {
+		*expand_count = jb->expand_count;
+	}
+
+	switch_mutex_unlock(jb->mutex);
 }
 
 SWITCH_DECLARE(void) switch_jb_set_session(switch_jb_t *jb, switch_core_session_t *session)
@@ -971,6 +1096,11 @@ SWITCH_DECLARE(void) switch_jb_reset(switch_jb_t *jb)
 	jb->period_miss_inc = 0;
 	jb->target_ts = 0;
 	jb->last_target_ts = 0;
+	/* a new stream has a new ts base, what was learned about the network still holds */
+	jb->transit_count = 0;
+	jb->transit_pos = 0;
+	jb->level_avg = 0;
+	jb->stretch_wait = 0;
 }
 
 SWITCH_DECLARE(uint32_t) switch_jb_get_nack_success(switch_jb_t *jb) 
@@ -996,7 +1126,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_peek_frame(switch_jb_t *jb, uint32_t t
 	switch_jb_node_t *node = NULL;
 	if (seq) {
 		uint16_t want_seq = seq + peek;
-		node = switch_core_inthash_find(jb->node_hash, htons(want_seq));
+		node = ring_find(jb, htons(want_seq));
 	} else if (ts && jb->samples_per_frame) {
 		uint32_t want_ts = ts + (peek * jb->samples_per_frame);
 		node = switch_core_inthash_find(jb->node_hash_ts, htonl(want_ts));
@@ -1097,7 +1227,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_create(switch_jb_t **jbp, switch_jb_ty
 		jb->period_len = 250;
 	}
 	
-	switch_core_inthash_init(&jb->node_hash);
+	switch_core_inthash_init(&jb->node_hash_ts);
 	switch_mutex_init(&jb->mutex, SWITCH_MUTEX_NESTED, pool);
 	switch_mutex_init(&jb->list_mutex, SWITCH_MUTEX_NESTED, pool);
 
@@ -1119,11 +1249,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_destroy(switch_jb_t **jbp)
 	if (jb->type == SJB_VIDEO) {
 		switch_core_inthash_destroy(&jb->missing_seq_hash);
 	}
-	switch_core_inthash_destroy(&jb->node_hash);
-
-	if (jb->node_hash_ts) {
-		switch_core_inthash_destroy(&jb->node_hash_ts);
-	}
+	switch_core_inthash_destroy(&jb->node_hash_ts);
 
 	free_nodes(jb);
 
@@ -1282,6 +1408,10 @@ SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp
 
 	add_node(jb, packet, len);
 
+	if (switch_test_flag(jb, SJB_ADAPTIVE)) {
+		jb_update_delay(jb, packet->header.ts);
+	}
+
 	if (switch_test_flag(jb, SJB_QUEUE_ONLY) && jb->max_packet_len && jb->max_frame_len * 2 > jb->max_packet_len &&
 			jb->allocated_nodes > jb->max_frame_len * 2 - 1) {
 		while ((jb->max_frame_len * 2 - jb->visible_nodes) < jb->max_packet_len) {
@@ -1303,7 +1433,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet_by_seq(switch_jb_t *jb, uin
 	switch_status_t status = SWITCH_STATUS_NOTFOUND;
 
 	switch_mutex_lock(jb->mutex);
-	if ((node = switch_core_inthash_find(jb->node_hash, seq))) {
+	if ((node = ring_find(jb, seq))) {
 		jb_debug(jb, 2, "Found buffered seq: %u\n", ntohs(seq));
 		*packet = node->packet;
 		*len = node->len;
@@ -1323,20 +1453,28 @@ SWITCH_DECLARE(switch_size_t) switch_jb_get_last_read_len(switch_jb_t *jb)
 	return jb->last_len;
 }
 
+SWITCH_DECLARE(switch_bool_t) switch_jb_last_read_accelerated(switch_jb_t *jb)
+{
+	return jb->last_accelerate ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t *len)
 {
 	switch_jb_node_t *node = NULL;
 	switch_status_t status;
-	int plc = 0;
+	int plc = 0, stretch = 0;
 	
 	switch_mutex_lock(jb->mutex);
 
+	jb->last_accelerate = 0;
+
 	if (jb->complete_frames == 0) {
 		jb->flush = 0;
 		switch_goto_status(SWITCH_STATUS_BREAK, end);
 	}
 
-	if (jb->complete_frames < jb->frame_len) {
+	/* once playing, an adaptive buffer grows by concealing frames instead of stalling the reader */
+	if (jb->complete_frames < jb->frame_len && !(switch_test_flag(jb, SJB_ADAPTIVE) && jb->read_init)) {
 
 		switch_jb_poll(jb);
 
@@ -1400,6 +1538,16 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
 	//	switch_jb_reset(jb);
 	//}
 
+	if (switch_test_flag(jb, SJB_ADAPTIVE)) {
+		if (!jb->read_init) {
+			jb->level_avg = jb->complete_frames;
+		} else if ((stretch = jb_stretch(jb)) < 0) {
+			/* leave the next frame where it is, the reader conceals one and the buffer is a frame deeper */
+			plc = 1;
+			switch_goto_status(SWITCH_STATUS_NOTFOUND, end);
+		}
+	}
+
 	if ((status = jb_next_packet(jb, &node)) == SWITCH_STATUS_SUCCESS) {
 		jb_debug(jb, 2, "Found next frame cur ts: %u seq: %u\n", htonl(node->packet.header.ts), htons(node->packet.header.seq));
 
@@ -1463,10 +1611,16 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
 		jb->last_len = *len;
 		memcpy(packet->body, node->packet.body, node->len);
 		packet->header.version = 2;
-		hide_node(node, SWITCH_TRUE);
+		hide_node(node);
 
 		jb_debug(jb, 2, "GET packet ts:%u seq:%u %s\n", ntohl(packet->header.ts), ntohs(packet->header.seq), packet->header.m ? " <MARK>" : "");
 
+		if (stretch > 0) {
+			/* the reader takes the next one right away and can squeeze the two into one frame */
+			status = SWITCH_STATUS_TIMEOUT;
+			jb->last_accelerate = 1;
+		}
+
 	} else {
 		status = SWITCH_STATUS_MORE_DATA;
 	}
@@ -59,6 +59,14 @@ struct switch_odbc_handle {
 	BOOL is_oracle;
 	int affected_rows;
 	int num_retries;
+	uint32_t generation;
+};
+
+struct switch_odbc_prepared {
+	switch_odbc_handle_t *handle;
+	SQLHSTMT stmt;
+	char *sql;
+	uint32_t generation;
 };
 #endif
 
@@ -137,6 +145,9 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_disconnect(switch_odbc_h
 
 	handle->state = SWITCH_ODBC_STATE_DOWN;
 
+	/* SQLDisconnect frees every statement on the connection, prepared ones included */
+	handle->generation++;
+
 	return SWITCH_ODBC_SUCCESS;
 #else
 	return SWITCH_ODBC_FAIL;
@@ -741,6 +752,202 @@ SWITCH_DECLARE(int) switch_odbc_handle_affected_rows(switch_odbc_handle_t *handl
 #endif
 }
 
+#ifdef SWITCH_HAVE_ODBC
+static switch_odbc_status_t odbc_prepared_prepare(switch_odbc_prepared_t *prepared, char **err)
+{
+	switch_odbc_handle_t *handle = prepared->handle;
+	char *err_str = NULL, *err2 = NULL;
+
+	if (prepared->stmt && prepared->generation == handle->generation) {
+		SQLFreeHandle(SQL_HANDLE_STMT, prepared->stmt);
+	}
+
+	prepared->stmt = NULL;
+
+	if (handle->state != SWITCH_ODBC_STATE_CONNECTED && !db_is_up(handle)) {
+		err2 = "Database is not up!";
+		goto error;
+	}
+
+	if (SQLAllocHandle(SQL_HANDLE_STMT, handle->con, &prepared->stmt) != SQL_SUCCESS) {
+		prepared->stmt = NULL;
+		err2 = "SQLAllocHandle failed.";
+		goto error;
+	}
+
+	if (SQLPrepare(prepared->stmt, (unsigned char *) prepared->sql, SQL_NTS) != SQL_SUCCESS) {
+		err2 = "SQLPrepare failed.";
+		goto error;
+	}
+
+	prepared->generation = handle->generation;
+
+	return SWITCH_ODBC_SUCCESS;
+
+  error:
+
+	if (prepared->stmt) {
+		err_str = switch_odbc_handle_get_error(handle, prepared->stmt);
+		SQLFreeHandle(SQL_HANDLE_STMT, prepared->stmt);
+		prepared->stmt = NULL;
+	}
+
+	if (zstr(err_str)) {
+		switch_safe_free(err_str);
+		err_str = strdup(err2);
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", prepared->sql, switch_str_nil(err_str));
+
+	if (err) {
+		*err = err_str;
+	} else {
+		free(err_str);
+	}
+
+	return SWITCH_ODBC_FAIL;
+}
+#endif
+
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_prepared_new(switch_odbc_handle_t *handle, const char *sql, switch_odbc_prepared_t **preparedp, char **err)
+{
+#ifdef SWITCH_HAVE_ODBC
+	switch_odbc_prepared_t *prepared;
+
+	switch_zmalloc(prepared, sizeof(*prepared));
+	prepared->handle = handle;
+	prepared->sql = strdup(sql);
+
+	if (odbc_prepared_prepare(prepared, err) != SWITCH_ODBC_SUCCESS) {
+		switch_odbc_prepared_destroy(&prepared);
+		return SWITCH_ODBC_FAIL;
+	}
+
+	*preparedp = prepared;
+
+	return SWITCH_ODBC_SUCCESS;
+#else
+	return SWITCH_ODBC_FAIL;
+#endif
+}
+
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_prepared_exec(switch_odbc_prepared_t *prepared, int argc, const char * const *argv, char **err)
+{
+#ifdef SWITCH_HAVE_ODBC
+	switch_odbc_handle_t *handle = prepared->handle;
+	SQLLEN *ind = NULL;
+	SQLLEN m = 0;
+	char *err_str = NULL, *err2 = NULL;
+	int result, i, retried = 0;
+
+	handle->affected_rows = 0;
+
+	if (argc > 0) {
+		switch_zmalloc(ind, sizeof(SQLLEN) * argc);
+	}
+
+  top:
+
+	if (!prepared->stmt || prepared->generation != handle->generation) {
+		if (odbc_prepared_prepare(prepared, err) != SWITCH_ODBC_SUCCESS) {
+			switch_safe_free(ind);
+			return SWITCH_ODBC_FAIL;
+		}
+	}
+
+	for (i = 0; i < argc; i++) {
+		SQLULEN size = argv[i] ? (SQLULEN) strlen(argv[i]) : 0;
+
+		ind[i] = argv[i] ? SQL_NTS : SQL_NULL_DATA;
+
+		result = SQLBindParameter(prepared->stmt, (SQLUSMALLINT) (i + 1), SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR,
+								  size ? size : 1, 0, (SQLPOINTER) argv[i], 0, &ind[i]);
+
+		if (result != SQL_SUCCESS && result != SQL_SUCCESS_WITH_INFO) {
+			err2 = "SQLBindParameter failed.";
+			goto error;
+		}
+	}
+
+	result = SQLExecute(prepared->stmt);
+
+	switch (result) {
+	case SQL_SUCCESS:
+	case SQL_SUCCESS_WITH_INFO:
+	case SQL_NO_DATA:
+		break;
+	default:
+		err2 = "SQLExecute failed.";
+		goto error;
+	}
+
+	SQLRowCount(prepared->stmt, &m);
+	handle->affected_rows = (int) m;
+
+	SQLFreeStmt(prepared->stmt, SQL_CLOSE);
+	SQLFreeStmt(prepared->stmt, SQL_RESET_PARAMS);
+	switch_safe_free(ind);
+
+	return SWITCH_ODBC_SUCCESS;
+
+  error:
+
+	err_str = switch_odbc_handle_get_error(handle, prepared->stmt);
+	SQLFreeStmt(prepared->stmt, SQL_CLOSE);
+	SQLFreeStmt(prepared->stmt, SQL_RESET_PARAMS);
+
+	/* a cached statement outlives the connection it was prepared on, check the link once before giving up */
+	if (!retried++) {
+		uint32_t generation = handle->generation;
+
+		db_is_up(handle);
+
+		if (generation != handle->generation) {
+			switch_safe_free(err_str);
+			goto top;
+		}
+	}
+
+	if (zstr(err_str)) {
+		switch_safe_free(err_str);
+		err_str = strdup(err2);
+	}
+
+	if (!switch_stristr("already exists", err_str) && !switch_stristr("duplicate key name", err_str)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", prepared->sql, switch_str_nil(err_str));
+	}
+
+	if (err) {
+		*err = err_str;
+	} else {
+		free(err_str);
+	}
+
+	switch_safe_free(ind);
+#endif
+	return SWITCH_ODBC_FAIL;
+}
+
+SWITCH_DECLARE(void) switch_odbc_prepared_destroy(switch_odbc_prepared_t **preparedp)
+{
+#ifdef SWITCH_HAVE_ODBC
+	switch_odbc_prepared_t *prepared;
+
+	if (!preparedp || !(prepared = *preparedp)) {
+		return;
+	}
+
+	*preparedp = NULL;
+
+	if (prepared->stmt && prepared->generation == prepared->handle->generation) {
+		SQLFreeHandle(SQL_HANDLE_STMT, prepared->stmt);
+	}
+
+	switch_safe_free(prepared->sql);
+	free(prepared);
+#endif
+}
+
 SWITCH_DECLARE(switch_bool_t) switch_odbc_available(void)
 {
 #ifdef SWITCH_HAVE_ODBC
@@ -33,6 +33,361 @@
 #include <switch.h>
 #include <pcre.h>
 
+/* compiled patterns shared by every caller, a matching perform hands out a reference that switch_regex_free gives back */
+typedef struct regex_cache_entry_s {
+	char *key;
+	char handle[32];
+	pcre *re;
+	pcre_extra *extra;
+	uint32_t refs;
+	int shared;
+	int dead;
+	struct regex_cache_entry_s *prev;
+	struct regex_cache_entry_s *next;
+} regex_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	switch_hash_t *handles;
+	regex_cache_entry_t *head;
+	regex_cache_entry_t *tail;
+	uint32_t max_entries;
+	uint32_t entries;
+	switch_bool_t jit;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} regex_cache;
+
+static void regex_cache_free(regex_cache_entry_t *entry)
+{
+	if (entry->extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(entry->extra);
+#else
+		pcre_free(entry->extra);
+#endif
+	}
+	if (entry->re) {
+		pcre_free(entry->re);
+	}
+	switch_safe_free(entry->key);
+	free(entry);
+}
+
+/* call with the lock held */
+static void regex_cache_unlink(regex_cache_entry_t *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		regex_cache.head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		regex_cache.tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+}
+
+/* call with the lock held */
+static void regex_cache_push(regex_cache_entry_t *entry)
+{
+	entry->next = regex_cache.head;
+	if (regex_cache.head) {
+		regex_cache.head->prev = entry;
+	}
+	regex_cache.head = entry;
+	if (!regex_cache.tail) {
+		regex_cache.tail = entry;
+	}
+}
+
+/* call with the lock held */
+static void regex_cache_remove(regex_cache_entry_t *entry)
+{
+	switch_core_hash_delete(regex_cache.hash, entry->key);
+	regex_cache_unlink(entry);
+	regex_cache.entries--;
+	entry->dead = 1;
+
+	if (!entry->refs) {
+		switch_core_hash_delete(regex_cache.handles, entry->handle);
+		regex_cache_free(entry);
+	}
+}
+
+/* call with the lock held */
+static void regex_cache_trim(void)
+{
+	regex_cache_entry_t *entry = regex_cache.tail, *prev;
+
+	while (entry && regex_cache.entries > regex_cache.max_entries) {
+		prev = entry->prev;
+
+		if (!entry->refs) {
+			regex_cache_remove(entry);
+			regex_cache.evictions++;
+		}
+
+		entry = prev;
+	}
+}
+
+/* call with the lock held */
+static void regex_cache_unref(regex_cache_entry_t *entry)
+{
+	if (!--entry->refs) {
+		if (entry->dead) {
+			switch_core_hash_delete(regex_cache.handles, entry->handle);
+			regex_cache_free(entry);
+		} else {
+			regex_cache_trim();
+		}
+	}
+}
+
+static void regex_cache_release(regex_cache_entry_t *entry)
+{
+	if (!entry->shared) {
+		regex_cache_free(entry);
+		return;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	regex_cache_unref(entry);
+	switch_mutex_unlock(regex_cache.mutex);
+}
+
+/* the pattern to hand to a caller, who gives it back with switch_regex_free */
+static pcre *regex_cache_hand_out(regex_cache_entry_t *entry)
+{
+	pcre *re = entry->re;
+
+	if (!entry->shared) {
+		/* compiled before the cache was started, the caller owns it outright */
+		entry->re = NULL;
+		regex_cache_free(entry);
+	}
+
+	return re;
+}
+
+/* the compiled pattern with a reference held, or NULL with error set when it does not compile */
+static regex_cache_entry_t *regex_cache_get(const char *pattern, int flags, const char **error, int *erroffset)
+{
+	regex_cache_entry_t *entry = NULL, *found;
+	char kbuf[512];
+	char *key = kbuf;
+	switch_bool_t jit = SWITCH_FALSE;
+
+	if (strlen(pattern) + 16 > sizeof(kbuf)) {
+		key = switch_mprintf("%x:%s", flags, pattern);
+	} else {
+		switch_snprintf(kbuf, sizeof(kbuf), "%x:%s", flags, pattern);
+	}
+
+	if (regex_cache.mutex) {
+		switch_mutex_lock(regex_cache.mutex);
+		if (regex_cache.max_entries && (entry = switch_core_hash_find(regex_cache.hash, key))) {
+			entry->refs++;
+			regex_cache.hits++;
+			if (entry != regex_cache.head) {
+				regex_cache_unlink(entry);
+				regex_cache_push(entry);
+			}
+		}
+		jit = regex_cache.jit;
+		switch_mutex_unlock(regex_cache.mutex);
+
+		if (entry) {
+			goto end;
+		}
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+
+	if (!(entry->re = pcre_compile(pattern, flags, error, erroffset, NULL)) || *error) {
+		if (entry->re) {
+			pcre_free(entry->re);
+		}
+		free(entry);
+		entry = NULL;
+		goto end;
+	}
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+	if (jit) {
+		const char *study_error = NULL;
+
+		/* NULL when there is nothing to gain, pcre_exec runs the interpreter then */
+		entry->extra = pcre_study(entry->re, PCRE_STUDY_JIT_COMPILE, &study_error);
+	}
+#endif
+
+	entry->key = strdup(key);
+	entry->refs = 1;
+	switch_snprintf(entry->handle, sizeof(entry->handle), "%p", (void *) entry->re);
+
+	if (!regex_cache.mutex) {
+		goto end;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	regex_cache.misses++;
+	entry->shared = 1;
+	if (!regex_cache.max_entries) {
+		entry->dead = 1;
+		switch_core_hash_insert(regex_cache.handles, entry->handle, entry);
+	} else if ((found = switch_core_hash_find(regex_cache.hash, key))) {
+		/* somebody else compiled it at the same time */
+		found->refs++;
+		regex_cache_free(entry);
+		entry = found;
+	} else {
+		switch_core_hash_insert(regex_cache.hash, entry->key, entry);
+		switch_core_hash_insert(regex_cache.handles, entry->handle, entry);
+		regex_cache_push(entry);
+		regex_cache.entries++;
+		regex_cache_trim();
+	}
+	switch_mutex_unlock(regex_cache.mutex);
+
+ end:
+	if (key != kbuf) {
+		free(key);
+	}
+
+	return entry;
+}
+
+static int regex_cache_exec(regex_cache_entry_t *entry, const char *subject, int options, int *ovector, int olen)
+{
+	int rc = pcre_exec(entry->re, entry->extra, subject, (int) strlen(subject), 0, options, ovector, olen);
+
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+	if (rc == PCRE_ERROR_JIT_STACKLIMIT) {
+		/* the default jit stack is small, the interpreter has no such limit */
+		rc = pcre_exec(entry->re, NULL, subject, (int) strlen(subject), 0, options, ovector, olen);
+	}
+#endif
+
+	return rc;
+}
+
+/* strip /pattern/opts down to the pattern and its compile flags, tmp holds the copy the pattern points into */
+static switch_status_t regex_parse_expression(const char *expression, const char **pattern, int *flags, char **tmp)
+{
+	*pattern = expression;
+	*flags = 0;
+	*tmp = NULL;
+
+	if (*expression == '/') {
+		char *opts = NULL;
+
+		*tmp = strdup(expression + 1);
+		switch_assert(*tmp);
+		if ((opts = strrchr(*tmp, '/'))) {
+			*opts++ = '\0';
+		} else {
+			/* Note our error */
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
+			return SWITCH_STATUS_FALSE;
+		}
+		*pattern = *tmp;
+		if (*opts) {
+			if (strchr(opts, 'i')) {
+				*flags |= PCRE_CASELESS;
+			}
+			if (strchr(opts, 's')) {
+				*flags |= PCRE_DOTALL;
+			}
+		}
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_init(switch_memory_pool_t *pool)
+{
+	if (!regex_cache.mutex) {
+		switch_mutex_init(&regex_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&regex_cache.hash);
+		switch_core_hash_init(&regex_cache.handles);
+		regex_cache.max_entries = SWITCH_REGEX_CACHE_DEFAULT_SIZE;
+		regex_cache.jit = SWITCH_TRUE;
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_set_size(uint32_t max_entries, switch_bool_t jit)
+{
+	if (!regex_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	regex_cache.max_entries = max_entries;
+	regex_cache.jit = jit;
+	regex_cache_trim();
+	switch_mutex_unlock(regex_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_flush(void)
+{
+	if (!regex_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	while (regex_cache.head) {
+		regex_cache_remove(regex_cache.head);
+	}
+	switch_mutex_unlock(regex_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!regex_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	stats->max_entries = regex_cache.max_entries;
+	stats->entries = regex_cache.entries;
+#ifdef PCRE_STUDY_JIT_COMPILE
+	stats->jit = regex_cache.jit;
+#endif
+	stats->hits = regex_cache.hits;
+	stats->misses = regex_cache.misses;
+	stats->evictions = regex_cache.evictions;
+	switch_mutex_unlock(regex_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_shutdown(void)
+{
+	switch_mutex_t *mutex = regex_cache.mutex;
+
+	if (!mutex) {
+		return;
+	}
+
+	switch_regex_cache_flush();
+
+	switch_mutex_lock(mutex);
+	switch_core_hash_destroy(&regex_cache.hash);
+	switch_core_hash_destroy(&regex_cache.handles);
+	regex_cache.mutex = NULL;
+	regex_cache.max_entries = 0;
+	switch_mutex_unlock(mutex);
+}
+
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern,
 													  int options, const char **errorptr, int *erroroffset, const unsigned char *tables)
 {
@@ -48,18 +403,31 @@ SWITCH_DECLARE(int) switch_regex_copy_substring(const char *subject, int *ovecto
 
 SWITCH_DECLARE(void) switch_regex_free(void *data)
 {
-	pcre_free(data);
+	regex_cache_entry_t *entry = NULL;
+	char handle[32];
+
+	if (regex_cache.mutex) {
+		switch_snprintf(handle, sizeof(handle), "%p", data);
+		switch_mutex_lock(regex_cache.mutex);
+		if ((entry = switch_core_hash_find(regex_cache.handles, handle))) {
+			regex_cache_unref(entry);
+		}
+		switch_mutex_unlock(regex_cache.mutex);
+	}
 
+	if (!entry) {
+		pcre_free(data);
+	}
 }
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
 {
 	const char *error = NULL;
 	int erroffset = 0;
-	pcre *re = NULL;
+	regex_cache_entry_t *entry = NULL;
 	int match_count = 0;
 	char *tmp = NULL;
-	uint32_t flags = 0;
+	int flags = 0;
 	char abuf[256] = "";
 
 	if (!(field && expression)) {
@@ -72,57 +440,24 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 		}
 	}
 
-	if (*expression == '/') {
-		char *opts = NULL;
-		tmp = strdup(expression + 1);
-		switch_assert(tmp);
-		if ((opts = strrchr(tmp, '/'))) {
-			*opts++ = '\0';
-		} else {
-			/* Note our error */
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
-			goto end;
-		}
-		expression = tmp;
-		if (*opts) {
-			if (strchr(opts, 'i')) {
-				flags |= PCRE_CASELESS;
-			}
-			if (strchr(opts, 's')) {
-				flags |= PCRE_DOTALL;
-			}
-		}
+	if (regex_parse_expression(expression, &expression, &flags, &tmp) != SWITCH_STATUS_SUCCESS) {
+		goto end;
 	}
 
-	re = pcre_compile(expression,	/* the pattern */
-					  flags,	/* default options */
-					  &error,	/* for error message */
-					  &erroffset,	/* for error offset */
-					  NULL);	/* use default character tables */
-	if (error) {
+	if (!(entry = regex_cache_get(expression, flags, &error, &erroffset))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
-		switch_regex_safe_free(re);
 		goto end;
 	}
 
-	match_count = pcre_exec(re,	/* result of pcre_compile() */
-							NULL,	/* we didn't study the pattern */
-							field,	/* the subject string */
-							(int) strlen(field),	/* the length of the subject string */
-							0,	/* start at offset 0 in the subject */
-							0,	/* default options */
-							ovector,	/* vector of integers for substring information */
-							olen);	/* number of elements (NOT size in bytes) */
-
+	match_count = regex_cache_exec(entry, field, 0, ovector, olen);
 
 	if (match_count <= 0) {
-		switch_regex_safe_free(re);
+		regex_cache_release(entry);
 		match_count = 0;
+	} else {
+		*new_re = (switch_regex_t *) regex_cache_hand_out(entry);
 	}
 
-	*new_re = (switch_regex_t *) re;
-
   end:
 	switch_safe_free(tmp);
 	return match_count;
@@ -216,47 +551,20 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 {
 	const char *error = NULL;	/* Used to hold any errors                                           */
 	int error_offset = 0;		/* Holds the offset of an error                                      */
-	pcre *pcre_prepared = NULL;	/* Holds the compiled regex                                          */
+	regex_cache_entry_t *entry = NULL;	/* Holds the compiled regex                                  */
 	int match_count = 0;		/* Number of times the regex was matched                             */
 	int offset_vectors[255];	/* not used, but has to exist or pcre won't even try to find a match */
 	int pcre_flags = 0;
-	uint32_t flags = 0;
+	int flags = 0;
 	char *tmp = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 
-	if (*expression == '/') {
-		char *opts = NULL;
-		tmp = strdup(expression + 1);
-		switch_assert(tmp);
-		if ((opts = strrchr(tmp, '/'))) {
-			*opts++ = '\0';
-		} else {
-			/* Note our error */
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
-			goto end;
-		}
-		expression = tmp;
-		if (*opts) {
-			if (strchr(opts, 'i')) {
-				flags |= PCRE_CASELESS;
-			}
-			if (strchr(opts, 's')) {
-				flags |= PCRE_DOTALL;
-			}
-		}
+	if (regex_parse_expression(expression, &expression, &flags, &tmp) != SWITCH_STATUS_SUCCESS) {
+		goto end;
 	}
 
 	/* Compile the expression */
-	pcre_prepared = pcre_compile(expression, flags, &error, &error_offset, NULL);
-
-	/* See if there was an error in the expression */
-	if (error != NULL) {
-		/* Clean up after ourselves */
-		if (pcre_prepared) {
-			pcre_free(pcre_prepared);
-			pcre_prepared = NULL;
-		}
+	if (!(entry = regex_cache_get(expression, flags, &error, &error_offset))) {
 		/* Note our error */
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
 						  "Regular Expression Error expression[%s] error[%s] location[%d]\n", expression, error, error_offset);
@@ -270,14 +578,10 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 	}
 
 	/* So far so good, run the regex */
-	match_count =
-		pcre_exec(pcre_prepared, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
+	match_count = regex_cache_exec(entry, target, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
 
 	/* Clean up */
-	if (pcre_prepared) {
-		pcre_free(pcre_prepared);
-		pcre_prepared = NULL;
-	}
+	regex_cache_release(entry);
 
 	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "number of matches: %d\n", match_count); */
 
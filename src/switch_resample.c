@@ -52,6 +52,328 @@
 
 #define resample_buffer(a, b, c) a > b ? ((a / 1000) / 2) * c : ((b / 1000) / 2) * c
 
+/* Polyphase filter for the mono conversions between 8k, 16k, 32k and 48k.  The ratio is reduced to up/down, every one of
+   the up phases gets its own row of Q14 taps cut from one windowed sinc, and each output is a single 16 bit dot product
+   against the input history so it runs on the vector kernels below. */
+
+#define POLYPHASE_ZERO_CROSSINGS 16
+#define POLYPHASE_SHIFT 14
+#define RESAMPLE_CACHE_MAX 32
+
+typedef struct {
+	uint32_t up;
+	uint32_t down;
+	/*! taps per phase, a multiple of 16 */
+	uint32_t taps;
+	int16_t *coef;
+	int16_t *hist;
+	uint32_t hist_len;
+	uint32_t hist_size;
+	/*! position of the next output in up ticks from hist[0] */
+	uint32_t pos;
+} polyphase_t;
+
+typedef struct resample_cache_entry_s {
+	uint32_t from_rate;
+	uint32_t to_rate;
+	uint32_t channels;
+	int quality;
+	int polyphase;
+	uint32_t idle;
+	switch_audio_resampler_t *free;
+	struct resample_cache_entry_s *next;
+} resample_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	resample_cache_entry_t *entries;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t idle;
+	switch_bool_t no_polyphase;
+} resample_globals;
+
+static int32_t sln_dot(const int16_t *a, const int16_t *b, uint32_t len);
+
+static int polyphase_rate(uint32_t rate)
+{
+	return rate == 8000 || rate == 16000 || rate == 32000 || rate == 48000;
+}
+
+static void polyphase_reset(polyphase_t *pp)
+{
+	/* start on a full history of silence so every call gives the same number of samples speex would */
+	pp->hist_len = pp->taps - 1;
+	memset(pp->hist, 0, pp->hist_len * sizeof(int16_t));
+	pp->pos = 0;
+}
+
+static polyphase_t *polyphase_create(uint32_t from_rate, uint32_t to_rate)
+{
+	polyphase_t *pp;
+	uint32_t a = from_rate, b = to_rate, widest, phase, i;
+	double cutoff, half;
+	double *h;
+
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+
+	switch_zmalloc(pp, sizeof(*pp));
+	pp->up = to_rate / a;
+	pp->down = from_rate / a;
+
+	/* cut off at the lower of the two nyquists, in ticks of the up sampled rate */
+	widest = MAX(pp->up, pp->down);
+	cutoff = 0.5 / widest;
+	half = (double) POLYPHASE_ZERO_CROSSINGS * widest;
+
+	pp->taps = (2 * POLYPHASE_ZERO_CROSSINGS * widest + pp->up - 1) / pp->up;
+	pp->taps = (pp->taps + 15) & ~15;
+
+	pp->coef = malloc(pp->up * pp->taps * sizeof(int16_t));
+	h = malloc(pp->taps * sizeof(double));
+	pp->hist_size = pp->taps * 4;
+	pp->hist = malloc(pp->hist_size * sizeof(int16_t));
+	switch_assert(pp->coef && h && pp->hist);
+
+	for (phase = 0; phase < pp->up; phase++) {
+		int16_t *row = pp->coef + phase * pp->taps;
+		double sum = 0;
+		int32_t qsum = 0;
+		uint32_t peak = 0;
+
+		for (i = 0; i < pp->taps; i++) {
+			/* tap i meets hist[base + i], the output sits between taps taps / 2 - 1 and taps / 2 */
+			double t = (double) phase + ((double) pp->taps / 2 - 1 - i) * pp->up;
+			double x = 2 * cutoff * t;
+
+			h[i] = 0;
+
+			if (fabs(t) < half) {
+				h[i] = (x == 0 ? 1.0 : sin(M_PI * x) / (M_PI * x)) * (0.42 + 0.5 * cos(M_PI * t / half) + 0.08 * cos(2 * M_PI * t / half));
+			}
+
+			sum += h[i];
+		}
+
+		/* unity gain per phase, whatever rounding loses goes back on the biggest tap */
+		for (i = 0; i < pp->taps; i++) {
+			row[i] = (int16_t) lrint(h[i] / sum * (1 << POLYPHASE_SHIFT));
+			qsum += row[i];
+
+			if (abs(row[i]) > abs(row[peak])) {
+				peak = i;
+			}
+		}
+
+		row[peak] += (int16_t) ((1 << POLYPHASE_SHIFT) - qsum);
+	}
+
+	free(h);
+	polyphase_reset(pp);
+
+	return pp;
+}
+
+static uint32_t polyphase_process(polyphase_t *pp, const int16_t *src, uint32_t srclen, int16_t *dst, uint32_t dst_size)
+{
+	uint32_t out = 0, base, drop;
+	int32_t acc;
+
+	if (pp->hist_len + srclen > pp->hist_size) {
+		pp->hist_size = pp->hist_len + srclen;
+		pp->hist = realloc(pp->hist, pp->hist_size * sizeof(int16_t));
+		switch_assert(pp->hist);
+	}
+
+	memcpy(pp->hist + pp->hist_len, src, srclen * sizeof(int16_t));
+	pp->hist_len += srclen;
+
+	while (out < dst_size) {
+		base = pp->pos / pp->up;
+
+		if (base + pp->taps > pp->hist_len) {
+			break;
+		}
+
+		acc = sln_dot(pp->coef + (pp->pos % pp->up) * pp->taps, pp->hist + base, pp->taps);
+		acc = (acc + (1 << (POLYPHASE_SHIFT - 1))) >> POLYPHASE_SHIFT;
+		switch_normalize_to_16bit(acc);
+		dst[out++] = (int16_t) acc;
+		pp->pos += pp->down;
+	}
+
+	if ((drop = pp->pos / pp->up)) {
+		memmove(pp->hist, pp->hist + drop, (pp->hist_len - drop) * sizeof(int16_t));
+		pp->hist_len -= drop;
+		pp->pos -= drop * pp->up;
+	}
+
+	return out;
+}
+
+static void polyphase_destroy(polyphase_t **ppP)
+{
+	polyphase_t *pp = *ppP;
+
+	*ppP = NULL;
+
+	if (pp) {
+		free(pp->coef);
+		free(pp->hist);
+		free(pp);
+	}
+}
+
+static void resample_free(switch_audio_resampler_t *resampler)
+{
+	if (resampler->resampler) {
+		speex_resampler_destroy(resampler->resampler);
+	}
+	polyphase_destroy((polyphase_t **) &resampler->polyphase);
+	free(resampler->to);
+	free(resampler);
+}
+
+static resample_cache_entry_t *resample_cache_find(uint32_t from_rate, uint32_t to_rate, int quality, uint32_t channels, int polyphase)
+{
+	resample_cache_entry_t *ep;
+
+	for (ep = resample_globals.entries; ep; ep = ep->next) {
+		if (ep->from_rate == from_rate && ep->to_rate == to_rate && ep->quality == quality &&
+			ep->channels == channels && ep->polyphase == polyphase) {
+			break;
+		}
+	}
+
+	return ep;
+}
+
+static switch_audio_resampler_t *resample_cache_take(uint32_t from_rate, uint32_t to_rate, int quality, uint32_t channels, int polyphase)
+{
+	resample_cache_entry_t *ep;
+	switch_audio_resampler_t *resampler = NULL;
+
+	if (!resample_globals.mutex) {
+		return NULL;
+	}
+
+	switch_mutex_lock(resample_globals.mutex);
+	if ((ep = resample_cache_find(from_rate, to_rate, quality, channels, polyphase)) && (resampler = ep->free)) {
+		ep->free = resampler->next;
+		ep->idle--;
+		resample_globals.idle--;
+		resample_globals.hits++;
+	} else {
+		resample_globals.misses++;
+	}
+	switch_mutex_unlock(resample_globals.mutex);
+
+	if (resampler) {
+		resampler->next = NULL;
+
+		if (resampler->polyphase) {
+			polyphase_reset(resampler->polyphase);
+		} else {
+			speex_resampler_reset_mem(resampler->resampler);
+		}
+	}
+
+	return resampler;
+}
+
+static switch_bool_t resample_cache_put(switch_audio_resampler_t *resampler)
+{
+	resample_cache_entry_t *ep;
+	switch_bool_t kept = SWITCH_FALSE;
+
+	if (!resample_globals.mutex) {
+		return SWITCH_FALSE;
+	}
+
+	switch_mutex_lock(resample_globals.mutex);
+	if (!(ep = resample_cache_find(resampler->from_rate, resampler->to_rate, resampler->quality, resampler->channels, !!resampler->polyphase))) {
+		switch_zmalloc(ep, sizeof(*ep));
+		ep->from_rate = resampler->from_rate;
+		ep->to_rate = resampler->to_rate;
+		ep->quality = resampler->quality;
+		ep->channels = resampler->channels;
+		ep->polyphase = !!resampler->polyphase;
+		ep->next = resample_globals.entries;
+		resample_globals.entries = ep;
+	}
+
+	if (ep->idle < RESAMPLE_CACHE_MAX) {
+		resampler->next = ep->free;
+		ep->free = resampler;
+		ep->idle++;
+		resample_globals.idle++;
+		kept = SWITCH_TRUE;
+	}
+	switch_mutex_unlock(resample_globals.mutex);
+
+	return kept;
+}
+
+SWITCH_DECLARE(void) switch_resample_cache_init(switch_memory_pool_t *pool)
+{
+	if (!resample_globals.mutex) {
+		switch_mutex_init(&resample_globals.mutex, SWITCH_MUTEX_NESTED, pool);
+	}
+}
+
+SWITCH_DECLARE(void) switch_resample_cache_shutdown(void)
+{
+	resample_cache_entry_t *ep, *entries;
+	switch_audio_resampler_t *resampler;
+	switch_mutex_t *mutex = resample_globals.mutex;
+
+	if (!mutex) {
+		return;
+	}
+
+	switch_mutex_lock(mutex);
+	entries = resample_globals.entries;
+	resample_globals.entries = NULL;
+	resample_globals.idle = 0;
+	resample_globals.mutex = NULL;
+	switch_mutex_unlock(mutex);
+
+	while ((ep = entries)) {
+		entries = ep->next;
+
+		while ((resampler = ep->free)) {
+			ep->free = resampler->next;
+			resample_free(resampler);
+		}
+
+		free(ep);
+	}
+}
+
+SWITCH_DECLARE(void) switch_resample_cache_stats(uint32_t *hits, uint32_t *misses, uint32_t *idle)
+{
+	if (resample_globals.mutex) {
+		switch_mutex_lock(resample_globals.mutex);
+	}
+
+	if (hits) *hits = resample_globals.hits;
+	if (misses) *misses = resample_globals.misses;
+	if (idle) *idle = resample_globals.idle;
+
+	if (resample_globals.mutex) {
+		switch_mutex_unlock(resample_globals.mutex);
+	}
+}
+
+SWITCH_DECLARE(void) switch_resample_set_polyphase(switch_bool_t enabled)
+{
+	resample_globals.no_polyphase = !enabled;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resampler_t **new_resampler,
 															   uint32_t from_rate, uint32_t to_rate,
 															   uint32_t to_size,
@@ -60,30 +382,51 @@ SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resa
 	int err = 0;
 	switch_audio_resampler_t *resampler;
 	double lto_rate, lfrom_rate;
-
-	switch_zmalloc(resampler, sizeof(*resampler));
+	uint32_t need;
+	int polyphase;
 
 	if (!channels) channels = 1;
 
-	resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
+	polyphase = !resample_globals.no_polyphase && channels == 1 && from_rate != to_rate && polyphase_rate(from_rate) && polyphase_rate(to_rate);
+	need = switch_resample_calc_buffer_size(to_rate, from_rate, to_size) / 2;
 
-	if (!resampler->resampler) {
-		free(resampler);
-		return SWITCH_STATUS_GENERR;
+	if ((resampler = resample_cache_take(from_rate, to_rate, quality, channels, polyphase))) {
+		if (need > resampler->to_size) {
+			resampler->to_size = need;
+			resampler->to = realloc(resampler->to, resampler->to_size * sizeof(int16_t) * resampler->channels);
+			switch_assert(resampler->to);
+		}
+		resampler->to_len = 0;
+		*new_resampler = resampler;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_zmalloc(resampler, sizeof(*resampler));
+
+	if (polyphase) {
+		resampler->polyphase = polyphase_create(from_rate, to_rate);
+	} else {
+		resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
+
+		if (!resampler->resampler) {
+			free(resampler);
+			return SWITCH_STATUS_GENERR;
+		}
 	}
 
 	*new_resampler = resampler;
-	lto_rate = (double) resampler->to_rate;
-	lfrom_rate = (double) resampler->from_rate;
 	resampler->from_rate = from_rate;
 	resampler->to_rate = to_rate;
+	lto_rate = (double) resampler->to_rate;
+	lfrom_rate = (double) resampler->from_rate;
 	resampler->factor = (lto_rate / lfrom_rate);
 	resampler->rfactor = (lfrom_rate / lto_rate);
 	resampler->channels = channels;
+	resampler->quality = quality;
 
 	//resampler->to_size = resample_buffer(to_rate, from_rate, (uint32_t) to_size);
 
-	resampler->to_size = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, to_size) / 2;
+	resampler->to_size = need;
 	resampler->to = malloc(resampler->to_size * sizeof(int16_t) * resampler->channels);
 	switch_assert(resampler->to);
 
@@ -100,6 +443,11 @@ SWITCH_DECLARE(uint32_t) switch_resample_process(switch_audio_resampler_t *resam
 		switch_assert(resampler->to);
 	}
 
+	if (resampler->polyphase) {
+		resampler->to_len = polyphase_process(resampler->polyphase, src, srclen, resampler->to, resampler->to_size);
+		return resampler->to_len;
+	}
+
 	resampler->to_len = resampler->to_size;
 	speex_resampler_process_interleaved_int(resampler->resampler, src, &srclen, resampler->to, &resampler->to_len);
 	return resampler->to_len;
@@ -109,11 +457,9 @@ SWITCH_DECLARE(void) switch_resample_destroy(switch_audio_resampler_t **resample
 {
 
 	if (resampler && *resampler) {
-		if ((*resampler)->resampler) {
-			speex_resampler_destroy((*resampler)->resampler);
+		if (!resample_cache_put(*resampler)) {
+			resample_free(*resampler);
 		}
-		free((*resampler)->to);
-		free(*resampler);
 		*resampler = NULL;
 	}
 }
@@ -271,6 +617,253 @@ SWITCH_DECLARE(uint32_t) switch_unmerge_sln(int16_t *data, uint32_t samples, int
 	return x;
 }
 
+/* Mixing kernels: accumulate 16 bit frames into a 32 bit mix and saturate back down, optionally minus one contributor.
+   The dot product is the inner loop of the polyphase resampler.  The vector versions are picked at runtime from what
+   the cpu supports. */
+
+static void mix_sln_accumulate_scalar(int32_t *mix, const int16_t *data, uint32_t samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < samples; i++) {
+		mix[i] += data[i];
+	}
+}
+
+static void mix_sln_subtract_scalar(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t i;
+	int32_t z;
+
+	for (i = 0; i < self_samples; i++) {
+		z = mix[i] - self[i];
+		switch_normalize_to_16bit(z);
+		out[i] = (int16_t) z;
+	}
+
+	for (; i < samples; i++) {
+		z = mix[i];
+		switch_normalize_to_16bit(z);
+		out[i] = (int16_t) z;
+	}
+}
+
+static int32_t sln_dot_scalar(const int16_t *a, const int16_t *b, uint32_t len)
+{
+	uint32_t i;
+	int32_t acc = 0;
+
+	for (i = 0; i < len; i++) {
+		acc += (int32_t) a[i] * b[i];
+	}
+
+	return acc;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(SWITCH_DISABLE_SIMD)
+#define SWITCH_MIX_SIMD 1
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static void mix_sln_accumulate_sse2(int32_t *mix, const int16_t *data, uint32_t samples)
+{
+	uint32_t i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+		_mm_storeu_si128((__m128i *) (mix + i), _mm_add_epi32(_mm_loadu_si128((__m128i *) (mix + i)), lo));
+		_mm_storeu_si128((__m128i *) (mix + i + 4), _mm_add_epi32(_mm_loadu_si128((__m128i *) (mix + i + 4)), hi));
+	}
+
+	mix_sln_accumulate_scalar(mix + i, data + i, samples - i);
+}
+
+__attribute__((target("sse2")))
+static void mix_sln_subtract_sse2(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t i = 0;
+
+	for (; i + 8 <= self_samples; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (self + i));
+		__m128i lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (mix + i)), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		__m128i hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (mix + i + 4)), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	if (i < self_samples) {
+		mix_sln_subtract_scalar(out + i, mix + i, self + i, self_samples - i, self_samples - i);
+		i = self_samples;
+	}
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i *) (mix + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *) (mix + i + 4));
+
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	mix_sln_subtract_scalar(out + i, mix + i, NULL, 0, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void mix_sln_accumulate_avx2(int32_t *mix, const int16_t *data, uint32_t samples)
+{
+	uint32_t i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + i)));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + i + 8)));
+
+		_mm256_storeu_si256((__m256i *) (mix + i), _mm256_add_epi32(_mm256_loadu_si256((__m256i *) (mix + i)), lo));
+		_mm256_storeu_si256((__m256i *) (mix + i + 8), _mm256_add_epi32(_mm256_loadu_si256((__m256i *) (mix + i + 8)), hi));
+	}
+
+	mix_sln_accumulate_scalar(mix + i, data + i, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void mix_sln_subtract_avx2(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t i = 0;
+
+	/* packs works per 128 bit lane so the result has to be put back in order with a permute */
+	for (; i + 16 <= self_samples; i += 16) {
+		__m256i lo = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (mix + i)),
+									  _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + i))));
+		__m256i hi = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (mix + i + 8)),
+									  _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + i + 8))));
+
+		_mm256_storeu_si256((__m256i *) (out + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8));
+	}
+
+	if (i < self_samples) {
+		mix_sln_subtract_scalar(out + i, mix + i, self + i, self_samples - i, self_samples - i);
+		i = self_samples;
+	}
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i lo = _mm256_loadu_si256((const __m256i *) (mix + i));
+		__m256i hi = _mm256_loadu_si256((const __m256i *) (mix + i + 8));
+
+		_mm256_storeu_si256((__m256i *) (out + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8));
+	}
+
+	mix_sln_subtract_scalar(out + i, mix + i, NULL, 0, samples - i);
+}
+
+__attribute__((target("sse2")))
+static int32_t sln_dot_sse2(const int16_t *a, const int16_t *b, uint32_t len)
+{
+	uint32_t i = 0;
+	__m128i acc = _mm_setzero_si128();
+
+	for (; i + 8 <= len; i += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (a + i)), _mm_loadu_si128((const __m128i *) (b + i))));
+	}
+
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+
+	return _mm_cvtsi128_si32(acc) + sln_dot_scalar(a + i, b + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static int32_t sln_dot_avx2(const int16_t *a, const int16_t *b, uint32_t len)
+{
+	uint32_t i = 0;
+	__m256i acc = _mm256_setzero_si256();
+	__m128i sum;
+
+	for (; i + 16 <= len; i += 16) {
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i))));
+	}
+
+	sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+	return _mm_cvtsi128_si32(sum) + sln_dot_scalar(a + i, b + i, len - i);
+}
+#endif
+
+typedef void (*mix_sln_accumulate_func_t)(int32_t *mix, const int16_t *data, uint32_t samples);
+typedef void (*mix_sln_subtract_func_t)(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples);
+typedef int32_t (*sln_dot_func_t)(const int16_t *a, const int16_t *b, uint32_t len);
+
+static struct {
+	mix_sln_accumulate_func_t accumulate;
+	mix_sln_subtract_func_t subtract;
+	sln_dot_func_t dot;
+	const char *name;
+} mix_kernel = { NULL, NULL, NULL, NULL };
+
+static void mix_sln_kernel_init(void)
+{
+	if (mix_kernel.name) {
+		return;
+	}
+
+	/* plain writes of the same values, safe if two threads race to get here first */
+	mix_kernel.accumulate = mix_sln_accumulate_scalar;
+	mix_kernel.subtract = mix_sln_subtract_scalar;
+	mix_kernel.dot = sln_dot_scalar;
+
+#ifdef SWITCH_MIX_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		mix_kernel.accumulate = mix_sln_accumulate_avx2;
+		mix_kernel.subtract = mix_sln_subtract_avx2;
+		mix_kernel.dot = sln_dot_avx2;
+		mix_kernel.name = "avx2";
+		return;
+	}
+
+	if (__builtin_cpu_supports("sse2")) {
+		mix_kernel.accumulate = mix_sln_accumulate_sse2;
+		mix_kernel.subtract = mix_sln_subtract_sse2;
+		mix_kernel.dot = sln_dot_sse2;
+		mix_kernel.name = "sse2";
+		return;
+	}
+#endif
+
+	mix_kernel.name = "scalar";
+}
+
+SWITCH_DECLARE(const char *) switch_mix_sln_kernel_name(void)
+{
+	mix_sln_kernel_init();
+	return mix_kernel.name;
+}
+
+static int32_t sln_dot(const int16_t *a, const int16_t *b, uint32_t len)
+{
+	mix_sln_kernel_init();
+	return mix_kernel.dot(a, b, len);
+}
+
+SWITCH_DECLARE(void) switch_mix_sln_accumulate(int32_t *mix, const int16_t *data, uint32_t samples)
+{
+	mix_sln_kernel_init();
+	mix_kernel.accumulate(mix, data, samples);
+}
+
+SWITCH_DECLARE(void) switch_mix_sln_subtract(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	mix_sln_kernel_init();
+
+	if (!self || self_samples > samples) {
+		self_samples = self ? samples : 0;
+	}
+
+	mix_kernel.subtract(out, mix, self, self_samples, samples);
+}
+
 SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, uint32_t orig_channels, uint32_t channels)
 {
 	switch_size_t i = 0;
@@ -342,6 +935,65 @@ SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, u
 	}
 }
 
+#define STRETCH_OVERLAP_MS 10
+#define STRETCH_PITCH_MAX_MS 15
+
+SWITCH_DECLARE(uint32_t) switch_accelerate_sln(int16_t *data, uint32_t samples, uint32_t max_remove, uint32_t rate)
+{
+	uint32_t overlap = rate * STRETCH_OVERLAP_MS / 1000;
+	uint32_t pitch_max = rate * STRETCH_PITCH_MAX_MS / 1000;
+	uint32_t lag, lag_min, lag_max, best_lag, i;
+	double best = -2.0;
+
+	if (overlap > samples / 4) {
+		overlap = samples / 4;
+	}
+
+	if (!overlap || !max_remove) {
+		return samples;
+	}
+
+	lag_max = max_remove;
+	if (lag_max > samples - overlap) {
+		lag_max = samples - overlap;
+	}
+
+	lag_min = lag_max > pitch_max ? lag_max - pitch_max : 1;
+
+	/* the lag within one pitch period of the wanted cut whose waveform lines up best with the start,
+	   silence lines up with anything so the longest cut wins there */
+	for (lag = lag_max, best_lag = lag_max; lag >= lag_min; lag--) {
+		int64_t xy = 0, xx = 0, yy = 0;
+		double score;
+
+		for (i = 0; i < overlap; i++) {
+			int32_t x = data[i], y = data[i + lag];
+
+			xy += x * y;
+			xx += x * x;
+			yy += y * y;
+		}
+
+		score = (xx < overlap || yy < overlap) ? 1.0 : (double) xy / sqrt((double) xx * (double) yy);
+
+		if (score > best) {
+			best = score;
+			best_lag = lag;
+		}
+	}
+
+	/* fade from the start into the same spot one cut later, then carry on from there */
+	for (i = 0; i < overlap; i++) {
+		int32_t z = ((int32_t) data[i] * (int32_t) (overlap - i) + (int32_t) data[i + best_lag] * (int32_t) i) / (int32_t) overlap;
+
+		data[i] = (int16_t) z;
+	}
+
+	memmove(data + overlap, data + overlap + best_lag, (samples - overlap - best_lag) * sizeof(int16_t));
+
+	return samples - best_lag;
+}
+
 SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t samples, int32_t vol)
 {
 	double newrate = 0;
@@ -49,6 +49,12 @@
 #include <switch_ssl.h>
 #include <switch_jitterbuffer.h>
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG) && defined(HAVE_EPOLL_CREATE)
+#define RTP_IO_ENGINE
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#endif
+
 //#define DEBUG_TS_ROLLOVER
 //#define TS_ROLLOVER_START 4294951295
 
@@ -319,6 +325,8 @@ typedef struct ts_normalize_s {
 	int last_external;
 } ts_normalize_t;
 
+typedef struct rtp_io_s rtp_io_t;
+
 struct switch_rtp {
 	/*
 	 * Two sockets are needed because we might be transcoding protocol families
@@ -497,7 +505,7 @@ struct switch_rtp {
 	int zrtp_mitm_tries;
 	int zinit;
 #endif
-
+	rtp_io_t *io;
 };
 
 struct switch_rtcp_report_block {
@@ -1311,185 +1319,1450 @@ static void handle_ice(switch_rtp_t *rtp_session, switch_rtp_ice_t *ice, void *d
 			switch_socket_sendto(sock_output, from_addr, 0, (void *) rpacket, &bytes);
 			//}
 		}
-	} else if (packet->header.type == SWITCH_STUN_BINDING_ERROR_RESPONSE) {
+	} else if (packet->header.type == SWITCH_STUN_BINDING_ERROR_RESPONSE) {
+
+		if (rtp_session->session) {
+			switch_core_session_message_t msg = { 0 };
+			msg.from = __FILE__;
+			msg.numeric_arg = packet->header.type;
+			msg.pointer_arg = packet;
+			msg.message_id = SWITCH_MESSAGE_INDICATE_STUN_ERROR;
+			switch_core_session_receive_message(rtp_session->session, &msg);
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG,
+							  "STUN/ICE binding error received on %s channel\n", rtp_type(rtp_session));
+		}
+
+	}
+
+
+
+
+ end:
+	switch_mutex_unlock(rtp_session->ice_mutex);
+	WRITE_DEC(rtp_session);
+	READ_DEC(rtp_session);
+}
+
+#ifdef ENABLE_ZRTP
+SWITCH_STANDARD_SCHED_FUNC(zrtp_cache_save_callback)
+{
+	zrtp_status_t status = zrtp_status_ok;
+
+	status = zrtp_def_cache_store(zrtp_global);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Saving ZRTP cache: %s\n", zrtp_status_ok == status ? "OK" : "FAIL");
+	task->runtime = switch_epoch_time_now(NULL) + 900;
+}
+
+static int zrtp_send_rtp_callback(const zrtp_stream_t *stream, char *rtp_packet, unsigned int rtp_packet_length)
+{
+	switch_rtp_t *rtp_session = zrtp_stream_get_userdata(stream);
+	switch_size_t len = rtp_packet_length;
+	zrtp_status_t status = zrtp_status_ok;
+
+	if (!rtp_session->sock_output) {
+		return status;
+	}
+
+	switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, rtp_packet, &len);
+	return status;
+}
+
+static void zrtp_event_callback(zrtp_stream_t *stream, unsigned event)
+{
+	switch_rtp_t *rtp_session = zrtp_stream_get_userdata(stream);
+	zrtp_session_info_t zrtp_session_info;
+
+	switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
+	switch_event_t *fsevent = NULL;
+	const char *type;
+
+	type = rtp_type(rtp_session);
+
+	switch (event) {
+	case ZRTP_EVENT_IS_SECURE:
+		{
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_SEND] = 1;
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_RECV] = 1;
+			if (!rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
+				rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_SEND] = 1;
+				rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_RECV] = 1;
+			}
+			if (zrtp_status_ok == zrtp_session_get(stream->session, &zrtp_session_info)) {
+				if (zrtp_session_info.sas_is_ready) {
+
+					switch_channel_set_variable_name_printf(channel, "true", "zrtp_secure_media_confirmed_%s", type);
+					switch_channel_set_variable_name_printf(channel, stream->session->sas1.buffer, "zrtp_sas1_string_%s", type);
+					switch_channel_set_variable_name_printf(channel, stream->session->sas2.buffer, "zrtp_sas2_string", type);
+					zrtp_verified_set(zrtp_global, &stream->session->zid, &stream->session->peer_zid, (uint8_t)1);
+				}
+			}
+
+			if (!rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
+
+
+				if (rtp_session->session) {
+					switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
+					switch_rtp_t *video_rtp_session = switch_channel_get_private(channel, "__zrtp_video_rtp_session");
+
+					if (!video_rtp_session) {
+						video_rtp_session = switch_channel_get_private_partner(channel, "__zrtp_video_rtp_session");
+					}
+
+					if (video_rtp_session) {
+						if (zrtp_status_ok != zrtp_stream_attach(stream->session, &video_rtp_session->zrtp_stream)) {
+							abort();
+						}
+						zrtp_stream_set_userdata(video_rtp_session->zrtp_stream, video_rtp_session);
+						if (switch_true(switch_channel_get_variable(channel, "zrtp_enrollment"))) {
+							zrtp_stream_registration_start(video_rtp_session->zrtp_stream, video_rtp_session->ssrc);
+						} else {
+							zrtp_stream_start(video_rtp_session->zrtp_stream, video_rtp_session->ssrc);
+						}
+					}
+				}
+			}
+
+			if (switch_event_create(&fsevent, SWITCH_EVENT_CALL_SECURE) == SWITCH_STATUS_SUCCESS) {
+				switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_media_type", "%s", type);
+				switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_type", "zrtp:%s:%s", stream->session->sas1.buffer,
+										stream->session->sas2.buffer);
+				switch_event_add_header_string(fsevent, SWITCH_STACK_BOTTOM, "caller-unique-id", switch_channel_get_uuid(channel));
+				switch_event_fire(&fsevent);
+			}
+		}
+		break;
+#if 0
+	case ZRTP_EVENT_NO_ZRTP_QUICK:
+		{
+			if (stream != NULL) {
+				zrtp_stream_stop(stream);
+			}
+		}
+		break;
+#endif
+	case ZRTP_EVENT_IS_CLIENT_ENROLLMENT:
+		{
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "Enrolled complete!\n");
+			switch_channel_set_variable_name_printf(channel, "true", "zrtp_enroll_complete_%s", type);
+		}
+		break;
+
+	case ZRTP_EVENT_USER_ALREADY_ENROLLED:
+		{
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "User already enrolled!\n");
+			switch_channel_set_variable_name_printf(channel, "true", "zrtp_already_enrolled_%s", type);
+		}
+		break;
+
+	case ZRTP_EVENT_NEW_USER_ENROLLED:
+		{
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "New user enrolled!\n");
+			switch_channel_set_variable_name_printf(channel, "true", "zrtp_new_user_enrolled_%s", type);
+		}
+		break;
+
+	case ZRTP_EVENT_USER_UNENROLLED:
+		{
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "User unenrolled!\n");
+			switch_channel_set_variable_name_printf(channel, "true", "zrtp_user_unenrolled_%s", type);
+		}
+		break;
+
+	case ZRTP_EVENT_IS_PENDINGCLEAR:
+		{
+			switch_channel_set_variable_name_printf(channel, "false", "zrtp_secure_media_confirmed_%s", type);
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_SEND] = 0;
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_RECV] = 0;
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_SEND] = 0;
+			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_RECV] = 0;
+			rtp_session->zrtp_mitm_tries = 0;
+		}
+		break;
+
+	case ZRTP_EVENT_NO_ZRTP:
+		{
+			switch_channel_set_variable_name_printf(channel, "false", "zrtp_secure_media_confirmed_%s", type);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void zrtp_logger(int level, const char *data, int len, int offset)
+{
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "%s", data);
+}
+#endif
+
+#ifdef RTP_IO_ENGINE
+/*
+  Batched receive engine: a few epoll threads drain the session sockets with recvmmsg() and queue the
+  packets on a single producer/single consumer ring per session, so the read path of a session finds
+  its packets without a poll() and a recvfrom() of its own.  Video sends are gathered up to the marker
+  bit and go out with one sendmmsg().
+
+  The engine also owns the shared ports: a small set of sockets per ip (rtp on an even port, rtcp on
+  the next one) used by many sessions at once.  Packets on a shared socket are handed to a session by
+  SSRC and source address together, then by remote address, then by the ICE ufrag of a binding request,
+  the ssrc being learned from the first packet that came in by address.  An SSRC alone only finds a
+  session that asked to follow its far end to a new address (RTP_BUG_ALWAYS_AUTO_ADJUST), and no key
+  ever moves from one session to another.
+*/
+#define RTP_IO_MAX_THREADS 16
+#define RTP_IO_MAX_SHARED 64
+#define RTP_IO_BATCH 32
+#define RTP_IO_SLOT_LEN 2048
+#define RTP_IO_AUDIO_RING (16 * 1024)
+#define RTP_IO_VIDEO_RING (256 * 1024)
+#define RTP_IO_RTCP_RING (4 * 1024)
+#define RTP_IO_WRAP 0xFFFFFFFF
+#define RTP_IO_KEY_LEN 80
+
+typedef enum {
+	RTP_IO_KEY_ADDR,
+	RTP_IO_KEY_RTCP_ADDR,
+	RTP_IO_KEY_SSRC,
+	RTP_IO_KEY_RTCP_SSRC,
+	RTP_IO_KEY_UFRAG,
+	RTP_IO_KEY_RTCP_UFRAG,
+	RTP_IO_KEY_LATCH,
+	RTP_IO_KEY_RTCP_LATCH,
+	RTP_IO_KEY_MAX
+} rtp_io_key_t;
+
+typedef union {
+	struct sockaddr sa;
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6;
+} rtp_io_addr_t;
+
+typedef struct {
+	uint32_t len;
+	uint32_t salen;
+	rtp_io_addr_t addr;
+} rtp_io_rec_t;
+
+#define RTP_IO_REC_SIZE(_len) ((sizeof(rtp_io_rec_t) + (_len) + 7) & ~7)
+
+typedef struct {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+} rtp_io_ring_t;
+
+struct rtp_io_worker_s;
+typedef struct rtp_io_shared_s rtp_io_shared_t;
+
+/* one socket registered with a worker, either the private socket of a session or one half of a shared port */
+typedef struct {
+	int fd;
+	uint32_t gen;
+	uint32_t slot;
+	int component;
+	rtp_io_t *io;
+	rtp_io_shared_t *shared;
+} rtp_io_src_t;
+
+struct rtp_io_shared_s {
+	char ip[64];
+	switch_port_t port;
+	switch_memory_pool_t *pool;
+	switch_socket_t *sock[2];
+	rtp_io_src_t src[2];
+	struct rtp_io_worker_s *worker;
+	switch_hash_t *demux;
+	uint32_t users;
+	uint32_t unknown;
+};
+
+typedef struct {
+	uint32_t count;
+	uint32_t next;
+	rtp_io_shared_t *list[RTP_IO_MAX_SHARED];
+} rtp_io_shared_ip_t;
+
+struct rtp_io_s {
+	struct rtp_io_worker_s *worker;
+	rtp_io_src_t src;
+	rtp_io_shared_t *shared;
+	int attached;
+	int waiting;
+	int video;
+	/* follow the far end by ssrc when it shows up from another address */
+	int relatch;
+	rtp_io_ring_t ring[2];
+	uint32_t dropped;
+	char keys[RTP_IO_KEY_MAX][RTP_IO_KEY_LEN];
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	/* outbound batch, only touched under the session write_mutex */
+	uint8_t *out;
+	int out_fd;
+	int out_count;
+	struct mmsghdr out_msg[RTP_IO_BATCH];
+	struct iovec out_iov[RTP_IO_BATCH];
+	rtp_io_addr_t out_addr[RTP_IO_BATCH];
+};
+
+typedef struct rtp_io_worker_s {
+	int poll_fd;
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	rtp_io_src_t **slots;
+	uint32_t nslots;
+	uint32_t used;
+	uint64_t packets;
+	uint64_t batches;
+	uint64_t dropped;
+} rtp_io_worker_t;
+
+static struct {
+	rtp_io_worker_t worker[RTP_IO_MAX_THREADS];
+	int count;
+	int32_t running;
+	uint32_t next;
+	uint32_t gen;
+	switch_hash_t *shared;
+	switch_hash_t *shared_ips;
+	switch_mutex_t *mutex;
+	switch_memory_pool_t *pool;
+} rtp_io_engine;
+
+static int rtp_io_push(rtp_io_ring_t *ring, const rtp_io_addr_t *addr, uint32_t salen, const void *data, uint32_t len)
+{
+	uint32_t need = RTP_IO_REC_SIZE(len);
+	uint32_t head = ring->head;
+	uint32_t free_bytes = ring->size - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+	uint32_t pos = head & (ring->size - 1);
+	uint32_t room = ring->size - pos;
+	rtp_io_rec_t *rec;
+
+	if (!ring->data) {
+		return 0;
+	}
+
+	if (room < need) {
+		/* records never wrap, burn the tail of the ring */
+		if (free_bytes < room + need) {
+			return 0;
+		}
+		((rtp_io_rec_t *) (ring->data + pos))->len = RTP_IO_WRAP;
+		head += room;
+		pos = 0;
+	} else if (free_bytes < need) {
+		return 0;
+	}
+
+	rec = (rtp_io_rec_t *) (ring->data + pos);
+	rec->len = len;
+	rec->salen = salen;
+	memcpy(&rec->addr, addr, salen);
+	memcpy(rec + 1, data, len);
+
+	__atomic_store_n(&ring->head, head + need, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+static rtp_io_rec_t *rtp_io_peek(rtp_io_ring_t *ring)
+{
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	rtp_io_rec_t *rec;
+	uint32_t pos;
+
+	while (ring->tail != head) {
+		pos = ring->tail & (ring->size - 1);
+		rec = (rtp_io_rec_t *) (ring->data + pos);
+
+		if (rec->len != RTP_IO_WRAP) {
+			return rec;
+		}
+
+		__atomic_store_n(&ring->tail, ring->tail + (ring->size - pos), __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+static switch_size_t rtp_io_pop(rtp_io_ring_t *ring, switch_sockaddr_t *from, void *buf, switch_size_t len)
+{
+	rtp_io_rec_t *rec;
+	switch_size_t bytes;
+
+	if (!(rec = rtp_io_peek(ring))) {
+		return 0;
+	}
+
+	bytes = rec->len < len ? rec->len : len;
+	memcpy(buf, rec + 1, bytes);
+
+	if (from) {
+		switch_sockaddr_set_raw(from, &rec->addr, rec->salen);
+	}
+
+	__atomic_store_n(&ring->tail, ring->tail + RTP_IO_REC_SIZE(rec->len), __ATOMIC_RELEASE);
+
+	return bytes;
+}
+
+static void rtp_io_addr_key(char *buf, int component, const struct sockaddr *sa)
+{
+	static const char hex[] = "0123456789abcdef";
+	const uint8_t *p;
+	size_t len, i;
+	char *o = buf;
+
+	if (sa->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *) sa;
+		p = (const uint8_t *) &in6->sin6_addr;
+		len = sizeof(in6->sin6_addr);
+		*o++ = 'a';
+		*o++ = hex[(ntohs(in6->sin6_port) >> 12) & 0xf];
+		*o++ = hex[(ntohs(in6->sin6_port) >> 8) & 0xf];
+		*o++ = hex[(ntohs(in6->sin6_port) >> 4) & 0xf];
+		*o++ = hex[ntohs(in6->sin6_port) & 0xf];
+	} else {
+		const struct sockaddr_in *in = (const struct sockaddr_in *) sa;
+		p = (const uint8_t *) &in->sin_addr;
+		len = sizeof(in->sin_addr);
+		*o++ = 'a';
+		*o++ = hex[(ntohs(in->sin_port) >> 12) & 0xf];
+		*o++ = hex[(ntohs(in->sin_port) >> 8) & 0xf];
+		*o++ = hex[(ntohs(in->sin_port) >> 4) & 0xf];
+		*o++ = hex[ntohs(in->sin_port) & 0xf];
+	}
+
+	*o++ = (char) ('0' + component);
+
+	for (i = 0; i < len; i++) {
+		*o++ = hex[p[i] >> 4];
+		*o++ = hex[p[i] & 0xf];
+	}
+
+	*o = '\0';
+}
+
+/* called with the worker locked, a key that already belongs to another session is refused */
+static switch_status_t rtp_io_set_key(rtp_io_t *io, rtp_io_key_t idx, const char *key)
+{
+	char *cur = io->keys[idx];
+	rtp_io_t *owner;
+
+	if (!io->shared || !strcmp(cur, key ? key : "")) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (*cur && switch_core_hash_find(io->shared->demux, cur) == io) {
+		switch_core_hash_delete(io->shared->demux, cur);
+	}
+
+	*cur = '\0';
+
+	if (zstr(key)) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if ((owner = switch_core_hash_find(io->shared->demux, key)) && owner != io) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Shared port %s:%u: demux key %s already belongs to another session, not taking it over\n",
+						  io->shared->ip, io->shared->port, key);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_copy_string(cur, key, RTP_IO_KEY_LEN);
+	switch_core_hash_insert(io->shared->demux, cur, io);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static uint32_t rtp_io_packet_ssrc(const uint8_t *data, uint32_t len, int *found)
+{
+	*found = 0;
+
+	if (len < 12 || (data[0] >> 6) != 2) {
+		return 0;
+	}
+
+	*found = 1;
+
+	/* rtcp carries the sender ssrc right after its header */
+	if (data[1] >= 192 && data[1] <= 223) {
+		return ntohl(*(uint32_t *) (data + 4));
+	}
+
+	return ntohl(*(uint32_t *) (data + 8));
+}
+
+static int rtp_io_stun_username(const uint8_t *data, uint32_t len, char *buf, size_t buflen)
+{
+	uint32_t pos = 20, alen, end;
+
+	if (len < 20 || data[0] > 1) {
+		return 0;
+	}
+
+	end = 20 + ((data[2] << 8) | data[3]);
+
+	if (end > len) {
+		end = len;
+	}
+
+	while (pos + 4 <= end) {
+		alen = (data[pos + 2] << 8) | data[pos + 3];
+
+		if (((data[pos] << 8) | data[pos + 1]) == SWITCH_STUN_ATTR_USERNAME) {
+			const char *user = (const char *) data + pos + 4;
+			uint32_t i;
+
+			/* the receiver's ufrag comes first */
+			for (i = 0; i < alen && pos + 4 + i < end && user[i] != ':' && i + 1 < buflen; i++) {
+				buf[i] = user[i];
+			}
+			buf[i] = '\0';
+
+			return i > 0;
+		}
+
+		pos += 4 + ((alen + 3) & ~3);
+	}
+
+	return 0;
+}
+
+/* called with the worker locked */
+static rtp_io_t *rtp_io_demux(rtp_io_shared_t *shared, int component, const rtp_io_addr_t *addr, const uint8_t *data, uint32_t len)
+{
+	char key[RTP_IO_KEY_LEN];
+	char addr_key[RTP_IO_KEY_LEN];
+	char latch_key[16];
+	rtp_io_t *io;
+	uint32_t ssrc;
+	int has_ssrc;
+
+	ssrc = rtp_io_packet_ssrc(data, len, &has_ssrc);
+	rtp_io_addr_key(addr_key, component, &addr->sa);
+
+	if (has_ssrc) {
+		/* the ssrc only counts together with the address it was learned from */
+		switch_snprintf(key, sizeof(key), "s%d%08x%s", component, ssrc, addr_key);
+
+		if ((io = switch_core_hash_find(shared->demux, key))) {
+			return io;
+		}
+	}
+
+	if ((io = switch_core_hash_find(shared->demux, addr_key))) {
+		if (has_ssrc) {
+			/* first packet of this stream from this address */
+			rtp_io_set_key(io, RTP_IO_KEY_SSRC + component, key);
+
+			if (io->relatch) {
+				switch_snprintf(latch_key, sizeof(latch_key), "l%d%08x", component, ssrc);
+				rtp_io_set_key(io, RTP_IO_KEY_LATCH + component, latch_key);
+			}
+		}
+		return io;
+	}
+
+	if (has_ssrc) {
+		/* the far end moved, only a session that asked to follow it gets the packet and re-latches on its own read path */
+		switch_snprintf(latch_key, sizeof(latch_key), "l%d%08x", component, ssrc);
+		return switch_core_hash_find(shared->demux, latch_key);
+	} else {
+		char ufrag[RTP_IO_KEY_LEN - 4];
+
+		if (rtp_io_stun_username(data, len, ufrag, sizeof(ufrag))) {
+			switch_snprintf(key, sizeof(key), "u%d%s", component, ufrag);
+			return switch_core_hash_find(shared->demux, key);
+		}
+	}
+
+	return NULL;
+}
+
+static void rtp_io_deliver(rtp_io_worker_t *worker, rtp_io_t *io, int component, const rtp_io_addr_t *addr, uint32_t salen, const void *data, uint32_t len)
+{
+	if (!rtp_io_push(&io->ring[component], addr, salen, data, len)) {
+		io->dropped++;
+		worker->dropped++;
+		return;
+	}
+
+	worker->packets++;
+
+	if (component) {
+		return;
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (io->waiting) {
+		switch_mutex_lock(io->mutex);
+		switch_thread_cond_signal(io->cond);
+		switch_mutex_unlock(io->mutex);
+	}
+}
+
+static void rtp_io_drain(rtp_io_worker_t *worker, rtp_io_src_t *src, struct mmsghdr *msg, struct iovec *iov, rtp_io_addr_t *addr, uint8_t *buf)
+{
+	rtp_io_t *io;
+	int i, r;
+
+	do {
+		for (i = 0; i < RTP_IO_BATCH; i++) {
+			iov[i].iov_base = buf + (i * RTP_IO_SLOT_LEN);
+			iov[i].iov_len = RTP_IO_SLOT_LEN;
+			memset(&msg[i].msg_hdr, 0, sizeof(msg[i].msg_hdr));
+			msg[i].msg_hdr.msg_iov = &iov[i];
+			msg[i].msg_hdr.msg_iovlen = 1;
+			msg[i].msg_hdr.msg_name = &addr[i];
+			msg[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+		}
+
+		if ((r = recvmmsg(src->fd, msg, RTP_IO_BATCH, MSG_DONTWAIT, NULL)) <= 0) {
+			break;
+		}
+
+		worker->batches++;
+
+		for (i = 0; i < r; i++) {
+			if (!msg[i].msg_len || (msg[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+				worker->dropped++;
+				continue;
+			}
+
+			if (!(io = src->io)) {
+				if (!(io = rtp_io_demux(src->shared, src->component, &addr[i], iov[i].iov_base, msg[i].msg_len))) {
+					src->shared->unknown++;
+					worker->dropped++;
+					continue;
+				}
+			}
+
+			rtp_io_deliver(worker, io, src->component, &addr[i], msg[i].msg_hdr.msg_namelen, iov[i].iov_base, msg[i].msg_len);
+		}
+	} while (r == RTP_IO_BATCH);
+}
+
+static void *SWITCH_THREAD_FUNC rtp_io_thread(switch_thread_t *thread, void *obj)
+{
+	rtp_io_worker_t *worker = (rtp_io_worker_t *) obj;
+	struct epoll_event e[64];
+	struct mmsghdr msg[RTP_IO_BATCH];
+	struct iovec iov[RTP_IO_BATCH];
+	rtp_io_addr_t addr[RTP_IO_BATCH];
+	rtp_io_src_t *src;
+	uint8_t *buf;
+	uint32_t slot;
+	int i, r;
+
+	switch_zmalloc(buf, RTP_IO_BATCH * RTP_IO_SLOT_LEN);
+
+	while (rtp_io_engine.running == 1) {
+		if ((r = epoll_wait(worker->poll_fd, e, sizeof(e) / sizeof(e[0]), 100)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		switch_mutex_lock(worker->mutex);
+		for (i = 0; i < r; i++) {
+			/* the slot table is the only way to a ring, a detached session is never touched again */
+			slot = (uint32_t) e[i].data.u64;
+
+			if (slot < worker->nslots && (src = worker->slots[slot]) && src->gen == (uint32_t) (e[i].data.u64 >> 32)) {
+				rtp_io_drain(worker, src, msg, iov, addr, buf);
+			}
+		}
+		switch_mutex_unlock(worker->mutex);
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+/* called with the worker locked */
+static switch_status_t rtp_io_worker_add(rtp_io_worker_t *worker, rtp_io_src_t *src)
+{
+	struct epoll_event e = { 0 };
+	uint32_t slot;
+
+	if (worker->used == worker->nslots) {
+		uint32_t nslots = worker->nslots ? worker->nslots * 2 : 256;
+		rtp_io_src_t **slots = realloc(worker->slots, nslots * sizeof(*slots));
+
+		if (!slots) {
+			return SWITCH_STATUS_MEMERR;
+		}
+		memset(slots + worker->nslots, 0, (nslots - worker->nslots) * sizeof(*slots));
+		worker->slots = slots;
+		worker->nslots = nslots;
+	}
+
+	for (slot = 0; worker->slots[slot]; slot++);
+
+	src->slot = slot;
+	src->gen = ++rtp_io_engine.gen;
+
+	e.events = EPOLLIN;
+	e.data.u64 = ((uint64_t) src->gen << 32) | slot;
+
+	if (epoll_ctl(worker->poll_fd, EPOLL_CTL_ADD, src->fd, &e) < 0) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	worker->slots[slot] = src;
+	worker->used++;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* called with the worker locked */
+static void rtp_io_worker_del(rtp_io_worker_t *worker, rtp_io_src_t *src)
+{
+	epoll_ctl(worker->poll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+
+	if (src->slot < worker->nslots && worker->slots[src->slot] == src) {
+		worker->slots[src->slot] = NULL;
+		worker->used--;
+	}
+}
+
+static rtp_io_t *rtp_io_get(switch_rtp_t *rtp_session)
+{
+	rtp_io_t *io;
+
+	if ((io = rtp_session->io)) {
+		return io;
+	}
+
+	io = switch_core_alloc(rtp_session->pool, sizeof(*io));
+	io->video = rtp_session->flags[SWITCH_RTP_FLAG_VIDEO];
+	io->ring[0].size = io->video ? RTP_IO_VIDEO_RING : RTP_IO_AUDIO_RING;
+	io->ring[0].data = switch_core_alloc(rtp_session->pool, io->ring[0].size);
+	if (io->video) {
+		io->out = switch_core_alloc(rtp_session->pool, RTP_IO_BATCH * RTP_IO_SLOT_LEN);
+	}
+	switch_mutex_init(&io->mutex, SWITCH_MUTEX_NESTED, rtp_session->pool);
+	switch_thread_cond_create(&io->cond, rtp_session->pool);
+	io->src.io = io;
+	rtp_session->io = io;
+
+	return io;
+}
+
+static void rtp_io_attach(switch_rtp_t *rtp_session)
+{
+	rtp_io_worker_t *worker;
+	rtp_io_t *io;
+	switch_os_socket_t fd = SWITCH_SOCK_INVALID;
+
+	if (rtp_io_engine.running != 1 || (rtp_session->io && (rtp_session->io->attached || rtp_session->io->shared)) ||
+		rtp_session->flags[SWITCH_RTP_FLAG_UDPTL] ||
+		switch_os_sock_get(&fd, rtp_session->sock_input) != SWITCH_STATUS_SUCCESS || fd == SWITCH_SOCK_INVALID) {
+		return;
+	}
+
+	io = rtp_io_get(rtp_session);
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+
+	if (rtp_io_engine.running == 1) {
+		worker = &rtp_io_engine.worker[rtp_io_engine.next++ % rtp_io_engine.count];
+
+		switch_mutex_lock(worker->mutex);
+		io->src.fd = fd;
+		if (rtp_io_worker_add(worker, &io->src) == SWITCH_STATUS_SUCCESS) {
+			io->worker = worker;
+			io->attached = 1;
+		}
+		switch_mutex_unlock(worker->mutex);
+	}
+
+	switch_mutex_unlock(rtp_io_engine.mutex);
+}
+
+static rtp_io_shared_t *rtp_io_shared_find(const char *ip, switch_port_t port)
+{
+	char key[128];
+
+	switch_snprintf(key, sizeof(key), "%s:%u", ip, port);
+
+	return rtp_io_engine.shared ? switch_core_hash_find(rtp_io_engine.shared, key) : NULL;
+}
+
+static switch_status_t rtp_io_attach_shared(switch_rtp_t *rtp_session, const char *ip, switch_port_t port)
+{
+	rtp_io_shared_t *shared;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	rtp_io_t *io = rtp_io_get(rtp_session);
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+
+	if (rtp_io_engine.running == 1 && (shared = rtp_io_shared_find(ip, port))) {
+		if (!io->ring[1].data) {
+			io->ring[1].size = RTP_IO_RTCP_RING;
+			io->ring[1].data = switch_core_alloc(rtp_session->pool, io->ring[1].size);
+		}
+
+		switch_mutex_lock(shared->worker->mutex);
+		if (io->shared != shared) {
+			shared->users++;
+			io->shared = shared;
+		}
+		io->worker = shared->worker;
+		io->attached = 1;
+		switch_mutex_unlock(shared->worker->mutex);
+
+		rtp_session->sock_input = shared->sock[0];
+		status = SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_unlock(rtp_io_engine.mutex);
+
+	return status;
+}
+
+/* called with the worker locked, the session leaves the demux and its ring is never written again */
+static void rtp_io_release(rtp_io_t *io)
+{
+	int i;
+
+	if (io->shared) {
+		for (i = 0; i < RTP_IO_KEY_MAX; i++) {
+			rtp_io_set_key(io, i, NULL);
+		}
+	} else {
+		rtp_io_worker_del(io->worker, &io->src);
+	}
+
+	io->attached = 0;
+
+	switch_mutex_lock(io->mutex);
+	switch_thread_cond_broadcast(io->cond);
+	switch_mutex_unlock(io->mutex);
+}
+
+static void rtp_io_detach(switch_rtp_t *rtp_session)
+{
+	rtp_io_t *io = rtp_session->io;
+
+	if (!io || !io->attached) {
+		return;
+	}
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+	if (io->attached) {
+		switch_mutex_lock(io->worker->mutex);
+		rtp_io_release(io);
+		switch_mutex_unlock(io->worker->mutex);
+	}
+	switch_mutex_unlock(rtp_io_engine.mutex);
+}
+
+/* register where the far end sends from so the shared socket can find this session */
+static void rtp_io_learn_remote(switch_rtp_t *rtp_session)
+{
+	rtp_io_t *io = rtp_session->io;
+	char key[RTP_IO_KEY_LEN];
+	char *p;
+	int i;
+
+	if (!io || !io->shared || !io->attached) {
+		return;
+	}
+
+	switch_mutex_lock(io->worker->mutex);
+
+	if (io->attached) {
+		io->relatch = (rtp_session->rtp_bugs & RTP_BUG_ALWAYS_AUTO_ADJUST) ? 1 : 0;
+
+		if (!io->relatch) {
+			rtp_io_set_key(io, RTP_IO_KEY_LATCH, NULL);
+			rtp_io_set_key(io, RTP_IO_KEY_RTCP_LATCH, NULL);
+		}
+
+		if (rtp_session->remote_addr) {
+			rtp_io_addr_key(key, 0, (struct sockaddr *) &rtp_session->remote_addr->sa);
+			rtp_io_set_key(io, RTP_IO_KEY_ADDR, key);
+		}
+
+		if (rtp_session->rtcp_remote_addr && rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP] && !rtp_session->flags[SWITCH_RTP_FLAG_RTCP_MUX]) {
+			rtp_io_addr_key(key, 1, (struct sockaddr *) &rtp_session->rtcp_remote_addr->sa);
+			rtp_io_set_key(io, RTP_IO_KEY_RTCP_ADDR, key);
+		}
+
+		for (i = 0; i < 2; i++) {
+			switch_rtp_ice_t *ice = i ? &rtp_session->rtcp_ice : &rtp_session->ice;
+
+			if (zstr(ice->user_ice)) {
+				continue;
+			}
+
+			/* binding requests carry our ufrag first, the same way user_ice is built */
+			switch_snprintf(key, sizeof(key), "u%d%s", i && !rtp_session->flags[SWITCH_RTP_FLAG_RTCP_MUX] ? 1 : 0, ice->user_ice);
+			if ((p = strchr(key, ':'))) {
+				*p = '\0';
+			}
+			rtp_io_set_key(io, RTP_IO_KEY_UFRAG + i, key);
+		}
+	}
+
+	switch_mutex_unlock(io->worker->mutex);
+}
+
+/* drop the reference on a shared port, the sockets belong to the engine and are never closed by the session */
+static void rtp_io_unshare(switch_rtp_t *rtp_session)
+{
+	rtp_io_t *io = rtp_session->io;
+	rtp_io_shared_t *shared;
+
+	if (!io || !io->shared) {
+		return;
+	}
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+	shared = io->shared;
+
+	if (rtp_session->sock_input == shared->sock[0] || rtp_session->sock_input == shared->sock[1]) {
+		rtp_session->sock_input = NULL;
+	}
+	if (rtp_session->sock_output == shared->sock[0] || rtp_session->sock_output == shared->sock[1]) {
+		rtp_session->sock_output = NULL;
+	}
+	if (rtp_session->rtcp_sock_input == shared->sock[0] || rtp_session->rtcp_sock_input == shared->sock[1]) {
+		rtp_session->rtcp_sock_input = NULL;
+	}
+	if (rtp_session->rtcp_sock_output == shared->sock[0] || rtp_session->rtcp_sock_output == shared->sock[1]) {
+		rtp_session->rtcp_sock_output = NULL;
+	}
+
+	if (io->attached) {
+		switch_mutex_lock(io->worker->mutex);
+		rtp_io_release(io);
+		switch_mutex_unlock(io->worker->mutex);
+	}
+
+	shared->users--;
+	io->shared = NULL;
+	switch_mutex_unlock(rtp_io_engine.mutex);
+}
+
+static switch_status_t rtp_io_wait(rtp_io_t *io, switch_interval_time_t timeout)
+{
+	if (rtp_io_peek(&io->ring[0])) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!timeout) {
+		return SWITCH_STATUS_TIMEOUT;
+	}
+
+	switch_mutex_lock(io->mutex);
+	io->waiting = 1;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (io->attached && !rtp_io_peek(&io->ring[0])) {
+		if (timeout < 0) {
+			switch_thread_cond_wait(io->cond, io->mutex);
+		} else {
+			switch_thread_cond_timedwait(io->cond, io->mutex, timeout);
+		}
+	}
+
+	io->waiting = 0;
+	switch_mutex_unlock(io->mutex);
+
+	if (rtp_io_peek(&io->ring[0])) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	return io->attached ? SWITCH_STATUS_TIMEOUT : SWITCH_STATUS_FALSE;
+}
+
+static void rtp_io_wake(rtp_io_t *io)
+{
+	switch_mutex_lock(io->mutex);
+	switch_thread_cond_broadcast(io->cond);
+	switch_mutex_unlock(io->mutex);
+}
+
+/* called with the session write_mutex held */
+static void rtp_io_flush(rtp_io_t *io)
+{
+	int sent = 0, r;
+
+	while (sent < io->out_count) {
+		if ((r = sendmmsg(io->out_fd, io->out_msg + sent, io->out_count - sent, 0)) <= 0) {
+			if (r < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		sent += r;
+	}
+
+	io->out_count = 0;
+}
+
+static void rtp_io_queue(switch_rtp_t *rtp_session, switch_os_socket_t fd, const void *data, switch_size_t bytes, switch_bool_t last)
+{
+	rtp_io_t *io = rtp_session->io;
+	struct mmsghdr *msg;
+	int i;
+
+	if (io->out_count && io->out_fd != fd) {
+		rtp_io_flush(io);
+	}
+
+	i = io->out_count++;
+	io->out_fd = fd;
+
+	memcpy(io->out + (i * RTP_IO_SLOT_LEN), data, bytes);
+	memcpy(&io->out_addr[i], &rtp_session->remote_addr->sa, rtp_session->remote_addr->salen);
+
+	io->out_iov[i].iov_base = io->out + (i * RTP_IO_SLOT_LEN);
+	io->out_iov[i].iov_len = bytes;
+
+	msg = &io->out_msg[i];
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_hdr.msg_name = &io->out_addr[i];
+	msg->msg_hdr.msg_namelen = rtp_session->remote_addr->salen;
+	msg->msg_hdr.msg_iov = &io->out_iov[i];
+	msg->msg_hdr.msg_iovlen = 1;
+
+	if (last || io->out_count == RTP_IO_BATCH) {
+		rtp_io_flush(io);
+	}
+}
+
+/* called with the engine locked */
+static rtp_io_shared_t *rtp_io_shared_create(const char *ip)
+{
+	switch_memory_pool_t *pool = NULL;
+	rtp_io_shared_t *shared;
+	switch_sockaddr_t *addr;
+	switch_os_socket_t fd;
+	char key[128];
+	int i, added = 0;
+
+	if (!(rtp_io_engine.running == 1)) {
+		return NULL;
+	}
+
+	switch_core_new_memory_pool(&pool);
+	shared = switch_core_alloc(pool, sizeof(*shared));
+	shared->pool = pool;
+	switch_copy_string(shared->ip, ip, sizeof(shared->ip));
+
+	if (!(shared->port = switch_rtp_request_port(ip))) {
+		goto fail;
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (switch_sockaddr_info_get(&addr, ip, SWITCH_UNSPEC, shared->port + i, 0, pool) != SWITCH_STATUS_SUCCESS ||
+			switch_socket_create(&shared->sock[i], switch_sockaddr_get_family(addr), SOCK_DGRAM, 0, pool) != SWITCH_STATUS_SUCCESS ||
+			switch_socket_bind(shared->sock[i], addr) != SWITCH_STATUS_SUCCESS ||
+			switch_os_sock_get(&fd, shared->sock[i]) != SWITCH_STATUS_SUCCESS) {
+			goto fail;
+		}
+
+		switch_socket_opt_set(shared->sock[i], SWITCH_SO_NONBLOCK, TRUE);
+		shared->src[i].fd = fd;
+		shared->src[i].component = i;
+		shared->src[i].shared = shared;
+	}
+
+	switch_core_hash_init(&shared->demux);
+	shared->worker = &rtp_io_engine.worker[rtp_io_engine.next++ % rtp_io_engine.count];
+
+	switch_mutex_lock(shared->worker->mutex);
+	for (i = 0; i < 2; i++) {
+		if (rtp_io_worker_add(shared->worker, &shared->src[i]) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+		added++;
+	}
+	if (added < 2) {
+		for (i = 0; i < added; i++) {
+			rtp_io_worker_del(shared->worker, &shared->src[i]);
+		}
+	}
+	switch_mutex_unlock(shared->worker->mutex);
+
+	if (added < 2) {
+		switch_core_hash_destroy(&shared->demux);
+		goto fail;
+	}
+
+	switch_snprintf(key, sizeof(key), "%s:%u", ip, shared->port);
+	switch_core_hash_insert(rtp_io_engine.shared, key, shared);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Opened shared RTP port %s:%u\n", ip, shared->port);
+
+	return shared;
+
+ fail:
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to open a shared RTP port on %s\n", ip);
+
+	for (i = 0; i < 2; i++) {
+		if (shared->sock[i]) {
+			switch_socket_close(shared->sock[i]);
+		}
+	}
+
+	if (shared->port) {
+		switch_rtp_release_port(ip, shared->port);
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+
+	return NULL;
+}
+
+/* called with the engine locked after the workers are gone */
+static void rtp_io_shared_destroy(rtp_io_shared_t *shared)
+{
+	switch_memory_pool_t *pool = shared->pool;
+	char key[128];
+	int i;
+
+	switch_snprintf(key, sizeof(key), "%s:%u", shared->ip, shared->port);
+	switch_core_hash_delete(rtp_io_engine.shared, key);
+
+	if (shared->users) {
+		/* still referenced by live sessions, they will find nothing to read */
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Shared RTP port %s:%u still has %u sessions\n", shared->ip, shared->port, shared->users);
+		return;
+	}
+
+	for (i = 0; i < 2; i++) {
+		close(shared->src[i].fd);
+		shared->src[i].fd = -1;
+	}
+
+	switch_core_hash_destroy(&shared->demux);
+	switch_rtp_release_port(shared->ip, shared->port);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+SWITCH_DECLARE(switch_port_t) switch_rtp_request_shared_port(const char *ip, uint32_t count)
+{
+	rtp_io_shared_ip_t *list;
+	rtp_io_shared_t *shared = NULL;
+	switch_port_t port = 0;
+
+	if (zstr(ip) || !count || !rtp_io_engine.mutex) {
+		return 0;
+	}
+
+	if (count > RTP_IO_MAX_SHARED) {
+		count = RTP_IO_MAX_SHARED;
+	}
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+
+	if (rtp_io_engine.running != 1) {
+		goto end;
+	}
+
+	if (!(list = switch_core_hash_find(rtp_io_engine.shared_ips, ip))) {
+		list = switch_core_alloc(rtp_io_engine.pool, sizeof(*list));
+		switch_core_hash_insert(rtp_io_engine.shared_ips, ip, list);
+	}
+
+	if (list->count < count && (shared = rtp_io_shared_create(ip))) {
+		list->list[list->count++] = shared;
+	} else if (list->count) {
+		shared = list->list[list->next++ % list->count];
+	}
+
+	if (shared) {
+		port = shared->port;
+	}
+
+ end:
+
+	switch_mutex_unlock(rtp_io_engine.mutex);
+
+	return port;
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_rtp_port_is_shared(const char *ip, switch_port_t port)
+{
+	switch_bool_t r = SWITCH_FALSE;
+
+	if (zstr(ip) || !port || !rtp_io_engine.mutex) {
+		return r;
+	}
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+	r = rtp_io_shared_find(ip, port) ? SWITCH_TRUE : SWITCH_FALSE;
+	switch_mutex_unlock(rtp_io_engine.mutex);
+
+	return r;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rtp_io_engine_start(uint32_t threads)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	rtp_io_worker_t *worker;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	int i;
+
+	if (!rtp_io_engine.mutex) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_mutex_lock(rtp_io_engine.mutex);
+
+	if (rtp_io_engine.running == 1) {
+		goto end;
+	}
+
+	if (!threads && !(threads = switch_core_cpu_count() / 8)) {
+		threads = 1;
+	}
+
+	if (threads > RTP_IO_MAX_THREADS) {
+		threads = RTP_IO_MAX_THREADS;
+	}
+
+	rtp_io_engine.running = 1;
+
+	for (i = 0; i < (int) threads; i++) {
+		worker = &rtp_io_engine.worker[i];
+		memset(worker, 0, sizeof(*worker));
+
+		if ((worker->poll_fd = epoll_create(64)) < 0) {
+			break;
+		}
 
-		if (rtp_session->session) {
-			switch_core_session_message_t msg = { 0 };
-			msg.from = __FILE__;
-			msg.numeric_arg = packet->header.type;
-			msg.pointer_arg = packet;
-			msg.message_id = SWITCH_MESSAGE_INDICATE_STUN_ERROR;
-			switch_core_session_receive_message(rtp_session->session, &msg);
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG,
-							  "STUN/ICE binding error received on %s channel\n", rtp_type(rtp_session));
+		switch_mutex_init(&worker->mutex, SWITCH_MUTEX_NESTED, rtp_io_engine.pool);
+		switch_threadattr_create(&thd_attr, rtp_io_engine.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+
+		if (switch_thread_create(&worker->thread, thd_attr, rtp_io_thread, worker, rtp_io_engine.pool) != SWITCH_STATUS_SUCCESS) {
+			close(worker->poll_fd);
+			break;
 		}
+	}
 
+	if (!(rtp_io_engine.count = i)) {
+		rtp_io_engine.running = 0;
+		status = SWITCH_STATUS_GENERR;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to start the RTP io engine\n");
+		goto end;
 	}
 
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Started %d RTP io engine thread%s\n", i, i == 1 ? "" : "s");
 
+ end:
 
+	switch_mutex_unlock(rtp_io_engine.mutex);
 
- end:
-	switch_mutex_unlock(rtp_session->ice_mutex);
-	WRITE_DEC(rtp_session);
-	READ_DEC(rtp_session);
+	return status;
 }
 
-#ifdef ENABLE_ZRTP
-SWITCH_STANDARD_SCHED_FUNC(zrtp_cache_save_callback)
+SWITCH_DECLARE(void) switch_rtp_io_engine_stop(void)
 {
-	zrtp_status_t status = zrtp_status_ok;
+	rtp_io_worker_t *worker;
+	rtp_io_shared_ip_t *list;
+	switch_hash_index_t *hi;
+	uint64_t packets = 0, batches = 0, dropped = 0;
+	switch_status_t st;
+	uint32_t slot, n;
+	void *val;
+	int i;
 
-	status = zrtp_def_cache_store(zrtp_global);
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Saving ZRTP cache: %s\n", zrtp_status_ok == status ? "OK" : "FAIL");
-	task->runtime = switch_epoch_time_now(NULL) + 900;
-}
+	if (!rtp_io_engine.mutex) {
+		return;
+	}
 
-static int zrtp_send_rtp_callback(const zrtp_stream_t *stream, char *rtp_packet, unsigned int rtp_packet_length)
-{
-	switch_rtp_t *rtp_session = zrtp_stream_get_userdata(stream);
-	switch_size_t len = rtp_packet_length;
-	zrtp_status_t status = zrtp_status_ok;
+	switch_mutex_lock(rtp_io_engine.mutex);
 
-	if (!rtp_session->sock_output) {
-		return status;
+	if (rtp_io_engine.running != 1) {
+		switch_mutex_unlock(rtp_io_engine.mutex);
+		return;
 	}
 
-	switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, rtp_packet, &len);
-	return status;
-}
+	rtp_io_engine.running = -1;
 
-static void zrtp_event_callback(zrtp_stream_t *stream, unsigned event)
-{
-	switch_rtp_t *rtp_session = zrtp_stream_get_userdata(stream);
-	zrtp_session_info_t zrtp_session_info;
+	for (i = 0; i < rtp_io_engine.count; i++) {
+		switch_thread_join(&st, rtp_io_engine.worker[i].thread);
+	}
 
-	switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
-	switch_event_t *fsevent = NULL;
-	const char *type;
+	/* whatever is still attached goes back to its own socket, shared ports are closed once unused */
+	for (hi = switch_core_hash_first(rtp_io_engine.shared_ips); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		list = (rtp_io_shared_ip_t *) val;
 
-	type = rtp_type(rtp_session);
+		for (n = 0; n < list->count; n++) {
+			rtp_io_shared_t *shared = list->list[n];
+			switch_hash_index_t *dhi;
+			void *dval;
 
-	switch (event) {
-	case ZRTP_EVENT_IS_SECURE:
-		{
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_SEND] = 1;
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_RECV] = 1;
-			if (!rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
-				rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_SEND] = 1;
-				rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_RECV] = 1;
+			switch_mutex_lock(shared->worker->mutex);
+			for (dhi = switch_core_hash_first(shared->demux); dhi; dhi = switch_core_hash_next(&dhi)) {
+				switch_core_hash_this(dhi, NULL, NULL, &dval);
+				((rtp_io_t *) dval)->attached = 0;
+				rtp_io_wake((rtp_io_t *) dval);
 			}
-			if (zrtp_status_ok == zrtp_session_get(stream->session, &zrtp_session_info)) {
-				if (zrtp_session_info.sas_is_ready) {
+			switch_mutex_unlock(shared->worker->mutex);
 
-					switch_channel_set_variable_name_printf(channel, "true", "zrtp_secure_media_confirmed_%s", type);
-					switch_channel_set_variable_name_printf(channel, stream->session->sas1.buffer, "zrtp_sas1_string_%s", type);
-					switch_channel_set_variable_name_printf(channel, stream->session->sas2.buffer, "zrtp_sas2_string", type);
-					zrtp_verified_set(zrtp_global, &stream->session->zid, &stream->session->peer_zid, (uint8_t)1);
-				}
+			rtp_io_shared_destroy(shared);
+		}
+
+		list->count = list->next = 0;
+	}
+
+	for (i = 0; i < rtp_io_engine.count; i++) {
+		worker = &rtp_io_engine.worker[i];
+
+		switch_mutex_lock(worker->mutex);
+		for (slot = 0; slot < worker->nslots; slot++) {
+			if (worker->slots[slot] && worker->slots[slot]->io) {
+				rtp_io_release(worker->slots[slot]->io);
 			}
+		}
+		switch_mutex_unlock(worker->mutex);
 
-			if (!rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
+		close(worker->poll_fd);
+		switch_safe_free(worker->slots);
+		worker->nslots = worker->used = 0;
 
+		packets += worker->packets;
+		batches += worker->batches;
+		dropped += worker->dropped;
+	}
 
-				if (rtp_session->session) {
-					switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
-					switch_rtp_t *video_rtp_session = switch_channel_get_private(channel, "__zrtp_video_rtp_session");
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Stopped RTP io engine, %" SWITCH_UINT64_T_FMT " packets in %" SWITCH_UINT64_T_FMT
+					  " batches, %" SWITCH_UINT64_T_FMT " dropped\n", packets, batches, dropped);
 
-					if (!video_rtp_session) {
-						video_rtp_session = switch_channel_get_private_partner(channel, "__zrtp_video_rtp_session");
-					}
+	rtp_io_engine.count = 0;
+	rtp_io_engine.running = 0;
 
-					if (video_rtp_session) {
-						if (zrtp_status_ok != zrtp_stream_attach(stream->session, &video_rtp_session->zrtp_stream)) {
-							abort();
-						}
-						zrtp_stream_set_userdata(video_rtp_session->zrtp_stream, video_rtp_session);
-						if (switch_true(switch_channel_get_variable(channel, "zrtp_enrollment"))) {
-							zrtp_stream_registration_start(video_rtp_session->zrtp_stream, video_rtp_session->ssrc);
-						} else {
-							zrtp_stream_start(video_rtp_session->zrtp_stream, video_rtp_session->ssrc);
-						}
-					}
-				}
-			}
+	switch_mutex_unlock(rtp_io_engine.mutex);
+}
+#else
+SWITCH_DECLARE(switch_port_t) switch_rtp_request_shared_port(const char *ip, uint32_t count)
+{
+	return 0;
+}
 
-			if (switch_event_create(&fsevent, SWITCH_EVENT_CALL_SECURE) == SWITCH_STATUS_SUCCESS) {
-				switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_media_type", "%s", type);
-				switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_type", "zrtp:%s:%s", stream->session->sas1.buffer,
-										stream->session->sas2.buffer);
-				switch_event_add_header_string(fsevent, SWITCH_STACK_BOTTOM, "caller-unique-id", switch_channel_get_uuid(channel));
-				switch_event_fire(&fsevent);
-			}
-		}
-		break;
-#if 0
-	case ZRTP_EVENT_NO_ZRTP_QUICK:
-		{
-			if (stream != NULL) {
-				zrtp_stream_stop(stream);
-			}
-		}
-		break;
-#endif
-	case ZRTP_EVENT_IS_CLIENT_ENROLLMENT:
-		{
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "Enrolled complete!\n");
-			switch_channel_set_variable_name_printf(channel, "true", "zrtp_enroll_complete_%s", type);
-		}
-		break;
+SWITCH_DECLARE(switch_bool_t) switch_rtp_port_is_shared(const char *ip, switch_port_t port)
+{
+	return SWITCH_FALSE;
+}
 
-	case ZRTP_EVENT_USER_ALREADY_ENROLLED:
-		{
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "User already enrolled!\n");
-			switch_channel_set_variable_name_printf(channel, "true", "zrtp_already_enrolled_%s", type);
-		}
-		break;
+SWITCH_DECLARE(switch_status_t) switch_rtp_io_engine_start(uint32_t threads)
+{
+	return SWITCH_STATUS_NOTIMPL;
+}
 
-	case ZRTP_EVENT_NEW_USER_ENROLLED:
-		{
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "New user enrolled!\n");
-			switch_channel_set_variable_name_printf(channel, "true", "zrtp_new_user_enrolled_%s", type);
-		}
-		break;
+SWITCH_DECLARE(void) switch_rtp_io_engine_stop(void)
+{
+}
+#endif
 
-	case ZRTP_EVENT_USER_UNENROLLED:
-		{
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG, "User unenrolled!\n");
-			switch_channel_set_variable_name_printf(channel, "true", "zrtp_user_unenrolled_%s", type);
-		}
-		break;
+/* the rtp (0) or rtcp (1) socket of the shared port the session uses */
+static switch_socket_t *rtp_shared_sock(switch_rtp_t *rtp_session, int component)
+{
+#ifdef RTP_IO_ENGINE
+	if (rtp_session->io && rtp_session->io->shared) {
+		return rtp_session->io->shared->sock[component];
+	}
+#endif
+	return NULL;
+}
 
-	case ZRTP_EVENT_IS_PENDINGCLEAR:
-		{
-			switch_channel_set_variable_name_printf(channel, "false", "zrtp_secure_media_confirmed_%s", type);
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_SEND] = 0;
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_RECV] = 0;
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_SEND] = 0;
-			rtp_session->flags[SWITCH_ZRTP_FLAG_SECURE_MITM_RECV] = 0;
-			rtp_session->zrtp_mitm_tries = 0;
-		}
-		break;
+/* a shared socket belongs to the engine, sessions never shut it down or close it */
+static switch_bool_t rtp_sock_is_shared(switch_rtp_t *rtp_session, switch_socket_t *sock)
+{
+	return (sock && (sock == rtp_shared_sock(rtp_session, 0) || sock == rtp_shared_sock(rtp_session, 1))) ? SWITCH_TRUE : SWITCH_FALSE;
+}
 
-	case ZRTP_EVENT_NO_ZRTP:
-		{
-			switch_channel_set_variable_name_printf(channel, "false", "zrtp_secure_media_confirmed_%s", type);
+static switch_status_t rtp_input_poll(switch_rtp_t *rtp_session, int32_t *fdr, switch_interval_time_t timeout)
+{
+#ifdef RTP_IO_ENGINE
+	if (rtp_session->io && (rtp_session->io->attached || rtp_session->io->shared)) {
+		return rtp_io_wait(rtp_session->io, timeout);
+	}
+#endif
+	return switch_poll(rtp_session->read_pollfd, 1, fdr, timeout);
+}
+
+static switch_status_t rtp_input_recvfrom(switch_rtp_t *rtp_session, void *buf, switch_size_t *bytes)
+{
+#ifdef RTP_IO_ENGINE
+	if (rtp_session->io && (rtp_session->io->attached || rtp_session->io->shared)) {
+		if ((*bytes = rtp_io_pop(&rtp_session->io->ring[0], rtp_session->from_addr, buf, *bytes))) {
+			return SWITCH_STATUS_SUCCESS;
 		}
-		break;
+		return SWITCH_STATUS_BREAK;
+	}
+#endif
+	return switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, buf, bytes);
+}
 
-	default:
-		break;
+static switch_status_t rtcp_input_poll(switch_rtp_t *rtp_session, int32_t *fdr)
+{
+#ifdef RTP_IO_ENGINE
+	if (rtp_session->io && rtp_session->io->shared) {
+		return rtp_io_peek(&rtp_session->io->ring[1]) ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_TIMEOUT;
 	}
+#endif
+	return switch_poll(rtp_session->rtcp_read_pollfd, 1, fdr, 0);
 }
 
-static void zrtp_logger(int level, const char *data, int len, int offset)
+static switch_status_t rtcp_input_recvfrom(switch_rtp_t *rtp_session, void *buf, switch_size_t *bytes)
 {
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "%s", data);
+#ifdef RTP_IO_ENGINE
+	if (rtp_session->io && rtp_session->io->shared) {
+		if ((*bytes = rtp_io_pop(&rtp_session->io->ring[1], rtp_session->rtcp_from_addr, buf, *bytes))) {
+			return SWITCH_STATUS_SUCCESS;
+		}
+		return SWITCH_STATUS_BREAK;
+	}
+#endif
+	return switch_socket_recvfrom(rtp_session->rtcp_from_addr, rtp_session->rtcp_sock_input, 0, buf, bytes);
 }
+
+/* more says another packet of the same frame follows right away, so the send may be batched */
+static switch_status_t rtp_output_sendto(switch_rtp_t *rtp_session, void *data, switch_size_t *bytes, switch_bool_t more)
+{
+#ifdef RTP_IO_ENGINE
+	rtp_io_t *io = rtp_session->io;
+	switch_os_socket_t fd = SWITCH_SOCK_INVALID;
+
+	if (io && io->out) {
+		if (io->attached && *bytes <= RTP_IO_SLOT_LEN && rtp_session->remote_addr &&
+			(more || io->out_count) && switch_os_sock_get(&fd, rtp_session->sock_output) == SWITCH_STATUS_SUCCESS) {
+			rtp_io_queue(rtp_session, fd, data, *bytes, !more);
+			return SWITCH_STATUS_SUCCESS;
+		}
+
+		if (io->out_count) {
+			switch_mutex_lock(rtp_session->write_mutex);
+			rtp_io_flush(io);
+			switch_mutex_unlock(rtp_session->write_mutex);
+		}
+	}
 #endif
+	return switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+}
 
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 {
+#ifdef RTP_IO_ENGINE
+	const char *io_threads;
+#endif
 #ifdef ENABLE_ZRTP
 	const char *zid_string = switch_core_get_variable_pdup("switch_serial", pool);
 	const char *zrtp_enabled = switch_core_get_variable_pdup("zrtp_enabled", pool);
@@ -1534,6 +2807,16 @@ SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 #endif
 	switch_mutex_init(&port_lock, SWITCH_MUTEX_NESTED, pool);
 	switch_rtp_dtls_init();
+#ifdef RTP_IO_ENGINE
+	switch_mutex_init(&rtp_io_engine.mutex, SWITCH_MUTEX_NESTED, pool);
+	rtp_io_engine.pool = pool;
+	switch_core_hash_init(&rtp_io_engine.shared);
+	switch_core_hash_init(&rtp_io_engine.shared_ips);
+
+	if ((io_threads = switch_core_get_variable("rtp_io_threads")) && atoi(io_threads) > 0) {
+		switch_rtp_io_engine_start(atoi(io_threads));
+	}
+#endif
 	global_init = 1;
 }
 
@@ -2511,6 +3794,8 @@ SWITCH_DECLARE(void) switch_rtp_shutdown(void)
 	switch_core_hash_destroy(&alloc_hash);
 	switch_mutex_unlock(port_lock);
 
+	switch_rtp_io_engine_stop();
+
 #ifdef ENABLE_ZRTP
 	if (zrtp_on) {
 		zrtp_status_t status = zrtp_status_ok;
@@ -2562,6 +3847,11 @@ SWITCH_DECLARE(void) switch_rtp_release_port(const char *ip, switch_port_t port)
 		return;
 	}
 
+	if (switch_rtp_port_is_shared(ip, port)) {
+		/* shared ports stay open until the io engine stops */
+		return;
+	}
+
 	switch_mutex_lock(port_lock);
 	if ((alloc = switch_core_hash_find(alloc_hash, ip))) {
 		switch_core_port_allocator_free_port(alloc, port);
@@ -2614,6 +3904,10 @@ SWITCH_DECLARE(void) switch_rtp_intentional_bugs(switch_rtp_t *rtp_session, swit
 		rtp_session->seq = 0;
 	}
 
+#ifdef RTP_IO_ENGINE
+	rtp_io_learn_remote(rtp_session);
+#endif
+
 }
 
 
@@ -2653,6 +3947,9 @@ static switch_status_t enable_remote_rtcp_socket(switch_rtp_t *rtp_session, cons
 			}
 		}
 
+#ifdef RTP_IO_ENGINE
+		rtp_io_learn_remote(rtp_session);
+#endif
 	} else {
 		*err = "RTCP NOT ACTIVE!";
 	}
@@ -2675,19 +3972,27 @@ static switch_status_t enable_local_rtcp_socket(switch_rtp_t *rtp_session, const
 			goto done;
 		}
 
-		if (switch_socket_create(&rtcp_new_sock, switch_sockaddr_get_family(rtp_session->rtcp_local_addr), SOCK_DGRAM, 0, rtp_session->pool) != SWITCH_STATUS_SUCCESS) {
-			*err = "RTCP Socket Error!";
-			goto done;
-		}
+		if (rtp_sock_is_shared(rtp_session, rtp_session->sock_input)) {
+			/* the shared port brings its own rtcp socket on the next port */
+			if (!rtp_sock_is_shared(rtp_session, rtp_session->rtcp_sock_input)) {
+				rtcp_old_sock = rtp_session->rtcp_sock_input;
+			}
+			rtp_session->rtcp_sock_input = rtp_shared_sock(rtp_session, 1);
+		} else {
+			if (switch_socket_create(&rtcp_new_sock, switch_sockaddr_get_family(rtp_session->rtcp_local_addr), SOCK_DGRAM, 0, rtp_session->pool) != SWITCH_STATUS_SUCCESS) {
+				*err = "RTCP Socket Error!";
+				goto done;
+			}
 
-		if (switch_socket_opt_set(rtcp_new_sock, SWITCH_SO_REUSEADDR, 1) != SWITCH_STATUS_SUCCESS) {
-			*err = "RTCP Socket Error!";
-			goto done;
-		}
+			if (switch_socket_opt_set(rtcp_new_sock, SWITCH_SO_REUSEADDR, 1) != SWITCH_STATUS_SUCCESS) {
+				*err = "RTCP Socket Error!";
+				goto done;
+			}
 
-		if (switch_socket_bind(rtcp_new_sock, rtp_session->rtcp_local_addr) != SWITCH_STATUS_SUCCESS) {
-			*err = "RTCP Bind Error!";
-			goto done;
+			if (switch_socket_bind(rtcp_new_sock, rtp_session->rtcp_local_addr) != SWITCH_STATUS_SUCCESS) {
+				*err = "RTCP Bind Error!";
+				goto done;
+			}
 		}
 
 		if (switch_sockaddr_info_get(&rtp_session->rtcp_from_addr, switch_get_addr(bufa, sizeof(bufa), rtp_session->from_addr),
@@ -2696,9 +4001,11 @@ static switch_status_t enable_local_rtcp_socket(switch_rtp_t *rtp_session, const
 			goto done;
 		}
 
-		rtcp_old_sock = rtp_session->rtcp_sock_input;
-		rtp_session->rtcp_sock_input = rtcp_new_sock;
-		rtcp_new_sock = NULL;
+		if (rtcp_new_sock) {
+			rtcp_old_sock = rtp_session->rtcp_sock_input;
+			rtp_session->rtcp_sock_input = rtcp_new_sock;
+			rtcp_new_sock = NULL;
+		}
 
 		switch_socket_create_pollset(&rtp_session->rtcp_read_pollfd, rtp_session->rtcp_sock_input, SWITCH_POLLIN | SWITCH_POLLERR, rtp_session->pool);
 
@@ -2771,6 +4078,23 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_local_address(switch_rtp_t *rtp_s
 		switch_rtp_kill_socket(rtp_session);
 	}
 
+#ifdef RTP_IO_ENGINE
+	rtp_io_unshare(rtp_session);
+
+	if (switch_rtp_port_is_shared(host, port)) {
+		old_sock = rtp_session->sock_input;
+
+		if (rtp_io_attach_shared(rtp_session, host, port) != SWITCH_STATUS_SUCCESS) {
+			old_sock = NULL;
+			*err = "Shared Port Error!";
+			goto done;
+		}
+
+		switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_NOBLOCK);
+		goto sock_ready;
+	}
+#endif
+
 	if (switch_socket_create(&new_sock, switch_sockaddr_get_family(rtp_session->local_addr), SOCK_DGRAM, 0, rtp_session->pool) != SWITCH_STATUS_SUCCESS) {
 		*err = "Socket Error!";
 		goto done;
@@ -2858,8 +4182,14 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_local_address(switch_rtp_t *rtp_s
 	if (rtp_session->flags[SWITCH_RTP_FLAG_USE_TIMER] || rtp_session->flags[SWITCH_RTP_FLAG_NOBLOCK] || rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
 		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, TRUE);
 		switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_NOBLOCK);
+#ifdef RTP_IO_ENGINE
+		rtp_io_attach(rtp_session);
+#endif
 	}
 
+#ifdef RTP_IO_ENGINE
+ sock_ready:
+#endif
 	switch_socket_create_pollset(&rtp_session->read_pollfd, rtp_session->sock_input, SWITCH_POLLIN | SWITCH_POLLERR, rtp_session->pool);
 
 	if (rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP]) {
@@ -3004,7 +4334,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_udptl_mode(switch_rtp_t *rtp_session)
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (switch_rtp_test_flag(rtp_session, SWITCH_RTP_FLAG_PROXY_MEDIA)) {
+	if (switch_rtp_test_flag(rtp_session, SWITCH_RTP_FLAG_PROXY_MEDIA) && !rtp_sock_is_shared(rtp_session, rtp_session->sock_input)) {
 		ping_socket(rtp_session);
 	}
 
@@ -3025,6 +4355,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_udptl_mode(switch_rtp_t *rtp_session)
 	if (rtp_session->flags[SWITCH_RTP_FLAG_RTCP_MUX]) {
 		rtp_session->rtcp_sock_input = NULL;
 		rtp_session->rtcp_sock_output = NULL;
+	} else if (rtp_sock_is_shared(rtp_session, rtp_session->rtcp_sock_input)) {
+		rtp_session->rtcp_sock_input = NULL;
+		rtp_session->rtcp_sock_output = NULL;
 	} else {
 		if (rtp_session->rtcp_sock_input && rtp_session->rtcp_sock_input != rtp_session->sock_input) {
 			ping_socket(rtp_session);
@@ -3050,8 +4383,11 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_udptl_mode(switch_rtp_t *rtp_session)
 
 	switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_UDPTL);
 	switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_PROXY_MEDIA);
-	switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, FALSE);
-	switch_rtp_clear_flag(rtp_session, SWITCH_RTP_FLAG_NOBLOCK);
+	if (!rtp_sock_is_shared(rtp_session, rtp_session->sock_input)) {
+		/* a shared port keeps feeding the session from the io engine */
+		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, FALSE);
+		switch_rtp_clear_flag(rtp_session, SWITCH_RTP_FLAG_NOBLOCK);
+	}
 
 	WRITE_DEC(rtp_session);
 	READ_DEC(rtp_session);
@@ -3134,6 +4470,10 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_remote_address(switch_rtp_t *rtp_
 			}*/
 	}
 
+#ifdef RTP_IO_ENGINE
+	rtp_io_learn_remote(rtp_session);
+#endif
+
 	switch_mutex_unlock(rtp_session->write_mutex);
 
 	return status;
@@ -4812,6 +6152,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_jitter_buffer(switch_rtp_t *
 		if (switch_true(switch_channel_get_variable_dup(switch_core_session_get_channel(rtp_session->session), "jb_use_timestamps", SWITCH_FALSE, -1))) {
 			switch_jb_ts_mode(rtp_session->jb, samples_per_packet, samples_per_second);
 		}
+		if (switch_true(switch_channel_get_variable_dup(switch_core_session_get_channel(rtp_session->session), "jb_adaptive", SWITCH_FALSE, -1))) {
+			switch_jb_set_adaptive(rtp_session->jb, samples_per_packet, samples_per_second);
+		}
 		//switch_jb_debug_level(rtp_session->jb, 10);
 		READ_DEC(rtp_session);
 	}
@@ -4961,6 +6304,10 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_ice(switch_rtp_t *rtp_sessio
 		switch_rtp_break(rtp_session);
 	}
 
+#ifdef RTP_IO_ENGINE
+	rtp_io_learn_remote(rtp_session);
+#endif
+
 	switch_mutex_unlock(rtp_session->ice_mutex);
 
 	return SWITCH_STATUS_SUCCESS;
@@ -5051,6 +6398,11 @@ SWITCH_DECLARE(void) switch_rtp_break(switch_rtp_t *rtp_session)
 	rtp_session->flags[SWITCH_RTP_FLAG_BREAK] = 1;
 
 	if (rtp_session->flags[SWITCH_RTP_FLAG_NOBLOCK]) {
+#ifdef RTP_IO_ENGINE
+		if (rtp_session->io && rtp_session->io->attached) {
+			rtp_io_wake(rtp_session->io);
+		}
+#endif
 		switch_mutex_unlock(rtp_session->flag_mutex);
 		return;
 	}
@@ -5066,22 +6418,27 @@ SWITCH_DECLARE(void) switch_rtp_kill_socket(switch_rtp_t *rtp_session)
 {
 	switch_assert(rtp_session != NULL);
 	switch_mutex_lock(rtp_session->flag_mutex);
+#ifdef RTP_IO_ENGINE
+	rtp_io_detach(rtp_session);
+#endif
 	if (rtp_session->flags[SWITCH_RTP_FLAG_IO]) {
 		rtp_session->flags[SWITCH_RTP_FLAG_IO] = 0;
-		if (rtp_session->sock_input) {
+		if (rtp_session->sock_input && !rtp_sock_is_shared(rtp_session, rtp_session->sock_input)) {
 			ping_socket(rtp_session);
 			switch_socket_shutdown(rtp_session->sock_input, SWITCH_SHUTDOWN_READWRITE);
 		}
-		if (rtp_session->sock_output && rtp_session->sock_output != rtp_session->sock_input) {
+		if (rtp_session->sock_output && rtp_session->sock_output != rtp_session->sock_input &&
+			!rtp_sock_is_shared(rtp_session, rtp_session->sock_output)) {
 			switch_socket_shutdown(rtp_session->sock_output, SWITCH_SHUTDOWN_READWRITE);
 		}
 
 		if (rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP]) {
-			if (rtp_session->rtcp_sock_input) {
+			if (rtp_session->rtcp_sock_input && !rtp_sock_is_shared(rtp_session, rtp_session->rtcp_sock_input)) {
 				ping_socket(rtp_session);
 				switch_socket_shutdown(rtp_session->rtcp_sock_input, SWITCH_SHUTDOWN_READWRITE);
 			}
-			if (rtp_session->rtcp_sock_output && rtp_session->rtcp_sock_output != rtp_session->rtcp_sock_input) {
+			if (rtp_session->rtcp_sock_output && rtp_session->rtcp_sock_output != rtp_session->rtcp_sock_input &&
+				!rtp_sock_is_shared(rtp_session, rtp_session->rtcp_sock_output)) {
 				switch_socket_shutdown(rtp_session->rtcp_sock_output, SWITCH_SHUTDOWN_READWRITE);
 			}
 		}
@@ -5164,6 +6521,9 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 	switch_mutex_lock((*rtp_session)->flag_mutex);
 
 	switch_rtp_kill_socket(*rtp_session);
+#ifdef RTP_IO_ENGINE
+	rtp_io_unshare(*rtp_session);
+#endif
 
 	while (switch_queue_trypop((*rtp_session)->dtmf_data.dtmf_inqueue, &pop) == SWITCH_STATUS_SUCCESS) {
 		switch_safe_free(pop);
@@ -5198,11 +6558,12 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 	}
 
 
-	sock = (*rtp_session)->sock_input;
-	(*rtp_session)->sock_input = NULL;
-	switch_socket_close(sock);
+	if ((sock = (*rtp_session)->sock_input)) {
+		(*rtp_session)->sock_input = NULL;
+		switch_socket_close(sock);
+	}
 
-	if ((*rtp_session)->sock_output != sock) {
+	if ((*rtp_session)->sock_output && (*rtp_session)->sock_output != sock) {
 		sock = (*rtp_session)->sock_output;
 		(*rtp_session)->sock_output = NULL;
 		switch_socket_close(sock);
@@ -5704,7 +7065,7 @@ static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_
 		do {
 			if (switch_rtp_ready(rtp_session)) {
 				bytes = sizeof(rtp_msg_t);
-				switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, &bytes);
+				rtp_input_recvfrom(rtp_session, (void *) &rtp_session->recv_msg, &bytes);
 
 				if (bytes) {
 					int do_cng = 0;
@@ -5847,7 +7208,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 			}
 		}
 
-		poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, to);
+		poll_status = rtp_input_poll(rtp_session, &fdr, to);
 
 		if (rtp_session->flags[SWITCH_RTP_FLAG_USE_TIMER] && rtp_session->timer.interval) {
 			switch_core_timer_sync(&rtp_session->timer);
@@ -5873,7 +7234,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	memset(&rtp_session->last_rtp_hdr, 0, sizeof(rtp_session->last_rtp_hdr));
 
 	if (poll_status == SWITCH_STATUS_SUCCESS) {
-		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+		status = rtp_input_recvfrom(rtp_session, (void *) &rtp_session->recv_msg, bytes);
 	} else {
 		*bytes = 0;
 	}
@@ -6495,6 +7856,9 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 				{
 					if (status == SWITCH_STATUS_TIMEOUT) {
 						rtp_session->skip_timer = 1;
+						if (switch_jb_last_read_accelerated(rtp_session->jb)) {
+							(*flags) |= SFF_JB_ACCELERATE;
+						}
 					}
 					rtp_session->stats.inbound.jb_packet_count++;
 					status = SWITCH_STATUS_SUCCESS;
@@ -7031,7 +8395,7 @@ static switch_status_t read_rtcp_packet(switch_rtp_t *rtp_session, switch_size_t
 
 	*bytes = sizeof(rtcp_msg_t);
 
-	if ((status = switch_socket_recvfrom(rtp_session->rtcp_from_addr, rtp_session->rtcp_sock_input, 0, (void *) rtp_session->rtcp_recv_msg_p, bytes))
+	if ((status = rtcp_input_recvfrom(rtp_session, (void *) rtp_session->rtcp_recv_msg_p, bytes))
 		!= SWITCH_STATUS_SUCCESS) {
 		*bytes = 0;
 	}
@@ -7247,7 +8611,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 			rtp_session->read_pollfd) {
 
 			if (rtp_session->jb && !rtp_session->pause_jb && jb_valid(rtp_session)) {
-				while (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				while (rtp_input_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 
 					if (status == SWITCH_STATUS_GENERR) {
@@ -7270,7 +8634,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 
 			} else if ((rtp_session->flags[SWITCH_RTP_FLAG_AUTOFLUSH] || rtp_session->flags[SWITCH_RTP_FLAG_STICKY_FLUSH])) {
 
-				if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				if (rtp_input_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 					if (status == SWITCH_STATUS_GENERR) {
 						ret = -1;
@@ -7289,7 +8653,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 					}
 
 					if (bytes) {
-						if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+						if (rtp_input_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 							rtp_session->hot_hits++;//+= rtp_session->samples_per_interval;
 
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG10, "%s Hot Hit %d\n",
@@ -7399,7 +8763,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 				pt = 0;
 			}
 
-			poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, pt);
+			poll_status = rtp_input_poll(rtp_session, &fdr, pt);
 
 			if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] && poll_status != SWITCH_STATUS_SUCCESS && rtp_session->media_timeout && rtp_session->last_media) {
 				check_timeout(rtp_session);
@@ -7541,7 +8905,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 				has_rtcp = 0;
 
 			} else if (rtp_session->rtcp_read_pollfd) {
-				rtcp_poll_status = switch_poll(rtp_session->rtcp_read_pollfd, 1, &rtcp_fdr, 0);
+				rtcp_poll_status = rtcp_input_poll(rtp_session, &rtcp_fdr);
 			}
 
 			if (rtcp_poll_status == SWITCH_STATUS_SUCCESS) {
@@ -8736,7 +10100,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ALERT,
 								  "Simulate dropping packet ......... ts: %u seq: %u\n", ntohl(send_msg->header.ts), ntohs(send_msg->header.seq));
 			} else {
-				if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+				if (rtp_output_sendto(rtp_session, (void *) send_msg, &bytes, SWITCH_FALSE) != SWITCH_STATUS_SUCCESS) {
 					rtp_session->seq--;
 					ret = -1;
 					goto end;
@@ -8750,7 +10114,8 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 		//
 		//	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SEND %u\n", ntohs(send_msg->header.seq));
 		//}
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+		if (rtp_output_sendto(rtp_session, (void *) send_msg, &bytes,
+							  rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] && !send_msg->header.m) != SWITCH_STATUS_SUCCESS) {
 			rtp_session->seq -= delta;
 
 			ret = -1;
@@ -8941,7 +10306,7 @@ SWITCH_DECLARE(int) switch_rtp_write_frame(switch_rtp_t *rtp_session, switch_fra
 
 		}
 
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, frame->packet, &bytes) != SWITCH_STATUS_SUCCESS) {
+		if (rtp_output_sendto(rtp_session, frame->packet, &bytes, SWITCH_FALSE) != SWITCH_STATUS_SUCCESS) {
 			return -1;
 		}
 
@@ -9116,7 +10481,14 @@ SWITCH_DECLARE(switch_rtp_stats_t *) switch_rtp_get_stats(switch_rtp_t *rtp_sess
 	}
 
 	if (rtp_session->jb) {
+		uint32_t target_ms = 0, delay_ms = 0, accelerate = 0, expand = 0;
+
 		switch_jb_get_frames(rtp_session->jb, NULL, NULL, NULL, (uint32_t *)&s->inbound.largest_jb_size);
+		switch_jb_get_delay_stats(rtp_session->jb, &target_ms, &delay_ms, &accelerate, &expand);
+		s->inbound.jb_target_delay = target_ms;
+		s->inbound.jb_delay = delay_ms;
+		s->inbound.jb_accelerate_count = accelerate;
+		s->inbound.jb_expand_count = expand;
 	}
 
 	do_mos(rtp_session);
@@ -9255,7 +10627,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_write_raw(switch_rtp_t *rtp_session,
 #endif
 	}
 
-	status = switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+	status = rtp_output_sendto(rtp_session, data, bytes, SWITCH_FALSE);
 #if defined(ENABLE_SRTP) || defined(ENABLE_ZRTP)
  end:
 #endif
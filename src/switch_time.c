@@ -37,6 +37,7 @@
 
 #ifdef HAVE_TIMERFD_CREATE
 #include <sys/timerfd.h>
+#include <sys/epoll.h>
 #endif
 
 //#if defined(DARWIN)
@@ -355,6 +356,11 @@ SWITCH_DECLARE(void) switch_time_set_timerfd(int enable)
 #endif
 }
 
+SWITCH_DECLARE(int) switch_time_get_timerfd(void)
+{
+	return TFD;
+}
+
 
 SWITCH_DECLARE(void) switch_time_set_matrix(switch_bool_t enable)
 {
@@ -532,6 +538,304 @@ static switch_status_t _timerfd_destroy(switch_timer_t *timer)
 	return rc;
 }
 
+/*
+  TFD == 3: one timerfd per interval, shared by every timer of that interval and owned by one of a few
+  epoll driven clock threads.  Each expiration bumps the interval tick and releases all of its waiters
+  with a single broadcast, so a session costs no fd and no syscalls of its own.
+*/
+#define SHARED_CLOCK_THREADS 4
+
+struct shared_interval {
+	int fd;
+	int users;
+	int clock;
+	uint64_t tick;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+};
+typedef struct shared_interval shared_interval_t;
+
+static shared_interval_t SHARED_INTERVALS[MAX_INTERVAL + 1];
+
+static struct {
+	int poll_fd[SHARED_CLOCK_THREADS];
+	switch_thread_t *thread[SHARED_CLOCK_THREADS];
+	int count;
+	int32_t running;
+	switch_mutex_t *mutex;
+} shared_clock;
+
+static void *SWITCH_THREAD_FUNC shared_clock_thread(switch_thread_t *thread, void *obj)
+{
+	int poll_fd = *(int *) obj;
+	struct epoll_event e[64];
+	shared_interval_t *si;
+	uint64_t u64;
+	int i, r;
+
+	while (shared_clock.running == 1) {
+		if ((r = epoll_wait(poll_fd, e, sizeof(e) / sizeof(e[0]), 100)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		for (i = 0; i < r; i++) {
+			si = e[i].data.ptr;
+
+			switch_mutex_lock(si->mutex);
+			if (si->fd > -1 && read(si->fd, &u64, sizeof(u64)) == sizeof(u64)) {
+				si->tick += u64;
+				switch_thread_cond_broadcast(si->cond);
+			}
+			switch_mutex_unlock(si->mutex);
+		}
+	}
+
+	return NULL;
+}
+
+/* called with shared_clock.mutex held */
+static switch_status_t shared_clock_start(void)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	int i;
+
+	if (shared_clock.running == 1) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	shared_clock.count = switch_core_cpu_count() / 8;
+
+	if (shared_clock.count < 1) {
+		shared_clock.count = 1;
+	} else if (shared_clock.count > SHARED_CLOCK_THREADS) {
+		shared_clock.count = SHARED_CLOCK_THREADS;
+	}
+
+	shared_clock.running = 1;
+
+	for (i = 0; i < shared_clock.count; i++) {
+		if ((shared_clock.poll_fd[i] = epoll_create(16)) < 0) {
+			break;
+		}
+
+		switch_threadattr_create(&thd_attr, module_pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+
+		if (switch_thread_create(&shared_clock.thread[i], thd_attr, shared_clock_thread, &shared_clock.poll_fd[i], module_pool) != SWITCH_STATUS_SUCCESS) {
+			close(shared_clock.poll_fd[i]);
+			break;
+		}
+	}
+
+	if (!(shared_clock.count = i)) {
+		shared_clock.running = 0;
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %d shared timerfd clock thread%s\n", i, i == 1 ? "" : "s");
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void shared_clock_stop(void)
+{
+	switch_status_t st;
+	int i;
+
+	if (!shared_clock.mutex || shared_clock.running != 1) {
+		return;
+	}
+
+	shared_clock.running = -1;
+
+	for (i = 0; i < shared_clock.count; i++) {
+		switch_thread_join(&st, shared_clock.thread[i]);
+		close(shared_clock.poll_fd[i]);
+	}
+
+	/* nobody ticks anymore, let the waiters go */
+	for (i = 1; i <= MAX_INTERVAL; i++) {
+		shared_interval_t *si = &SHARED_INTERVALS[i];
+
+		if (si->mutex) {
+			switch_mutex_lock(si->mutex);
+			switch_thread_cond_broadcast(si->cond);
+			switch_mutex_unlock(si->mutex);
+		}
+	}
+
+	shared_clock.running = 0;
+}
+
+static switch_status_t _timerfd_shared_init(switch_timer_t *timer)
+{
+	shared_interval_t *si;
+	struct itimerspec val;
+	struct epoll_event e = { 0 };
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	int fd;
+
+	if (timer->interval < 1 || timer->interval > MAX_INTERVAL) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if (!shared_clock.mutex) {
+		switch_mutex_init(&shared_clock.mutex, SWITCH_MUTEX_NESTED, module_pool);
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	switch_mutex_lock(shared_clock.mutex);
+
+	if (shared_clock_start() != SWITCH_STATUS_SUCCESS) {
+		status = SWITCH_STATUS_GENERR;
+		goto end;
+	}
+
+	si = &SHARED_INTERVALS[timer->interval];
+
+	if (!si->mutex) {
+		switch_mutex_init(&si->mutex, SWITCH_MUTEX_NESTED, module_pool);
+		switch_thread_cond_create(&si->cond, module_pool);
+		si->fd = -1;
+	}
+
+	if (si->users++) {
+		goto done;
+	}
+
+	if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		si->users--;
+		status = SWITCH_STATUS_GENERR;
+		goto end;
+	}
+
+	val.it_interval.tv_sec = timer->interval / 1000;
+	val.it_interval.tv_nsec = (timer->interval % 1000) * 1000000;
+	val.it_value = val.it_interval;
+
+	si->clock = timer->interval % shared_clock.count;
+	e.events = EPOLLIN | EPOLLERR;
+	e.data.ptr = si;
+
+	switch_mutex_lock(si->mutex);
+	si->fd = fd;
+
+	if (timerfd_settime(fd, 0, &val, NULL) < 0 || epoll_ctl(shared_clock.poll_fd[si->clock], EPOLL_CTL_ADD, fd, &e) < 0) {
+		close(fd);
+		si->fd = -1;
+		si->users--;
+		status = SWITCH_STATUS_GENERR;
+	}
+	switch_mutex_unlock(si->mutex);
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		goto end;
+	}
+
+ done:
+
+	timer->start = switch_micro_time_now();
+	timer->private_info = si;
+	timer->tick = si->tick;
+
+ end:
+
+	switch_mutex_unlock(shared_clock.mutex);
+
+	return status;
+}
+
+static switch_status_t _timerfd_shared_next(switch_timer_t *timer)
+{
+	shared_interval_t *si = timer->private_info;
+
+	if (!si) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	/* not called for a while, catch up instead of returning instantly until it does */
+	if ((int64_t)(timer->tick - si->tick) < -1) {
+		timer->tick = si->tick;
+	}
+
+	_timerfd_step(timer);
+
+	switch_mutex_lock(si->mutex);
+	while ((int64_t)(timer->tick - si->tick) > 0 && shared_clock.running == 1) {
+		switch_thread_cond_wait(si->cond, si->mutex);
+	}
+	switch_mutex_unlock(si->mutex);
+
+	return shared_clock.running == 1 ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t _timerfd_shared_sync(switch_timer_t *timer)
+{
+	shared_interval_t *si = timer->private_info;
+
+	if (!si) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	timer->tick = si->tick;
+	timer->samplecount = (uint32_t)(timer->tick * timer->samples);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t _timerfd_shared_check(switch_timer_t *timer, switch_bool_t step)
+{
+	shared_interval_t *si = timer->private_info;
+	int64_t diff;
+
+	if (!si) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	if ((diff = (int64_t)(timer->tick - si->tick)) > 0) {
+		timer->diff = (switch_size_t)diff;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	timer->diff = 0;
+
+	if (step) {
+		_timerfd_step(timer);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t _timerfd_shared_destroy(switch_timer_t *timer)
+{
+	shared_interval_t *si = timer->private_info;
+
+	if (!si) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_mutex_lock(shared_clock.mutex);
+	if (si->users && !--si->users) {
+		switch_mutex_lock(si->mutex);
+		if (si->fd > -1) {
+			epoll_ctl(shared_clock.poll_fd[si->clock], EPOLL_CTL_DEL, si->fd, NULL);
+			close(si->fd);
+			si->fd = -1;
+		}
+		switch_mutex_unlock(si->mutex);
+	}
+	switch_mutex_unlock(shared_clock.mutex);
+
+	timer->private_info = NULL;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 #endif
 ////////
 
@@ -713,6 +1017,10 @@ static switch_status_t timer_init(switch_timer_t *timer)
 	if (TFD == 2) {
 		return _timerfd_init(timer);
 	}
+
+	if (TFD == 3) {
+		return _timerfd_shared_init(timer);
+	}
 #endif
 
 	while (globals.STARTED == 0) {
@@ -781,7 +1089,7 @@ static switch_status_t timer_step(switch_timer_t *timer)
 	}
 
 #ifdef HAVE_TIMERFD_CREATE
-	if (TFD == 2) {
+	if (TFD == 2 || TFD == 3) {
 		return _timerfd_step(timer);
 	}
 #endif
@@ -818,6 +1126,10 @@ static switch_status_t timer_sync(switch_timer_t *timer)
 	if (TFD == 2) {
 		return timer_generic_sync(timer);
 	}
+
+	if (TFD == 3) {
+		return _timerfd_shared_sync(timer);
+	}
 #endif
 
 	private_info = timer->private_info;
@@ -855,6 +1167,10 @@ static switch_status_t timer_next(switch_timer_t *timer)
 	if (TFD == 2) {
 		return _timerfd_next(timer);
 	}
+
+	if (TFD == 3) {
+		return _timerfd_shared_next(timer);
+	}
 #endif
 
 	private_info = timer->private_info;
@@ -912,6 +1228,10 @@ static switch_status_t timer_check(switch_timer_t *timer, switch_bool_t step)
 	if (TFD == 2) {
 		return _timerfd_check(timer, step);
 	}
+
+	if (TFD == 3) {
+		return _timerfd_shared_check(timer, step);
+	}
 #endif
 
 	private_info = timer->private_info;
@@ -957,6 +1277,10 @@ static switch_status_t timer_destroy(switch_timer_t *timer)
 	if (TFD == 2) {
 		return _timerfd_destroy(timer);
 	}
+
+	if (TFD == 3) {
+		return _timerfd_shared_destroy(timer);
+	}
 #endif
 
 	private_info = timer->private_info;
@@ -985,6 +1309,467 @@ static switch_status_t timer_destroy(switch_timer_t *timer)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/*
+  "wheel" timer: a hierarchical timing wheel driven by its own thread at a fixed 1ms resolution.
+  Each timer waits on its own condition and only the timers whose deadline fell in the current
+  slot are signaled, in one batch per tick, instead of broadcasting to every timer of an interval.
+  While no timer is armed the thread sleeps on wheel.cond instead of ticking.
+  It never changes the global runtime.microseconds_per_tick.
+*/
+#define WHEEL_TICK_US 1000
+#define WHEEL_INNER_BITS 8
+#define WHEEL_INNER_SLOTS (1 << WHEEL_INNER_BITS)
+#define WHEEL_OUTER_SLOTS 64
+#define WHEEL_SPAN ((uint64_t)WHEEL_INNER_SLOTS * WHEEL_OUTER_SLOTS)
+#define WHEEL_HISTOGRAM 9
+
+static const switch_time_t wheel_buckets[WHEEL_HISTOGRAM - 1] = { 50, 100, 250, 500, 1000, 2000, 5000, 10000 };
+
+struct wheel_timer {
+	switch_time_t start;
+	switch_time_t deadline;
+	switch_time_t interval;
+	uint64_t expires;
+	struct wheel_timer **slot;
+	int pending;
+	int fired;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	struct wheel_timer *prev;
+	struct wheel_timer *next;
+};
+typedef struct wheel_timer wheel_timer_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_thread_t *thread;
+	int32_t running;
+	/* timers linked into a slot, the thread parks on cond while there are none */
+	uint32_t armed;
+	int idle;
+	switch_time_t start;
+	uint64_t now;
+	wheel_timer_t *inner[WHEEL_INNER_SLOTS];
+	wheel_timer_t *outer[WHEEL_OUTER_SLOTS];
+	uint32_t timers;
+	uint32_t max_batch;
+	switch_atomic_t late[WHEEL_HISTOGRAM];
+} wheel;
+
+/* both called with wheel.mutex held, nothing is linked for a tick before first */
+static void wheel_link(wheel_timer_t *wt, uint64_t first)
+{
+	wheel_timer_t **slot;
+	uint64_t delta;
+
+	if (wt->expires < first) {
+		wt->expires = first;
+	}
+
+	delta = wt->expires - wheel.now;
+
+	if (delta < WHEEL_INNER_SLOTS) {
+		slot = &wheel.inner[wt->expires & (WHEEL_INNER_SLOTS - 1)];
+	} else if (delta < WHEEL_SPAN) {
+		slot = &wheel.outer[(wt->expires >> WHEEL_INNER_BITS) & (WHEEL_OUTER_SLOTS - 1)];
+	} else {
+		/* further out than the wheel spans, park it in the last outer slot and look again when it cascades */
+		slot = &wheel.outer[((wheel.now + WHEEL_SPAN - 1) >> WHEEL_INNER_BITS) & (WHEEL_OUTER_SLOTS - 1)];
+	}
+
+	wt->prev = NULL;
+	if ((wt->next = *slot)) {
+		wt->next->prev = wt;
+	}
+	*slot = wt;
+	wt->slot = slot;
+}
+
+static void wheel_unlink(wheel_timer_t *wt)
+{
+	if (!wt->slot) {
+		return;
+	}
+
+	wheel.armed--;
+
+	if (wt->prev) {
+		wt->prev->next = wt->next;
+	} else {
+		*wt->slot = wt->next;
+	}
+
+	if (wt->next) {
+		wt->next->prev = wt->prev;
+	}
+
+	wt->prev = wt->next = NULL;
+	wt->slot = NULL;
+}
+
+static void wheel_signal(wheel_timer_t *wt)
+{
+	switch_mutex_lock(wt->mutex);
+	wt->fired = 1;
+	wt->pending = 0;
+	switch_thread_cond_signal(wt->cond);
+	switch_mutex_unlock(wt->mutex);
+}
+
+static void *SWITCH_THREAD_FUNC wheel_thread(switch_thread_t *thread, void *obj)
+{
+	wheel_timer_t *batch, *wt, *next;
+	switch_time_t target, now;
+	uint32_t batch_count;
+	int i;
+
+	while (wheel.running == 1) {
+		if (!wheel.armed) {
+			switch_mutex_lock(wheel.mutex);
+			while (wheel.running == 1 && !wheel.armed) {
+				wheel.idle = 1;
+				switch_thread_cond_wait(wheel.cond, wheel.mutex);
+			}
+			wheel.idle = 0;
+			switch_mutex_unlock(wheel.mutex);
+			continue;
+		}
+
+		target = wheel.start + (switch_time_t)(wheel.now + 1) * WHEEL_TICK_US;
+
+		if ((now = switch_mono_micro_time_now()) < target) {
+			do_sleep(target - now);
+			continue;
+		}
+
+		batch = NULL;
+		batch_count = 0;
+
+		switch_mutex_lock(wheel.mutex);
+
+		/* catch up on every tick that passed, late timers still go out in this one batch */
+		while (wheel.start + (switch_time_t)(wheel.now + 1) * WHEEL_TICK_US <= now) {
+			uint64_t tick = ++wheel.now;
+			wheel_timer_t **slot;
+
+			if (!(tick & (WHEEL_INNER_SLOTS - 1))) {
+				slot = &wheel.outer[(tick >> WHEEL_INNER_BITS) & (WHEEL_OUTER_SLOTS - 1)];
+				wt = *slot;
+				*slot = NULL;
+
+				for (; wt; wt = next) {
+					next = wt->next;
+					wheel_link(wt, tick);
+				}
+			}
+
+			slot = &wheel.inner[tick & (WHEEL_INNER_SLOTS - 1)];
+			wt = *slot;
+			*slot = NULL;
+
+			for (; wt; wt = next) {
+				next = wt->next;
+				wheel.armed--;
+				wt->slot = NULL;
+				wt->pending = 1;
+				wt->prev = NULL;
+				wt->next = batch;
+				batch = wt;
+				batch_count++;
+			}
+		}
+
+		if (batch_count > wheel.max_batch) {
+			wheel.max_batch = batch_count;
+		}
+
+		switch_mutex_unlock(wheel.mutex);
+
+		for (wt = batch; wt; wt = next) {
+			next = wt->next;
+			wt->next = NULL;
+			wheel_signal(wt);
+		}
+	}
+
+	/* let anybody still waiting go */
+	switch_mutex_lock(wheel.mutex);
+	for (i = 0; i < WHEEL_INNER_SLOTS + WHEEL_OUTER_SLOTS; i++) {
+		wheel_timer_t **slot = i < WHEEL_INNER_SLOTS ? &wheel.inner[i] : &wheel.outer[i - WHEEL_INNER_SLOTS];
+
+		for (wt = *slot, *slot = NULL; wt; wt = next) {
+			next = wt->next;
+			wt->slot = NULL;
+			wt->prev = wt->next = NULL;
+			wheel_signal(wt);
+		}
+	}
+	wheel.running = 0;
+	switch_mutex_unlock(wheel.mutex);
+
+	return NULL;
+}
+
+static switch_status_t wheel_start(void)
+{
+	switch_threadattr_t *thd_attr = NULL;
+
+	if (wheel.running == 1) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!wheel.mutex) {
+		switch_mutex_init(&wheel.mutex, SWITCH_MUTEX_NESTED, module_pool);
+		switch_thread_cond_create(&wheel.cond, module_pool);
+	}
+
+	wheel.start = switch_mono_micro_time_now();
+	wheel.now = 0;
+	wheel.armed = 0;
+	wheel.idle = 0;
+	wheel.running = 1;
+
+	switch_threadattr_create(&thd_attr, module_pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+
+	if (switch_thread_create(&wheel.thread, thd_attr, wheel_thread, NULL, module_pool) != SWITCH_STATUS_SUCCESS) {
+		wheel.running = 0;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void wheel_stop(void)
+{
+	switch_status_t st;
+
+	if (!wheel.thread) {
+		return;
+	}
+
+	switch_mutex_lock(wheel.mutex);
+	wheel.running = -1;
+	switch_thread_cond_signal(wheel.cond);
+	switch_mutex_unlock(wheel.mutex);
+
+	switch_thread_join(&st, wheel.thread);
+	wheel.thread = NULL;
+}
+
+static void wheel_record(switch_time_t late)
+{
+	int i;
+
+	for (i = 0; i < WHEEL_HISTOGRAM - 1 && late > wheel_buckets[i]; i++);
+
+	switch_atomic_inc(&wheel.late[i]);
+}
+
+static switch_status_t wheel_timer_init(switch_timer_t *timer)
+{
+	wheel_timer_t *wt;
+
+	if (timer->interval < 1 || timer->interval > MAX_ELEMENTS) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if (wheel_start() != SWITCH_STATUS_SUCCESS) {
+		switch_mutex_unlock(globals.mutex);
+		return SWITCH_STATUS_FALSE;
+	}
+	wheel.timers++;
+	switch_mutex_unlock(globals.mutex);
+
+	wt = switch_core_alloc(timer->memory_pool, sizeof(*wt));
+	switch_mutex_init(&wt->mutex, SWITCH_MUTEX_NESTED, timer->memory_pool);
+	switch_thread_cond_create(&wt->cond, timer->memory_pool);
+	wt->interval = (switch_time_t)timer->interval * 1000;
+	wt->start = wt->deadline = switch_mono_micro_time_now();
+
+	timer->start = switch_micro_time_now();
+	timer->private_info = wt;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_step(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	wt->deadline += wt->interval;
+	timer->tick++;
+	timer->samplecount += timer->samples;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_sync(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	timer->tick = (switch_mono_micro_time_now() - wt->start) / wt->interval;
+	timer->samplecount = (uint32_t)(timer->tick * timer->samples);
+	wt->deadline = wt->start + (switch_time_t)timer->tick * wt->interval;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_next(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+	switch_time_t now;
+
+	if (!wt) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	now = switch_mono_micro_time_now();
+
+	/* not called for a while, start over from now instead of returning instantly until it catches up */
+	if (now - wt->deadline > wt->interval * 2) {
+		wheel_timer_sync(timer);
+	}
+
+	wheel_timer_step(timer);
+
+	if (wt->deadline > now) {
+		switch_mutex_lock(wheel.mutex);
+		if (wheel.running != 1) {
+			switch_mutex_unlock(wheel.mutex);
+			return SWITCH_STATUS_FALSE;
+		}
+		if (wheel.idle) {
+			/* nothing was armed while the thread slept, skip the ticks it missed instead of replaying them */
+			wheel.now = (uint64_t)((now - wheel.start) / WHEEL_TICK_US);
+			wheel.idle = 0;
+			switch_thread_cond_signal(wheel.cond);
+		}
+		wt->expires = (uint64_t)((wt->deadline - wheel.start + WHEEL_TICK_US - 1) / WHEEL_TICK_US);
+		wt->fired = 0;
+		wheel_link(wt, wheel.now + 1);
+		wheel.armed++;
+		switch_mutex_unlock(wheel.mutex);
+
+		switch_mutex_lock(wt->mutex);
+		while (!wt->fired) {
+			switch_thread_cond_wait(wt->cond, wt->mutex);
+		}
+		switch_mutex_unlock(wt->mutex);
+
+		now = switch_mono_micro_time_now();
+	}
+
+	wheel_record(now > wt->deadline ? now - wt->deadline : 0);
+
+	return wheel.running == 1 ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t wheel_timer_check(switch_timer_t *timer, switch_bool_t step)
+{
+	wheel_timer_t *wt = timer->private_info;
+	switch_time_t now;
+
+	if (!wt) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	now = switch_mono_micro_time_now();
+
+	if (now < wt->deadline + wt->interval) {
+		timer->diff = (switch_size_t)(wt->deadline + wt->interval - now);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	timer->diff = 0;
+
+	if (step) {
+		wheel_timer_step(timer);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_destroy(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	switch_mutex_lock(wheel.mutex);
+	wheel_unlink(wt);
+	switch_mutex_unlock(wheel.mutex);
+
+	/* the wheel thread may still be about to signal it */
+	for (;;) {
+		int pending;
+
+		switch_mutex_lock(wt->mutex);
+		pending = wt->pending;
+		switch_mutex_unlock(wt->mutex);
+
+		if (!pending) {
+			break;
+		}
+
+		switch_os_yield();
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if (wheel.timers) {
+		wheel.timers--;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	timer->private_info = NULL;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_time_wheel_stats(switch_core_db_callback_func_t callback, void *pArg)
+{
+	char *names[] = { "latency", "wakeups", "percent" };
+	char *vals[3];
+	char latency[32], wakeups[32], percent[32];
+	uint32_t counts[WHEEL_HISTOGRAM], total = 0;
+	int i;
+
+	for (i = 0; i < WHEEL_HISTOGRAM; i++) {
+		total += counts[i] = switch_atomic_read(&wheel.late[i]);
+	}
+
+	for (i = 0; i < WHEEL_HISTOGRAM; i++) {
+		if (i < WHEEL_HISTOGRAM - 1) {
+			switch_snprintf(latency, sizeof(latency), "<=%" SWITCH_TIME_T_FMT "us", wheel_buckets[i]);
+		} else {
+			switch_snprintf(latency, sizeof(latency), ">%" SWITCH_TIME_T_FMT "us", wheel_buckets[i - 1]);
+		}
+		switch_snprintf(wakeups, sizeof(wakeups), "%u", counts[i]);
+		switch_snprintf(percent, sizeof(percent), "%.2f", total ? counts[i] * 100.0 / total : 0.0);
+
+		vals[0] = latency;
+		vals[1] = wakeups;
+		vals[2] = percent;
+
+		if (callback(pArg, 3, vals, names)) {
+			break;
+		}
+	}
+}
+
 static void win32_init_timers(void)
 {
 #ifdef WIN32
@@ -1537,6 +2322,15 @@ SWITCH_MODULE_LOAD_FUNCTION(softtimer_load)
 	timer_interface->timer_check = timer_check;
 	timer_interface->timer_destroy = timer_destroy;
 
+	timer_interface = switch_loadable_module_create_interface(*module_interface, SWITCH_TIMER_INTERFACE);
+	timer_interface->interface_name = "wheel";
+	timer_interface->timer_init = wheel_timer_init;
+	timer_interface->timer_next = wheel_timer_next;
+	timer_interface->timer_step = wheel_timer_step;
+	timer_interface->timer_sync = wheel_timer_sync;
+	timer_interface->timer_check = wheel_timer_check;
+	timer_interface->timer_destroy = wheel_timer_destroy;
+
 	if (!switch_test_flag((&runtime), SCF_USE_CLOCK_RT)) {
 		switch_time_set_nanosleep(SWITCH_FALSE);
 	}
@@ -1590,6 +2384,12 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(softtimer_shutdown)
 			do_sleep(10000);
 		}
 	}
+	wheel_stop();
+
+#ifdef HAVE_TIMERFD_CREATE
+	shared_clock_stop();
+#endif
+
 #if defined(WIN32)
 	timeEndPeriod(1);
 	win32_tick_time_since_start = -1; /* we are not initialized anymore */
@@ -34,6 +34,75 @@
 
 #include <test/switch_test.h>
 
+static int count_wakeups(void *pArg, int argc, char **argv, char **columnNames)
+{
+	uint32_t *wakeups = (uint32_t *) pArg;
+
+	*wakeups += atoi(argv[1]);
+
+	return 0;
+}
+
+struct channel_index_result {
+	int rows;
+	int argc;
+	char b_uuid[64];
+	char cid_num[64];
+	char dest[64];
+};
+
+static int channel_index_row(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct channel_index_result *result = (struct channel_index_result *) pArg;
+	int x;
+
+	result->rows++;
+	result->argc = argc;
+
+	for (x = 0; x < argc; x++) {
+		if (!strcmp(columnNames[x], "b_uuid")) {
+			switch_set_string(result->b_uuid, switch_str_nil(argv[x]));
+		} else if (!strcmp(columnNames[x], "cid_num")) {
+			switch_set_string(result->cid_num, switch_str_nil(argv[x]));
+		} else if (!strcmp(columnNames[x], "dest")) {
+			switch_set_string(result->dest, switch_str_nil(argv[x]));
+		}
+	}
+
+	return 0;
+}
+
+static void fire_channel_event(switch_event_types_t type, const char *uuid, const char *header, const char *value, const char *header2, const char *value2)
+{
+	switch_event_t *event = NULL;
+
+	switch_event_create(&event, type);
+	switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Unique-ID", uuid);
+	if (header) {
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, header, value);
+	}
+	if (header2) {
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, header2, value2);
+	}
+	switch_event_fire(&event);
+}
+
+/* the index is fed by the event dispatch threads, give them a moment */
+static uint32_t wait_channel_index(switch_channel_index_view_t view, switch_channel_index_flag_t flags, uint32_t expected)
+{
+	uint32_t rows = 0;
+	int x;
+
+	for (x = 0; x < 200; x++) {
+		if ((rows = switch_core_channel_index_query(view, "ci-test-%", flags, NULL, NULL)) == expected) {
+			break;
+		}
+		switch_yield(10000);
+	}
+
+	return rows;
+}
+
 FST_CORE_BEGIN("./conf")
 {
 	FST_SUITE_BEGIN(switch_ivr_originate)
@@ -82,6 +151,167 @@ FST_CORE_BEGIN("./conf")
 			switch_safe_free(var_default_password);
 		}
 		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_wheel_timer)
+		{
+			switch_timer_t timer = { 0 }, other = { 0 };
+			switch_time_t start, elapsed;
+			uint32_t wakeups = 0;
+			int x;
+
+			fst_requires(switch_core_timer_init(&timer, "wheel", 20, 160, fst_pool) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_core_timer_init(&other, "wheel", 30, 240, fst_pool) == SWITCH_STATUS_SUCCESS);
+
+			start = switch_time_ref();
+			for (x = 0; x < 25; x++) {
+				switch_core_timer_next(&timer);
+			}
+			elapsed = switch_time_ref() - start;
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "25 wheel ticks of 20ms took %" SWITCH_TIME_T_FMT "us\n", elapsed);
+			fst_check(elapsed >= 480000);
+			fst_check(elapsed < 1000000);
+			fst_check(timer.samplecount == 160 * 26);
+
+			/* the other timer was never waited on */
+			fst_check(switch_core_timer_check(&other, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS);
+
+			switch_time_wheel_stats(count_wakeups, &wakeups);
+			fst_check(wakeups >= 25);
+
+			switch_core_timer_destroy(&other);
+			switch_core_timer_destroy(&timer);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_shared_timerfd_timer)
+		{
+			switch_timer_t timers[4] = { { 0 } };
+			switch_time_t start, elapsed;
+			int x, i, tfd = switch_time_get_timerfd();
+
+			/* no-op where there is no timerfd, the soft timer still has to keep time */
+			switch_time_set_timerfd(3);
+
+			for (i = 0; i < 4; i++) {
+				fst_requires(switch_core_timer_init(&timers[i], "soft", 20, 160, fst_pool) == SWITCH_STATUS_SUCCESS);
+			}
+
+			switch_core_timer_next(&timers[0]);
+			start = switch_time_ref();
+			for (x = 0; x < 25; x++) {
+				switch_core_timer_next(&timers[0]);
+			}
+			elapsed = switch_time_ref() - start;
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "25 shared timerfd ticks of 20ms took %" SWITCH_TIME_T_FMT "us\n", elapsed);
+			fst_check(elapsed >= 480000);
+			fst_check(elapsed < 1000000);
+
+			for (i = 0; i < 4; i++) {
+				switch_core_timer_destroy(&timers[i]);
+			}
+
+			switch_time_set_timerfd(tfd);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_channel_index)
+		{
+			struct channel_index_result result = { 0 };
+			switch_event_t *event = NULL;
+			switch_bool_t was_enabled = switch_core_channel_index_enabled();
+
+			switch_core_channel_index_enable(SWITCH_TRUE);
+			fst_requires(switch_core_channel_index_enabled());
+
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-a", "Channel-Name", "test/a", "Call-Direction", "inbound");
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-b", "Channel-Name", "test/b", "Call-Direction", "outbound");
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 2) == 2);
+
+			/* creates are handled in order, once ci-test-c shows up the repeated create of ci-test-a was seen too */
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-a", "Channel-Name", "test/dup", "Call-Direction", "inbound");
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-c", "Channel-Name", "test/c", "Call-Direction", "inbound");
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 3) == 3);
+			fst_check(switch_core_channel_index_query(SCI_VIEW_CHANNELS, "test/dup", SCIF_NONE, NULL, NULL) == 0);
+			fst_check(switch_core_channel_index_query(SCI_VIEW_CHANNELS, "test/a", SCIF_NONE, NULL, NULL) == 1);
+			fire_channel_event(SWITCH_EVENT_CHANNEL_DESTROY, "ci-test-c", NULL, NULL, NULL, NULL);
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 2) == 2);
+
+			switch_event_create(&event, SWITCH_EVENT_CHANNEL_STATE);
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Unique-ID", "ci-test-a");
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Channel-State", "CS_ROUTING");
+			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Channel-State-Number", "%d", CS_ROUTING);
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Caller-Caller-ID-Number", "1000");
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Caller-Destination-Number", "2000");
+			switch_event_fire(&event);
+
+			fire_channel_event(SWITCH_EVENT_CHANNEL_BRIDGE, "ci-test-a", "Bridge-A-Unique-ID", "ci-test-a", "Bridge-B-Unique-ID", "ci-test-b");
+			fst_check(wait_channel_index(SCI_VIEW_BASIC_CALLS, SCIF_BRIDGED, 1) == 1);
+
+			/* the b leg is folded into the a leg row like the basic_calls view does */
+			fst_check(switch_core_channel_index_query(SCI_VIEW_BASIC_CALLS, "ci-test-%", SCIF_NONE, channel_index_row, &result) == 1);
+			fst_check(result.argc == 41);
+			fst_check_string_equals(result.b_uuid, "ci-test-b");
+			fst_check_string_equals(result.cid_num, "1000");
+			fst_check_string_equals(result.dest, "2000");
+
+			memset(&result, 0, sizeof(result));
+			fst_check(switch_core_channel_index_query(SCI_VIEW_DETAILED_CALLS, "%test-A", SCIF_NONE, channel_index_row, &result) == 1);
+			fst_check(result.argc == 65);
+			fst_check_string_equals(result.b_uuid, "ci-test-b");
+
+			memset(&result, 0, sizeof(result));
+			fst_check(switch_core_channel_index_query(SCI_VIEW_CHANNELS, "ci-test-%", SCIF_COUNT, channel_index_row, &result) == 2);
+			fst_check(result.rows == 1 && result.argc == 1);
+
+			fire_channel_event(SWITCH_EVENT_CHANNEL_UNBRIDGE, "ci-test-a", "Caller-Unique-ID", "ci-test-a", NULL, NULL);
+			fst_check(wait_channel_index(SCI_VIEW_BASIC_CALLS, SCIF_BRIDGED, 0) == 0);
+			fst_check(switch_core_channel_index_query(SCI_VIEW_BASIC_CALLS, "ci-test-%", SCIF_NONE, NULL, NULL) == 2);
+
+			fire_channel_event(SWITCH_EVENT_CHANNEL_DESTROY, "ci-test-a", NULL, NULL, NULL, NULL);
+			fire_channel_event(SWITCH_EVENT_CHANNEL_DESTROY, "ci-test-b", NULL, NULL, NULL, NULL);
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 0) == 0);
+
+			if (!was_enabled) {
+				switch_core_channel_index_enable(SWITCH_FALSE);
+			}
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_channel_index_restart)
+		{
+			switch_bool_t was_enabled = switch_core_channel_index_enabled();
+			int x;
+
+			switch_core_channel_index_enable(SWITCH_TRUE);
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-r", "Channel-Name", "test/r", "Call-Direction", "inbound");
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 1) == 1);
+
+			/* stopping with events still queued must not touch the freed stripes */
+			for (x = 0; x < 50; x++) {
+				fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-q", "Channel-Name", "test/q", "Call-Direction", "inbound");
+				fire_channel_event(SWITCH_EVENT_CHANNEL_DESTROY, "ci-test-q", NULL, NULL, NULL, NULL);
+			}
+			switch_core_channel_index_enable(SWITCH_FALSE);
+			fst_check(!switch_core_channel_index_enabled());
+			fst_check(switch_core_channel_index_query(SCI_VIEW_CHANNELS, "ci-test-%", SCIF_NONE, NULL, NULL) == 0);
+
+			/* only live sessions are seeded on enable, the fake ci-test rows are gone */
+			switch_core_channel_index_enable(SWITCH_TRUE);
+			fst_requires(switch_core_channel_index_enabled());
+			fst_check(switch_core_channel_index_query(SCI_VIEW_CHANNELS, "ci-test-r", SCIF_NONE, NULL, NULL) == 0);
+
+			fire_channel_event(SWITCH_EVENT_CHANNEL_CREATE, "ci-test-r", "Channel-Name", "test/r", "Call-Direction", "inbound");
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 1) == 1);
+			fire_channel_event(SWITCH_EVENT_CHANNEL_DESTROY, "ci-test-r", NULL, NULL, NULL, NULL);
+			fst_check(wait_channel_index(SCI_VIEW_CHANNELS, SCIF_NONE, 0) == 0);
+
+			if (!was_enabled) {
+				switch_core_channel_index_enable(SWITCH_FALSE);
+			}
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
@@ -118,6 +118,107 @@ FST_CORE_DB_BEGIN("./conf")
 		}
 		FST_TEST_END()
 
+		FST_TEST_BEGIN(test_switch_cache_db_prepare)
+		{
+			switch_cache_db_handle_t *dbh = NULL;
+			switch_cache_db_stmt_t *stmt = NULL, *again = NULL;
+			char *dsn = "test_switch_cache_db_prepare.db";
+			char res[64] = "";
+			int i;
+
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql(dbh, "DROP TABLE IF EXISTS p;", NULL);
+			switch_cache_db_execute_sql(dbh, "CREATE TABLE p (id INTEGER, name VARCHAR(64), note VARCHAR(64));", NULL);
+
+			for (i = 0; i < max_rows; i++) {
+				fst_check(switch_cache_db_prepare(dbh, "insert into p (id, name, note) values (?, ?, ?)", &stmt, NULL) == SWITCH_STATUS_SUCCESS);
+				fst_requires(stmt);
+
+				if (again) {
+					fst_check(stmt == again);
+				}
+				again = stmt;
+
+				switch_cache_db_bind_int64(stmt, 1, i);
+				switch_cache_db_bind(stmt, 2, "it's a ?");
+				switch_cache_db_bind(stmt, 3, (i % 2) ? "odd" : NULL);
+				fst_check(switch_cache_db_step(stmt, NULL) == SWITCH_STATUS_SUCCESS);
+			}
+
+			fst_check(switch_cache_db_bind(stmt, 4, "out of range") != SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql2str(dbh, "SELECT COUNT(*) FROM p WHERE name = 'it''s a ?'", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "150");
+
+			switch_cache_db_execute_sql2str(dbh, "SELECT COUNT(*) FROM p WHERE note IS NULL", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "75");
+
+			switch_cache_db_execute_sql2str(dbh, "SELECT SUM(id) FROM p", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "11175");
+
+			/* a schema change must not break the statement that is already cached */
+			switch_cache_db_execute_sql(dbh, "CREATE INDEX p_id ON p (id);", NULL);
+			fst_check(switch_cache_db_prepare(dbh, "insert into p (id, name, note) values (?, ?, ?)", &stmt, NULL) == SWITCH_STATUS_SUCCESS);
+			fst_check(stmt == again);
+			switch_cache_db_bind_int64(stmt, 1, max_rows);
+			switch_cache_db_bind(stmt, 2, "after index");
+			switch_cache_db_bind(stmt, 3, NULL);
+			fst_check(switch_cache_db_step(stmt, NULL) == SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql2str(dbh, "SELECT COUNT(*) FROM p", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "151");
+
+			fst_check(switch_cache_db_prepare(dbh, "insert into nonexistent values (?)", &stmt, NULL) != SWITCH_STATUS_SUCCESS);
+			fst_check(stmt == NULL);
+
+			switch_cache_db_release_db_handle(&dbh);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_cache_db_queue_manager_push_prepared)
+		{
+			int i;
+			switch_sql_queue_manager_t *qm = NULL;
+			char id[32];
+			const char *argv[2];
+
+			status = 0;
+
+			switch_sql_queue_manager_init_name("TEST",
+				&qm,
+				2,
+				"test_switch_cache_db_queue_manager_push_prepared",
+				SWITCH_MAX_TRANS,
+				NULL, NULL, NULL, NULL);
+
+			switch_sql_queue_manager_start(qm);
+
+			switch_sql_queue_manager_push_confirm(qm, "DROP TABLE IF EXISTS q;", 0, SWITCH_TRUE);
+			switch_sql_queue_manager_push_confirm(qm, "CREATE TABLE q (id INT, name VARCHAR(64));", 0, SWITCH_TRUE);
+
+			for (i = 0; i < max_rows; i++) {
+				switch_snprintf(id, sizeof(id), "%d", i);
+				argv[0] = id;
+				argv[1] = (i % 3) ? "x'y" : NULL;
+				switch_sql_queue_manager_push_prepared(qm, "INSERT INTO q (id, name) VALUES (?, ?)", i % 2, 2, argv);
+			}
+
+			while (switch_sql_queue_manager_size(qm, 0) || switch_sql_queue_manager_size(qm, 1)) {
+				switch_cond_next();
+			}
+
+			switch_sleep(500 * 1000);
+
+			switch_sql_queue_manager_execute_sql_callback(qm, "SELECT COUNT(*) FROM q WHERE name = 'x''y';", table_count_func, NULL);
+			switch_sleep(500 * 1000);
+
+			switch_sql_queue_manager_stop(qm);
+			switch_sql_queue_manager_destroy(&qm);
+
+			fst_check_int_equals(status, 100);
+		}
+		FST_TEST_END()
 
 	}
 	FST_SUITE_END()
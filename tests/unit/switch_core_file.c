@@ -223,6 +223,82 @@ FST_CORE_BEGIN("./conf")
 			unlink(filename);
 		}
 		FST_TEST_END()
+		FST_TEST_BEGIN(test_switch_core_file_cache)
+		{
+			switch_status_t status = SWITCH_STATUS_FALSE;
+			switch_file_handle_t fhw = { 0 };
+			switch_file_handle_t fh1 = { 0 };
+			switch_file_handle_t fh2 = { 0 };
+			switch_file_cache_stats_t before = { 0 }, after = { 0 };
+			static char filename[] = "/tmp/fs_cache_unit_test.wav";
+			int16_t buf[160], buf1[160], buf2[160];
+			int i, j;
+			switch_size_t len;
+
+			status = switch_core_file_open(&fhw, filename, 1, 8000, SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+
+			for (i = 0; i < 50; i++) {
+				for (j = 0; j < 160; j++) {
+					buf[j] = (int16_t)((i * 160 + j) * 7);
+				}
+				len = 160;
+				switch_core_file_write(&fhw, buf, &len);
+			}
+
+			status = switch_core_file_close(&fhw);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+
+			switch_core_file_cache_flush();
+			switch_core_file_cache_set_size(1024 * 1024, SWITCH_FALSE);
+			switch_core_file_cache_stats(&before);
+
+			status = switch_core_file_open(&fh1, filename, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+			status = switch_core_file_open(&fh2, filename, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+
+			switch_core_file_cache_stats(&after);
+			fst_check(after.entries == before.entries + 1);
+			fst_check(after.hits == before.hits + 1);
+
+			/* both handles read the same audio independently */
+			for (i = 0; i < 50; i++) {
+				switch_size_t len1 = 160, len2 = 160;
+
+				fst_check(switch_core_file_read(&fh1, buf1, &len1) == SWITCH_STATUS_SUCCESS);
+				fst_check(switch_core_file_read(&fh2, buf2, &len2) == SWITCH_STATUS_SUCCESS);
+				fst_check(len1 == 160 && len2 == 160);
+				fst_check(!memcmp(buf1, buf2, sizeof(buf1)));
+				fst_check(buf1[0] == (int16_t)(i * 160 * 7));
+			}
+
+			len = 160;
+			fst_check(switch_core_file_read(&fh1, buf1, &len) != SWITCH_STATUS_SUCCESS || len == 0);
+
+			{
+				unsigned int pos = 0;
+
+				fst_check(switch_core_file_seek(&fh2, &pos, 160, SEEK_SET) == SWITCH_STATUS_SUCCESS);
+				len = 160;
+				fst_check(switch_core_file_read(&fh2, buf2, &len) == SWITCH_STATUS_SUCCESS);
+				fst_check(buf2[0] == (int16_t)(160 * 7));
+			}
+
+			status = switch_core_file_close(&fh1);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+			status = switch_core_file_close(&fh2);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+
+			switch_core_file_cache_flush();
+			switch_core_file_cache_stats(&after);
+			fst_check(after.entries == 0);
+			fst_check(after.bytes == 0);
+
+			switch_core_file_cache_set_size(before.max_bytes, SWITCH_FALSE);
+			unlink(filename);
+		}
+		FST_TEST_END()
 
 	}
 	FST_SUITE_END()
@@ -34,6 +34,43 @@
 
 #include <test/switch_test.h>
 
+static int img_planes_equal(switch_image_t *a, switch_image_t *b)
+{
+	int i, p;
+
+	for (p = 0; p < 3; p++) {
+		int w = p ? (a->d_w + 1) / 2 : a->d_w, h = p ? (a->d_h + 1) / 2 : a->d_h;
+
+		for (i = 0; i < h; i++) {
+			if (memcmp(a->planes[p] + i * a->stride[p], b->planes[p] + i * b->stride[p], w)) return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* composite one 1080p frame from cols x rows tiles, half argb with mixed alpha and half i420 at 60% opacity */
+static void img_compose_layout(switch_image_t *canvas, switch_image_t *argb, switch_image_t *i420, int cols, int rows)
+{
+	switch_rgb_color_t bg = { 0 };
+	int c, r;
+
+	bg.r = bg.g = bg.b = 32;
+	switch_img_fill(canvas, 0, 0, canvas->d_w, canvas->d_h, &bg);
+
+	for (r = 0; r < rows; r++) {
+		for (c = 0; c < cols; c++) {
+			int x = c * canvas->d_w / cols + 1, y = r * canvas->d_h / rows;
+
+			if ((r + c) & 1) {
+				switch_img_overlay(canvas, i420, x, y, 60);
+			} else {
+				switch_img_patch(canvas, argb, x, y);
+			}
+		}
+	}
+}
+
 FST_CORE_BEGIN("./conf")
 {
 	FST_SUITE_BEGIN(switch_ivr_originate)
@@ -84,6 +121,116 @@ FST_CORE_BEGIN("./conf")
 			switch_img_free(&argb_img);
 		}
 		FST_TEST_END()
+
+		FST_TEST_BEGIN(img_kernel_benchmark)
+		{
+			const char *kernels[] = { "scalar", "sse4.1", "avx2" };
+			int layouts[][2] = { { 2, 2 }, { 3, 3 }, { 4, 4 } };
+			switch_image_t *canvas = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, 1920, 1080, 1);
+			switch_image_t *ref = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, 1920, 1080, 1);
+			switch_image_t *key = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, 1920, 1080, 1);
+			switch_image_t *key_ref = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, 1920, 1080, 1);
+			switch_rgb_color_t green = { 0 }, black = { 0 };
+			int k, l, n, iterations = 10;
+
+			fst_requires(canvas && ref && key && key_ref);
+			green.g = 255;
+			green.a = 255;
+
+			for (l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+				int cols = layouts[l][0], rows = layouts[l][1];
+				switch_image_t *argb = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, 1920 / cols - 2, 1080 / rows, 1);
+				switch_image_t *i420 = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, 1920 / cols - 2, 1080 / rows, 1);
+				int x, y;
+
+				fst_requires(argb && i420);
+
+				for (y = 0; y < argb->d_h; y++) {
+					for (x = 0; x < argb->d_w; x++) {
+						switch_rgb_color_t *px = (switch_rgb_color_t *)(argb->planes[SWITCH_PLANE_PACKED] + y * argb->stride[SWITCH_PLANE_PACKED]) + x;
+
+						px->r = x * 255 / argb->d_w;
+						px->g = y * 255 / argb->d_h;
+						px->b = (x + y) & 0xFF;
+						px->a = x < argb->d_w / 3 ? 255 : x < argb->d_w * 2 / 3 ? (y & 0xFF) : 0;
+					}
+				}
+
+				switch_img_copy(argb, &i420);
+
+				for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+					switch_time_t start;
+					double secs;
+
+					if (switch_img_set_kernel(kernels[k]) != SWITCH_STATUS_SUCCESS) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s kernel not supported here\n", kernels[k]);
+						continue;
+					}
+
+					start = switch_micro_time_now();
+
+					for (n = 0; n < iterations; n++) {
+						img_compose_layout(canvas, argb, i420, cols, rows);
+					}
+
+					secs = (switch_micro_time_now() - start) / 1000000.0;
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%dx%d layout %s: %.1f Mpixels/sec\n",
+									  cols, rows, kernels[k], iterations * 1920.0 * 1080.0 / (secs > 0 ? secs : 1e-6) / 1000000.0);
+
+					if (k == 0) {
+						switch_img_copy(canvas, &ref);
+					} else {
+						fst_check(img_planes_equal(canvas, ref));
+					}
+				}
+
+				switch_img_free(&argb);
+				switch_img_free(&i420);
+			}
+
+			for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+				switch_time_t start;
+				double secs;
+
+				if (switch_img_set_kernel(kernels[k]) != SWITCH_STATUS_SUCCESS) continue;
+
+				for (n = 0; n < key->d_w * key->d_h; n++) {
+					switch_rgb_color_t *px = (switch_rgb_color_t *)key->planes[SWITCH_PLANE_PACKED] + n;
+					int x = n % key->d_w, y = n / key->d_w;
+
+					if (x > 480 && x < 1440 && y > 270 && y < 810) {
+						*px = green;
+					} else {
+						px->r = x & 0xFF;
+						px->g = y & 0xFF;
+						px->b = (x ^ y) & 0xFF;
+						px->a = 255;
+					}
+				}
+
+				start = switch_micro_time_now();
+				switch_img_chromakey(key, &green, 0);
+				switch_img_fill_noalpha(key, 0, 0, key->d_w, key->d_h, &black);
+				secs = (switch_micro_time_now() - start) / 1000000.0;
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "chromakey + fill_noalpha %s: %.1f Mpixels/sec\n",
+								  kernels[k], 2 * 1920.0 * 1080.0 / (secs > 0 ? secs : 1e-6) / 1000000.0);
+
+				if (k == 0) {
+					switch_img_copy(key, &key_ref);
+				} else {
+					fst_check(!memcmp(key->planes[SWITCH_PLANE_PACKED], key_ref->planes[SWITCH_PLANE_PACKED], key->d_w * key->d_h * 4));
+				}
+			}
+
+			switch_img_set_kernel(NULL);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "compositing kernel: %s\n", switch_img_kernel_name());
+
+			switch_img_free(&canvas);
+			switch_img_free(&ref);
+			switch_img_free(&key);
+			switch_img_free(&key_ref);
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
@@ -4,6 +4,8 @@
 
 // #define BENCHMARK 1
 
+#define FRAME_SUBCLASS "test::binary_frame"
+
 FST_MINCORE_BEGIN("./conf")
 
 FST_SUITE_BEGIN(switch_event)
@@ -18,6 +20,112 @@ FST_TEARDOWN_BEGIN()
 }
 FST_TEARDOWN_END()
 
+FST_TEST_BEGIN(header_index)
+{
+  switch_event_t *event = NULL, *clone = NULL;
+  switch_event_header_t *hp;
+
+  switch_event_create(&event, SWITCH_EVENT_CLONE);
+  fst_requires(event);
+
+  /* lookups return the first header of that name, whatever happened to the ones before it */
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "dup", "one");
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Dup", "two");
+  fst_check_string_equals(switch_event_get_header(event, "DUP"), "one");
+
+  switch_event_add_header_string(event, SWITCH_STACK_TOP, "dup", "zero");
+  fst_check_string_equals(switch_event_get_header(event, "dup"), "zero");
+
+  switch_event_del_header_val(event, "dup", "zero");
+  fst_check_string_equals(switch_event_get_header(event, "dup"), "one");
+
+  switch_event_del_header_val(event, "dup", "one");
+  fst_check_string_equals(switch_event_get_header(event, "dup"), "two");
+
+  switch_event_rename_header(event, "dup", "renamed");
+  fst_check(switch_event_get_header(event, "dup") == NULL);
+  fst_check_string_equals(switch_event_get_header(event, "renamed"), "two");
+
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "list", "a");
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "list", "b");
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "list[3]", "d");
+  fst_check_string_equals(switch_event_get_header(event, "list"), "ARRAY::a|:b|:|:d");
+
+  switch_event_dup(&clone, event);
+  fst_requires(clone);
+  fst_check_string_equals(switch_event_get_header(clone, "renamed"), "two");
+  fst_check_string_equals(switch_event_get_header_idx(clone, "list", 1), "b");
+
+  hp = switch_event_get_header_ptr(clone, "list");
+  fst_requires(hp);
+  fst_check(hp->idx == 4);
+
+  switch_event_destroy(&event);
+  switch_event_destroy(&clone);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(binary_frame)
+{
+  switch_event_t *event = NULL, *parsed = NULL;
+  char *data = NULL, *plain = NULL;
+  char name[64], value[64];
+  switch_size_t len = 0;
+  switch_time_t start_ts;
+  uint64_t binary_us, plain_us;
+  int i, loops = 10000;
+
+  switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, FRAME_SUBCLASS);
+  fst_requires(event);
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "spaces", "a value: with\nnewlines");
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "list", "a");
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "list", "b");
+  switch_event_add_body(event, "body%d", 1);
+
+  fst_requires(switch_event_binary_frame_render(event, &data, &len) == SWITCH_STATUS_SUCCESS);
+  fst_check(len == switch_event_binary_frame_size(event));
+
+  fst_requires(switch_event_binary_frame_parse(&parsed, data, len) == SWITCH_STATUS_SUCCESS);
+  fst_check(parsed->event_id == SWITCH_EVENT_CUSTOM);
+  fst_check_string_equals(parsed->subclass_name, FRAME_SUBCLASS);
+  fst_check_string_equals(switch_event_get_header(parsed, "spaces"), "a value: with\nnewlines");
+  fst_check_string_equals(switch_event_get_header_idx(parsed, "list", 1), "b");
+  fst_check_string_equals(parsed->body, "body1");
+  switch_event_destroy(&parsed);
+
+  /* anything cut short is refused */
+  fst_check(switch_event_binary_frame_parse(&parsed, data, len - 1) != SWITCH_STATUS_SUCCESS);
+  fst_check(parsed == NULL);
+  switch_safe_free(data);
+
+  for (i = 0; i < 150; i++) {
+    switch_snprintf(name, sizeof(name), "Variable-benchmark-header-%d", i);
+    switch_snprintf(value, sizeof(value), "some value %d", i);
+    switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, name, value);
+  }
+
+  start_ts = switch_time_now();
+  for (i = 0; i < loops; i++) {
+    switch_event_binary_frame_render(event, &data, &len);
+    switch_safe_free(data);
+  }
+  binary_us = switch_time_now() - start_ts;
+
+  start_ts = switch_time_now();
+  for (i = 0; i < loops; i++) {
+    switch_event_serialize(event, &plain, SWITCH_TRUE);
+    switch_safe_free(plain);
+  }
+  plain_us = switch_time_now() - start_ts;
+
+  fst_check_string_equals(switch_event_get_header(event, "Variable-benchmark-header-149"), "some value 149");
+
+  printf("switch_event serialize: binary %.2f us, plain %.2f us per event\n", binary_us / (double) loops, plain_us / (double) loops);
+
+  switch_event_destroy(&event);
+}
+FST_TEST_END()
+
 FST_TEST_BEGIN(benchmark)
 {
   switch_event_t *event = NULL;
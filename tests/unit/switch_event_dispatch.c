@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <switch.h>
+#include <test/switch_test.h>
+
+#define FIRE_SUBCLASS "test::fire_benchmark"
+
+static switch_atomic_t fired = 0;
+
+static void fire_counter(switch_event_t *event)
+{
+  switch_atomic_inc(&fired);
+}
+
+#define SHARE_SUBCLASS "test::fan_out"
+
+static switch_atomic_t shared_calls = 0;
+static switch_atomic_t shared_foreign = 0;
+
+/* a subscriber that changes its event, nobody else may ever see the header it adds */
+static void mutating_subscriber(switch_event_t *event)
+{
+  if (switch_event_get_header(event, "X-Subscriber")) {
+    switch_atomic_inc(&shared_foreign);
+  }
+
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "X-Subscriber", (const char *) event->bind_user_data);
+  switch_atomic_inc(&shared_calls);
+}
+
+static void read_only_subscriber(switch_event_t *event)
+{
+  if (switch_event_get_header(event, "X-Subscriber")) {
+    switch_atomic_inc(&shared_foreign);
+  }
+
+  switch_atomic_inc(&shared_calls);
+}
+
+static int subscriber_row(void *pArg, int argc, char **argv, char **columnNames)
+{
+  int *rows = (int *) pArg;
+
+  if (argc == 7 && !strcmp(argv[0], "subscriber_stats") && !strcmp(argv[2], FIRE_SUBCLASS) && !strcmp(argv[3], "0")) {
+    (*rows)++;
+  }
+
+  return 0;
+}
+
+FST_CORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(switch_event_dispatch)
+
+FST_SETUP_BEGIN()
+{
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(subscriber_stats)
+{
+  int rows = 0;
+
+  fst_requires(switch_event_bind("subscriber_stats", SWITCH_EVENT_CUSTOM, FIRE_SUBCLASS, fire_counter, NULL) == SWITCH_STATUS_SUCCESS);
+  switch_event_subscriber_stats(subscriber_row, &rows);
+  fst_check(rows == 1);
+
+  switch_event_unbind_callback(fire_counter);
+  rows = 0;
+  switch_event_subscriber_stats(subscriber_row, &rows);
+  fst_check(rows == 0);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(fan_out_isolation)
+{
+  switch_event_t *event = NULL;
+  switch_time_t start_ts;
+  int loops = 1000, x;
+
+  switch_event_reserve_subclass(SHARE_SUBCLASS);
+  fst_requires(switch_event_bind("fan_out_a", SWITCH_EVENT_CUSTOM, SHARE_SUBCLASS, mutating_subscriber, "a") == SWITCH_STATUS_SUCCESS);
+  fst_requires(switch_event_bind("fan_out_b", SWITCH_EVENT_CUSTOM, SHARE_SUBCLASS, mutating_subscriber, "b") == SWITCH_STATUS_SUCCESS);
+  fst_requires(switch_event_bind_removable_flags("fan_out_ro", SWITCH_EVENT_CUSTOM, SHARE_SUBCLASS, read_only_subscriber, NULL,
+                                                 SEBF_READ_ONLY, NULL) == SWITCH_STATUS_SUCCESS);
+
+  start_ts = switch_time_now();
+  for (x = 0; x < loops; x++) {
+    switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, SHARE_SUBCLASS);
+    fst_requires(event);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Seq", "%d", x);
+    switch_event_fire(&event);
+  }
+
+  while (switch_atomic_read(&shared_calls) < (uint32_t) loops * 3 && switch_time_now() - start_ts < 30000000) {
+    switch_yield(1000);
+  }
+
+  /* every subscriber saw every event and nobody saw a header another one added */
+  fst_check(switch_atomic_read(&shared_calls) == (uint32_t) loops * 3);
+  fst_check(switch_atomic_read(&shared_foreign) == 0);
+
+  switch_event_unbind_callback(mutating_subscriber);
+  switch_event_unbind_callback(read_only_subscriber);
+  switch_event_free_subclass(SHARE_SUBCLASS);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(fire_benchmark)
+{
+  switch_event_t *event = NULL;
+  switch_time_t start_ts, end_ts;
+  char *names[150] = { 0 };
+  int loops = 10000, x = 0, i = 0;
+  uint64_t micro_total = 0;
+
+  for (i = 0; i < 150; i++) {
+    names[i] = switch_mprintf("Variable-benchmark-header-%d", i);
+  }
+
+  switch_event_reserve_subclass(FIRE_SUBCLASS);
+  fst_requires(switch_event_bind("fire_benchmark", SWITCH_EVENT_CUSTOM, FIRE_SUBCLASS, fire_counter, NULL) == SWITCH_STATUS_SUCCESS);
+
+  /* roughly the shape of a CHANNEL_* event, built, dup'ed for a second consumer and fired */
+  start_ts = switch_time_now();
+  for (x = 0; x < loops; x++) {
+    switch_event_t *clone = NULL;
+
+    switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, FIRE_SUBCLASS);
+    fst_requires(event);
+
+    for (i = 0; i < 150; i++) {
+      switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, names[i], names[(i + x) % 150]);
+    }
+
+    switch_event_dup(&clone, event);
+    switch_event_destroy(&clone);
+
+    switch_event_fire(&event);
+  }
+
+  /* time until the subscriber has seen every event, that is the cost of the whole fire path */
+  while (switch_atomic_read(&fired) < (uint32_t) loops && switch_time_now() - start_ts < 30000000) {
+    switch_yield(1000);
+  }
+  end_ts = switch_time_now();
+
+  fst_check(switch_atomic_read(&fired) == (uint32_t) loops);
+
+  micro_total = end_ts - start_ts;
+  printf("switch_event fire: Total %" SWITCH_UINT64_T_FMT "us / %d events, %.2f us per event, %.0f events per second\n",
+       micro_total, loops, micro_total / (double) loops, loops * 1000000.0 / micro_total);
+
+  switch_event_unbind_callback(fire_counter);
+  switch_event_free_subclass(FIRE_SUBCLASS);
+
+  for (i = 0; i < 150; i++) {
+    switch_safe_free(names[i]);
+  }
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_CORE_END()
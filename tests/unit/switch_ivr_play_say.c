@@ -33,6 +33,108 @@
 
 #include <test/switch_test.h>
 
+struct async_bug_helper {
+	switch_thread_id_t media_thread;
+	int pings;
+	int off_thread;
+	int closed;
+};
+
+static switch_bool_t async_bug_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
+{
+	struct async_bug_helper *helper = (struct async_bug_helper *) user_data;
+
+	switch (type) {
+	case SWITCH_ABC_TYPE_READ_PING:
+		helper->pings++;
+		if (switch_thread_self() != helper->media_thread) {
+			helper->off_thread++;
+		}
+		break;
+	case SWITCH_ABC_TYPE_CLOSE:
+		helper->closed = helper->pings;
+		break;
+	default:
+		break;
+	}
+
+	return SWITCH_TRUE;
+}
+
+struct slow_bug_helper {
+	int reads;
+	int frames;
+};
+
+/* slower than the call so a small ring fills, and reading the frame takes the bug's read mutex */
+static switch_bool_t slow_bug_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
+{
+	struct slow_bug_helper *helper = (struct slow_bug_helper *) user_data;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	switch_frame_t frame = { 0 };
+
+	if (type == SWITCH_ABC_TYPE_READ) {
+		frame.data = data;
+		frame.buflen = sizeof(data);
+		helper->reads++;
+		if (switch_core_media_bug_read(bug, &frame, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS) {
+			helper->frames++;
+		}
+		switch_yield(30000);
+	}
+
+	return SWITCH_TRUE;
+}
+
+struct tap_bug_helper {
+	int frames;
+	int64_t sum;
+};
+
+static switch_bool_t tap_bug_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
+{
+	struct tap_bug_helper *helper = (struct tap_bug_helper *) user_data;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	switch_frame_t frame = { 0 };
+	uint32_t i;
+
+	if (type != SWITCH_ABC_TYPE_READ && type != SWITCH_ABC_TYPE_WRITE) {
+		return SWITCH_TRUE;
+	}
+
+	frame.data = data;
+	frame.buflen = sizeof(data);
+
+	while (switch_core_media_bug_read(bug, &frame, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS && frame.datalen) {
+		int16_t *samples = (int16_t *) frame.data;
+
+		for (i = 0; i < frame.datalen / 2; i++) {
+			helper->sum += samples[i];
+		}
+		helper->frames++;
+	}
+
+	return SWITCH_TRUE;
+}
+
+/* every write frame becomes a flat 100 */
+static switch_bool_t flat_replace_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
+{
+	if (type == SWITCH_ABC_TYPE_WRITE_REPLACE) {
+		switch_frame_t *frame = switch_core_media_bug_get_write_replace_frame(bug);
+		int16_t *samples = (int16_t *) frame->data;
+		uint32_t i;
+
+		for (i = 0; i < frame->datalen / 2; i++) {
+			samples[i] = 100;
+		}
+
+		switch_core_media_bug_set_write_replace_frame(bug, frame);
+	}
+
+	return SWITCH_TRUE;
+}
+
 FST_CORE_BEGIN("./conf_playsay")
 {
 	FST_SUITE_BEGIN(switch_ivr_play_say)
@@ -265,6 +367,160 @@ FST_CORE_BEGIN("./conf_playsay")
 			recognition_result = NULL;
 		}
 		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(record_session_shared_writer)
+		{
+			const char *path = switch_core_session_sprintf(fst_session, "%s%sfst_record_writer_%s.wav", SWITCH_GLOBAL_dirs.temp_dir,
+														   SWITCH_PATH_SEPARATOR, switch_core_session_get_uuid(fst_session));
+			switch_ivr_record_writer_stats_t before, during, after;
+			switch_file_handle_t fh = { 0 };
+
+			switch_ivr_record_writer_stats(&before);
+			fst_requires(before.threads > 0);
+
+			fst_requires(switch_ivr_record_session(fst_session, path, 0, NULL) == SWITCH_STATUS_SUCCESS);
+			switch_ivr_record_writer_stats(&during);
+			fst_check(during.recordings == before.recordings + 1);
+
+			switch_ivr_play_file(fst_session, NULL, "silence_stream://3000,1400", NULL);
+			switch_ivr_stop_record_session(fst_session, path);
+
+			/* the audio went through the shared writers in a few large writes, not one per frame */
+			switch_ivr_record_writer_stats(&after);
+			fst_check(after.recordings == before.recordings);
+			fst_check(after.writes > before.writes);
+			fst_check(after.writes - before.writes < 50);
+			fst_check(after.errors == before.errors);
+
+			fst_requires(switch_core_file_open(&fh, path, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL) == SWITCH_STATUS_SUCCESS);
+			fst_check(fh.samplerate && fh.samples / fh.samplerate >= 2);
+			switch_core_file_close(&fh);
+			unlink(path);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(media_bug_async_worker_pool)
+		{
+			struct async_bug_helper helper = { 0 };
+			switch_media_bug_pool_stats_t pool_stats;
+			switch_media_bug_async_stats_t stats;
+			switch_media_bug_t *bug = NULL;
+
+			switch_core_media_bug_pool_stats(&pool_stats);
+			fst_requires(pool_stats.threads > 0);
+
+			helper.media_thread = switch_thread_self();
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_async", NULL, async_bug_callback, &helper, 0,
+												   SMBF_READ_PING | SMBF_ASYNC, &bug) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_core_media_bug_test_flag(bug, SMBF_ASYNC));
+			fst_check(switch_core_media_bug_set_async_policy(bug, SMBA_DROP_OLDEST, 20) == SWITCH_STATUS_SUCCESS);
+
+			switch_ivr_play_file(fst_session, NULL, "silence_stream://1000,1400", NULL);
+
+			fst_check(switch_core_media_bug_get_async_stats(bug, &stats) == SWITCH_STATUS_SUCCESS);
+			fst_check(stats.policy == SMBA_DROP_OLDEST);
+			fst_check(stats.depth == 20);
+			fst_check(stats.queued > 0);
+
+			switch_core_media_bug_remove(fst_session, &bug);
+
+			/* every ping ran on a worker and all of them were delivered before the close */
+			fst_check(helper.pings > 0);
+			fst_check(helper.off_thread == helper.pings);
+			fst_check(helper.closed == helper.pings);
+			fst_check((uint64_t) helper.pings + stats.dropped >= stats.queued);
+
+			/* replace bugs have to answer on the media thread */
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_async", NULL, async_bug_callback, &helper, 0,
+												   SMBF_READ_REPLACE | SMBF_ASYNC, &bug) == SWITCH_STATUS_SUCCESS);
+			fst_check(!switch_core_media_bug_test_flag(bug, SMBF_ASYNC));
+			fst_check(switch_core_media_bug_get_async_stats(bug, &stats) == SWITCH_STATUS_FALSE);
+			switch_core_media_bug_remove(fst_session, &bug);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(media_bug_async_block)
+		{
+			struct slow_bug_helper helper = { 0 };
+			switch_media_bug_async_stats_t stats;
+			switch_media_bug_t *bug = NULL;
+			switch_time_t start;
+
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_async_block", NULL, slow_bug_callback, &helper, 0,
+												   SMBF_READ_STREAM | SMBF_ASYNC, &bug) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_core_media_bug_test_flag(bug, SMBF_ASYNC));
+			fst_check(switch_core_media_bug_set_async_policy(bug, SMBA_BLOCK, 2) == SWITCH_STATUS_SUCCESS);
+
+			start = switch_time_now();
+			switch_ivr_play_file(fst_session, NULL, "silence_stream://1000,1400", NULL);
+
+			fst_check(switch_core_media_bug_get_async_stats(bug, &stats) == SWITCH_STATUS_SUCCESS);
+			switch_core_media_bug_remove(fst_session, &bug);
+
+			/* the media thread waited for the worker instead of giving up on frames while holding it off */
+			fst_check(stats.blocked > 0);
+			fst_check(stats.dropped == 0);
+			fst_check(helper.reads > 0);
+			fst_check((uint64_t) helper.reads == stats.queued);
+			fst_check(switch_time_now() - start < 5000000);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(media_bug_shared_tap)
+		{
+			struct tap_bug_helper one = { 0 }, two = { 0 };
+			switch_media_bug_t *bug_one = NULL, *bug_two = NULL;
+			switch_stream_handle_t stream = { 0 };
+			const char *reused;
+
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_tap_one", NULL, tap_bug_callback, &one, 0,
+												   SMBF_READ_STREAM | SMBF_WRITE_STREAM, &bug_one) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_tap_two", NULL, tap_bug_callback, &two, 0,
+												   SMBF_READ_STREAM | SMBF_WRITE_STREAM, &bug_two) == SWITCH_STATUS_SUCCESS);
+
+			switch_ivr_play_file(fst_session, NULL, "tone_stream://%(500,0,800)", NULL);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_core_media_bug_enumerate(fst_session, &stream);
+
+			switch_core_media_bug_remove(fst_session, &bug_two);
+			switch_core_media_bug_remove(fst_session, &bug_one);
+
+			/* both bugs heard the same audio and the second one got it without mixing again */
+			fst_check(one.frames > 0);
+			fst_check(one.frames == two.frames);
+			fst_check(one.sum == two.sum);
+			fst_requires((reused = strstr((char *) stream.data, "reused=\"")));
+			fst_check(atoi(reused + strlen("reused=\"")) >= two.frames / 2);
+			switch_safe_free(stream.data);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(media_bug_tap_write_replace)
+		{
+			struct tap_bug_helper before = { 0 }, after = { 0 };
+			switch_media_bug_t *bug_before = NULL, *bug_replace = NULL, *bug_after = NULL;
+
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_tap_before", NULL, tap_bug_callback, &before, 0,
+												   SMBF_WRITE_STREAM, &bug_before) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_replace", NULL, flat_replace_callback, NULL, 0,
+												   SMBF_WRITE_REPLACE, &bug_replace) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_core_media_bug_add(fst_session, "fst_tap_after", NULL, tap_bug_callback, &after, 0,
+												   SMBF_WRITE_STREAM, &bug_after) == SWITCH_STATUS_SUCCESS);
+
+			switch_ivr_play_file(fst_session, NULL, "tone_stream://%(500,0,800)", NULL);
+
+			switch_core_media_bug_remove(fst_session, &bug_after);
+			switch_core_media_bug_remove(fst_session, &bug_replace);
+			switch_core_media_bug_remove(fst_session, &bug_before);
+
+			/* one frame per write for each of them, the first one heard the tone and the last one only the replacement */
+			fst_check(before.frames > 0);
+			fst_check(before.frames == after.frames);
+			fst_check(before.sum != after.sum);
+			fst_check(after.sum == (int64_t) after.frames * 160 * 100);
+		}
+		FST_SESSION_END()
 	}
 	FST_SUITE_END()
 }
@@ -0,0 +1,459 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * switch_jitterbuffer.c -- tests and micro benchmarks for the jitter buffer
+ *
+ */
+
+#include <stdio.h>
+#include <switch.h>
+#include <test/switch_test.h>
+
+/* the body carries the low byte of the unwrapped sequence so the tests can tell packets apart after the buffer rewrites seq */
+static void make_packet(switch_rtp_packet_t *packet, uint16_t seq, uint32_t ts, int marker, uint32_t index)
+{
+	memset(&packet->header, 0, sizeof(packet->header));
+	packet->header.version = 2;
+	packet->header.pt = 96;
+	packet->header.seq = htons(seq);
+	packet->header.ts = htonl(ts);
+	packet->header.m = marker;
+	packet->body[0] = (char) (index & 0xff);
+}
+
+static uint8_t packet_index(switch_rtp_packet_t *packet)
+{
+	return (uint8_t) packet->body[0];
+}
+
+/* sleep until tick i of a clock that started at start, so slow wakeups don't add up to clock drift */
+static void wait_tick(switch_time_t start, uint32_t i, uint32_t usec)
+{
+	switch_time_t now = switch_time_now(), when = start + (switch_time_t) i * usec;
+
+	if (when > now) {
+		switch_sleep(when - now);
+	}
+}
+
+/* video frames of frame_packets packets, shuffled inside the frame with loss_pct percent dropped, read back as frames complete */
+static double video_bench(uint16_t first_seq, uint32_t frame_packets, uint32_t packets, int loss_pct, uint32_t *read)
+{
+	switch_memory_pool_t *bench_pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	switch_time_t start;
+	uint32_t i, j, *order;
+	double ns;
+
+	*read = 0;
+	order = malloc(frame_packets * sizeof(*order));
+	switch_core_new_memory_pool(&bench_pool);
+	switch_jb_create(&jb, SJB_VIDEO, 1, 30, bench_pool);
+
+	start = switch_time_now();
+	for (i = 0; i < packets; i += frame_packets) {
+		for (j = 0; j < frame_packets; j++) {
+			order[j] = j;
+		}
+		for (j = 0; j < frame_packets; j++) {
+			uint32_t r = rand() % frame_packets, t = order[j];
+			order[j] = order[r];
+			order[r] = t;
+		}
+		for (j = 0; j < frame_packets; j++) {
+			uint32_t s = i + order[j];
+
+			if (loss_pct && (rand() % 100) < loss_pct) {
+				continue;
+			}
+
+			make_packet(&packet, (uint16_t) (first_seq + s), (s / frame_packets) * 3000, order[j] == frame_packets - 1, s);
+			switch_jb_put_packet(jb, &packet, 12 + 1000);
+		}
+
+		for (;;) {
+			len = sizeof(out);
+			if (switch_jb_get_packet(jb, &out, &len) != SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+			(*read)++;
+		}
+	}
+	ns = (switch_time_now() - start) * 1000.0 / packets;
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&bench_pool);
+	free(order);
+
+	return ns;
+}
+
+/* the nack send buffer: every packet is queued and a few recent ones are looked up again per frame */
+static double nack_bench(uint32_t frames, uint32_t packets, uint32_t *found)
+{
+	switch_memory_pool_t *bench_pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	switch_time_t start;
+	uint32_t i, j;
+	double ns;
+
+	*found = 0;
+	switch_core_new_memory_pool(&bench_pool);
+	switch_jb_create(&jb, SJB_VIDEO, frames, frames, bench_pool);
+	switch_jb_set_flag(jb, SJB_QUEUE_ONLY);
+
+	start = switch_time_now();
+	for (i = 0; i < packets; i++) {
+		uint16_t seq = (uint16_t) (60000 + i);
+
+		make_packet(&packet, seq, (i / 10) * 3000, (i % 10) == 9, i);
+		switch_jb_put_packet(jb, &packet, 12 + 1000);
+
+		if ((i % 10) == 9) {
+			for (j = 0; j < 3; j++) {
+				len = sizeof(out);
+				if (switch_jb_get_packet_by_seq(jb, htons((uint16_t) (seq - (rand() % 50))), &out, &len) == SWITCH_STATUS_SUCCESS) {
+					(*found)++;
+				}
+			}
+		}
+	}
+	ns = (switch_time_now() - start) * 1000.0 / packets;
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&bench_pool);
+
+	return ns;
+}
+
+FST_MINCORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(switch_jitterbuffer)
+
+FST_SETUP_BEGIN()
+{
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(audio_reorder_plays_in_order)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	int i, got = 0, last = -1, in_order = 1, n = 2000;
+	uint16_t first_seq = 65000;
+
+	switch_core_new_memory_pool(&pool);
+	fst_requires(switch_jb_create(&jb, SJB_AUDIO, 3, 10, pool) == SWITCH_STATUS_SUCCESS);
+
+	/* swap every fourth and fifth packet and run the sequence through the 16 bit wrap */
+	for (i = 0; i < n; i++) {
+		int s = i;
+
+		if (i % 5 == 3) {
+			s = i + 1;
+		} else if (i % 5 == 4) {
+			s = i - 1;
+		}
+
+		make_packet(&packet, (uint16_t) (first_seq + s), s * 160, 0, s);
+		switch_jb_put_packet(jb, &packet, 12 + 160);
+
+		len = sizeof(out);
+		if (switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS) {
+			int index = packet_index(&out);
+
+			if (last >= 0 && index != ((last + 1) & 0xff)) {
+				in_order = 0;
+			}
+			last = index;
+			got++;
+		}
+	}
+
+	fst_check(in_order);
+	fst_check(got >= n - 3);
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(nack_queue_lookup)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	uint32_t i, n = 1000;
+	uint16_t first_seq = 65500;
+	int found_all = 1, lost_missing = 1;
+
+	switch_core_new_memory_pool(&pool);
+	fst_requires(switch_jb_create(&jb, SJB_VIDEO, 10, 10, pool) == SWITCH_STATUS_SUCCESS);
+	switch_jb_set_flag(jb, SJB_QUEUE_ONLY);
+
+	/* frames of ten packets, every seventh packet lost and the last two of each frame swapped */
+	for (i = 0; i < n; i++) {
+		uint32_t s = i;
+
+		if (i % 10 == 8) {
+			s = i + 1;
+		} else if (i % 10 == 9) {
+			s = i - 1;
+		}
+
+		if (s % 7 == 0) {
+			continue;
+		}
+
+		make_packet(&packet, (uint16_t) (first_seq + s), (s / 10) * 3000, (s % 10) == 9, s);
+		switch_jb_put_packet(jb, &packet, 12 + 1000);
+	}
+
+	/* the newest frame is all there */
+	for (i = n - 10; i < n; i++) {
+		len = sizeof(out);
+		if (switch_jb_get_packet_by_seq(jb, htons((uint16_t) (first_seq + i)), &out, &len) == SWITCH_STATUS_SUCCESS) {
+			if (i % 7 == 0 || packet_index(&out) != (i & 0xff) || len != 12 + 1000) {
+				lost_missing = 0;
+			}
+		} else if (i % 7) {
+			found_all = 0;
+		}
+	}
+
+	fst_check(found_all);
+	fst_check(lost_missing);
+
+	/* the oldest ones aged out */
+	len = sizeof(out);
+	fst_check(switch_jb_get_packet_by_seq(jb, htons(first_seq + 1), &out, &len) == SWITCH_STATUS_NOTFOUND);
+
+	switch_jb_reset(jb);
+	len = sizeof(out);
+	fst_check(switch_jb_get_packet_by_seq(jb, htons((uint16_t) (first_seq + n - 2)), &out, &len) == SWITCH_STATUS_NOTFOUND);
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(adaptive_target_follows_jitter)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	switch_time_t start;
+	uint32_t target_ms = 0, i;
+
+	/* 5ms frames so a second of traffic is quick */
+	switch_core_new_memory_pool(&pool);
+	fst_requires(switch_jb_create(&jb, SJB_AUDIO, 1, 20, pool) == SWITCH_STATUS_SUCCESS);
+	switch_jb_set_adaptive(jb, 40, 8000);
+
+	start = switch_time_now();
+	for (i = 0; i < 100; i++) {
+		make_packet(&packet, (uint16_t) i, i * 40, 0, i);
+		switch_jb_put_packet(jb, &packet, 12 + 40);
+		len = sizeof(out);
+		switch_jb_get_packet(jb, &out, &len);
+		wait_tick(start, i + 1, 5000);
+	}
+
+	switch_jb_get_delay_stats(jb, &target_ms, NULL, NULL, NULL);
+	fst_check(target_ms <= 10);
+
+	/* now the packets come four at a time */
+	for (; i < 300; i++) {
+		if (i % 4 == 3) {
+			uint32_t j;
+
+			for (j = i - 3; j <= i; j++) {
+				make_packet(&packet, (uint16_t) j, j * 40, 0, j);
+				switch_jb_put_packet(jb, &packet, 12 + 40);
+			}
+		}
+		len = sizeof(out);
+		switch_jb_get_packet(jb, &out, &len);
+		wait_tick(start, i + 1, 5000);
+	}
+
+	switch_jb_get_delay_stats(jb, &target_ms, NULL, NULL, NULL);
+	fst_check(target_ms >= 15);
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(adaptive_accelerates_and_expands)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	switch_status_t status;
+	uint32_t accelerate = 0, expand = 0, early = 0, i, seq = 0;
+	int last = -1, in_order = 1;
+
+	switch_core_new_memory_pool(&pool);
+	fst_requires(switch_jb_create(&jb, SJB_AUDIO, 1, 50, pool) == SWITCH_STATUS_SUCCESS);
+	switch_jb_set_adaptive(jb, 160, 8000);
+
+	/* a deep start with a quiet network, the reader takes the extra frame right away like rtp does on a timeout */
+	for (; seq < 12; seq++) {
+		make_packet(&packet, (uint16_t) seq, seq * 160, 0, seq);
+		switch_jb_put_packet(jb, &packet, 12 + 160);
+	}
+
+	for (i = 0; i < 200; i++, seq++) {
+		make_packet(&packet, (uint16_t) seq, seq * 160, 0, seq);
+		switch_jb_put_packet(jb, &packet, 12 + 160);
+
+		do {
+			len = sizeof(out);
+			status = switch_jb_get_packet(jb, &out, &len);
+			if (status == SWITCH_STATUS_SUCCESS || status == SWITCH_STATUS_TIMEOUT) {
+				if (last >= 0 && packet_index(&out) != ((last + 1) & 0xff)) {
+					in_order = 0;
+				}
+				last = packet_index(&out);
+			}
+			if (status == SWITCH_STATUS_TIMEOUT && switch_jb_last_read_accelerated(jb)) {
+				early++;
+			}
+		} while (status == SWITCH_STATUS_TIMEOUT);
+	}
+
+	switch_jb_get_delay_stats(jb, NULL, NULL, &accelerate, NULL);
+	fst_check(accelerate > 0);
+	fst_check(early == accelerate);
+	fst_check(switch_jb_frame_count(jb) <= 3);
+	fst_check(in_order);
+
+	/* a higher floor makes the buffer conceal frames until it is deep enough, nothing is skipped */
+	switch_jb_set_frames(jb, 5, 50);
+
+	for (i = 0; i < 50; i++, seq++) {
+		make_packet(&packet, (uint16_t) seq, seq * 160, 0, seq);
+		switch_jb_put_packet(jb, &packet, 12 + 160);
+
+		len = sizeof(out);
+		if (switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS) {
+			if (packet_index(&out) != ((last + 1) & 0xff)) {
+				in_order = 0;
+			}
+			last = packet_index(&out);
+		}
+	}
+
+	switch_jb_get_delay_stats(jb, NULL, NULL, NULL, &expand);
+	fst_check(expand > 0);
+	fst_check(switch_jb_frame_count(jb) >= 3);
+	fst_check(in_order);
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(overfull_is_not_accelerated)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_jb_t *jb = NULL;
+	switch_rtp_packet_t packet, out;
+	switch_size_t len;
+	uint32_t seq;
+
+	/* a plain buffer past 1.5x its max also hands out frames early, that is not a stretch decision */
+	switch_core_new_memory_pool(&pool);
+	fst_requires(switch_jb_create(&jb, SJB_AUDIO, 1, 4, pool) == SWITCH_STATUS_SUCCESS);
+
+	for (seq = 0; seq < 8; seq++) {
+		make_packet(&packet, (uint16_t) seq, seq * 160, 0, seq);
+		switch_jb_put_packet(jb, &packet, 12 + 160);
+	}
+
+	len = sizeof(out);
+	fst_check(switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_TIMEOUT);
+	fst_check(!switch_jb_last_read_accelerated(jb));
+
+	switch_jb_destroy(&jb);
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(jitterbuffer_benchmark)
+{
+	uint32_t frame_sizes[] = { 10, 100 };
+	uint32_t windows[] = { 50, 500 };
+	int loss[] = { 0, 2 };
+	uint32_t read, found;
+	double ns;
+	int f, l, w;
+
+	for (f = 0; f < 2; f++) {
+		for (l = 0; l < 2; l++) {
+			ns = video_bench(65000, frame_sizes[f], 20000, loss[l], &read);
+			fst_check(read > 0);
+			printf("jb video %3u packets/frame %d%% loss: %u/%u read, %8.0f ns/packet\n", frame_sizes[f], loss[l], read, 20000, ns);
+		}
+	}
+
+	for (w = 0; w < 2; w++) {
+		ns = nack_bench(windows[w], 20000, &found);
+		fst_check(found > 0);
+		printf("jb nack queue %3u frames: %u lookups hit, %8.0f ns/packet\n", windows[w], found, ns);
+	}
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_MINCORE_END()
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
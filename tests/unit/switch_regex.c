@@ -0,0 +1,226 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * switch_regex.c -- tests and micro benchmarks for the compiled regex cache
+ *
+ */
+
+#include <stdio.h>
+#include <switch.h>
+#include <test/switch_test.h>
+
+#define DIALPLAN_EXTENSIONS 400
+
+/* a dialplan shaped like the vanilla one grown to 400 extensions, the last one catches everything */
+static char *dialplan[DIALPLAN_EXTENSIONS];
+
+static void dialplan_build(void)
+{
+	int i;
+
+	for (i = 0; i < DIALPLAN_EXTENSIONS - 1; i++) {
+		switch (i % 4) {
+		case 0:
+			dialplan[i] = switch_mprintf("^(%03d)(\\d{4})$", i);
+			break;
+		case 1:
+			dialplan[i] = switch_mprintf("^\\+?1?(%03d)(\\d{7})$", i);
+			break;
+		case 2:
+			dialplan[i] = switch_mprintf("/^%03d[0-9]*#$/i", i);
+			break;
+		default:
+			dialplan[i] = switch_mprintf("^(%03d|9%03d)$", i, i);
+			break;
+		}
+	}
+
+	dialplan[i] = strdup("^(.*)$");
+}
+
+static void dialplan_free(void)
+{
+	int i;
+
+	for (i = 0; i < DIALPLAN_EXTENSIONS; i++) {
+		switch_safe_free(dialplan[i]);
+	}
+}
+
+/* the index of the first extension whose condition matches, walked the way dialplan_hunt walks a context */
+static int dialplan_route(const char *destination_number)
+{
+	switch_regex_t *re = NULL;
+	int ovector[30];
+	char substituted[1024];
+	int i, proceed;
+
+	for (i = 0; i < DIALPLAN_EXTENSIONS; i++) {
+		if ((proceed = switch_regex_perform(destination_number, dialplan[i], &re, ovector, sizeof(ovector) / sizeof(ovector[0])))) {
+			switch_perform_substitution(re, proceed, "$1", destination_number, substituted, sizeof(substituted), ovector);
+			switch_regex_safe_free(re);
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static double dialplan_bench(int calls, int *routes)
+{
+	char destination_number[32];
+	switch_time_t start;
+	int i;
+
+	start = switch_time_now();
+	for (i = 0; i < calls; i++) {
+		switch_snprintf(destination_number, sizeof(destination_number), "%03d%04d", (i * 7) % DIALPLAN_EXTENSIONS, i % 10000);
+		routes[i] = dialplan_route(destination_number);
+	}
+
+	return (double) calls * 1000000 / (double) (switch_time_now() - start + 1);
+}
+
+FST_MINCORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(switch_regex)
+
+FST_SETUP_BEGIN()
+{
+	switch_regex_cache_set_size(SWITCH_REGEX_CACHE_DEFAULT_SIZE, SWITCH_TRUE);
+	switch_regex_cache_flush();
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(cache_shares_compiled_patterns)
+{
+	switch_regex_cache_stats_t before, after;
+	switch_regex_t *re = NULL, *again = NULL;
+	int ovector[30];
+	char buf[32];
+
+	switch_regex_cache_stats(&before);
+
+	fst_check(switch_regex_perform("5551234", "^(555)(\\d+)$", &re, ovector, 30) == 3);
+	fst_check(switch_regex_perform("5559876", "^(555)(\\d+)$", &again, ovector, 30) == 3);
+	fst_check(re == again);
+
+	switch_regex_copy_substring("5559876", ovector, 3, 2, buf, sizeof(buf));
+	fst_check_string_equals(buf, "9876");
+
+	switch_regex_cache_stats(&after);
+	fst_check(after.misses == before.misses + 1);
+	fst_check(after.hits == before.hits + 1);
+
+	/* a handle outlives a flush of the cache it came from */
+	switch_regex_cache_flush();
+	switch_regex_safe_free(again);
+	fst_check(switch_regex_perform("5551234", "^(555)(\\d+)$", &again, ovector, 30) == 3);
+	fst_check(again != re);
+	switch_regex_safe_free(re);
+	switch_regex_safe_free(again);
+
+	/* the flags are part of the key */
+	fst_check(switch_regex_match("ABC", "/^abc$/i") == SWITCH_STATUS_SUCCESS);
+	fst_check(switch_regex_match("ABC", "^abc$") == SWITCH_STATUS_FALSE);
+	fst_check(switch_regex_match("ABC", "/^abc$/i") == SWITCH_STATUS_SUCCESS);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(cache_stays_bounded)
+{
+	switch_regex_cache_stats_t stats;
+	char pattern[32];
+	int i, partial;
+
+	switch_regex_cache_set_size(16, SWITCH_TRUE);
+
+	for (i = 0; i < 100; i++) {
+		switch_snprintf(pattern, sizeof(pattern), "^%d$", i);
+		fst_check(switch_regex_match("42", pattern) == (i == 42 ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE));
+	}
+
+	switch_regex_cache_stats(&stats);
+	fst_check(stats.entries == 16);
+	fst_check(stats.evictions >= 84);
+
+	partial = 1;
+	fst_check(switch_regex_match_partial("55", "^5551234$", &partial) == SWITCH_STATUS_SUCCESS);
+	fst_check(partial == 1);
+	partial = 1;
+	fst_check(switch_regex_match_partial("5551234", "^5551234$", &partial) == SWITCH_STATUS_SUCCESS);
+	fst_check(partial == 0);
+
+	/* a pattern that does not compile is never cached */
+	fst_check(switch_regex_match("(", "(") == SWITCH_STATUS_FALSE);
+	fst_check(switch_regex_match("a", "/a") == SWITCH_STATUS_FALSE);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(dialplan_benchmark)
+{
+	int calls = 2000, i, same = 1;
+	int *cached = malloc(calls * sizeof(int)), *uncached = malloc(calls * sizeof(int));
+	double off, on, jit;
+
+	dialplan_build();
+
+	switch_regex_cache_set_size(0, SWITCH_FALSE);
+	off = dialplan_bench(calls, uncached);
+
+	switch_regex_cache_set_size(SWITCH_REGEX_CACHE_DEFAULT_SIZE, SWITCH_FALSE);
+	switch_regex_cache_flush();
+	dialplan_bench(calls, cached);
+	on = dialplan_bench(calls, cached);
+
+	switch_regex_cache_set_size(SWITCH_REGEX_CACHE_DEFAULT_SIZE, SWITCH_TRUE);
+	switch_regex_cache_flush();
+	dialplan_bench(calls, cached);
+	jit = dialplan_bench(calls, cached);
+
+	for (i = 0; i < calls; i++) {
+		if (cached[i] != uncached[i]) {
+			same = 0;
+		}
+	}
+	fst_check(same);
+
+	printf("regex %d extension dialplan: %.0f routes/sec uncached, %.0f cached, %.0f cached with jit\n", DIALPLAN_EXTENSIONS, off, on, jit);
+
+	dialplan_free();
+	free(cached);
+	free(uncached);
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_MINCORE_END()
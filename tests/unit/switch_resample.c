@@ -0,0 +1,361 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * switch_resample.c -- tests and micro benchmarks for the signed linear helpers
+ *
+ */
+
+#include <stdio.h>
+#include <switch.h>
+#include <test/switch_test.h>
+
+/* the loops mod_conference ran before the mixing kernels */
+static void ref_accumulate(int32_t *mix, const int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		mix[x] += (int32_t) data[x];
+	}
+}
+
+static void ref_subtract(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t x;
+	int32_t z;
+
+	for (x = 0; x < samples; x++) {
+		z = mix[x];
+		if (self && x < self_samples) {
+			z -= (int32_t) self[x];
+		}
+		switch_normalize_to_16bit(z);
+		out[x] = (int16_t) z;
+	}
+}
+
+static void fill_random(int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		data[x] = (int16_t) ((rand() % 65536) - 32768);
+	}
+}
+
+static void fill_tone(int16_t *data, uint32_t samples, uint32_t rate, double freq, uint32_t *phase)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++, (*phase)++) {
+		data[x] = (int16_t) (10000 * sin(2 * M_PI * freq * *phase / rate));
+	}
+}
+
+/* feed one second of a tone through 20ms frames and return the rms of the last half */
+static double resample_tone(uint32_t from_rate, uint32_t to_rate, double freq)
+{
+	switch_audio_resampler_t *resampler = NULL;
+	int16_t frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	uint32_t phase = 0, out_count = 0;
+	double energy = 0;
+	int f, ok = 1;
+
+	if (switch_resample_create(&resampler, from_rate, to_rate, from_rate / 50 * 2, SWITCH_RESAMPLE_QUALITY, 1) != SWITCH_STATUS_SUCCESS) {
+		return -1;
+	}
+
+	for (f = 0; f < 50; f++) {
+		uint32_t out, x;
+
+		fill_tone(frame, from_rate / 50, from_rate, freq, &phase);
+		out = switch_resample_process(resampler, frame, from_rate / 50);
+
+		if (out != to_rate / 50) {
+			ok = 0;
+		}
+
+		if (f >= 25) {
+			for (x = 0; x < out; x++) {
+				energy += (double) resampler->to[x] * resampler->to[x];
+			}
+			out_count += out;
+		}
+	}
+
+	switch_resample_destroy(&resampler);
+
+	return ok && out_count ? sqrt(energy / out_count) : -1;
+}
+
+FST_MINCORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(switch_resample)
+
+FST_SETUP_BEGIN()
+{
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(mix_kernel_matches_scalar)
+{
+	int16_t a[SWITCH_RECOMMENDED_BUFFER_SIZE], b[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int16_t out[SWITCH_RECOMMENDED_BUFFER_SIZE], ref_out[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int32_t mix[SWITCH_RECOMMENDED_BUFFER_SIZE], ref_mix[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int i;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "mixing kernel: %s\n", switch_mix_sln_kernel_name());
+
+	for (i = 0; i < 500; i++) {
+		uint32_t samples = rand() % 1921;
+		uint32_t self_samples = rand() % (samples + 1);
+		uint32_t x;
+
+		fill_random(a, samples);
+		fill_random(b, samples);
+
+		for (x = 0; x < samples; x++) {
+			mix[x] = ref_mix[x] = (rand() % 400000) - 200000;
+		}
+
+		switch_mix_sln_accumulate(mix, a, samples);
+		ref_accumulate(ref_mix, a, samples);
+		fst_check(!memcmp(mix, ref_mix, samples * sizeof(int32_t)));
+
+		switch_mix_sln_subtract(out, mix, b, self_samples, samples);
+		ref_subtract(ref_out, ref_mix, b, self_samples, samples);
+		fst_check(!memcmp(out, ref_out, samples * sizeof(int16_t)));
+
+		switch_mix_sln_subtract(out, mix, NULL, 0, samples);
+		ref_subtract(ref_out, ref_mix, NULL, 0, samples);
+		fst_check(!memcmp(out, ref_out, samples * sizeof(int16_t)));
+	}
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(accelerate_cuts_whole_periods)
+{
+	int16_t data[320];
+	uint32_t samples, i;
+	int max_step = 0;
+
+	/* 200hz at 8khz, 40 samples a period */
+	for (i = 0; i < 320; i++) {
+		data[i] = (int16_t) (8000 * sin(2 * M_PI * i / 40));
+	}
+
+	samples = switch_accelerate_sln(data, 320, 160, 8000);
+	fst_check(samples == 160);
+
+	for (i = 1; i < samples; i++) {
+		int step = abs(data[i] - data[i - 1]);
+
+		if (step > max_step) {
+			max_step = step;
+		}
+	}
+
+	/* no click where the cut is, a sample never moves more than the sine itself does */
+	fst_check(max_step <= (int) (8000 * 2 * M_PI / 40) + 2);
+
+	memset(data, 0, sizeof(data));
+	fst_check(switch_accelerate_sln(data, 320, 160, 8000) == 160);
+	fst_check(switch_accelerate_sln(data, 320, 0, 8000) == 320);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(resample_polyphase_keeps_tone)
+{
+	uint32_t rates[] = { 8000, 16000, 32000, 48000 };
+	int i, j;
+
+	/* a 1khz tone survives every conversion at its full 7071 rms, 20ms in gives 20ms out */
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			double rms;
+
+			if (i == j) continue;
+
+			rms = resample_tone(rates[i], rates[j], 1000);
+			fst_check(rms > 6900 && rms < 7250);
+		}
+	}
+
+	/* 6khz is above the 8k nyquist and has to be filtered out going down */
+	fst_check(resample_tone(48000, 8000, 6000) >= 0);
+	fst_check(resample_tone(48000, 8000, 6000) < 20);
+	fst_check(resample_tone(16000, 8000, 6000) < 20);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(resample_cache_reuses_handles)
+{
+	switch_audio_resampler_t *a = NULL, *b = NULL, *first;
+	uint32_t hits, misses, idle, hits_after;
+	int16_t frame[960] = { 0 };
+
+	fst_requires(switch_resample_create(&a, 8000, 48000, 320, SWITCH_RESAMPLE_QUALITY, 1) == SWITCH_STATUS_SUCCESS);
+	fst_check(switch_resample_process(a, frame, 160) == 960);
+	first = a;
+	switch_resample_destroy(&a);
+	fst_check(a == NULL);
+
+	switch_resample_cache_stats(&hits, &misses, &idle);
+	fst_check(idle >= 1);
+
+	/* same rates come back out of the cache, with a bigger buffer if one is asked for */
+	fst_requires(switch_resample_create(&a, 8000, 48000, 640, SWITCH_RESAMPLE_QUALITY, 1) == SWITCH_STATUS_SUCCESS);
+	switch_resample_cache_stats(&hits_after, NULL, NULL);
+	fst_check(a == first);
+	fst_check(hits_after == hits + 1);
+	fst_check(a->to_size >= 1920);
+	fst_check(a->to_len == 0);
+
+	/* other rates and stereo do not */
+	fst_requires(switch_resample_create(&b, 8000, 16000, 320, SWITCH_RESAMPLE_QUALITY, 2) == SWITCH_STATUS_SUCCESS);
+	fst_check(b != first);
+	fst_check(b->polyphase == NULL);
+	fst_check(switch_resample_process(b, frame, 160) > 0);
+
+	switch_resample_destroy(&a);
+	switch_resample_destroy(&b);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(resample_benchmark)
+{
+	uint32_t pairs[][2] = { { 8000, 16000 }, { 16000, 8000 }, { 8000, 48000 }, { 48000, 8000 }, { 16000, 48000 }, { 48000, 16000 } };
+	int16_t frame[960];
+	int p, l, loops = 500;
+
+	fill_random(frame, 960);
+
+	for (p = 0; p < 6; p++) {
+		uint32_t from_rate = pairs[p][0], to_rate = pairs[p][1];
+		double rate[2];
+		int pass;
+
+		/* pass 0 is the polyphase filter, pass 1 the speex path every conversion took before */
+		for (pass = 0; pass < 2; pass++) {
+			switch_audio_resampler_t *resampler = NULL;
+			switch_time_t start, elapsed;
+
+			switch_resample_set_polyphase(pass == 0);
+			fst_requires(switch_resample_create(&resampler, from_rate, to_rate, from_rate / 50 * 2, SWITCH_RESAMPLE_QUALITY, 1) == SWITCH_STATUS_SUCCESS);
+			fst_check((resampler->polyphase != NULL) == (pass == 0));
+
+			start = switch_time_now();
+			for (l = 0; l < loops; l++) {
+				switch_resample_process(resampler, frame, from_rate / 50);
+			}
+			elapsed = switch_time_now() - start;
+			rate[pass] = elapsed > 0 ? (double) from_rate / 50 * loops * 1000000 / elapsed : 0;
+
+			switch_resample_destroy(&resampler);
+		}
+
+		printf("resample %5u -> %5uhz: polyphase/%s %12.0f samples/sec, speex %12.0f samples/sec (%.2fx)\n",
+			   from_rate, to_rate, switch_mix_sln_kernel_name(), rate[0], rate[1], rate[1] > 0 ? rate[0] / rate[1] : 0);
+	}
+
+	switch_resample_set_polyphase(SWITCH_TRUE);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(mix_kernel_benchmark)
+{
+	uint32_t rates[] = { 8000, 16000, 48000 };
+	uint32_t member_counts[] = { 10, 100, 1000 };
+	int r, m, loops = 50;
+
+	for (r = 0; r < 3; r++) {
+		uint32_t samples = rates[r] / 50;
+
+		for (m = 0; m < 3; m++) {
+			uint32_t members = member_counts[m], i;
+			int16_t *frames = malloc(members * samples * sizeof(int16_t));
+			int16_t out[SWITCH_RECOMMENDED_BUFFER_SIZE];
+			int32_t mix[SWITCH_RECOMMENDED_BUFFER_SIZE];
+			switch_time_t start;
+			double kernel_ns, scalar_ns;
+			int l;
+
+			fst_requires(frames);
+			fill_random(frames, members * samples);
+
+			/* one conference tick: every member speaks, every member gets the mix minus itself */
+			start = switch_time_now();
+			for (l = 0; l < loops; l++) {
+				memset(mix, 0, samples * sizeof(int32_t));
+				for (i = 0; i < members; i++) {
+					switch_mix_sln_accumulate(mix, frames + i * samples, samples);
+				}
+				for (i = 0; i < members; i++) {
+					switch_mix_sln_subtract(out, mix, frames + i * samples, samples, samples);
+				}
+			}
+			kernel_ns = (switch_time_now() - start) * 1000.0 / loops;
+
+			start = switch_time_now();
+			for (l = 0; l < loops; l++) {
+				memset(mix, 0, samples * sizeof(int32_t));
+				for (i = 0; i < members; i++) {
+					ref_accumulate(mix, frames + i * samples, samples);
+				}
+				for (i = 0; i < members; i++) {
+					ref_subtract(out, mix, frames + i * samples, samples, samples);
+				}
+			}
+			scalar_ns = (switch_time_now() - start) * 1000.0 / loops;
+
+			printf("mix %5uhz %4u members: %s %10.0f ns/frame, scalar %10.0f ns/frame (%.2fx)\n",
+				   rates[r], members, switch_mix_sln_kernel_name(), kernel_ns, scalar_ns, kernel_ns > 0 ? scalar_ns / kernel_ns : 0);
+
+			free(frames);
+		}
+	}
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_MINCORE_END()
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -16,6 +16,95 @@ switch_frame_flag_t *frame_flags;
 switch_io_flag_t io_flags;
 switch_payload_t read_pt;
 
+#define BENCH_SESSIONS 32
+#define BENCH_PACKETS 4
+#define BENCH_ROUNDS 500
+
+/* blast BENCH_PACKETS packets at every session per round and read them back, returns packets per cpu second or -1 */
+static double rtp_io_bench(switch_memory_pool_t *bench_pool, switch_port_t base_port, uint32_t *received)
+{
+	switch_rtp_t *sessions[BENCH_SESSIONS] = { 0 };
+	switch_sockaddr_t *addrs[BENCH_SESSIONS] = { 0 };
+	switch_rtp_flag_t bench_flags[SWITCH_RTP_FLAG_INVALID] = { 0 };
+	switch_socket_t *sock = NULL;
+	switch_sockaddr_t *local = NULL;
+	switch_rtp_packet_t packet = { { 0 } };
+	switch_frame_t frame = { 0 };
+	switch_size_t len;
+	clock_t start;
+	int i, r, p, tries;
+	double cpu, rate = -1;
+
+	*received = 0;
+	bench_flags[SWITCH_RTP_FLAG_NOBLOCK] = 1;
+
+	for (i = 0; i < BENCH_SESSIONS; i++) {
+		switch_port_t port = base_port + (i * 2);
+
+		sessions[i] = switch_rtp_new(rx_host, port, tx_host, tx_port, TEST_PT, 8000, 20 * 1000, bench_flags, "soft", &err, bench_pool, 0, 0);
+		if (!switch_rtp_ready(sessions[i])) {
+			goto end;
+		}
+		switch_sockaddr_info_get(&addrs[i], rx_host, SWITCH_UNSPEC, port, 0, bench_pool);
+	}
+
+	switch_sockaddr_info_get(&local, tx_host, SWITCH_UNSPEC, 0, 0, bench_pool);
+	if (switch_socket_create(&sock, switch_sockaddr_get_family(local), SOCK_DGRAM, 0, bench_pool) != SWITCH_STATUS_SUCCESS ||
+		switch_socket_bind(sock, local) != SWITCH_STATUS_SUCCESS) {
+		goto end;
+	}
+
+	packet.header.version = 2;
+	packet.header.pt = TEST_PT;
+	packet.header.ssrc = htonl(0x1234);
+	memset(packet.body, 0xd5, 160);
+
+	start = clock();
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (p = 0; p < BENCH_PACKETS; p++) {
+			uint32_t seq = r * BENCH_PACKETS + p;
+
+			packet.header.seq = htons((uint16_t) seq);
+			packet.header.ts = htonl(seq * 160);
+
+			for (i = 0; i < BENCH_SESSIONS; i++) {
+				len = 12 + 160;
+				switch_socket_sendto(sock, addrs[i], 0, (void *) &packet, &len);
+			}
+		}
+
+		for (i = 0; i < BENCH_SESSIONS; i++) {
+			for (p = 0, tries = 0; p < BENCH_PACKETS && tries < BENCH_PACKETS * 2; tries++) {
+				if (switch_rtp_zerocopy_read_frame(sessions[i], &frame, SWITCH_IO_FLAG_NONE) != SWITCH_STATUS_SUCCESS) {
+					break;
+				}
+				if (frame.datalen && !switch_test_flag((&frame), SFF_CNG)) {
+					(*received)++;
+					p++;
+				}
+			}
+		}
+	}
+
+	cpu = (double) (clock() - start) / CLOCKS_PER_SEC;
+	rate = cpu > 0 ? *received / cpu : 0;
+
+ end:
+
+	if (sock) {
+		switch_socket_close(sock);
+	}
+
+	for (i = 0; i < BENCH_SESSIONS; i++) {
+		if (sessions[i]) {
+			switch_rtp_destroy(&sessions[i]);
+		}
+	}
+
+	return rate;
+}
+
 FST_CORE_BEGIN("./conf")
 {
 FST_SUITE_BEGIN(switch_rtp)
@@ -96,6 +185,122 @@ FST_TEARDOWN_END()
 		switch_core_destroy_memory_pool(&pool);
 	}
 	FST_TEST_END()
+
+	FST_TEST_BEGIN(test_rtp_io_engine_benchmark)
+	{
+		uint32_t plain_received, engine_received;
+		double plain_rate, engine_rate;
+
+		switch_core_new_memory_pool(&pool);
+
+		plain_rate = rtp_io_bench(pool, 24000, &plain_received);
+		fst_requires(plain_rate >= 0);
+		fst_check(plain_received == BENCH_SESSIONS * BENCH_PACKETS * BENCH_ROUNDS);
+
+		if (switch_rtp_io_engine_start(2) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "RTP io engine not available, only the per session path was measured\n");
+			printf("rtp read per session: %u packets, %.0f packets/cpu sec\n", plain_received, plain_rate);
+		} else {
+			engine_rate = rtp_io_bench(pool, 24000 + (BENCH_SESSIONS * 2), &engine_received);
+			switch_rtp_io_engine_stop();
+			fst_requires(engine_rate >= 0);
+			fst_check(engine_received == BENCH_SESSIONS * BENCH_PACKETS * BENCH_ROUNDS);
+
+			printf("rtp read per session: %u packets, %.0f packets/cpu sec; io engine: %u packets, %.0f packets/cpu sec (%.2fx)\n",
+				   plain_received, plain_rate, engine_received, engine_rate, plain_rate > 0 ? engine_rate / plain_rate : 0);
+		}
+
+		switch_core_destroy_memory_pool(&pool);
+	}
+	FST_TEST_END()
+
+	FST_TEST_BEGIN(test_rtp_shared_port)
+	{
+		switch_rtp_t *sessions[2] = { 0 };
+		switch_socket_t *socks[2] = { 0 };
+		switch_rtp_flag_t shared_flags[SWITCH_RTP_FLAG_INVALID] = { 0 };
+		switch_sockaddr_t *addr = NULL, *local = NULL;
+		switch_rtp_packet_t packet = { { 0 } };
+		switch_frame_t frame = { 0 };
+		switch_port_t port;
+		switch_size_t len;
+		int i, tries;
+
+		if (switch_rtp_io_engine_start(1) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "RTP io engine not available, skipping the shared port test\n");
+		} else {
+			switch_core_new_memory_pool(&pool);
+			shared_flags[SWITCH_RTP_FLAG_NOBLOCK] = 1;
+
+			port = switch_rtp_request_shared_port(rx_host, 1);
+			fst_requires(port);
+			fst_check(switch_rtp_port_is_shared(rx_host, port));
+			fst_check(switch_rtp_request_shared_port(rx_host, 1) == port);
+			switch_sockaddr_info_get(&addr, rx_host, SWITCH_UNSPEC, port, 0, pool);
+
+			/* two calls on one port, told apart by the address they talk to */
+			for (i = 0; i < 2; i++) {
+				sessions[i] = switch_rtp_new(rx_host, port, tx_host, tx_port + 10 + (i * 2), TEST_PT, 8000, 20 * 1000, shared_flags, "soft", &err, pool, 0, 0);
+				fst_requires(switch_rtp_ready(sessions[i]));
+
+				switch_sockaddr_info_get(&local, tx_host, SWITCH_UNSPEC, tx_port + 10 + (i * 2), 0, pool);
+				fst_requires(switch_socket_create(&socks[i], switch_sockaddr_get_family(local), SOCK_DGRAM, 0, pool) == SWITCH_STATUS_SUCCESS);
+				fst_requires(switch_socket_bind(socks[i], local) == SWITCH_STATUS_SUCCESS);
+			}
+
+			packet.header.version = 2;
+			packet.header.pt = TEST_PT;
+
+			for (i = 0; i < 2; i++) {
+				packet.header.ssrc = htonl(0x1000 + i);
+				memset(packet.body, 0x10 + i, 160);
+				len = 12 + 160;
+				switch_socket_sendto(socks[i], addr, 0, (void *) &packet, &len);
+			}
+
+			for (i = 0; i < 2; i++) {
+				for (tries = 0; tries < 10; tries++) {
+					memset(&frame, 0, sizeof(frame));
+					if (switch_rtp_zerocopy_read_frame(sessions[i], &frame, SWITCH_IO_FLAG_NONE) != SWITCH_STATUS_SUCCESS ||
+						(frame.datalen && !switch_test_flag((&frame), SFF_CNG))) {
+						break;
+					}
+				}
+				fst_check(frame.datalen == 160);
+				fst_check(frame.datalen && ((uint8_t *) frame.data)[0] == 0x10 + i);
+			}
+
+			/* a packet reusing the first call's SSRC from the second call's address stays with the second call */
+			packet.header.ssrc = htonl(0x1000);
+			packet.header.seq = htons(1);
+			packet.header.ts = htonl(160);
+			memset(packet.body, 0x30, 160);
+			len = 12 + 160;
+			switch_socket_sendto(socks[1], addr, 0, (void *) &packet, &len);
+
+			for (tries = 0; tries < 10; tries++) {
+				memset(&frame, 0, sizeof(frame));
+				if (switch_rtp_zerocopy_read_frame(sessions[1], &frame, SWITCH_IO_FLAG_NONE) != SWITCH_STATUS_SUCCESS ||
+					(frame.datalen && !switch_test_flag((&frame), SFF_CNG))) {
+					break;
+				}
+			}
+			fst_check(frame.datalen && ((uint8_t *) frame.data)[0] == 0x30);
+
+			for (i = 0; i < 2; i++) {
+				switch_socket_close(socks[i]);
+				switch_rtp_destroy(&sessions[i]);
+			}
+
+			/* the port stays with the engine until it stops */
+			fst_check(switch_rtp_port_is_shared(rx_host, port));
+			switch_rtp_io_engine_stop();
+			fst_check(!switch_rtp_port_is_shared(rx_host, port));
+
+			switch_core_destroy_memory_pool(&pool);
+		}
+	}
+	FST_TEST_END()
 }
 FST_SUITE_END()
 }